@@ -0,0 +1,75 @@
+#ifndef RECORD_FORMAT_H
+#define RECORD_FORMAT_H
+
+#include <stdint.h>
+
+/*
+ * Binary encoding of the FCT, PFC and qlen outputs (OUTPUT_FORMAT binary,
+ * see RecordSink) and of the checkpoints (CHECKPOINT_SAVE_FILE). A file starts
+ * with a RecordFileHeader and the records follow back to back, in the byte
+ * order of the machine that wrote them. analysis/record_reader prints them
+ * as the text the simulation writes otherwise; it has a copy of this file.
+ */
+namespace ns3{
+
+enum RecordKind{
+	RecordFct = 1,
+	RecordPfc = 2,
+	RecordQlen = 3,
+	RecordCheckpoint = 4
+};
+
+static const uint32_t RecordMagic = 0x7273636e; // "ncsr"
+static const uint16_t RecordVersion = 1;
+
+struct RecordFileHeader{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t kind; // RecordKind
+};
+
+// a finished flow
+struct FctRecord{
+	uint32_t sip, dip;
+	uint16_t sport, dport;
+	uint32_t nackRecv; // NACKs received
+	uint64_t size; // bytes
+	uint64_t startTime, fct, standaloneFct; // ns
+	uint32_t retxCnt, reserved; // go-back-N recoveries
+	uint64_t retxBytes; // bytes sent again
+};
+
+// a PFC pause (type 1) or resume (type 0) received
+struct PfcRecord{
+	uint64_t time;
+	uint32_t node, nodeType, ifIndex, type;
+};
+
+/*
+ * a dump of the queue length distributions: a QlenDumpRecord followed by
+ * nPorts QlenPortRecords, each followed by its n counters (uint32_t, the
+ * i-th is the number of samples with a queue length of i KB)
+ */
+struct QlenDumpRecord{
+	uint64_t time;
+	uint32_t nPorts, reserved;
+};
+struct QlenPortRecord{
+	uint32_t node, port, n;
+};
+
+/*
+ * a checkpoint (CHECKPOINT_SAVE_FILE): a CheckpointRecord followed by the
+ * size bytes of the saved state, which only a run of the same config reads
+ * back (CHECKPOINT_RESTORE_FILE, see CheckpointWriter)
+ */
+struct CheckpointRecord{
+	uint64_t time, events; // ns, events run so far
+	uint32_t seed, run; // of the RngSeedManager
+	uint32_t nEvents, nPackets; // pending events, distinct packets in the queues and on the links
+	uint64_t size; // bytes
+};
+
+}
+
+#endif /* RECORD_FORMAT_H */
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "record-format.h"
+
+using namespace ns3;
+using namespace std;
+
+// print the records of a binary FCT, PFC or qlen output as the simulation writes them with OUTPUT_FORMAT text,
+// or the content of a checkpoint (CHECKPOINT_FILE), one line per QP, rx QP and queue.
+// With -loss, the FCT lines also have the loss counters of the flow (NACKs received, retransmissions, retransmitted bytes)
+int main(int argc, char** argv){
+	bool loss = argc == 3 && string(argv[1]) == "-loss";
+	if (argc != 2 && !loss){
+		printf("Usage: ./record_reader [-loss] <binary fct/pfc/qlen or checkpoint file>\n");
+		return 0;
+	}
+	const char *name = argv[argc - 1];
+	FILE* file = fopen(name, "r");
+	if (file == NULL){
+		perror(name);
+		return 1;
+	}
+	RecordFileHeader h;
+	if (fread(&h, sizeof(h), 1, file) != 1 || h.magic != RecordMagic){
+		fprintf(stderr, "%s is not a binary record file\n", name);
+		return 1;
+	}
+	if (h.version != RecordVersion){
+		fprintf(stderr, "%s has version %u, this reader knows version %u\n", name, h.version, RecordVersion);
+		return 1;
+	}
+	if (h.kind == RecordFct){
+		FctRecord r;
+		while (fread(&r, sizeof(r), 1, file) == 1){
+			printf("%08x %08x %u %u %lu %lu %lu %lu", r.sip, r.dip, r.sport, r.dport, r.size, r.startTime, r.fct, r.standaloneFct);
+			if (loss)
+				printf(" %u %u %lu", r.nackRecv, r.retxCnt, r.retxBytes);
+			printf("\n");
+		}
+	}else if (h.kind == RecordPfc){
+		PfcRecord r;
+		while (fread(&r, sizeof(r), 1, file) == 1)
+			printf("%lu %u %u %u %u\n", r.time, r.node, r.nodeType, r.ifIndex, r.type);
+	}else if (h.kind == RecordQlen){
+		QlenDumpRecord d;
+		vector<uint32_t> cnt;
+		while (fread(&d, sizeof(d), 1, file) == 1){
+			printf("time: %lu\n", d.time);
+			for (uint32_t i = 0; i < d.nPorts; i++){
+				QlenPortRecord r;
+				if (fread(&r, sizeof(r), 1, file) != 1)
+					break;
+				cnt.resize(r.n);
+				if (r.n > 0 && fread(cnt.data(), sizeof(uint32_t), r.n, file) != r.n)
+					break;
+				printf("%u %u", r.node, r.port);
+				for (uint32_t j = 0; j < r.n; j++)
+					printf(" %u", cnt[j]);
+				printf("\n");
+			}
+		}
+	}else if (h.kind == RecordCheckpoint){
+		CheckpointRecord c;
+		if (fread(&c, sizeof(c), 1, file) == 1) // the state is only read back by the simulation
+			printf("time: %lu events: %lu seed: %u run: %u pending: %u packets: %u bytes: %lu\n", c.time, c.events, c.seed, c.run, c.nEvents, c.nPackets, c.size);
+	}else{
+		fprintf(stderr, "%s: unknown record kind %u\n", name, h.kind);
+		return 1;
+	}
+	fclose(file);
+	return 0;
+}
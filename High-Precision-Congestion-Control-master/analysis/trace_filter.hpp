@@ -10,6 +10,22 @@
 
 class TraceFilter{
 public:
+	/**********************************
+	 * when a field is known while capturing a trace,
+	 * so the simulator can skip work once the result is decided
+	 **********************************/
+	enum Stage{
+		DEVICE = 0,	// node, nodeType, intf, event: known when connecting the trace source
+		EVENT = 1,	// time, qidx, qlen: known when the event fires
+		PEEK = 2,	// addresses, ports, l3Prot, size, ecn: read from fixed offsets of the packet
+		PARSE = 3	// the rest needs the full header parse
+	};
+	enum Result{
+		FAIL = 0,
+		PASS = 1,
+		UNKNOWN = 2
+	};
+
 	/**********************************
 	 * classes for test a single field
 	 **********************************/
@@ -17,9 +33,11 @@ public:
 	public:
 		uint32_t offset; // data offset in TraceFormat
 		uint8_t op;
+		uint8_t stage;
 
 		Field(uint32_t _offset, std::string &_op){
 			offset = _offset;
+			stage = PARSE;
 			if (_op == "=")
 				op = 0;
 			else if (_op == ">")
@@ -146,6 +164,28 @@ public:
 				return son[0]->test(tr) || son[1]->test(tr);
 			return false;
 		}
+		// test with only the fields up to stage `known` filled in
+		int test(ns3::TraceFormat &tr, uint8_t known){
+			if (type == 0){
+				if (f->stage > known)
+					return UNKNOWN;
+				return f->test(tr) ? PASS : FAIL;
+			}
+			int a = son[0]->test(tr, known);
+			if (type == 1){
+				if (a == FAIL)
+					return FAIL;
+				int b = son[1]->test(tr, known);
+				return b == FAIL ? FAIL : (a == PASS && b == PASS ? PASS : UNKNOWN);
+			}
+			if (type == 2){
+				if (a == PASS)
+					return PASS;
+				int b = son[1]->test(tr, known);
+				return b == PASS ? PASS : (a == FAIL && b == FAIL ? FAIL : UNKNOWN);
+			}
+			return FAIL;
+		}
 		void clear(){
 			if (son[0]){
 				son[0]->clear();
@@ -175,6 +215,12 @@ public:
 			return root->test(tr);
 		return true;
 	}
+	// test a partially filled trace, see Stage
+	int test(ns3::TraceFormat &tr, uint8_t known){
+		if (root)
+			return root->test(tr, known);
+		return PASS;
+	}
 
 	// parse an filter expression
 	void parse(std::string expr){
@@ -231,6 +277,14 @@ public:
 		}else if (field == "qp.dport"){
 			f = new WordField(offsetof(ns3::TraceFormat, qp.dport), op, v);
 		}
+		if (f){
+			if (field == "node" || field == "nodeType" || field == "intf" || field == "event")
+				f->stage = DEVICE;
+			else if (field == "time" || field == "qidx" || field == "qlen")
+				f->stage = EVENT;
+			else if (field != "data.seq" && field != "ack.flags")
+				f->stage = PEEK;
+		}
 		return f;
 	}
 	
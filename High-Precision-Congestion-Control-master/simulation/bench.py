@@ -0,0 +1,321 @@
+#!/usr/bin/env python
+"""Simulator performance benchmark.
+
+Runs scratch/third on a fixed set of scenarios and reports, per scenario:
+events/s, simulated ns per wall second, peak RSS and the wall time of each
+phase (config, topology, routing, setup, run, teardown), from the "perf:"
+lines that third prints at the end of a run.
+
+The scenarios are generated with fixed seeds, so the event count of a
+scenario only changes when the simulated behavior changes.
+
+Results are written as JSON; --baseline compares against an earlier result
+and exits with 1 if a scenario got slower than --threshold.
+
+Examples:
+  python bench.py                                # all scenarios
+  python bench.py -s dumbbell,incast -r 5 -o new.json
+  python bench.py -b old.json -o new.json        # regression check
+"""
+from __future__ import print_function
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'traffic_gen'))
+from custom_rand import CustomRand
+
+TRAFFIC_GEN = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'traffic_gen')
+
+def read_topology_header(path):
+	with open(path) as f:
+		return f.readline().split()
+
+def fat_tree(path, k, bw, delay):
+	"""k-ary fat-tree: hosts 0..k^3/4-1, then edge, aggregation and core switches"""
+	nhost = k * k * k // 4
+	nedge = nagg = k * k // 2
+	ncore = k * k // 4
+	edge0, agg0, core0 = nhost, nhost + nedge, nhost + nedge + nagg
+	links = []
+	for h in range(nhost):
+		links.append((h, edge0 + h // (k // 2)))
+	for pod in range(k):
+		for e in range(k // 2):
+			for a in range(k // 2):
+				links.append((edge0 + pod * k // 2 + e, agg0 + pod * k // 2 + a))
+		for a in range(k // 2):
+			for c in range(k // 2):
+				links.append((agg0 + pod * k // 2 + a, core0 + a * k // 2 + c))
+	switches = range(nhost, nhost + nedge + nagg + ncore)
+	with open(path, 'w') as f:
+		f.write('%d %d 0 %d\n' % (nhost + len(switches), len(switches), len(links)))
+		f.write(' '.join(str(s) for s in switches) + '\n')
+		for a, b in links:
+			f.write('%d %d %s %s 0\n' % (a, b, bw, delay))
+	return nhost
+
+def copy_topology(src, dst):
+	"""copy a topology, adding the border router count (0) to the old 3-field header"""
+	with open(src) as f:
+		lines = f.readlines()
+	head = lines[0].split()
+	if len(head) == 3:
+		lines[0] = '%s %s 0 %s\n' % tuple(head)
+	with open(dst, 'w') as f:
+		f.writelines(lines)
+	return int(head[0]) - int(head[1])
+
+def write_flows(path, flows):
+	with open(path, 'w') as f:
+		f.write('%d\n' % len(flows))
+		for src, dst, size, t in sorted(flows, key=lambda x: x[3]):
+			f.write('%d %d 0 100 %d %.9f\n' % (src, dst, size, t))
+
+def poisson_flows(rng, nhost, cdf_file, load, bps, duration):
+	"""open-loop Poisson arrivals with sizes from cdf_file, like traffic_gen.py"""
+	cdf = []
+	with open(os.path.join(TRAFFIC_GEN, cdf_file)) as f:
+		for line in f:
+			if line.strip():
+				x, y = map(float, line.split())
+				cdf.append([x, y])
+	size_rand = CustomRand()
+	size_rand.setCdf(cdf)
+	avg_gap = size_rand.getAvg() * 8 / (bps * load) # seconds
+	flows = []
+	for src in range(nhost):
+		t = 2.0 + rng.expovariate(1 / avg_gap)
+		while t < 2.0 + duration:
+			dst = rng.randrange(nhost - 1)
+			if dst >= src:
+				dst += 1
+			size = max(int(size_rand.getValueFromPercentile(rng.random() * 100)), 1)
+			flows.append((src, dst, size, t))
+			t += rng.expovariate(1 / avg_gap)
+	return flows
+
+# name -> (description, function(dir, rng) -> (topology file, flow file, stop time))
+def scenario_dumbbell(d, rng):
+	return 'mix/topology.txt', 'mix/flow.txt', 2.1
+
+def scenario_ali(d, rng):
+	topo = os.path.join(d, 'topology.txt')
+	nhost = copy_topology('mix/ali_32host_10rack.txt', topo)
+	flows = poisson_flows(rng, nhost, 'AliStorage2019.txt', 0.3, 25e9, 0.0002)
+	write_flows(os.path.join(d, 'flow.txt'), flows)
+	return topo, os.path.join(d, 'flow.txt'), 2.002
+
+def scenario_incast(d, rng):
+	topo = os.path.join(d, 'topology.txt')
+	nhost = fat_tree(topo, 8, '100Gbps', '1000ns')
+	senders = rng.sample(range(1, nhost), 32)
+	write_flows(os.path.join(d, 'flow.txt'), [(s, 0, 500000, 2.0) for s in senders])
+	return topo, os.path.join(d, 'flow.txt'), 2.01
+
+def scenario_websearch(d, rng):
+	topo = os.path.join(d, 'topology.txt')
+	nhost = fat_tree(topo, 8, '100Gbps', '1000ns')
+	flows = poisson_flows(rng, nhost, 'WebSearch_distribution.txt', 0.3, 100e9, 0.0005)
+	write_flows(os.path.join(d, 'flow.txt'), flows)
+	return topo, os.path.join(d, 'flow.txt'), 2.002
+
+SCENARIOS = [
+	('dumbbell', 'mix/topology.txt with mix/flow.txt', scenario_dumbbell),
+	('ali', 'ali_32host_10rack, AliStorage2019 sizes at 30% load', scenario_ali),
+	('incast', 'k=8 fat-tree, 32-to-1 incast of 500KB', scenario_incast),
+	('websearch', 'k=8 fat-tree, WebSearch sizes at 30% load', scenario_websearch),
+]
+
+def write_config(path, base, overrides):
+	"""base config with the keys in overrides replaced (or added)"""
+	lines = []
+	seen = set()
+	with open(base) as f:
+		for line in f:
+			key = line.split()[0] if line.split() else ''
+			if key in overrides:
+				lines.append('%s %s\n' % (key, overrides[key]))
+				seen.add(key)
+			else:
+				lines.append(line)
+	for key in sorted(overrides):
+		if key not in seen:
+			lines.append('%s %s\n' % (key, overrides[key]))
+	with open(path, 'w') as f:
+		f.writelines(lines)
+
+def profile_module(function):
+	"""the class of an event_profile function name, e.g. QbbNetDevice for
+	ns3::QbbNetDevice::DequeueAndTransmit(), or the function if it is not a member"""
+	if function.startswith('(cancelled)'):
+		return '(cancelled)'
+	if function.startswith('0x'): # not resolved, "<address> <event class>"
+		return '(unknown)'
+	name = function.split('(')[0]
+	if name.startswith('ns3::'):
+		name = name[5:]
+	return name.rsplit('::', 1)[0]
+
+def parse_perf(log):
+	"""the "perf:", "perf_phase:", "event_profile:" and "mem_profile:" lines of all ranks"""
+	res = {'events': 0, 'sim_ns': 0, 'wall': 0.0, 'maxrss_kb': 0, 'ranks': 0, 'phases': {}}
+	functions = {}
+	memory = {}
+	for line in log.splitlines():
+		w = line.split()
+		if not w:
+			continue
+		if w[0] == 'perf:':
+			v = dict(zip(w[3::2], w[4::2]))
+			res['ranks'] += 1
+			res['events'] += int(v['events'])
+			res['sim_ns'] = max(res['sim_ns'], int(v['sim_ns']))
+			res['wall'] = max(res['wall'], float(v['wall']))
+			res['maxrss_kb'] = max(res['maxrss_kb'], int(v['maxrss_kb']))
+		elif w[0] == 'perf_phase:':
+			res['phases'][w[3]] = max(res['phases'].get(w[3], 0.0), float(w[4]))
+		elif w[0] == 'event_profile:' and w[2] != 'total':
+			# event_profile: <rank> <events> <cancelled> <cycles> <%> <cycles/event> <ns> <function>
+			f = line.split(None, 8)[8]
+			e = functions.setdefault(f, [0, 0])
+			e[0] += int(w[2])
+			e[1] += int(w[4])
+		elif w[0] == 'mem_profile:' and w[2] != 'total':
+			# mem_profile: <rank> <live objects> <live bytes> <peak bytes> <allocs> <category> [+]
+			m = memory.setdefault(w[6], 0)
+			memory[w[6]] = m + int(w[4])
+	if memory:
+		# built with --enable-mem-profile: peak bytes per category, summed over ranks
+		res['memory'] = [{'name': c, 'peak': b} for c, b in sorted(memory.items(), key=lambda x: -x[1])]
+	if functions:
+		# built with --enable-event-profile: cycles per function and per class, summed over ranks
+		total = float(sum(c for n, c in functions.values())) or 1
+		modules = {}
+		for f, (n, c) in functions.items():
+			m = modules.setdefault(profile_module(f), [0, 0])
+			m[0] += n
+			m[1] += c
+		res['profile'] = {
+			'functions': [{'name': f, 'events': n, 'share': c / total}
+				for f, (n, c) in sorted(functions.items(), key=lambda x: -x[1][1])],
+			'modules': [{'name': m, 'events': n, 'share': c / total}
+				for m, (n, c) in sorted(modules.items(), key=lambda x: -x[1][1])]}
+	return res
+
+def run_scenario(args, name, fn):
+	d = os.path.join(args.out, name)
+	if not os.path.isdir(d):
+		os.makedirs(d)
+	rng = random.Random(args.seed)
+	topo, flow, stop = fn(d, rng)
+	with open(os.path.join(d, 'trace.txt'), 'w') as f:
+		f.write('0\n\n')
+	cfg = os.path.join(d, 'config.txt')
+	write_config(cfg, args.config, {
+		'TOPOLOGY_FILE': topo, 'FLOW_FILE': flow, 'TRACE_FILE': os.path.join(d, 'trace.txt'),
+		'TRACE_OUTPUT_FILE': os.path.join(d, 'mix.tr'), 'FCT_OUTPUT_FILE': os.path.join(d, 'fct.txt'),
+		'PFC_OUTPUT_FILE': os.path.join(d, 'pfc.txt'), 'QLEN_MON_FILE': os.path.join(d, 'qlen.txt'),
+		'PARTITION_FILE': os.path.join(d, 'partition.txt'),
+		'SIMULATOR_STOP_TIME': '%g' % stop, 'ENABLE_TRACE': '0'})
+	cmd = [args.binary, cfg]
+	if args.np > 1:
+		cmd = ['mpirun', '-np', str(args.np)] + cmd
+	env = dict(os.environ)
+	env['LD_LIBRARY_PATH'] = os.path.dirname(os.path.dirname(os.path.abspath(args.binary))) + ':' + env.get('LD_LIBRARY_PATH', '')
+	best = None
+	for i in range(args.runs):
+		if os.path.exists(os.path.join(d, 'partition.txt')):
+			os.remove(os.path.join(d, 'partition.txt')) # depends on --np
+		start = time.time()
+		p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, env=env)
+		log = p.communicate()[0].decode('utf-8', 'replace')
+		wall = time.time() - start
+		if p.returncode != 0:
+			with open(os.path.join(d, 'log.txt'), 'w') as f:
+				f.write(log)
+			raise RuntimeError('%s failed (%d), see %s' % (name, p.returncode, os.path.join(d, 'log.txt')))
+		r = parse_perf(log)
+		r['process_wall'] = wall
+		if best is None or r['phases'].get('run', 0) < best['phases'].get('run', 0):
+			best = r
+	run = best['phases'].get('run', best['wall'])
+	with open(os.path.join(d, 'fct.txt')) as f:
+		best['flows_done'] = sum(1 for line in f if line.strip())
+	best['events_per_s'] = best['events'] / run if run > 0 else 0
+	best['sim_ns_per_s'] = (best['sim_ns'] - 2e9) / run if run > 0 else 0 # flows start at 2s
+	return best
+
+def compare(base, cur, threshold):
+	"""list of regressions: scenarios whose run phase got slower than threshold"""
+	bad = []
+	for name, r in sorted(cur.items()):
+		if name not in base:
+			continue
+		b = base[name]
+		if r['events'] != b['events']:
+			print('  %s: event count changed %d -> %d (simulated behavior changed)' % (name, b['events'], r['events']))
+		ratio = b['events_per_s'] / r['events_per_s'] if r['events_per_s'] > 0 else float('inf')
+		t_ratio = r['phases'].get('run', 0) / b['phases']['run'] if b['phases'].get('run', 0) > 0 else 1
+		print('  %s: events/s %.0f -> %.0f, run %.3fs -> %.3fs (%+.1f%%), rss %d -> %d KB' % (
+			name, b['events_per_s'], r['events_per_s'], b['phases'].get('run', 0), r['phases'].get('run', 0),
+			(t_ratio - 1) * 100, b['maxrss_kb'], r['maxrss_kb']))
+		if t_ratio > 1 + threshold:
+			bad.append(name)
+	return bad
+
+if __name__ == '__main__':
+	parser = argparse.ArgumentParser(description='simulator performance benchmark',
+			formatter_class=argparse.RawDescriptionHelpFormatter,
+			epilog='scenarios:\n' + '\n'.join('  %-10s %s' % (n, d) for n, d, f in SCENARIOS))
+	parser.add_argument('-s', '--scenarios', default=','.join(n for n, d, f in SCENARIOS), help='comma separated scenarios')
+	parser.add_argument('-r', '--runs', type=int, default=3, help='runs per scenario, the fastest is kept')
+	parser.add_argument('--binary', default='build/scratch/third')
+	parser.add_argument('--config', default='mix/config.txt', help='base config, CC settings are taken from it')
+	parser.add_argument('--np', type=int, default=1, help='MPI ranks')
+	parser.add_argument('--seed', type=int, default=1)
+	parser.add_argument('--out', default='build/bench', help='directory of the generated scenarios and outputs')
+	parser.add_argument('-o', '--output', default=None, help='JSON result file')
+	parser.add_argument('-b', '--baseline', default=None, help='JSON result file to compare with')
+	parser.add_argument('-t', '--threshold', type=float, default=0.1, help='allowed slowdown of the run phase')
+	parser.add_argument('--top', type=int, default=8, help='classes shown from the event profile (--enable-event-profile builds) and memory categories (--enable-mem-profile)')
+	args = parser.parse_args()
+
+	results = {}
+	names = args.scenarios.split(',')
+	for n in names:
+		if n not in [s[0] for s in SCENARIOS]:
+			print('unknown scenario:', n)
+			sys.exit(2)
+	print('%-10s %10s %12s %14s %10s %10s %8s' % ('scenario', 'events', 'events/s', 'sim-ns/wall-s', 'run (s)', 'rss (KB)', 'flows'))
+	for name, desc, fn in SCENARIOS:
+		if name not in names:
+			continue
+		r = run_scenario(args, name, fn)
+		results[name] = r
+		print('%-10s %10d %12.0f %14.0f %10.3f %10d %8d' % (name, r['events'], r['events_per_s'], r['sim_ns_per_s'],
+				r['phases'].get('run', 0), r['maxrss_kb'], r['flows_done']))
+		print('           ' + ', '.join('%s %.3fs' % (p, r['phases'][p]) for p in
+				['config', 'topology', 'routing', 'setup', 'run', 'teardown'] if p in r['phases']))
+		if 'profile' in r:
+			print('           ' + ', '.join('%s %.1f%%' % (m['name'], m['share'] * 100) for m in r['profile']['modules'][:args.top]))
+		if 'memory' in r:
+			print('           peak ' + ', '.join('%s %d KB' % (m['name'], m['peak'] / 1024) for m in r['memory'][:args.top]))
+		sys.stdout.flush()
+
+	if args.output:
+		with open(args.output, 'w') as f:
+			json.dump({'binary': args.binary, 'config': args.config, 'np': args.np, 'seed': args.seed,
+				'time': time.strftime('%Y-%m-%d %H:%M:%S'), 'scenarios': results}, f, indent=1, sort_keys=True)
+	if args.baseline:
+		with open(args.baseline) as f:
+			base = json.load(f)['scenarios']
+		print('compared with %s:' % args.baseline)
+		bad = compare(base, results, args.threshold)
+		if bad:
+			print('regression (> %d%% slower): %s' % (args.threshold * 100, ', '.join(bad)))
+			sys.exit(1)
@@ -19,8 +19,11 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <unordered_map>
+#include <set>
 #include <time.h> 
+#include <sys/resource.h>
 #include "ns3/core-module.h"
 #include "ns3/qbb-helper.h"
 #include "ns3/point-to-point-helper.h"
@@ -37,66 +40,115 @@
 #include <ns3/switch-node.h>
 #include <ns3/sim-setting.h>
 #include <ns3/enquserver-node.h>
+#include <ns3/topology-partitioner.h>
+#include <ns3/stats-registry.h>
+#include <ns3/trace-writer.h>
+#include <ns3/record-sink.h>
+#include <ns3/record-format.h>
+#include <ns3/checkpoint.h>
+#include <ns3/thread-rand.h>
+#include "ns3/mpi-interface.h"
 #include <unistd.h> 
+#ifdef NS3_MPI
+#include <mpi.h>
+#endif
 
 using namespace ns3;
 using namespace std;
 
 NS_LOG_COMPONENT_DEFINE("GENERIC_SIMULATION");
 
-uint32_t cc_mode = 1;
-bool enable_qcn = true, use_dynamic_pfc_threshold = true;
-uint32_t packet_payload_size = 1000, l2_chunk_size = 0, l2_ack_interval = 0;
-double pause_time = 5, simulator_stop_time = 3.01;
-std::string data_rate, link_delay, topology_file, flow_file, trace_file, trace_output_file;
-std::string fct_output_file = "fct.txt";
-std::string pfc_output_file = "pfc.txt";
-
-double alpha_resume_interval = 55, rp_timer, ewma_gain = 1 / 16;
-double rate_decrease_interval = 4;
-uint32_t fast_recovery_times = 5;
-std::string rate_ai, rate_hai, min_rate = "100Mb/s";
-std::string dctcp_rate_ai = "1000Mb/s";
-
-bool clamp_target_rate = false, l2_back_to_zero = false;
-double error_rate_per_link = 0.0;
-uint32_t has_win = 1;
-uint32_t global_t = 1;
-uint32_t mi_thresh = 5;
-bool var_win = false, fast_react = true;
-bool multi_rate = true;
-bool sample_feedback = false;
-double pint_log_base = 1.05;
-double pint_prob = 1.0;
-double u_target = 0.95;
-uint32_t int_multi = 1;
-bool rate_bound = true;
-
-uint32_t ack_high_prio = 0;
-uint64_t link_down_time = 0;
-uint32_t link_down_A = 0, link_down_B = 0;
-
-uint32_t enable_trace = 1;
-
-uint32_t buffer_size = 16;
-
-uint32_t qlen_dump_interval = 100000000, qlen_mon_interval = 100;
-uint64_t qlen_mon_start = 2000000000, qlen_mon_end = 2100000000;
-string qlen_mon_file;
-
-unordered_map<uint64_t, uint32_t> rate2kmax, rate2kmin;
-unordered_map<uint64_t, double> rate2pmax;
+/************************************************
+ * The state of a run is thread_local: in batch mode (see RunBatch) every
+ * run has its own thread, and starts from the defaults below
+ ***********************************************/
+thread_local uint32_t cc_mode = 11;
+thread_local std::string cc_algorithm; // TypeId name of the RdmaCc, empty for the one of cc_mode
+thread_local bool enable_qcn = true, use_dynamic_pfc_threshold = true;
+thread_local uint32_t packet_payload_size = 1000, l2_chunk_size = 0, l2_ack_interval = 0;
+thread_local double pause_time = 5, simulator_stop_time = 3.01;
+thread_local std::string data_rate, link_delay, topology_file, flow_file, trace_file, trace_output_file;
+thread_local std::string fct_output_file = "fct.txt";
+thread_local std::string pfc_output_file = "pfc.txt";
+
+thread_local double alpha_resume_interval = 55, rp_timer, ewma_gain = 1 / 16;
+thread_local double rate_decrease_interval = 4;
+thread_local uint32_t fast_recovery_times = 5;
+thread_local std::string rate_ai, rate_hai, min_rate = "100Mb/s";
+thread_local std::string dctcp_rate_ai = "1000Mb/s";
+
+thread_local bool clamp_target_rate = false, l2_back_to_zero = false;
+thread_local double error_rate_per_link = 0.0;
+thread_local uint32_t has_win = 1;
+thread_local uint32_t global_t = 1;
+thread_local uint32_t mi_thresh = 5;
+thread_local bool var_win = false, fast_react = true;
+thread_local bool multi_rate = true;
+thread_local bool sample_feedback = false;
+thread_local double pint_log_base = 1.05;
+thread_local double pint_prob = 1.0;
+thread_local double u_target = 0.95;
+thread_local uint32_t int_multi = 1;
+thread_local uint32_t int_version = 1; // FIDCC INT encoding, see MyIntHeader::version
+thread_local bool rate_bound = true;
+
+thread_local uint32_t ack_high_prio = 0;
+thread_local uint64_t link_down_time = 0;
+thread_local uint32_t link_down_A = 0, link_down_B = 0;
+
+thread_local uint32_t enable_trace = 1;
+thread_local string trace_filter; // analysis/trace_filter.hpp expression, applied while capturing
+thread_local uint32_t trace_sample = 1, trace_sample_per_flow = 0;
+thread_local uint32_t trace_buffer_size = 4 << 20, trace_buffer_num = 8, trace_direct_io = 0; // see TraceWriter
+thread_local string output_format = "text"; // FCT, PFC and qlen outputs: text, or binary (see RecordSink, analysis/record_reader)
+thread_local uint32_t output_buffer_size = 1 << 20;
+
+thread_local uint32_t buffer_size = 16;
+thread_local uint32_t dynamic_egress_threshold = 0;
+thread_local map<uint32_t, double> egress_alpha; // queue index -> dynamic threshold alpha
+
+thread_local uint32_t qlen_dump_interval = 100000000, qlen_mon_interval = 100;
+thread_local uint64_t qlen_mon_start = 2000000000, qlen_mon_end = 2100000000;
+thread_local string qlen_mon_file;
+
+thread_local string stats_mon_file; // drop/retransmission counters, disabled if empty
+thread_local uint64_t stats_mon_interval = 1000000;
+thread_local StatsRegistry stats;
+
+thread_local double checkpoint_time = 0; // s, 0: no checkpoint is saved
+thread_local string checkpoint_save_file; // the state of the run at checkpoint_time, see save_checkpoint
+thread_local string checkpoint_restore_file; // the run goes on from this checkpoint instead of starting, see restore_checkpoint
+thread_local string checkpoint_flow_file; // flows started in addition after the restored checkpoint
+
+thread_local unordered_map<uint64_t, uint32_t> rate2kmax, rate2kmin;
+thread_local unordered_map<uint64_t, double> rate2pmax;
 
 /************************************************
  * Runtime varibles
  ***********************************************/
-std::ifstream topof, flowf, tracef;
+thread_local std::ifstream topof, tracef;
+
+thread_local NodeContainer n;
 
-NodeContainer n;
+thread_local uint64_t nic_rate;
 
-uint64_t nic_rate;
+thread_local uint64_t maxRtt, maxBdp;
 
-uint64_t maxRtt, maxBdp;
+/************************************************
+ * Distributed run (mpirun -np N): every rank builds the whole topology,
+ * but only owns (schedules events for) the nodes whose system id is its rank
+ ***********************************************/
+thread_local uint32_t system_id = 0, system_count = 1;
+thread_local std::vector<uint32_t> node_system_id;
+thread_local std::string partition_file;
+thread_local double partition_imbalance = 0.1;
+
+struct LinkInput{
+	uint32_t src, dst;
+	std::string data_rate, link_delay;
+	double error_rate;
+};
+thread_local std::vector<LinkInput> link_input;
 
 struct Interface{
 	uint32_t idx;
@@ -106,55 +158,109 @@ struct Interface{
 
 	Interface() : idx(0), up(false){}
 };
-map<Ptr<Node>, map<Ptr<Node>, Interface> > nbr2if;
+thread_local map<Ptr<Node>, map<Ptr<Node>, Interface> > nbr2if;
 // Mapping destination to next hop for each node: <node, <dest, <nexthop0, ...> > >
-map<Ptr<Node>, map<Ptr<Node>, vector<Ptr<Node> > > > nextHop;
-map<Ptr<Node>, map<Ptr<Node>, Ptr<Node> > > nextHopenc;//每个switch节点到目的地址的下一跳的节点<node, <dest, nexthop > >
-map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairDelay;
-map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairTxDelay;
-map<uint32_t, map<uint32_t, uint64_t> > pairBw;
-map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairBdp;
-map<uint32_t, map<uint32_t, uint64_t> > pairRtt;
+thread_local map<Ptr<Node>, map<Ptr<Node>, vector<Ptr<Node> > > > nextHop;
+thread_local map<Ptr<Node>, map<Ptr<Node>, Ptr<Node> > > nextHopenc;//每个switch节点到目的地址的下一跳的节点<node, <dest, nexthop > >
+thread_local map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairDelay;
+thread_local map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairTxDelay;
+thread_local map<uint32_t, map<uint32_t, uint64_t> > pairBw;
+// what every flow looks up (its window and base RTT when it starts, its standalone FCT when it
+// completes), per host pair in one array: pair_info[host_idx[src] * host_num + host_idx[dst]]
+struct PairInfo{
+	uint64_t rtt, bdp, bw;
+};
+thread_local std::vector<uint32_t> host_idx; // node id -> index among the hosts
+thread_local uint32_t host_num;
+thread_local std::vector<PairInfo> pair_info;
+inline PairInfo &get_pair_info(uint32_t src, uint32_t dst){
+	return pair_info[(uint64_t)host_idx[src] * host_num + host_idx[dst]];
+}
 
-std::vector<Ipv4Address> serverAddress;
+thread_local std::vector<Ipv4Address> serverAddress;
 
 // maintain port number for each host pair
-std::unordered_map<uint32_t, unordered_map<uint32_t, uint16_t> > portNumder;
+thread_local std::unordered_map<uint32_t, unordered_map<uint32_t, uint16_t> > portNumder;
 
 struct FlowInput{
 	uint32_t src, dst, pg, maxPacketCount, port, dport;
 	double start_time;
 	uint32_t idx;
 };
-FlowInput flow_input = {0};
-uint32_t flow_num;
-
-void ReadFlowInput(){
-	if (flow_input.idx < flow_num){
-		flowf >> flow_input.src >> flow_input.dst >> flow_input.pg >> flow_input.dport >> flow_input.maxPacketCount >> flow_input.start_time;
+// a flow file, whose flows are started at their start time by ScheduleFlowInputs
+struct FlowReader{
+	std::ifstream f;
+	FlowInput next;
+	uint32_t num;
+	EventId event; // the next ScheduleFlowInputs
+};
+thread_local FlowReader flow_reader; // FLOW_FILE
+thread_local FlowReader extra_flow_reader; // CHECKPOINT_FLOW_FILE
+// flows read but not started yet, per sender, and the StartFlows that starts them
+thread_local std::vector<std::vector<RdmaFlow> > pending_flows;
+thread_local std::vector<EventId> pending_flows_event;
+
+void ReadFlowInput(FlowReader *r){
+	FlowInput &flow_input = r->next;
+	if (flow_input.idx < r->num){
+		r->f >> flow_input.src >> flow_input.dst >> flow_input.pg >> flow_input.dport >> flow_input.maxPacketCount >> flow_input.start_time;
 		NS_ASSERT(n.Get(flow_input.src)->GetNodeType() == 0 && n.Get(flow_input.dst)->GetNodeType() == 0);
 	}
 }
-void ScheduleFlowInputs(){
-	while (flow_input.idx < flow_num && Seconds(flow_input.start_time) == Simulator::Now()){
+void StartFlows(uint32_t src){
+	n.Get(src)->GetObject<RdmaDriver>()->AddFlows(pending_flows[src]);
+	pending_flows[src].clear();
+}
+void ScheduleFlowInputs(FlowReader *r){
+	FlowInput &flow_input = r->next;
+	while (flow_input.idx < r->num && Seconds(flow_input.start_time) == Simulator::Now()){
 		uint32_t port = portNumder[flow_input.src][flow_input.dst]++; // get a new port number 
-		RdmaClientHelper clientHelper(flow_input.pg, serverAddress[flow_input.src], serverAddress[flow_input.dst], port, flow_input.dport, flow_input.maxPacketCount, has_win?(global_t==1?maxBdp:pairBdp[n.Get(flow_input.src)][n.Get(flow_input.dst)]):0, global_t==1?maxRtt:pairRtt[flow_input.src][flow_input.dst]);
-		ApplicationContainer appCon = clientHelper.Install(n.Get(flow_input.src));
-		appCon.Start(Time(0));
+		// every rank reads the whole flow file to keep port numbers consistent, but only the owner of the sender starts the flow
+		if (n.Get(flow_input.src)->GetSystemId() == system_id){
+			// the flows of a sender that start now go to its RdmaDriver as one batch, in the sender's context
+			std::vector<RdmaFlow> &batch = pending_flows[flow_input.src];
+			if (batch.empty()){
+				EventId slot = Simulator::ReserveWithContext(flow_input.src, Time(0));
+				pending_flows_event[flow_input.src] = Simulator::ScheduleReserved(slot, MakeEvent(&StartFlows, flow_input.src));
+			}
+			RdmaFlow flow;
+			flow.size = flow_input.maxPacketCount;
+			flow.sip = serverAddress[flow_input.src];
+			flow.dip = serverAddress[flow_input.dst];
+			flow.pg = flow_input.pg;
+			flow.sport = port;
+			flow.dport = flow_input.dport;
+			flow.notify = 0; // completions are logged by the QpComplete trace
+			flow.win = has_win?(global_t==1?maxBdp:get_pair_info(flow_input.src, flow_input.dst).bdp):0;
+			flow.baseRtt = global_t==1?maxRtt:get_pair_info(flow_input.src, flow_input.dst).rtt;
+			batch.push_back(flow);
+		}
 
 		// get the next flow input
 		flow_input.idx++;
-		ReadFlowInput();
+		ReadFlowInput(r);
 	}
 
 	// schedule the next time to run this function
-	if (flow_input.idx < flow_num){
-		Simulator::Schedule(Seconds(flow_input.start_time)-Simulator::Now(), ScheduleFlowInputs);
+	if (flow_input.idx < r->num){
+		r->event = Simulator::Schedule(Seconds(flow_input.start_time)-Simulator::Now(), &ScheduleFlowInputs, r);
 	}else { // no more flows, close the file
-		flowf.close();
+		r->f.close();
 	}
 }
 
+// read the first flow of r (whose file is open) and schedule its start; false if it starts in the past
+bool StartFlowInput(FlowReader *r){
+	r->next.idx = 0;
+	if (r->num == 0)
+		return true;
+	ReadFlowInput(r);
+	if (Seconds(r->next.start_time) < Simulator::Now())
+		return false;
+	r->event = Simulator::Schedule(Seconds(r->next.start_time)-Simulator::Now(), &ScheduleFlowInputs, r);
+	return true;
+}
+
 Ipv4Address node_id_to_ip(uint32_t id){
 	return Ipv4Address(0x0b000001 + ((id / 256) * 0x00010000) + ((id % 256) * 0x00000100));
 }
@@ -163,23 +269,56 @@ uint32_t ip_to_node_id(Ipv4Address ip){
 	return (ip.Get() >> 8) & 0xffff;
 }
 
-void qp_finish(FILE* fout, Ptr<RdmaQueuePair> q){
-	uint32_t sid = ip_to_node_id(q->sip), did = ip_to_node_id(q->dip);
-	uint64_t base_rtt = pairRtt[sid][did], b = pairBw[sid][did];
-	uint32_t total_bytes = q->m_size + ((q->m_size-1) / packet_payload_size + 1) * (CustomHeader::GetStaticWholeHeaderSize() - IntHeader::GetStaticSize()); // translate to the minimum bytes required (with header but no INT)
-	uint64_t standalone_fct = base_rtt + total_bytes * 8000000000lu / b;
-	// sip, dip, sport, dport, size (B), start_time, fct (ns), standalone_fct (ns)
-	fprintf(fout, "%08x %08x %u %u %lu %lu %lu %lu\n", q->sip.Get(), q->dip.Get(), q->sport, q->dport, q->m_size, q->startTime.GetTimeStep(), (Simulator::Now() - q->startTime).GetTimeStep(), standalone_fct);
-	fflush(fout);
-
-	// remove rxQp from the receiver
-	Ptr<Node> dstNode = n.Get(did);
-	Ptr<RdmaDriver> rdma = dstNode->GetObject<RdmaDriver> ();
-	rdma->m_rdma->DeleteRxQp(q->sip.Get(), q->m_pg, q->sport);
+// the FCT records of a batch of completed flows of a host (see RdmaHw::CompletionBatch)
+void flows_finish(Ptr<RecordSink> fout, const RdmaFlowDone *done, uint32_t n){
+	for (uint32_t i = 0; i < n; i++){
+		const RdmaFlowDone &q = done[i];
+		uint32_t sid = ip_to_node_id(q.sip), did = ip_to_node_id(q.dip);
+		const PairInfo &pair = get_pair_info(sid, did);
+		uint64_t base_rtt = pair.rtt, b = pair.bw;
+		uint32_t total_bytes = q.size + ((q.size-1) / packet_payload_size + 1) * (CustomHeader::GetStaticWholeHeaderSize() - IntHeader::GetStaticSize()); // translate to the minimum bytes required (with header but no INT)
+		uint64_t standalone_fct = base_rtt + total_bytes * 8000000000lu / b;
+		uint64_t fct = (q.finishTime - q.startTime).GetTimeStep();
+		if (fout->IsBinary()){
+			FctRecord r;
+			r.sip = q.sip.Get();
+			r.dip = q.dip.Get();
+			r.sport = q.sport;
+			r.dport = q.dport;
+			r.nackRecv = q.nackRecv;
+			r.size = q.size;
+			r.startTime = q.startTime.GetTimeStep();
+			r.fct = fct;
+			r.standaloneFct = standalone_fct;
+			r.retxCnt = q.retxCnt;
+			r.reserved = 0;
+			r.retxBytes = q.retxBytes;
+			fout->Write(&r, sizeof(r));
+		}else // sip, dip, sport, dport, size (B), start_time, fct (ns), standalone_fct (ns); the loss counters are only in the binary record
+			fout->Printf("%08x %08x %u %u %lu %lu %lu %lu\n", q.sip.Get(), q.dip.Get(), q.sport, q.dport, q.size, q.startTime.GetTimeStep(), fct, standalone_fct);
+	}
+	// the receiver frees its rxQp itself, on the FIN packet (RdmaHw::ReceiveTcp)
+}
+
+// write the completed flows that the hosts of this rank have not reported yet
+void flush_completions(){
+	for (uint32_t i = 0; i < n.GetN(); i++){
+		if (n.Get(i)->GetNodeType() == 0 && n.Get(i)->GetSystemId() == system_id)
+			n.Get(i)->GetObject<RdmaDriver>()->FlushCompletions();
+	}
 }
 
-void get_pfc(FILE* fout, Ptr<QbbNetDevice> dev, uint32_t type){
-	fprintf(fout, "%lu %u %u %u %u\n", Simulator::Now().GetTimeStep(), dev->GetNode()->GetId(), dev->GetNode()->GetNodeType(), dev->GetIfIndex(), type);
+void get_pfc(Ptr<RecordSink> fout, Ptr<QbbNetDevice> dev, uint32_t type){
+	if (fout->IsBinary()){
+		PfcRecord r;
+		r.time = Simulator::Now().GetTimeStep();
+		r.node = dev->GetNode()->GetId();
+		r.nodeType = dev->GetNode()->GetNodeType();
+		r.ifIndex = dev->GetIfIndex();
+		r.type = type;
+		fout->Write(&r, sizeof(r));
+	}else
+		fout->Printf("%lu %u %u %u %u\n", Simulator::Now().GetTimeStep(), dev->GetNode()->GetId(), dev->GetNode()->GetNodeType(), dev->GetIfIndex(), type);
 }
 
 struct QlenDistribution{
@@ -192,10 +331,43 @@ struct QlenDistribution{
 		cnt[kb]++;
 	}
 };
-map<uint32_t, map<uint32_t, QlenDistribution> > queue_result;
-void monitor_buffer(FILE* qlen_output, NodeContainer *n){
+thread_local map<uint32_t, map<uint32_t, QlenDistribution> > queue_result;
+void dump_qlen(Ptr<RecordSink> qlen_output){
+	if (qlen_output->IsBinary()){
+		QlenDumpRecord d;
+		d.time = Simulator::Now().GetTimeStep();
+		d.nPorts = 0;
+		d.reserved = 0;
+		for (auto &it0 : queue_result)
+			d.nPorts += it0.second.size();
+		qlen_output->Write(&d, sizeof(d));
+		for (auto &it0 : queue_result)
+			for (auto &it1 : it0.second){
+				auto &dist = it1.second.cnt;
+				QlenPortRecord r;
+				r.node = it0.first;
+				r.port = it1.first;
+				r.n = dist.size();
+				qlen_output->Write(&r, sizeof(r));
+				qlen_output->Write(dist.data(), dist.size() * sizeof(uint32_t));
+			}
+		return;
+	}
+	qlen_output->Printf("time: %lu\n", Simulator::Now().GetTimeStep());
+	for (auto &it0 : queue_result)
+		for (auto &it1 : it0.second){
+			qlen_output->Printf("%u %u", it0.first, it1.first);
+			auto &dist = it1.second.cnt;
+			for (uint32_t i = 0; i < dist.size(); i++)
+				qlen_output->Printf(" %u", dist[i]);
+			qlen_output->Printf("\n");
+		}
+}
+
+thread_local EventId qlen_mon_event; // the next monitor_buffer
+void monitor_buffer(Ptr<RecordSink> qlen_output, NodeContainer *n){
 	for (uint32_t i = 0; i < n->GetN(); i++){
-		if (n->Get(i)->GetNodeType() == 1){ // is switch
+		if (n->Get(i)->GetNodeType() == 1 && n->Get(i)->GetSystemId() == system_id){ // is local switch
 			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(n->Get(i));
 			if (queue_result.find(i) == queue_result.end())
 				queue_result[i];
@@ -207,20 +379,64 @@ void monitor_buffer(FILE* qlen_output, NodeContainer *n){
 			}
 		}
 	}
-	if (Simulator::Now().GetTimeStep() % qlen_dump_interval == 0){
-		fprintf(qlen_output, "time: %lu\n", Simulator::Now().GetTimeStep());
-		for (auto &it0 : queue_result)
-			for (auto &it1 : it0.second){
-				fprintf(qlen_output, "%u %u", it0.first, it1.first);
-				auto &dist = it1.second.cnt;
-				for (uint32_t i = 0; i < dist.size(); i++)
-					fprintf(qlen_output, " %u", dist[i]);
-				fprintf(qlen_output, "\n");
-			}
-		fflush(qlen_output);
-	}
+	if (Simulator::Now().GetTimeStep() % qlen_dump_interval == 0)
+		dump_qlen(qlen_output);
 	if (Simulator::Now().GetTimeStep() < qlen_mon_end)
-		Simulator::Schedule(NanoSeconds(qlen_mon_interval), &monitor_buffer, qlen_output, n);
+		qlen_mon_event = Simulator::Schedule(NanoSeconds(qlen_mon_interval), &monitor_buffer, qlen_output, n);
+}
+
+void RegisterStats(void){
+	char name[128];
+	for (uint32_t i = 0; i < n.GetN(); i++){
+		Ptr<Node> node = n.Get(i);
+		if (node->GetSystemId() != system_id)
+			continue;
+		if (node->GetNodeType() == 1){ // switch: per port/queue drops
+			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(node);
+			sprintf(name, "sw%u.no_route_drop", i);
+			stats.Register(name, &sw->m_noRouteDrops);
+			for (uint32_t j = 1; j < sw->GetNDevices(); j++)
+				for (uint32_t k = 0; k < SwitchMmu::qCnt; k++){
+					sprintf(name, "sw%u.%u.%u.ingress_drop", i, j, k);
+					stats.Register(name, &sw->m_mmu->ingress_drop_pkts[j][k]);
+					sprintf(name, "sw%u.%u.%u.egress_drop", i, j, k);
+					stats.Register(name, &sw->m_mmu->egress_drop_pkts[j][k]);
+					sprintf(name, "sw%u.%u.%u.egress_drop_bytes", i, j, k);
+					stats.Register(name, &sw->m_mmu->egress_drop_bytes[j][k]);
+				}
+		}else if (node->GetNodeType() == 0 && node->GetObject<RdmaDriver>()){ // host: loss recovery totals
+			Ptr<RdmaHw> rdma = node->GetObject<RdmaDriver>()->m_rdma;
+			sprintf(name, "host%u.nack_recv", i);
+			stats.Register(name, &rdma->m_nackRecv);
+			sprintf(name, "host%u.retx", i);
+			stats.Register(name, &rdma->m_retxCnt);
+			sprintf(name, "host%u.retx_bytes", i);
+			stats.Register(name, &rdma->m_retxBytes);
+			sprintf(name, "host%u.nack_sent", i);
+			stats.Register(name, &rdma->m_nackSent);
+			sprintf(name, "host%u.out_of_order", i);
+			stats.Register(name, &rdma->m_outOfOrderRecv);
+			sprintf(name, "host%u.duplicate", i);
+			stats.Register(name, &rdma->m_duplicateRecv);
+			sprintf(name, "host%u.rx_qp", i);
+			stats.Register(name, &rdma->m_rxQpLive);
+			sprintf(name, "host%u.rx_qp_created", i);
+			stats.Register(name, &rdma->m_rxQpCreated);
+			sprintf(name, "host%u.rx_qp_fin", i);
+			stats.Register(name, &rdma->m_rxQpFin);
+			sprintf(name, "host%u.rx_qp_expired", i);
+			stats.Register(name, &rdma->m_rxQpExpired);
+		}
+	}
+#ifdef NS3_MEM_PROFILE
+	// live bytes and objects of this rank per allocation category (see MemProfiler)
+	for (uint32_t i = 0; i < MemProfiler::GetN(); i++){
+		sprintf(name, "mem%u.%s.bytes", system_id, MemProfiler::GetName(i));
+		stats.Register(name, &MemProfiler::Get(i).bytes);
+		sprintf(name, "mem%u.%s.count", system_id, MemProfiler::GetName(i));
+		stats.Register(name, &MemProfiler::Get(i).count);
+	}
+#endif
 }
 
 void CalculateRoute(Ptr<Node> host){
@@ -377,6 +593,8 @@ void SetRoutingEntriesEnc(){
 	// For each node.
 	for (auto i = nextHopenc.begin(); i != nextHopenc.end(); i++){
 		Ptr<Node> node = i->first;
+		if (node->GetSystemId() != system_id) // owned by another rank
+			continue;
 		auto &table = i->second;
 		for (auto j = table.begin(); j != table.end(); j++){
 			// The destination node.
@@ -410,8 +628,15 @@ void TakeDownLink(NodeContainer n, Ptr<Node> a, Ptr<Node> b){
 	nbr2if[a][b].up = nbr2if[b][a].up = false;
 	nextHop.clear();
 	CalculateRoutes(n);
+	// the FCT records use the new bottleneck bandwidths (the base RTTs stay those of the setup)
+	for (uint32_t i = 0; i < n.GetN(); i++)
+		for (uint32_t j = 0; j < n.GetN(); j++)
+			if (n.Get(i)->GetNodeType() == 0 && n.Get(j)->GetNodeType() == 0)
+				get_pair_info(i, j).bw = pairBw[i][j];
 	// clear routing tables
 	for (uint32_t i = 0; i < n.GetN(); i++){
+		if (n.Get(i)->GetSystemId() != system_id)
+			continue;
 		if (n.Get(i)->GetNodeType() == 1)
 			DynamicCast<SwitchNode>(n.Get(i))->ClearTable();
 		else
@@ -424,11 +649,381 @@ void TakeDownLink(NodeContainer n, Ptr<Node> a, Ptr<Node> b){
 	SetRoutingEntriesEnc();
 	// redistribute qp on each host
 	for (uint32_t i = 0; i < n.GetN(); i++){
-		if (n.Get(i)->GetNodeType() == 0)
+		if (n.Get(i)->GetNodeType() == 0 && n.Get(i)->GetSystemId() == system_id)
 			n.Get(i)->GetObject<RdmaDriver>()->m_rdma->RedistributeQp();
 	}
 }
 
+/******************************************************
+ * Checkpoints: with CHECKPOINT_TIME, the run stops at that time, saves its
+ * state to CHECKPOINT_SAVE_FILE and goes on to SIMULATOR_STOP_TIME. The
+ * state is that of the simulator (its clock and every pending event), of
+ * the links, devices, switches and hosts (the packets in the queues and on
+ * the wires, the QPs and their CC state, the MMU counters, the random
+ * streams) and of this file (the flows not started yet, the monitors), see
+ * CheckpointWriter. A run of the same config with CHECKPOINT_RESTORE_FILE
+ * builds the network, and instead of starting it goes on from the
+ * checkpoint: it produces the records the saved run produced after the
+ * checkpoint, plus those of the flows of CHECKPOINT_FLOW_FILE.
+ ******************************************************/
+thread_local EventId link_down_event, stop_event;
+
+void save_flow_reader(CheckpointWriter &w, FlowReader &r){
+	w.Put<int64_t>(r.f.is_open() ? (int64_t)r.f.tellg() : -1);
+	w.Put(r.num);
+	w.Put(r.next);
+	w.PutEvent(r.event);
+}
+
+void restore_flow_reader(CheckpointReader &r, FlowReader &f){
+	int64_t pos = r.Get<int64_t>();
+	if (r.Get<uint32_t>() != f.num)
+		r.Fail("the flow file has another number of flows");
+	r.Get(f.next);
+	f.event = r.GetEvent(MakeEvent(&ScheduleFlowInputs, &f));
+	if (pos < 0)
+		f.f.close();
+	else if (!f.f.seekg(pos))
+		r.Fail("the flow file is shorter");
+}
+
+// the state of the run that lives in this file
+void save_run(CheckpointWriter &w, FILE *stats_output){
+	save_flow_reader(w, flow_reader);
+	for (uint32_t i = 0; i < pending_flows.size(); i++){
+		w.Put((uint32_t)pending_flows[i].size());
+		if (pending_flows[i].empty())
+			continue;
+		w.PutBytes(pending_flows[i].data(), pending_flows[i].size() * sizeof(RdmaFlow));
+		w.PutEvent(pending_flows_event[i]);
+	}
+	// the port numbers that flows took
+	std::vector<std::pair<uint32_t, uint16_t> > ports;
+	for (uint32_t i = 0; i < n.GetN(); i++)
+		for (uint32_t j = 0; j < n.GetN(); j++)
+			if (n.Get(i)->GetNodeType() == 0 && n.Get(j)->GetNodeType() == 0 && portNumder[i][j] != 10000)
+				ports.push_back(std::make_pair(i * n.GetN() + j, portNumder[i][j]));
+	w.Put((uint32_t)ports.size());
+	w.PutBytes(ports.data(), ports.size() * sizeof(ports[0]));
+	w.Put((uint32_t)queue_result.size());
+	for (auto &it0 : queue_result){
+		w.Put(it0.first);
+		w.Put((uint32_t)it0.second.size());
+		for (auto &it1 : it0.second){
+			w.Put(it1.first);
+			w.Put((uint32_t)it1.second.cnt.size());
+			w.PutBytes(it1.second.cnt.data(), it1.second.cnt.size() * sizeof(uint32_t));
+		}
+	}
+	w.Put(stats_output != NULL);
+	if (stats_output)
+		stats.Save(w);
+	ThreadRand::Save(w);
+	w.PutEvent(link_down_event);
+	w.PutEvent(qlen_mon_event);
+	w.PutEvent(stop_event);
+}
+
+void restore_run(CheckpointReader &r, FILE *stats_output, Ptr<RecordSink> qlen_output, bool qlen_open){
+	restore_flow_reader(r, flow_reader);
+	for (uint32_t i = 0; i < pending_flows.size() && !r.Failed(); i++){
+		uint32_t cnt = r.Get<uint32_t>();
+		if (cnt == 0)
+			continue;
+		if (cnt > n.GetN() * 65536u){
+			r.Fail("the checkpoint is corrupted");
+			break;
+		}
+		pending_flows[i].resize(cnt);
+		r.GetBytes(pending_flows[i].data(), cnt * sizeof(RdmaFlow));
+		pending_flows_event[i] = r.GetEvent(MakeEvent(&StartFlows, i));
+	}
+	uint32_t nPorts = r.Get<uint32_t>();
+	for (uint32_t i = 0; i < nPorts && !r.Failed(); i++){
+		std::pair<uint32_t, uint16_t> p;
+		r.GetBytes(&p, sizeof(p));
+		uint32_t src = p.first / n.GetN(), dst = p.first % n.GetN();
+		if (src >= n.GetN() || n.Get(src)->GetNodeType() != 0 || n.Get(dst)->GetNodeType() != 0)
+			r.Fail("the port numbers are of other hosts");
+		else
+			portNumder[src][dst] = p.second;
+	}
+	uint32_t nNodes = r.Get<uint32_t>();
+	for (uint32_t i = 0; i < nNodes && !r.Failed(); i++){
+		std::map<uint32_t, QlenDistribution> &node = queue_result[r.Get<uint32_t>()];
+		uint32_t nPorts = r.Get<uint32_t>();
+		for (uint32_t j = 0; j < nPorts && !r.Failed(); j++){
+			std::vector<uint32_t> &cnt = node[r.Get<uint32_t>()].cnt;
+			uint32_t size = r.Get<uint32_t>();
+			if (size > (1u << 24)){
+				r.Fail("the checkpoint is corrupted");
+				break;
+			}
+			cnt.resize(size);
+			r.GetBytes(cnt.data(), size * sizeof(uint32_t));
+		}
+	}
+	if (r.Get<bool>() != (stats_output != NULL))
+		r.Fail("STATS_MON_FILE is set in only one of the runs");
+	else if (stats_output)
+		stats.Restore(r, stats_output, NanoSeconds(stats_mon_interval), Seconds(simulator_stop_time));
+	ThreadRand::Restore(r);
+	link_down_event = r.GetEvent(MakeEvent(&TakeDownLink, n, n.Get(link_down_A), n.Get(link_down_B)));
+	if (link_down_event.IsRunning() != (link_down_time > 0))
+		r.Fail("LINK_DOWN is set in only one of the runs");
+	qlen_mon_event = r.GetEvent(MakeEvent(&monitor_buffer, qlen_output, &n));
+	if (qlen_mon_event.IsRunning() && !qlen_open)
+		r.Fail("the queue lengths are monitored but the qlen output file is not open");
+	stop_event = r.GetEvent(MakeEvent(static_cast<void (*)(void)>(&Simulator::Stop)));
+}
+
+// the run, then every channel, device, switch and host, in the order of the nodes
+void checkpoint_network(CheckpointWriter *w, CheckpointReader *r){
+	std::set<Ptr<QbbChannel> > channels;
+	for (uint32_t i = 0; i < n.GetN(); i++){
+		Ptr<Node> node = n.Get(i);
+		for (uint32_t j = 0; j < node->GetNDevices(); j++){
+			Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(node->GetDevice(j));
+			if (!dev)
+				continue;
+			Ptr<QbbChannel> ch = DynamicCast<QbbChannel>(dev->GetChannel());
+			if (ch && channels.insert(ch).second){
+				if (w)
+					ch->Save(*w);
+				else
+					ch->Restore(*r);
+			}
+			if (w)
+				dev->Save(*w);
+			else
+				dev->Restore(*r);
+		}
+		if (node->GetNodeType() == 1){
+			if (w)
+				DynamicCast<SwitchNode>(node)->Save(*w);
+			else
+				DynamicCast<SwitchNode>(node)->Restore(*r);
+		}else if (node->GetNodeType() == 2){
+			if (w)
+				DynamicCast<EnquserverNode>(node)->Save(*w);
+			else
+				DynamicCast<EnquserverNode>(node)->Restore(*r);
+		}else if (node->GetObject<RdmaDriver>()){
+			if (w)
+				node->GetObject<RdmaDriver>()->m_rdma->Save(*w);
+			else
+				node->GetObject<RdmaDriver>()->m_rdma->Restore(*r);
+		}
+		if (r && r->Failed())
+			return;
+	}
+}
+
+// the nodes and devices the checkpoint was saved from
+void save_topology(CheckpointWriter &w){
+	w.Put(n.GetN());
+	for (uint32_t i = 0; i < n.GetN(); i++){
+		w.Put(n.Get(i)->GetNodeType());
+		w.Put(n.Get(i)->GetNDevices());
+	}
+}
+
+void restore_topology(CheckpointReader &r){
+	if (r.Get<uint32_t>() != n.GetN()){
+		r.Fail("the checkpoint is of another number of nodes");
+		return;
+	}
+	for (uint32_t i = 0; i < n.GetN(); i++){
+		uint32_t type = r.Get<uint32_t>();
+		uint32_t nDevices = r.Get<uint32_t>();
+		if (type != n.Get(i)->GetNodeType() || nDevices != n.Get(i)->GetNDevices()){
+			std::ostringstream why;
+			why << "node " << i << " is another node in the checkpoint";
+			r.Fail(why.str());
+			return;
+		}
+	}
+}
+
+// false, with the reason in error, if the state of the run cannot be saved
+bool save_checkpoint(std::string file, FILE *stats_output, std::string &error){
+	flush_completions(); // the flows completed before the checkpoint are in the output of the saving run only
+	CheckpointWriter w;
+	save_topology(w);
+	save_run(w, stats_output);
+	checkpoint_network(&w, NULL);
+	if (!w.Finish()){
+		error = w.GetError();
+		return false;
+	}
+	Ptr<RecordSink> out = Create<RecordSink>();
+	if (!out->Open(file, true, RecordCheckpoint)){
+		error = "cannot open " + file;
+		return false;
+	}
+	CheckpointRecord c;
+	memset(&c, 0, sizeof(c));
+	c.time = Simulator::Now().GetTimeStep();
+	c.events = Simulator::GetEventCount();
+	c.seed = RngSeedManager::GetSeed();
+	c.run = RngSeedManager::GetRun();
+	c.nEvents = w.GetNEvents();
+	c.nPackets = w.GetNPackets();
+	c.size = w.GetData().size();
+	out->Write(&c, sizeof(c));
+	out->Write(w.GetData().data(), w.GetData().size());
+	out->Close();
+	return true;
+}
+
+// goes on from the checkpoint in file; the simulator must have no pending event
+bool restore_checkpoint(std::string file, FILE *stats_output, Ptr<RecordSink> qlen_output, bool qlen_open, std::string &error){
+	std::ifstream in(file.c_str(), std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	RecordFileHeader h;
+	CheckpointRecord c;
+	if (in.bad() || data.size() < sizeof(h) + sizeof(c)){
+		error = "cannot read " + file;
+		return false;
+	}
+	memcpy(&h, data.data(), sizeof(h));
+	memcpy(&c, data.data() + sizeof(h), sizeof(c));
+	if (h.magic != RecordMagic || h.version != RecordVersion || h.kind != RecordCheckpoint || c.size != data.size() - sizeof(h) - sizeof(c)){
+		error = file + " is not a checkpoint";
+		return false;
+	}
+	if (c.seed != RngSeedManager::GetSeed() || c.run != RngSeedManager::GetRun()){
+		error = "the checkpoint is of another RNG seed or run";
+		return false;
+	}
+	CheckpointReader r(data.substr(sizeof(h) + sizeof(c)));
+	r.Begin();
+	restore_topology(r);
+	restore_run(r, stats_output, qlen_output, qlen_open);
+	checkpoint_network(NULL, &r);
+	if (!r.Finish()){
+		error = r.GetError();
+		return false;
+	}
+	return true;
+}
+
+// node -> rank map: loaded from PARTITION_FILE if it exists, otherwise computed by TopologyPartitioner
+// (cutting links with the largest delay first, to get a large lookahead) and saved to PARTITION_FILE.
+// Only rank 0 reads or writes the file; the other ranks receive its map.
+void PartitionNodes(uint32_t node_num, std::vector<uint32_t> &node_type){
+	node_system_id.assign(node_num, 0);
+	if (system_count <= 1)
+		return;
+	if (system_id == 0){
+		std::vector<uint32_t> map;
+		if (partition_file.size() > 0 && TopologyPartitioner::ReadMap(partition_file, map)){
+			if (map.size() != node_num)
+				NS_FATAL_ERROR("partition file " << partition_file << " does not match the topology");
+			for (uint32_t i = 0; i < node_num; i++){
+				if (map[i] >= system_count)
+					NS_FATAL_ERROR("partition file " << partition_file << " uses more ranks than mpirun provides");
+				node_system_id[i] = map[i];
+			}
+			std::cout << "PARTITION loaded from " << partition_file << "\n";
+		}else {
+			TopologyPartitioner partitioner;
+			partitioner.SetMtu(packet_payload_size);
+			for (uint32_t i = 0; i < node_num; i++)
+				partitioner.AddNode(i, node_type[i]);
+			for (auto &l : link_input)
+				partitioner.AddLink(l.src, l.dst, Time(l.link_delay).GetNanoSeconds(), DataRate(l.data_rate).GetBitRate());
+			partitioner.ReadFlows(flow_file);
+			node_system_id = partitioner.Partition(system_count, partition_imbalance);
+			std::cout << "PARTITION lookahead " << partitioner.GetLookahead() << "ns\n";
+			if (partition_file.size() > 0)
+				TopologyPartitioner::WriteMap(partition_file, node_system_id);
+		}
+	}
+#ifdef NS3_MPI
+	MPI_Bcast(&node_system_id[0], node_num, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+#endif
+}
+
+// per-rank output file name, so that ranks do not overwrite each other
+std::string rank_file_name(std::string name){
+	if (system_count <= 1)
+		return name;
+	return name + "." + std::to_string(system_id);
+}
+
+/******************************************************
+ * wall-clock time of each setup/run phase, printed as
+ * "perf:" lines at the end of the run (see bench.py)
+ ******************************************************/
+thread_local vector<pair<string, double> > perf_phases;
+thread_local double perf_last;
+
+double wall_time(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void perf_phase(const char *name){
+	double now = wall_time();
+	perf_phases.push_back(make_pair(string(name), now - perf_last));
+	perf_last = now;
+}
+
+#ifdef NS3_MEM_PROFILE
+// "mem_profile:" lines: the bytes tracked by MemProfiler against the resident
+// set of the process (of all the runs of a batch), then the categories
+void mem_report(){
+	uint64_t pages = 0, rss = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f){
+		if (fscanf(f, "%*u %lu", &pages) == 1)
+			rss = pages * sysconf(_SC_PAGESIZE);
+		fclose(f);
+	}
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	uint64_t tracked = MemProfiler::GetTotalBytes();
+	printf("mem_profile: %u total %lu rss %lu maxrss %lu untracked %ld\n", system_id, tracked, rss,
+			usage.ru_maxrss * 1024ul, (int64_t)(rss - tracked));
+	fflush(stdout);
+	MemProfiler::Report(std::cout, system_id);
+}
+#endif
+
+// concatenate the per-rank output files into the original file on rank 0
+// skip: bytes to drop at the start of the files of the ranks but the first (a RecordFileHeader)
+void MergeRankFiles(std::string name, uint32_t skip = 0){
+	if (system_count <= 1)
+		return;
+#ifdef NS3_MPI
+	MPI_Barrier(MPI_COMM_WORLD);
+#endif
+	if (system_id != 0)
+		return;
+	FILE *fout = fopen(name.c_str(), "w");
+	if (fout == NULL){
+		std::cout << "Error: cannot open " << name << ", the outputs of the ranks are left in " << name << ".<rank>\n";
+		return;
+	}
+	char buf[1 << 16];
+	for (uint32_t i = 0; i < system_count; i++){
+		std::string rank_name = name + "." + std::to_string(i);
+		FILE *fin = fopen(rank_name.c_str(), "r");
+		if (fin == NULL)
+			continue;
+		if (i > 0 && skip > 0)
+			fseek(fin, skip, SEEK_SET);
+		size_t len;
+		while ((len = fread(buf, 1, sizeof(buf), fin)) > 0)
+			fwrite(buf, 1, len, fout);
+		fclose(fin);
+		remove(rank_name.c_str());
+	}
+	fclose(fout);
+}
+
 uint64_t get_nic_rate(NodeContainer &n){
 	for (uint32_t i = 0; i < n.GetN(); i++)
 		if (n.Get(i)->GetNodeType() == 0){
@@ -437,10 +1032,13 @@ uint64_t get_nic_rate(NodeContainer &n){
 
 }
 
-int main(int argc, char *argv[])
+// run the simulation of a config file (NULL if none was given) in the calling thread;
+// trace_suffix, if not NULL, is appended to TRACE_OUTPUT_FILE
+int RunScenario(const char *config_file, const char *trace_suffix)
 {
 	clock_t begint, endt;
 	begint = clock();
+	double perf_start = perf_last = wall_time();
 	char cwd[1024];
 	if (getcwd(cwd, sizeof(cwd)) != nullptr) {
     	std::cout << "Current working directory: " << cwd << std::endl;
@@ -449,7 +1047,7 @@ int main(int argc, char *argv[])
 }
 
 #ifndef PGO_TRAINING
-	if (argc > 1)
+	if (config_file != NULL)
 #else
 	if (true)
 #endif
@@ -457,7 +1055,7 @@ int main(int argc, char *argv[])
 		//Read the configuration file
 		std::ifstream conf;
 #ifndef PGO_TRAINING
-		conf.open(argv[1]);
+		conf.open(config_file);
 #else
 		conf.open(PATH_TO_PGO_CONFIG);
 #endif
@@ -576,9 +1174,9 @@ int main(int argc, char *argv[])
 				std::string v;
 				conf >> v;
 				trace_output_file = v;
-				if (argc > 2)
+				if (trace_suffix != NULL)
 				{
-					trace_output_file = trace_output_file + std::string(argv[2]);
+					trace_output_file = trace_output_file + std::string(trace_suffix);
 				}
 				std::cout << "TRACE_OUTPUT_FILE\t\t" << trace_output_file << "\n";
 			}
@@ -641,6 +1239,9 @@ int main(int argc, char *argv[])
 			else if (key.compare("CC_MODE") == 0){
 				conf >> cc_mode;
 				std::cout << "CC_MODE\t\t" << cc_mode << '\n';
+			}else if (key.compare("CC_ALGORITHM") == 0){
+				conf >> cc_algorithm;
+				std::cout << "CC_ALGORITHM\t\t" << cc_algorithm << '\n';
 			}else if (key.compare("RATE_DECREASE_INTERVAL") == 0){
 				double v;
 				conf >> v;
@@ -677,6 +1278,9 @@ int main(int argc, char *argv[])
 			}else if (key.compare("INT_MULTI") == 0){
 				conf >> int_multi;
 				std::cout << "INT_MULTI\t\t\t\t" << int_multi << '\n';
+			}else if (key.compare("INT_VERSION") == 0){
+				conf >> int_version;
+				std::cout << "INT_VERSION\t\t\t\t" << int_version << '\n';
 			}else if (key.compare("RATE_BOUND") == 0){
 				uint32_t v;
 				conf >> v;
@@ -694,9 +1298,42 @@ int main(int argc, char *argv[])
 			}else if (key.compare("LINK_DOWN") == 0){
 				conf >> link_down_time >> link_down_A >> link_down_B;
 				std::cout << "LINK_DOWN\t\t\t\t" << link_down_time << ' '<< link_down_A << ' ' << link_down_B << '\n';
+			}else if (key.compare("PARTITION_FILE") == 0){
+				conf >> partition_file;
+				std::cout << "PARTITION_FILE\t\t\t\t" << partition_file << '\n';
+			}else if (key.compare("PARTITION_IMBALANCE") == 0){
+				conf >> partition_imbalance;
+				std::cout << "PARTITION_IMBALANCE\t\t\t" << partition_imbalance << '\n';
 			}else if (key.compare("ENABLE_TRACE") == 0){
 				conf >> enable_trace;
 				std::cout << "ENABLE_TRACE\t\t\t\t" << enable_trace << '\n';
+			}else if (key.compare("TRACE_FILTER") == 0){
+				// the rest of the line, so the expression may contain spaces
+				std::getline(conf, trace_filter);
+				trace_filter.erase(0, trace_filter.find_first_not_of(" \t"));
+				trace_filter.erase(trace_filter.find_last_not_of(" \t\r") + 1);
+				std::cout << "TRACE_FILTER\t\t\t\t" << trace_filter << '\n';
+			}else if (key.compare("TRACE_SAMPLE") == 0){
+				conf >> trace_sample;
+				std::cout << "TRACE_SAMPLE\t\t\t\t" << trace_sample << '\n';
+			}else if (key.compare("TRACE_SAMPLE_PER_FLOW") == 0){
+				conf >> trace_sample_per_flow;
+				std::cout << "TRACE_SAMPLE_PER_FLOW\t\t\t" << trace_sample_per_flow << '\n';
+			}else if (key.compare("TRACE_BUFFER_SIZE") == 0){
+				conf >> trace_buffer_size;
+				std::cout << "TRACE_BUFFER_SIZE\t\t\t" << trace_buffer_size << '\n';
+			}else if (key.compare("TRACE_BUFFER_NUM") == 0){
+				conf >> trace_buffer_num;
+				std::cout << "TRACE_BUFFER_NUM\t\t\t" << trace_buffer_num << '\n';
+			}else if (key.compare("TRACE_DIRECT_IO") == 0){
+				conf >> trace_direct_io;
+				std::cout << "TRACE_DIRECT_IO\t\t\t\t" << trace_direct_io << '\n';
+			}else if (key.compare("OUTPUT_FORMAT") == 0){
+				conf >> output_format;
+				std::cout << "OUTPUT_FORMAT\t\t\t\t" << output_format << '\n';
+			}else if (key.compare("OUTPUT_BUFFER_SIZE") == 0){
+				conf >> output_buffer_size;
+				std::cout << "OUTPUT_BUFFER_SIZE\t\t\t" << output_buffer_size << '\n';
 			}else if (key.compare("KMAX_MAP") == 0){
 				int n_k ;
 				conf >> n_k;
@@ -736,9 +1373,46 @@ int main(int argc, char *argv[])
 			}else if (key.compare("BUFFER_SIZE") == 0){
 				conf >> buffer_size;
 				std::cout << "BUFFER_SIZE\t\t\t\t" << buffer_size << '\n';
+			}else if (key.compare("DYNAMIC_EGRESS_THRESHOLD") == 0){
+				conf >> dynamic_egress_threshold;
+				std::cout << "DYNAMIC_EGRESS_THRESHOLD\t\t" << dynamic_egress_threshold << '\n';
+			}else if (key.compare("EGRESS_ALPHA_MAP") == 0){
+				int n_a;
+				conf >> n_a;
+				std::cout << "EGRESS_ALPHA_MAP\t\t\t";
+				for (int i = 0; i < n_a; i++){
+					uint32_t q;
+					double a;
+					conf >> q >> a;
+					if (q >= SwitchMmu::qCnt){
+						std::cout << "\nError: EGRESS_ALPHA_MAP queue " << q << " is not below " << SwitchMmu::qCnt << '\n';
+						return 1;
+					}
+					egress_alpha[q] = a;
+					std::cout << ' ' << q << ' ' << a;
+				}
+				std::cout<<'\n';
 			}else if (key.compare("QLEN_MON_FILE") == 0){
 				conf >> qlen_mon_file;
 				std::cout << "QLEN_MON_FILE\t\t\t\t" << qlen_mon_file << '\n';
+			}else if (key.compare("STATS_MON_FILE") == 0){
+				conf >> stats_mon_file;
+				std::cout << "STATS_MON_FILE\t\t\t\t" << stats_mon_file << '\n';
+			}else if (key.compare("STATS_MON_INTERVAL") == 0){
+				conf >> stats_mon_interval;
+				std::cout << "STATS_MON_INTERVAL\t\t\t" << stats_mon_interval << '\n';
+			}else if (key.compare("CHECKPOINT_TIME") == 0){
+				conf >> checkpoint_time;
+				std::cout << "CHECKPOINT_TIME\t\t\t\t" << checkpoint_time << '\n';
+			}else if (key.compare("CHECKPOINT_SAVE_FILE") == 0){
+				conf >> checkpoint_save_file;
+				std::cout << "CHECKPOINT_SAVE_FILE\t\t\t" << checkpoint_save_file << '\n';
+			}else if (key.compare("CHECKPOINT_RESTORE_FILE") == 0){
+				conf >> checkpoint_restore_file;
+				std::cout << "CHECKPOINT_RESTORE_FILE\t\t\t" << checkpoint_restore_file << '\n';
+			}else if (key.compare("CHECKPOINT_FLOW_FILE") == 0){
+				conf >> checkpoint_flow_file;
+				std::cout << "CHECKPOINT_FLOW_FILE\t\t\t" << checkpoint_flow_file << '\n';
 			}else if (key.compare("QLEN_MON_START") == 0){
 				conf >> qlen_mon_start;
 				std::cout << "QLEN_MON_START\t\t\t\t" << qlen_mon_start << '\n';
@@ -765,6 +1439,7 @@ int main(int argc, char *argv[])
 			fflush(stdout);
 		}
 		conf.close();
+		perf_phase("config");
 	}
 	else
 	{
@@ -773,15 +1448,42 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	// a checkpoint holds the events of one simulator, and each rank of mpirun has its own
+	if ((checkpoint_time > 0 || checkpoint_restore_file.size() > 0) && system_count > 1){
+		std::cout << "Error: checkpoints are not supported with mpirun\n";
+		return 1;
+	}
+	if (checkpoint_time > 0){
+		if (checkpoint_save_file.empty()){
+			std::cout << "Error: CHECKPOINT_TIME needs CHECKPOINT_SAVE_FILE\n";
+			return 1;
+		}
+		if (checkpoint_restore_file.size() > 0){
+			std::cout << "Error: a run restored from a checkpoint cannot save another one\n";
+			return 1;
+		}
+		if (checkpoint_time >= simulator_stop_time){
+			std::cout << "Error: CHECKPOINT_TIME must be before SIMULATOR_STOP_TIME\n";
+			return 1;
+		}
+		// the routes TakeDownLink computes again are not saved
+		if (link_down_time > 0 && Seconds(checkpoint_time) >= Seconds(2) + MicroSeconds(link_down_time)){
+			std::cout << "Error: CHECKPOINT_TIME must be before the link down of LINK_DOWN\n";
+			return 1;
+		}
+	}
+	if (checkpoint_flow_file.size() > 0 && checkpoint_restore_file.empty()){
+		std::cout << "Error: CHECKPOINT_FLOW_FILE needs CHECKPOINT_RESTORE_FILE\n";
+		return 1;
+	}
 
 	bool dynamicth = use_dynamic_pfc_threshold;
 
-	Config::SetDefault("ns3::QbbNetDevice::PauseTime", UintegerValue(pause_time));
-	Config::SetDefault("ns3::QbbNetDevice::QcnEnabled", BooleanValue(enable_qcn));
-	Config::SetDefault("ns3::QbbNetDevice::DynamicThreshold", BooleanValue(dynamicth));
-
 	// set int_multi
 	IntHop::multi = int_multi;
+	// FIDCC INT encoding of the packets sent by the hosts; switches and border routers follow the version in each header
+	NS_ASSERT_MSG(int_version == 1 || int_version == 2, "INT_VERSION must be 1 or 2");
+	MyIntHeader::version = int_version;
 	// IntHeader::mode
 	if (cc_mode == 7) // timely, use ts
 		IntHeader::mode = IntHeader::TS;
@@ -802,11 +1504,13 @@ int main(int argc, char *argv[])
 	//SeedManager::SetSeed(time(NULL));
 
 	topof.open(topology_file.c_str());
-	flowf.open(flow_file.c_str());
+	flow_reader.f.open(flow_file.c_str());
 	tracef.open(trace_file.c_str());
 	uint32_t node_num, switch_num, en_num,link_num, trace_num;
 	topof >> node_num >> switch_num >>en_num >>link_num;
-	flowf >> flow_num;
+	flow_reader.f >> flow_reader.num;
+	if (int_version == 1 && node_num > 256)
+		printf("Warning: INT_VERSION 1 carries 8-bit node ids, ids of the %u nodes will alias; use INT_VERSION 2\n", node_num);
 	tracef >> trace_num;
 
 
@@ -824,15 +1528,19 @@ int main(int argc, char *argv[])
 		topof >> eid;
 		node_type[eid] = 2;
 	}	
+	link_input.resize(link_num);
+	for (uint32_t i = 0; i < link_num; i++)
+		topof >> link_input[i].src >> link_input[i].dst >> link_input[i].data_rate >> link_input[i].link_delay >> link_input[i].error_rate;
+	PartitionNodes(node_num, node_type);
 	for (uint32_t i = 0; i < node_num; i++){
 		if (node_type[i] == 0)
-			n.Add(CreateObject<Node>());
+			n.Add(CreateObject<Node>(node_system_id[i]));
 		else if(node_type[i] == 1){
-			Ptr<SwitchNode> sw = CreateObject<SwitchNode>();
+			Ptr<SwitchNode> sw = CreateObject<SwitchNode>(node_system_id[i]);
 			n.Add(sw);
 			sw->SetAttribute("EcnEnabled", BooleanValue(enable_qcn));
 		}else{
-			Ptr<EnquserverNode> en = CreateObject<EnquserverNode>();
+			Ptr<EnquserverNode> en = CreateObject<EnquserverNode>(node_system_id[i]);
 			n.Add(en);
 			en->SetAttribute("EcnEnabled", BooleanValue(enable_qcn));
 		}
@@ -868,16 +1576,29 @@ int main(int argc, char *argv[])
 	rem->SetAttribute("ErrorRate", DoubleValue(error_rate_per_link));
 	rem->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
 
-	FILE *pfc_file = fopen(pfc_output_file.c_str(), "w");
+	if (output_format != "text" && output_format != "binary"){
+		std::cout << "Error: unknown OUTPUT_FORMAT " << output_format << '\n';
+		return 1;
+	}
+	bool binary_output = output_format == "binary";
+	RecordSink::InstallExitHandlers();
+	Ptr<RecordSink> pfc_file = Create<RecordSink>();
+	if (!pfc_file->Open(rank_file_name(pfc_output_file), binary_output, RecordPfc, output_buffer_size)){
+		std::cout << "Error: cannot open PFC output file " << pfc_output_file << '\n';
+		return 1;
+	}
 
 	QbbHelper qbb;
+	// attributes of the devices of this run only: Config::SetDefault would change them for the whole process
+	qbb.SetDeviceAttribute("PauseTime", UintegerValue(pause_time));
+	qbb.SetDeviceAttribute("QcnEnabled", BooleanValue(enable_qcn));
+	qbb.SetDeviceAttribute("DynamicThreshold", BooleanValue(dynamicth));
 	Ipv4AddressHelper ipv4;
 	for (uint32_t i = 0; i < link_num; i++)
 	{
-		uint32_t src, dst;
-		std::string data_rate, link_delay;
-		double error_rate;
-		topof >> src >> dst >> data_rate >> link_delay >> error_rate;
+		uint32_t src = link_input[i].src, dst = link_input[i].dst;
+		std::string data_rate = link_input[i].data_rate, link_delay = link_input[i].link_delay;
+		double error_rate = link_input[i].error_rate;
 		std::cout << "src-------------- " << src << std::endl;
 		std::cout << "dst-------------- " << dst << std::endl;
 		std::cout << "data_rate----------- " << data_rate << std::endl;
@@ -939,11 +1660,11 @@ int main(int argc, char *argv[])
 		// niux: set max rate for egress port of switch
 		if (snode->GetNodeType() == 1){ // is switch
 			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(snode);
-			sw->max_rate[nbr2if[snode][dnode].idx] = nbr2if[snode][dnode].bw;
+			sw->SetMaxRate(nbr2if[snode][dnode].idx, nbr2if[snode][dnode].bw);
 		}
 		if (dnode->GetNodeType() == 1) {
 			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(dnode);
-			sw->max_rate[nbr2if[dnode][snode].idx] = nbr2if[dnode][snode].bw;
+			sw->SetMaxRate(nbr2if[dnode][snode].idx, nbr2if[dnode][snode].bw);
 		}
 
 
@@ -959,6 +1680,7 @@ int main(int argc, char *argv[])
 	}
 
 	nic_rate = get_nic_rate(n); //获得服务器节点网卡的rate
+	perf_phase("topology");
 
 	// config switch
 	for (uint32_t i = 0; i < node_num; i++){
@@ -969,10 +1691,9 @@ int main(int argc, char *argv[])
 				Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(sw->GetDevice(j));
 				// set ecn
 				uint64_t rate = dev->GetDataRate().GetBitRate();
-				//k NS_ASSERT_MSG(rate2kmin.find(rate) != rate2kmin.end(), "must set kmin for each link speed");
-				//k NS_ASSERT_MSG(rate2kmax.find(rate) != rate2kmax.end(), "must set kmax for each link speed");
-				//k NS_ASSERT_MSG(rate2pmax.find(rate) != rate2pmax.end(), "must set pmax for each link speed");
-				//k sw->m_mmu->ConfigEcn(j, rate2kmin[rate], rate2kmax[rate], rate2pmax[rate]);
+				// links whose speed is missing from the K*_MAPs are never marked
+				if (rate2kmin.find(rate) != rate2kmin.end() && rate2kmax.find(rate) != rate2kmax.end() && rate2pmax.find(rate) != rate2pmax.end())
+					sw->m_mmu->ConfigEcn(j, rate2kmin[rate], rate2kmax[rate], rate2pmax[rate]);
 				// set pfc
 				uint64_t delay = DynamicCast<QbbChannel>(dev->GetChannel())->GetDelay().GetTimeStep();
 				uint32_t headroom = rate * delay / 8 / 1000000000 * 3;
@@ -987,6 +1708,9 @@ int main(int argc, char *argv[])
 			}
 			sw->m_mmu->ConfigNPort(sw->GetNDevices()-1);
 			sw->m_mmu->ConfigBufferSize(buffer_size* 1024 * 1024);
+			sw->m_mmu->dynamic_egress = dynamic_egress_threshold;
+			for (auto &it : egress_alpha)
+				sw->m_mmu->ConfigEgressAlpha(it.first, it.second);
 			sw->m_mmu->node_id = sw->GetId();
 		}
 		else if (n.Get(i)->GetNodeType() == 2)// is border router
@@ -1021,12 +1745,16 @@ int main(int argc, char *argv[])
 	}
 
 	#if ENABLE_QP
-	FILE *fct_output = fopen(fct_output_file.c_str(), "w");
+	Ptr<RecordSink> fct_output = Create<RecordSink>();
+	if (!fct_output->Open(rank_file_name(fct_output_file), binary_output, RecordFct, output_buffer_size)){
+		std::cout << "Error: cannot open FCT output file " << fct_output_file << '\n';
+		return 1;
+	}
 	//
 	// install RDMA driver
 	//
 	for (uint32_t i = 0; i < node_num; i++){
-		if (n.Get(i)->GetNodeType() == 0){ // is server
+		if (n.Get(i)->GetNodeType() == 0 && n.Get(i)->GetSystemId() == system_id){ // is local server
 			// create RdmaHw
 			Ptr<RdmaHw> rdmaHw = CreateObject<RdmaHw>();
 			rdmaHw->SetAttribute("ClampTargetRate", BooleanValue(clamp_target_rate));
@@ -1040,6 +1768,7 @@ int main(int argc, char *argv[])
 			rdmaHw->SetAttribute("L2ChunkSize", UintegerValue(l2_chunk_size));
 			rdmaHw->SetAttribute("L2AckInterval", UintegerValue(l2_ack_interval));
 			rdmaHw->SetAttribute("CcMode", UintegerValue(cc_mode));
+			rdmaHw->SetAttribute("CcAlgorithm", StringValue(cc_algorithm));
 			rdmaHw->SetAttribute("RateDecreaseInterval", DoubleValue(rate_decrease_interval));
 			rdmaHw->SetAttribute("MinRate", DataRateValue(DataRate(min_rate)));
 			rdmaHw->SetAttribute("Mtu", UintegerValue(packet_payload_size));
@@ -1060,7 +1789,7 @@ int main(int argc, char *argv[])
 
 			node->AggregateObject (rdma);
 			rdma->Init();
-			rdma->TraceConnectWithoutContext("QpComplete", MakeBoundCallback (qp_finish, fct_output));
+			rdma->TraceConnectWithoutContext("FlowsComplete", MakeBoundCallback (flows_finish, fct_output));
 		}
 	}
 	#endif
@@ -1075,11 +1804,18 @@ int main(int argc, char *argv[])
 	CalculateRoutes(n);
 	// SetRoutingEntries();
 	SetRoutingEntriesEnc();
+	perf_phase("routing");
 
 	//
 	// get BDP and delay
 	//
 	maxRtt = maxBdp = 0;
+	host_idx.assign(node_num, 0);
+	host_num = 0;
+	for (uint32_t i = 0; i < node_num; i++)
+		if (n.Get(i)->GetNodeType() == 0)
+			host_idx[i] = host_num++;
+	pair_info.resize((uint64_t)host_num * host_num);
 	for (uint32_t i = 0; i < node_num; i++){
 		if (n.Get(i)->GetNodeType() != 0)
 			continue;
@@ -1092,8 +1828,10 @@ int main(int argc, char *argv[])
 			uint64_t bw = pairBw[i][j];
 			//uint64_t bdp = rtt * bw / 1000000000/8; 
 			uint64_t bdp = (rtt/1000000)*bw/1000/8;
-			pairBdp[n.Get(i)][n.Get(j)] = bdp;
-			pairRtt[i][j] = rtt;
+			PairInfo &pair = get_pair_info(i, j);
+			pair.rtt = rtt;
+			pair.bdp = bdp;
+			pair.bw = bw;
 			if (bdp > maxBdp)
 				maxBdp = bdp;
 			if (rtt > maxRtt)
@@ -1128,15 +1866,23 @@ int main(int argc, char *argv[])
 	{
 		uint32_t nid;
 		tracef >> nid;
-		if (nid >= n.GetN()){
+		if (nid >= n.GetN() || n.Get(nid)->GetSystemId() != system_id){
 			continue;
 		}
 		trace_nodes = NodeContainer(trace_nodes, n.Get(nid));
 	}
 
-	FILE *trace_output = fopen(trace_output_file.c_str(), "w");
-	if (enable_trace)
+	// written by a background thread, so the simulation does not wait for the disk
+	Ptr<TraceWriter> trace_output = Create<TraceWriter>();
+	if (!trace_output->Open(rank_file_name(trace_output_file), trace_buffer_size, trace_buffer_num, trace_direct_io)){
+		std::cout << "Error: cannot open trace output file " << trace_output_file << '\n';
+		return 1;
+	}
+	if (enable_trace){
+		qbb.SetTraceFilter(trace_filter);
+		qbb.SetTraceSampling(trace_sample, trace_sample_per_flow);
 		qbb.EnableTracing(trace_output, trace_nodes);
+	}
 
 	// dump link speed to trace file
 	{
@@ -1150,7 +1896,13 @@ int main(int argc, char *argv[])
 			}
 		}
 		sim_setting.win = maxBdp;
-		sim_setting.Serialize(trace_output);
+		char *buf;
+		size_t len;
+		FILE *mem = open_memstream(&buf, &len);
+		sim_setting.Serialize(mem);
+		fclose(mem);
+		trace_output->Write(buf, len);
+		free(buf);
 	}
 
 	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
@@ -1168,23 +1920,36 @@ int main(int argc, char *argv[])
 			}
 	}
 
-	flow_input.idx = 0;
-	if (flow_num > 0){
-		ReadFlowInput();
-		Simulator::Schedule(Seconds(flow_input.start_time)-Simulator::Now(), ScheduleFlowInputs);
-	}
+	pending_flows.resize(node_num);
+	pending_flows_event.resize(node_num);
+	// a restored run has the state of its flows in the checkpoint
+	if (checkpoint_restore_file.empty())
+		StartFlowInput(&flow_reader);
 
 	topof.close();
 	tracef.close();
 
 	// schedule link down
-	if (link_down_time > 0){
-		Simulator::Schedule(Seconds(2) + MicroSeconds(link_down_time), &TakeDownLink, n, n.Get(link_down_A), n.Get(link_down_B));
+	if (link_down_time > 0 && checkpoint_restore_file.empty()){
+		link_down_event = Simulator::Schedule(Seconds(2) + MicroSeconds(link_down_time), &TakeDownLink, n, n.Get(link_down_A), n.Get(link_down_B));
 	}
 
 	// schedule buffer monitor
-	FILE* qlen_output = fopen(qlen_mon_file.c_str(), "w");
-	Simulator::Schedule(NanoSeconds(qlen_mon_start), &monitor_buffer, qlen_output, &n);
+	Ptr<RecordSink> qlen_output = Create<RecordSink>();
+	bool qlen_open = qlen_output->Open(rank_file_name(qlen_mon_file), binary_output, RecordQlen, output_buffer_size);
+	if (!qlen_open)
+		std::cout << "Warning: cannot open qlen output file " << qlen_mon_file << ", queue lengths are not monitored\n";
+	else if (checkpoint_restore_file.empty())
+		qlen_mon_event = Simulator::Schedule(NanoSeconds(qlen_mon_start), &monitor_buffer, qlen_output, &n);
+
+	// schedule drop/retransmission counter sampling
+	FILE* stats_output = NULL;
+	if (stats_mon_file.size() > 0){
+		RegisterStats();
+		stats_output = fopen(rank_file_name(stats_mon_file).c_str(), "w");
+		if (checkpoint_restore_file.empty())
+			stats.StartSampling(stats_output, NanoSeconds(stats_mon_interval), Seconds(simulator_stop_time));
+	}
 
 	//
 	// Now, do the actual simulation.
@@ -1192,13 +1957,187 @@ int main(int argc, char *argv[])
 	std::cout << "Running Simulation.\n";
 	fflush(stdout);
 	NS_LOG_INFO("Run Simulation.");
-	Simulator::Stop(Seconds(simulator_stop_time));
+	int ret = 0;
+	std::string error;
+	if (checkpoint_restore_file.size() > 0){
+		// the nodes initialize at time 0 (see NodeList::Add), then the checkpoint replaces what they scheduled
+		Simulator::Stop(Seconds(0));
+		Simulator::Run();
+		if (!restore_checkpoint(checkpoint_restore_file, stats_output, qlen_output, qlen_open, error)){
+			std::cout << "Error: cannot restore checkpoint " << checkpoint_restore_file << ": " << error << '\n';
+			return 1;
+		}
+		printf("restored checkpoint at %lu ns\n", Simulator::Now().GetTimeStep());
+		if (checkpoint_flow_file.size() > 0){
+			extra_flow_reader.f.open(checkpoint_flow_file.c_str());
+			extra_flow_reader.f >> extra_flow_reader.num;
+			if (!extra_flow_reader.f || !StartFlowInput(&extra_flow_reader)){
+				std::cout << "Error: cannot read " << checkpoint_flow_file << ", whose flows must start after the checkpoint\n";
+				return 1;
+			}
+		}
+		// the run may stop at another time than the saved one
+		if (stop_event.GetTs() != (uint64_t)Seconds(simulator_stop_time).GetTimeStep()){
+			if (Seconds(simulator_stop_time) <= Simulator::Now()){
+				std::cout << "Error: SIMULATOR_STOP_TIME must be after the checkpoint\n";
+				return 1;
+			}
+			stop_event.Cancel();
+			stop_event = Simulator::Schedule(Seconds(simulator_stop_time) - Simulator::Now(), static_cast<void (*)(void)>(&Simulator::Stop));
+		}
+	}else if (checkpoint_time > 0){
+		Simulator::Stop(Seconds(checkpoint_time));
+		// scheduled now, as Stop(Seconds(simulator_stop_time)) would be, so that the run ends after the same events
+		stop_event = Simulator::Schedule(Seconds(simulator_stop_time), static_cast<void (*)(void)>(&Simulator::Stop));
+	}else
+		Simulator::Stop(Seconds(simulator_stop_time));
+	perf_phase("setup");
 	Simulator::Run();
+	if (checkpoint_time > 0){
+		perf_phase("warmup");
+		if (!save_checkpoint(checkpoint_save_file, stats_output, error)){
+			std::cout << "Error: cannot save checkpoint " << checkpoint_save_file << ": " << error << '\n';
+			ret = 1;
+		}
+		Simulator::Run();
+	}
+	flush_completions();
+	perf_phase("run");
+	uint64_t perf_events = Simulator::GetEventCount();
+	uint64_t perf_sim_ns = Simulator::Now().GetTimeStep();
+	if (stats_output){
+		stats.Sample(stats_output); // counters live in the nodes, so sample before they are disposed
+		fclose(stats_output);
+	}
+#ifdef NS3_MEM_PROFILE
+	mem_report(); // while the nodes and packets still exist
+#endif
 	Simulator::Destroy();
 	NS_LOG_INFO("Done.");
-	fclose(trace_output);
+	trace_output->Close();
+	if (enable_trace)
+		trace_output->PrintStats(stdout);
+	qlen_output->Close();
+	uint32_t header_size = binary_output ? sizeof(RecordFileHeader) : 0;
+	pfc_file->Close();
+	MergeRankFiles(pfc_output_file, header_size);
+#if ENABLE_QP
+	fct_output->Close();
+	MergeRankFiles(fct_output_file, header_size);
+#endif
+	if (stats_mon_file.size() > 0)
+		MergeRankFiles(stats_mon_file);
+	perf_phase("teardown");
 
 	endt = clock();
 	std::cout << (double)(endt - begint) / CLOCKS_PER_SEC << "\n";
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("perf: rank %u events %lu sim_ns %lu wall %.6f maxrss_kb %ld\n", system_id, perf_events, perf_sim_ns, wall_time() - perf_start, usage.ru_maxrss);
+	for (auto &p : perf_phases)
+		printf("perf_phase: rank %u %s %.6f\n", system_id, p.first.c_str(), p.second);
+	return ret;
+}
 
+/******************************************************
+ * Batch mode: third --batch <list> [threads] runs the config files listed
+ * in <list> (one per line, # for comments) as independent simulations in
+ * this process, at most [threads] (default: one per core) at a time.
+ * Each run gets a new thread, hence its own simulator (see Simulator) and
+ * a fresh copy of the thread_local state above, so it produces the same
+ * output as when run alone. The configs must name distinct output files;
+ * what the runs print to stdout is interleaved.
+ ******************************************************/
+struct BatchRun{
+	std::string config;
+	int result;
+};
+struct BatchQueue{
+	std::vector<BatchRun> runs;
+	uint32_t next;
+	SystemMutex lock;
+};
+
+void RunBatchScenario(BatchRun *run){
+	run->result = RunScenario(run->config.c_str(), NULL);
+	Simulator::Destroy(); // in case the run stopped at an error
+}
+
+void RunBatchWorker(BatchQueue *q){
+	while (true){
+		uint32_t i;
+		{
+			CriticalSection cs(q->lock);
+			if (q->next >= q->runs.size())
+				return;
+			i = q->next++;
+		}
+		Ptr<SystemThread> t = Create<SystemThread>(MakeBoundCallback(&RunBatchScenario, &q->runs[i]));
+		t->Start();
+		t->Join();
+	}
+}
+
+int RunBatch(const char *list, uint32_t threads){
+	if (system_count > 1){
+		std::cout << "Error: --batch does not run under mpirun\n";
+		return 1;
+	}
+	BatchQueue q;
+	q.next = 0;
+	std::ifstream in(list);
+	if (!in){
+		std::cout << "Error: cannot open batch list " << list << '\n';
+		return 1;
+	}
+	std::string line;
+	while (std::getline(in, line)){
+		std::istringstream ls(line);
+		BatchRun run;
+		if (!(ls >> run.config) || run.config[0] == '#')
+			continue;
+		run.result = -1;
+		q.runs.push_back(run);
+	}
+	if (threads == 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	threads = std::max(1u, std::min(threads, (uint32_t)q.runs.size()));
+	double start = wall_time();
+	std::vector<Ptr<SystemThread> > workers;
+	for (uint32_t i = 0; i < threads; i++){
+		workers.push_back(Create<SystemThread>(MakeBoundCallback(&RunBatchWorker, &q)));
+		workers.back()->Start();
+	}
+	for (uint32_t i = 0; i < workers.size(); i++)
+		workers[i]->Join();
+	int ret = 0;
+	for (auto &r : q.runs){
+		printf("batch: %s %d\n", r.config.c_str(), r.result);
+		if (r.result != 0)
+			ret = 1;
+	}
+	printf("batch: %lu runs, %u threads, wall %.6f\n", q.runs.size(), threads, wall_time() - start);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef NS3_MPI
+	// run with mpirun to split the topology over several processes
+	MpiInterface::Enable(&argc, &argv);
+	system_id = MpiInterface::GetSystemId();
+	system_count = MpiInterface::GetSize();
+	if (system_count > 1)
+		GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+	std::cout << "MPI rank " << system_id << " of " << system_count << "\n";
+#endif
+	int ret;
+	if (argc > 2 && strcmp(argv[1], "--batch") == 0)
+		ret = RunBatch(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+	else
+		ret = RunScenario(argc > 1 ? argv[1] : NULL, argc > 2 ? argv[2] : NULL);
+#ifdef NS3_MPI
+	MpiInterface::Disable();
+#endif
+	return ret;
 }
@@ -75,7 +75,7 @@ struct CallbackTraits<T *>
  * Abstract base class for CallbackImpl
  * Provides reference counting and equality test.
  */
-class CallbackImplBase : public SimpleRefCount<CallbackImplBase>
+class CallbackImplBase : public AtomicRefCount<CallbackImplBase>
 {
 public:
   /** Virtual destructor */
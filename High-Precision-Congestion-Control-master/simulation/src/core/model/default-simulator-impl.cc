@@ -29,6 +29,9 @@
 #include "log.h"
 
 #include <cmath>
+#ifdef NS3_EVENT_PROFILE
+#include <iostream>
+#endif
 
 // Note:  Logging in this file is largely avoided due to the
 // number of calls that are made to these functions and the possibility
@@ -63,6 +66,7 @@ DefaultSimulatorImpl::DefaultSimulatorImpl ()
   m_currentUid = 0;
   m_currentTs = 0;
   m_currentContext = 0xffffffff;
+  m_eventCount = 0;
   m_unscheduledEvents = 0;
   m_eventsWithContextEmpty = true;
 #if HAVE_PTHREAD_H
@@ -101,6 +105,9 @@ DefaultSimulatorImpl::Destroy ()
           ev->Invoke ();
         }
     }
+#ifdef NS3_EVENT_PROFILE
+  m_profiler.Report (std::cout, GetSystemId ());
+#endif
 }
 
 void
@@ -139,7 +146,12 @@ DefaultSimulatorImpl::ProcessOneEvent (void)
   m_currentTs = next.key.m_ts;
   m_currentContext = next.key.m_context;
   m_currentUid = next.key.m_uid;
+  m_eventCount++;
+#ifdef NS3_EVENT_PROFILE
+  m_profiler.Invoke (next.impl);
+#else
   next.impl->Invoke ();
+#endif
   next.impl->Unref ();
 
   ProcessEventsWithContext ();
@@ -321,6 +333,89 @@ DefaultSimulatorImpl::ScheduleDestroy (EventImpl *event)
   return id;
 }
 
+//
+// Take the uid of an event scheduled now, without scheduling it: an event
+// scheduled later in this slot runs in the same order as if it had been
+// scheduled here.
+//
+EventId
+DefaultSimulatorImpl::Reserve (uint32_t context, Time const &time)
+{
+#ifdef HAVE_PTHREAD_H 
+  NS_ASSERT_MSG (SystemThread::Equals (m_main), "Simulator::Reserve Thread-unsafe invocation!");
+#endif
+  Time tAbsolute = time + TimeStep (m_currentTs);
+  NS_ASSERT (tAbsolute >= TimeStep (m_currentTs));
+  EventId slot (0, (uint64_t) tAbsolute.GetTimeStep (), context, m_uid);
+  m_uid++;
+  return slot;
+}
+
+EventId
+DefaultSimulatorImpl::ScheduleReserved (const EventId &slot, EventImpl *event)
+{
+#ifdef HAVE_PTHREAD_H 
+  NS_ASSERT_MSG (SystemThread::Equals (m_main), "Simulator::ScheduleReserved Thread-unsafe invocation!");
+#endif
+  NS_ASSERT_MSG (!IsPassed (slot), "Simulator::ScheduleReserved: the slot has passed");
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = slot.GetTs ();
+  ev.key.m_context = slot.GetContext ();
+  ev.key.m_uid = slot.GetUid ();
+  m_unscheduledEvents++;
+  m_events->Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+bool
+DefaultSimulatorImpl::IsPassed (const EventId &slot) const
+{
+  return slot.GetTs () < m_currentTs ||
+         (slot.GetTs () == m_currentTs && slot.GetUid () <= m_currentUid);
+}
+
+Simulator::Clock
+DefaultSimulatorImpl::GetClock (void) const
+{
+  Simulator::Clock clock;
+  clock.ts = m_currentTs;
+  clock.uid = m_currentUid;
+  clock.nextUid = m_uid;
+  clock.context = m_currentContext;
+  clock.eventCount = m_eventCount;
+  return clock;
+}
+
+void
+DefaultSimulatorImpl::SetClock (const Simulator::Clock &clock)
+{
+  NS_ASSERT_MSG (m_events->IsEmpty () && m_eventsWithContextEmpty, "Simulator::SetClock: events are pending");
+  NS_ASSERT_MSG (clock.ts >= m_currentTs && clock.nextUid >= m_uid, "Simulator::SetClock: the clock goes back");
+  m_currentTs = clock.ts;
+  m_currentUid = clock.uid;
+  m_uid = clock.nextUid;
+  m_currentContext = clock.context;
+  m_eventCount = clock.eventCount;
+}
+
+void
+DefaultSimulatorImpl::GetEvents (std::vector<EventId> &events)
+{
+  NS_ASSERT_MSG (m_eventsWithContextEmpty, "Simulator::GetEvents: events of other threads are pending");
+  // the scheduler cannot be walked: take the events out and put them back
+  std::vector<Scheduler::Event> pending;
+  while (!m_events->IsEmpty ())
+    {
+      pending.push_back (m_events->RemoveNext ());
+    }
+  for (uint32_t i = 0; i < pending.size (); i++)
+    {
+      m_events->Insert (pending[i]);
+      events.push_back (EventId (pending[i].impl, pending[i].key.m_ts, pending[i].key.m_context, pending[i].key.m_uid));
+    }
+}
+
 Time
 DefaultSimulatorImpl::Now (void) const
 {
@@ -431,4 +526,10 @@ DefaultSimulatorImpl::GetContext (void) const
   return m_currentContext;
 }
 
+uint64_t
+DefaultSimulatorImpl::GetEventCount (void) const
+{
+  return m_eventCount;
+}
+
 } // namespace ns3
@@ -24,6 +24,7 @@
 #include "simulator-impl.h"
 #include "scheduler.h"
 #include "event-impl.h"
+#include "event-profiler.h"
 #if HAVE_PTHREAD_H
 #include "system-thread.h"
 #include "ns3/system-mutex.h"
@@ -64,6 +65,13 @@ public:
   virtual void SetScheduler (ObjectFactory schedulerFactory);
   virtual uint32_t GetSystemId (void) const; 
   virtual uint32_t GetContext (void) const;
+  virtual uint64_t GetEventCount (void) const;
+  virtual EventId Reserve (uint32_t context, Time const &time);
+  virtual EventId ScheduleReserved (const EventId &slot, EventImpl *event);
+  virtual bool IsPassed (const EventId &slot) const;
+  virtual Simulator::Clock GetClock (void) const;
+  virtual void SetClock (const Simulator::Clock &clock);
+  virtual void GetEvents (std::vector<EventId> &events);
 
 private:
   virtual void DoDispose (void);
@@ -91,6 +99,10 @@ private:
   uint32_t m_currentUid;
   uint64_t m_currentTs;
   uint32_t m_currentContext;
+  uint64_t m_eventCount;
+#ifdef NS3_EVENT_PROFILE
+  EventProfiler m_profiler;
+#endif
   // number of events that have been inserted but not yet scheduled,
   // not counting the "destroy" events; this is used for validation
   int m_unscheduledEvents;
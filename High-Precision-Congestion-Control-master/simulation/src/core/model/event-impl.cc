@@ -60,4 +60,12 @@ EventImpl::IsCancelled (void)
   return m_cancel;
 }
 
+#ifdef NS3_EVENT_PROFILE
+const void *
+EventImpl::GetProfileTarget (void)
+{
+  return 0;
+}
+#endif
+
 } // namespace ns3
@@ -57,6 +57,13 @@ public:
    * Invoked by the simulation engine before calling Invoke.
    */
   bool IsCancelled (void);
+#ifdef NS3_EVENT_PROFILE
+  /**
+   * \returns the address of the function this event calls, used to key
+   * the event profile (see EventProfiler); 0 if unknown.
+   */
+  virtual const void *GetProfileTarget (void);
+#endif
 
 protected:
   virtual void Notify (void) = 0;
@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "event-profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+
+namespace ns3 {
+
+static double
+WallNs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static std::string
+Demangle (const char *name)
+{
+  int status;
+  char *s = abi::__cxa_demangle (name, 0, 0, &status);
+  if (status != 0)
+    {
+      return name;
+    }
+  std::string res (s);
+  std::free (s);
+  return res;
+}
+
+// the function at target, or the event class if the symbol is not exported
+// (link the program with -rdynamic to name functions of the executable)
+static std::string
+TargetName (const std::type_info *type, const void *target)
+{
+  Dl_info info;
+  if (target != 0 && dladdr (target, &info) != 0 && info.dli_sname != 0)
+    {
+      return Demangle (info.dli_sname);
+    }
+  char addr[32];
+  std::snprintf (addr, sizeof (addr), "%p ", target);
+  return addr + Demangle (type->name ());
+}
+
+EventProfiler::EventProfiler ()
+  : m_startCycles (0),
+    m_startWall (0)
+{
+}
+
+void
+EventProfiler::Record (EventImpl *event, const void *target, bool cancelled, uint64_t cycles)
+{
+  if (m_startCycles == 0)
+    {
+      m_startCycles = GetCycles ();
+      m_startWall = WallNs ();
+    }
+  Key k = {&typeid (*event), target};
+  Entry &e = m_entries[k];
+  e.events++;
+  e.cancelled += cancelled;
+  e.cycles += cycles;
+}
+
+void
+EventProfiler::Report (std::ostream &os, uint32_t rank) const
+{
+  typedef std::pair<Key, Entry> Item;
+  std::vector<Item> items (m_entries.begin (), m_entries.end ());
+  uint64_t total = 0, events = 0;
+  for (std::vector<Item>::const_iterator i = items.begin (); i != items.end (); i++)
+    {
+      total += i->second.cycles;
+      events += i->second.events;
+    }
+  if (events == 0)
+    {
+      return;
+    }
+  std::sort (items.begin (), items.end (), [] (const Item &a, const Item &b) {
+               return a.second.cycles > b.second.cycles;
+             });
+  double nsPerCycle = (WallNs () - m_startWall) / (GetCycles () - m_startCycles);
+  char line[128];
+  std::snprintf (line, sizeof (line), "event_profile: %u total %lu cycles %lu ns %.0f ns/cycle %.4f\n",
+                 rank, events, total, total * nsPerCycle, nsPerCycle);
+  os << line;
+  for (std::vector<Item>::const_iterator i = items.begin (); i != items.end (); i++)
+    {
+      const Entry &e = i->second;
+      std::snprintf (line, sizeof (line), "event_profile: %u %lu %lu %lu %.2f %.0f %.0f ",
+                     rank, e.events, e.cancelled, e.cycles, 100.0 * e.cycles / total,
+                     (double)e.cycles / e.events, e.cycles * nsPerCycle);
+      // cancelled events are keyed by class only: their object may be gone
+      os << line << (i->first.target == 0 && e.cancelled == e.events ? "(cancelled) " + Demangle (i->first.type->name ())
+                                                                     : TargetName (i->first.type, i->first.target)) << "\n";
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,104 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include <stdint.h>
+#include <ostream>
+#include <typeinfo>
+#include <unordered_map>
+#include "event-impl.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ * \brief Event counts and run time per event target.
+ *
+ * Used by the simulator implementations when ns-3 is configured with
+ * --enable-event-profile (NS3_EVENT_PROFILE); without it nothing is
+ * recorded and the event loop is unchanged.
+ *
+ * Events are keyed by the function they call (EventImpl::GetProfileTarget)
+ * and by their EventImpl class, in a hash table. Time is measured with the
+ * cycle counter and converted to ns with the wall clock over the profiled
+ * period. Report writes one line per key, the most expensive first:
+ *
+ *   event_profile: <rank> <events> <cancelled> <cycles> <% of cycles> <cycles/event> <ns> <function>
+ */
+class EventProfiler
+{
+public:
+  EventProfiler ();
+
+  static inline uint64_t GetCycles (void)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc ();
+#else
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+  }
+
+#ifdef NS3_EVENT_PROFILE
+  /**
+   * Invoke the event and record it. The target is read before the call, in
+   * case the event destroys its object.
+   */
+  inline void Invoke (EventImpl *event)
+  {
+    bool cancelled = event->IsCancelled ();
+    const void *target = cancelled ? 0 : event->GetProfileTarget ();
+    uint64_t start = GetCycles ();
+    event->Invoke ();
+    Record (event, target, cancelled, GetCycles () - start);
+  }
+#endif
+  /**
+   * \param event the event that ran, before it is unreferenced
+   * \param target the function it called, 0 if unknown
+   * \param cancelled the event was cancelled, so only counted
+   * \param cycles cycles spent in EventImpl::Invoke
+   */
+  void Record (EventImpl *event, const void *target, bool cancelled, uint64_t cycles);
+  void Report (std::ostream &os, uint32_t rank) const;
+
+private:
+  struct Key
+  {
+    const std::type_info *type;
+    const void *target;
+    bool operator == (const Key &o) const
+    {
+      return type == o.type && target == o.target;
+    }
+  };
+  struct KeyHash
+  {
+    size_t operator () (const Key &k) const
+    {
+      return (size_t)k.target * 0x9e3779b97f4a7c15ull ^ (size_t)k.type;
+    }
+  };
+  struct Entry
+  {
+    uint64_t events;
+    uint64_t cancelled;
+    uint64_t cycles;
+  };
+
+  std::unordered_map<Key, Entry, KeyHash> m_entries;
+  uint64_t m_startCycles;
+  double m_startWall;
+};
+
+} // namespace ns3
+
+#endif /* EVENT_PROFILER_H */
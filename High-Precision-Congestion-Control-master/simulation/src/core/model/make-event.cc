@@ -27,6 +27,7 @@ protected:
       (*m_function)();
     }
 private:
+    NS_EVENT_PROFILE_FUNCTION_TARGET
     F m_function;
   } *ev = new EventFunctionImpl0 (f);
   return ev;
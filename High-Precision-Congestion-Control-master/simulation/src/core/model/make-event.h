@@ -58,6 +58,11 @@ EventImpl * MakeEvent (void (*f)(U1,U2,U3,U4,U5), T1 a1, T2 a2, T3 a3, T4 a4, T5
 
 #include "event-impl.h"
 #include "type-traits.h"
+#ifdef NS3_EVENT_PROFILE
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+#endif
 
 namespace ns3 {
 
@@ -73,6 +78,49 @@ struct EventMemberImplObjTraits<T *>
   }
 };
 
+#ifdef NS3_EVENT_PROFILE
+/**
+ * \returns the code a pointer to member function calls on obj, for the
+ * event profile. Reads the Itanium C++ ABI representation {ptr, adj}: ptr
+ * is the function address, or 1 + the vtable offset of a virtual function;
+ * 0 with other ABIs.
+ */
+template <typename M, typename C, typename T>
+const void *EventProfileMemberTarget (M C::*mem, T *obj)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  struct
+  {
+    uintptr_t ptr;
+    ptrdiff_t adj;
+  } rep = {0, 0};
+  std::memcpy (&rep, &mem, sizeof (mem) < sizeof (rep) ? sizeof (mem) : sizeof (rep));
+  if ((rep.ptr & 1) == 0)
+    {
+      return reinterpret_cast<const void *> (rep.ptr);
+    }
+  const C *self = obj;
+  const void * const *vtable = *reinterpret_cast<const void * const * const *> (reinterpret_cast<const char *> (self) + rep.adj);
+  return vtable[(rep.ptr - 1) / sizeof (void *)];
+#else
+  return 0;
+#endif
+}
+#define NS_EVENT_PROFILE_MEMBER_TARGET \
+  virtual const void *GetProfileTarget (void) \
+  { \
+    return EventProfileMemberTarget (m_function, &EventMemberImplObjTraits<OBJ>::GetReference (m_obj)); \
+  }
+#define NS_EVENT_PROFILE_FUNCTION_TARGET \
+  virtual const void *GetProfileTarget (void) \
+  { \
+    return reinterpret_cast<const void *> (m_function); \
+  }
+#else
+#define NS_EVENT_PROFILE_MEMBER_TARGET
+#define NS_EVENT_PROFILE_FUNCTION_TARGET
+#endif
+
 template <typename MEM, typename OBJ>
 EventImpl * MakeEvent (MEM mem_ptr, OBJ obj)
 {
@@ -93,6 +141,7 @@ private:
     {
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function)();
     }
+    NS_EVENT_PROFILE_MEMBER_TARGET
     OBJ m_obj;
     MEM m_function;
   } *ev = new EventMemberImpl0 (obj, mem_ptr);
@@ -123,6 +172,7 @@ private:
     {
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function)(m_a1);
     }
+    NS_EVENT_PROFILE_MEMBER_TARGET
     OBJ m_obj;
     MEM m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
@@ -154,6 +204,7 @@ private:
     {
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function)(m_a1, m_a2);
     }
+    NS_EVENT_PROFILE_MEMBER_TARGET
     OBJ m_obj;
     MEM m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
@@ -187,6 +238,7 @@ private:
     {
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function)(m_a1, m_a2, m_a3);
     }
+    NS_EVENT_PROFILE_MEMBER_TARGET
     OBJ m_obj;
     MEM m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
@@ -222,6 +274,7 @@ private:
     {
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function)(m_a1, m_a2, m_a3, m_a4);
     }
+    NS_EVENT_PROFILE_MEMBER_TARGET
     OBJ m_obj;
     MEM m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
@@ -260,6 +313,7 @@ private:
     {
       (EventMemberImplObjTraits<OBJ>::GetReference (m_obj).*m_function)(m_a1, m_a2, m_a3, m_a4, m_a5);
     }
+    NS_EVENT_PROFILE_MEMBER_TARGET
     OBJ m_obj;
     MEM m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
@@ -294,6 +348,7 @@ private:
     {
       (*m_function)(m_a1);
     }
+    NS_EVENT_PROFILE_FUNCTION_TARGET
     F m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
   } *ev = new EventFunctionImpl1 (f, a1);
@@ -324,6 +379,7 @@ private:
     {
       (*m_function)(m_a1, m_a2);
     }
+    NS_EVENT_PROFILE_FUNCTION_TARGET
     F m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
     typename TypeTraits<T2>::ReferencedType m_a2;
@@ -357,6 +413,7 @@ private:
     {
       (*m_function)(m_a1, m_a2, m_a3);
     }
+    NS_EVENT_PROFILE_FUNCTION_TARGET
     F m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
     typename TypeTraits<T2>::ReferencedType m_a2;
@@ -392,6 +449,7 @@ private:
     {
       (*m_function)(m_a1, m_a2, m_a3, m_a4);
     }
+    NS_EVENT_PROFILE_FUNCTION_TARGET
     F m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
     typename TypeTraits<T2>::ReferencedType m_a2;
@@ -429,6 +487,7 @@ private:
     {
       (*m_function)(m_a1, m_a2, m_a3, m_a4, m_a5);
     }
+    NS_EVENT_PROFILE_FUNCTION_TARGET
     F m_function;
     typename TypeTraits<T1>::ReferencedType m_a1;
     typename TypeTraits<T2>::ReferencedType m_a2;
@@ -0,0 +1,117 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "mem-profiler.h"
+#include "assert.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace ns3 {
+
+thread_local MemProfiler::Counter MemProfiler::m_counters[MemProfiler::MAX_CATEGORIES];
+
+// the categories are registered by static initializers, before any thread
+// starts; a function static, as those of other libraries may run before ours
+struct MemCategory
+{
+  const char *name;
+  bool inTotal;
+};
+
+static MemCategory *
+Categories (uint32_t **n)
+{
+  static MemCategory categories[MemProfiler::MAX_CATEGORIES];
+  static uint32_t size = 0;
+  *n = &size;
+  return categories;
+}
+
+uint32_t
+MemProfiler::Register (const char *name, bool inTotal)
+{
+  uint32_t *n;
+  MemCategory *categories = Categories (&n);
+  for (uint32_t i = 0; i < *n; i++)
+    {
+      if (std::strcmp (categories[i].name, name) == 0)
+        {
+          return i;
+        }
+    }
+  NS_ASSERT_MSG (*n < MAX_CATEGORIES, "too many memory categories");
+  categories[*n].name = name;
+  categories[*n].inTotal = inTotal;
+  return (*n)++;
+}
+
+uint32_t
+MemProfiler::GetN (void)
+{
+  uint32_t *n;
+  Categories (&n);
+  return *n;
+}
+
+const char *
+MemProfiler::GetName (uint32_t category)
+{
+  uint32_t *n;
+  return Categories (&n)[category].name;
+}
+
+bool
+MemProfiler::IsInTotal (uint32_t category)
+{
+  uint32_t *n;
+  return Categories (&n)[category].inTotal;
+}
+
+const MemProfiler::Counter &
+MemProfiler::Get (uint32_t category)
+{
+  return m_counters[category];
+}
+
+uint64_t
+MemProfiler::GetTotalBytes (void)
+{
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < GetN (); i++)
+    {
+      if (IsInTotal (i))
+        {
+          total += m_counters[i].bytes;
+        }
+    }
+  return total;
+}
+
+void
+MemProfiler::Report (std::ostream &os, uint32_t rank)
+{
+  std::vector<uint32_t> used;
+  for (uint32_t i = 0; i < GetN (); i++)
+    {
+      if (m_counters[i].allocs != 0)
+        {
+          used.push_back (i);
+        }
+    }
+  std::sort (used.begin (), used.end (), [] (uint32_t a, uint32_t b) {
+               return m_counters[a].bytes > m_counters[b].bytes;
+             });
+  char line[160];
+  for (std::vector<uint32_t>::const_iterator i = used.begin (); i != used.end (); i++)
+    {
+      const Counter &c = m_counters[*i];
+      std::snprintf (line, sizeof (line), "mem_profile: %u %lu %lu %lu %lu %s%s\n",
+                     rank, c.count, c.bytes, c.peak, c.allocs, GetName (*i),
+                     IsInTotal (*i) ? "" : " +");
+      os << line;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,95 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef MEM_PROFILER_H
+#define MEM_PROFILER_H
+
+#include <stdint.h>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * \ingroup core
+ * \brief Live bytes and objects per allocation category.
+ *
+ * A category is registered once by name, usually by a static in the .cc
+ * file of the class it counts (NS_MEM_CATEGORY), and the class reports
+ * its allocations and frees with NS_MEM_ALLOC / NS_MEM_FREE. These only
+ * count when ns-3 is configured with --enable-mem-profile (NS3_MEM_PROFILE);
+ * without it they compile to nothing.
+ *
+ * The counters are per thread, like the simulator, so the runs of a batch
+ * are counted separately. They can be read at any time (Get), e.g. from a
+ * scheduled event or by a stats sampler; Report writes one line per used
+ * category, the largest first:
+ *
+ *   mem_profile: <rank> <live objects> <live bytes> <peak bytes> <allocs> <category>
+ *
+ * Categories left out of the total end with a '+'.
+ */
+class MemProfiler
+{
+public:
+  struct Counter
+  {
+    uint64_t count;  //!< live objects
+    uint64_t bytes;  //!< live bytes
+    uint64_t peak;   //!< largest value of bytes
+    uint64_t allocs; //!< objects allocated so far
+  };
+
+  static const uint32_t MAX_CATEGORIES = 64;
+
+  /**
+   * \param name the category, e.g. "ns3::Packet"
+   * \param inTotal false for a category whose bytes are also counted by
+   *        another one (e.g. the packets held by queues), so that they are
+   *        left out of GetTotalBytes
+   * \returns its id; the same name always gets the same id
+   */
+  static uint32_t Register (const char *name, bool inTotal = true);
+
+  static inline void Alloc (uint32_t category, uint64_t bytes, uint64_t count = 1)
+  {
+    Counter &c = m_counters[category];
+    c.count += count;
+    c.allocs += count;
+    c.bytes += bytes;
+    if (c.bytes > c.peak)
+      {
+        c.peak = c.bytes;
+      }
+  }
+  static inline void Free (uint32_t category, uint64_t bytes, uint64_t count = 1)
+  {
+    Counter &c = m_counters[category];
+    c.count -= count;
+    c.bytes -= bytes;
+  }
+
+  static uint32_t GetN (void);
+  static const char *GetName (uint32_t category);
+  static const Counter &Get (uint32_t category);
+  static bool IsInTotal (uint32_t category);
+  /** \returns the live bytes of the categories that are in the total */
+  static uint64_t GetTotalBytes (void);
+  static void Report (std::ostream &os, uint32_t rank);
+
+private:
+  static thread_local Counter m_counters[MAX_CATEGORIES];
+};
+
+} // namespace ns3
+
+#ifdef NS3_MEM_PROFILE
+#define NS_MEM_CATEGORY(var, ...) \
+  static const uint32_t var = ns3::MemProfiler::Register (__VA_ARGS__)
+#define NS_MEM_ALLOC(category, ...) ns3::MemProfiler::Alloc (category, __VA_ARGS__)
+#define NS_MEM_FREE(category, ...) ns3::MemProfiler::Free (category, __VA_ARGS__)
+#else
+#define NS_MEM_CATEGORY(var, ...)
+#define NS_MEM_ALLOC(category, ...) ((void) 0)
+#define NS_MEM_FREE(category, ...) ((void) 0)
+#endif
+
+#endif /* MEM_PROFILER_H */
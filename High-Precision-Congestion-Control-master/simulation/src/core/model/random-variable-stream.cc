@@ -123,6 +123,20 @@ RandomVariableStream::GetStream(void) const
   return m_stream;
 }
 
+void
+RandomVariableStream::GetState (uint32_t state[6]) const
+{
+  NS_LOG_FUNCTION (this);
+  m_rng->GetState (state);
+}
+
+void
+RandomVariableStream::SetState (const uint32_t state[6])
+{
+  NS_LOG_FUNCTION (this);
+  m_rng->SetState (state);
+}
+
 RngStream *
 RandomVariableStream::Peek(void) const
 {
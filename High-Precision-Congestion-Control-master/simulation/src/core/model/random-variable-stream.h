@@ -129,6 +129,19 @@ public:
    */
   virtual uint32_t GetInteger (void) = 0;
 
+  /**
+   * \brief Copy the state of the underlying RNG stream, see RngStream::GetState.
+   *
+   * This is the whole state of a UniformRandomVariable; the variables
+   * that keep a draw for the next call (NormalRandomVariable...) have more.
+   */
+  void GetState (uint32_t state[6]) const;
+
+  /**
+   * \brief Continue the underlying RNG stream from a state of GetState.
+   */
+  void SetState (const uint32_t state[6]);
+
 protected:
   /**
    * \brief Returns a pointer to the underlying RNG stream.
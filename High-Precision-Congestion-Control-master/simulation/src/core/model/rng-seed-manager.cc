@@ -9,7 +9,8 @@ NS_LOG_COMPONENT_DEFINE ("RngSeedManager");
 
 namespace ns3 {
 
-static uint64_t g_nextStreamIndex = 0;
+// per thread, like the simulation the streams belong to (see Simulator)
+static thread_local uint64_t g_nextStreamIndex = 0;
 static ns3::GlobalValue g_rngSeed ("RngSeed", 
                                    "The global seed of all rng streams",
                                    ns3::IntegerValue(1),
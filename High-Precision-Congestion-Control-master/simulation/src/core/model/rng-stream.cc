@@ -312,6 +312,24 @@ RngStream::RngStream(const RngStream& r)
     }
 }
 
+void
+RngStream::GetState (uint32_t state[6]) const
+{
+  for (int i = 0; i < 6; ++i)
+    {
+      state[i] = static_cast<uint32_t> (m_currentState[i]);
+    }
+}
+
+void
+RngStream::SetState (const uint32_t state[6])
+{
+  for (int i = 0; i < 6; ++i)
+    {
+      m_currentState[i] = state[i];
+    }
+}
+
 void 
 RngStream::AdvanceNthBy (uint64_t nth, int by, double state[6])
 {
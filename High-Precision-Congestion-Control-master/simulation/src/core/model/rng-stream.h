@@ -45,6 +45,15 @@ public:
    * Uniformly distributed between 0 and 1.
    */
   double RandU01 (void);
+  /**
+   * Copy the state of this stream into state, e.g. for a checkpoint.
+   * The six components are integers below 2^32.
+   */
+  void GetState (uint32_t state[6]) const;
+  /**
+   * Continue from a state returned by GetState.
+   */
+  void SetState (const uint32_t state[6]);
 
 private:
   void AdvanceNthBy (uint64_t nth, int by, double state[6]);
@@ -137,6 +137,53 @@ private:
   mutable uint32_t m_count;
 };
 
+/**
+ * \ingroup ptr
+ * \brief A SimpleRefCount whose count can be changed from several threads
+ *
+ * Each thread of a process runs its own simulation (see Simulator), so
+ * almost all reference-counted objects are only ever seen by one thread.
+ * The exceptions are the objects that describe types rather than a
+ * simulation: attribute values, accessors and checkers, trace source
+ * accessors and callbacks, which are held by the TypeId registry and
+ * referenced by every thread that creates an object of that type. Those
+ * use this template, which counts with atomic operations.
+ */
+template <typename T, typename PARENT = empty, typename DELETER = DefaultDeleter<T> >
+class AtomicRefCount : public PARENT
+{
+public:
+  AtomicRefCount ()
+    : m_count (1)
+  {}
+  AtomicRefCount (const AtomicRefCount &o)
+    : m_count (1)
+  {}
+  AtomicRefCount &operator = (const AtomicRefCount &o)
+  {
+    return *this;
+  }
+  inline void Ref (void) const
+  {
+    NS_ASSERT (m_count < std::numeric_limits<uint32_t>::max());
+    __atomic_add_fetch (&m_count, 1, __ATOMIC_RELAXED);
+  }
+  inline void Unref (void) const
+  {
+    if (__atomic_sub_fetch (&m_count, 1, __ATOMIC_ACQ_REL) == 0)
+      {
+        DELETER::Delete (static_cast<T*> (const_cast<AtomicRefCount *> (this)));
+      }
+  }
+  inline uint32_t GetReferenceCount (void) const
+  {
+    return __atomic_load_n (&m_count, __ATOMIC_RELAXED);
+  }
+  static void Cleanup (void) {}
+private:
+  mutable uint32_t m_count;
+};
+
 } // namespace ns3
 
 #endif /* SIMPLE_REF_COUNT_H */
@@ -64,7 +64,7 @@ template <typename T>
 T **
 SimulationSingleton<T>::GetObject (void)
 {
-  static T *pobject = 0;
+  static thread_local T *pobject = 0; // one per thread, like the simulator
   if (pobject == 0)
     {
       pobject = new T ();
@@ -1,5 +1,7 @@
 #include "simulator-impl.h"
 #include "log.h"
+#include "assert.h"
+#include "fatal-error.h"
 
 NS_LOG_COMPONENT_DEFINE ("SimulatorImpl");
 
@@ -14,4 +16,48 @@ SimulatorImpl::GetTypeId (void)
   return tid;
 }
 
+EventId
+SimulatorImpl::Reserve (uint32_t context, Time const &time)
+{
+  return EventId (0, (Now () + time).GetTimeStep (), context, 0);
+}
+
+EventId
+SimulatorImpl::ScheduleReserved (const EventId &slot, EventImpl *event)
+{
+  NS_ASSERT (!IsPassed (slot));
+  Time delay = TimeStep (slot.GetTs ()) - Now ();
+  if (slot.GetContext () == GetContext ())
+    {
+      return Schedule (delay, event);
+    }
+  ScheduleWithContext (slot.GetContext (), delay, event);
+  return EventId ();
+}
+
+bool
+SimulatorImpl::IsPassed (const EventId &slot) const
+{
+  return TimeStep (slot.GetTs ()) < Now ();
+}
+
+Simulator::Clock
+SimulatorImpl::GetClock (void) const
+{
+  NS_FATAL_ERROR ("SimulatorImpl::GetClock: " << GetInstanceTypeId ().GetName () << " cannot be checkpointed");
+  return Simulator::Clock ();
+}
+
+void
+SimulatorImpl::SetClock (const Simulator::Clock &clock)
+{
+  NS_FATAL_ERROR ("SimulatorImpl::SetClock: " << GetInstanceTypeId ().GetName () << " cannot be checkpointed");
+}
+
+void
+SimulatorImpl::GetEvents (std::vector<EventId> &events)
+{
+  NS_FATAL_ERROR ("SimulatorImpl::GetEvents: " << GetInstanceTypeId ().GetName () << " cannot be checkpointed");
+}
+
 } // namespace ns3
@@ -27,6 +27,8 @@
 #include "object.h"
 #include "object-factory.h"
 #include "ptr.h"
+#include "simulator.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -182,6 +184,47 @@ public:
    * \return the current simulation context
    */
   virtual uint32_t GetContext (void) const = 0;
+  /**
+   * \return the number of events executed so far
+   */
+  virtual uint64_t GetEventCount (void) const = 0;
+  /**
+   * \param context the context of the event
+   * \param time delay until the event expires
+   * \return the place in the event list that an event scheduled now
+   *         would take, see Simulator::Reserve.
+   *
+   * The default implementation does not keep the place of the event
+   * among the events of the same time: ScheduleReserved then behaves
+   * like ScheduleWithContext.
+   */
+  virtual EventId Reserve (uint32_t context, Time const &time);
+  /**
+   * \param slot a place returned by Reserve which has not passed yet
+   * \param event the event to schedule
+   * \return the id of the event
+   */
+  virtual EventId ScheduleReserved (const EventId &slot, EventImpl *event);
+  /**
+   * \param slot a place returned by Reserve
+   * \return true if the events of the place would already have run.
+   */
+  virtual bool IsPassed (const EventId &slot) const;
+  /**
+   * \return the position of the simulation, see Simulator::GetClock.
+   *
+   * The default implementation aborts: an implementation that can be
+   * checkpointed overrides the three methods below.
+   */
+  virtual Simulator::Clock GetClock (void) const;
+  /**
+   * \param clock see Simulator::SetClock
+   */
+  virtual void SetClock (const Simulator::Clock &clock);
+  /**
+   * \param events see Simulator::GetEvents
+   */
+  virtual void GetEvents (std::vector<EventId> &events);
 };
 
 } // namespace ns3
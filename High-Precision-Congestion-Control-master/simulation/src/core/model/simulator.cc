@@ -74,9 +74,14 @@ NodePrinter (std::ostream &os)
     }
 }
 
+/*
+ * The implementation is per thread: each thread that calls a Simulator::
+ * function runs its own simulation, with its own event list, time and
+ * context, until it calls Simulator::Destroy.
+ */
 static SimulatorImpl **PeekImpl (void)
 {
-  static SimulatorImpl *impl = 0;
+  static thread_local SimulatorImpl *impl = 0;
   return &impl;
 }
 
@@ -302,6 +307,54 @@ Simulator::GetContext (void)
   return GetImpl ()->GetContext ();
 }
 
+uint64_t
+Simulator::GetEventCount (void)
+{
+  return GetImpl ()->GetEventCount ();
+}
+
+EventId
+Simulator::Reserve (Time const &time)
+{
+  return GetImpl ()->Reserve (GetImpl ()->GetContext (), time);
+}
+
+EventId
+Simulator::ReserveWithContext (uint32_t context, Time const &time)
+{
+  return GetImpl ()->Reserve (context, time);
+}
+
+EventId
+Simulator::ScheduleReserved (const EventId &slot, EventImpl *event)
+{
+  return GetImpl ()->ScheduleReserved (slot, event);
+}
+
+bool
+Simulator::IsPassed (const EventId &slot)
+{
+  return GetImpl ()->IsPassed (slot);
+}
+
+Simulator::Clock
+Simulator::GetClock (void)
+{
+  return GetImpl ()->GetClock ();
+}
+
+void
+Simulator::SetClock (const Clock &clock)
+{
+  GetImpl ()->SetClock (clock);
+}
+
+void
+Simulator::GetEvents (std::vector<EventId> &events)
+{
+  GetImpl ()->GetEvents (events);
+}
+
 uint32_t
 Simulator::GetSystemId (void)
 {
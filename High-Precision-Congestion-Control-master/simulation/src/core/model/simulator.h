@@ -31,6 +31,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace ns3 {
 
@@ -58,6 +59,15 @@ class Scheduler;
  * A simple example of how to use the Simulator class to schedule events
  * is shown below:
  * \include src/core/examples/sample-simulator.cc
+ *
+ * The simulator is per thread: every thread of a process that calls these
+ * methods gets its own implementation (event list, time, context), and
+ * so do the NodeList, ChannelList, Config namespace, SimulationSingleton
+ * objects and packet/stream/address counters that belong to a simulation.
+ * Independent simulations can thus run concurrently, one per thread,
+ * as long as each calls Destroy before its thread exits and none of them
+ * changes process-wide settings (Config::SetDefault, GlobalValue::Bind,
+ * Time::SetResolution) while the others run.
  */
 class Simulator 
 {
@@ -748,6 +758,84 @@ public:
    */
   static uint32_t GetContext (void);
 
+  /**
+   * \returns the number of events executed so far
+   */
+  static uint64_t GetEventCount (void);
+
+  /**
+   * \param time delay until the event expires
+   * \returns the place in the event list of an event which is not
+   *          scheduled yet, an EventId without event.
+   *
+   * Events with the same time run in the order they were scheduled.
+   * Reserve takes the place an event scheduled now would take, so that
+   * an event scheduled later with ScheduleReserved runs exactly where it
+   * would have run had it been scheduled here. This lets a model defer
+   * (or skip) an event without changing the order of the simulation.
+   * The reserved event has the current context.
+   */
+  static EventId Reserve (Time const &time);
+
+  /**
+   * \param context the context of the reserved event
+   * \param time delay until the event expires
+   * \returns the place in the event list, see Reserve.
+   */
+  static EventId ReserveWithContext (uint32_t context, Time const &time);
+
+  /**
+   * \param slot a place returned by Reserve or ReserveWithContext, which
+   *        must not have passed (see IsPassed) and must be used at most once.
+   * \param event the event to schedule, typically built with MakeEvent
+   * \returns the id of the event
+   */
+  static EventId ScheduleReserved (const EventId &slot, EventImpl *event);
+
+  /**
+   * \param slot a place returned by Reserve or ReserveWithContext
+   * \returns true if an event scheduled in this place would already have
+   *          run, i.e. the place is the current event or before it.
+   */
+  static bool IsPassed (const EventId &slot);
+
+  /**
+   * \brief The position of the simulation in time and in the event
+   * sequence, what a checkpoint saves besides the pending events.
+   */
+  struct Clock
+  {
+    uint64_t ts;         //!< current time step
+    uint32_t uid;        //!< uid of the current event
+    uint32_t nextUid;    //!< uid of the next event to be scheduled
+    uint32_t context;    //!< current context
+    uint64_t eventCount; //!< events run so far
+  };
+
+  /**
+   * \returns the position of the simulation, see SetClock
+   */
+  static Clock GetClock (void);
+
+  /**
+   * \param clock a position returned by GetClock, possibly in another
+   *        process, at or after the current one
+   *
+   * Moves a simulation that has no pending event to clock. The events of
+   * a checkpoint are then put back at the places they had with
+   * ScheduleReserved, so the restored simulation runs them, and schedules
+   * the next ones, in the same order as the one that was saved.
+   */
+  static void SetClock (const Clock &clock);
+
+  /**
+   * \param events filled with the ids of the pending events, including
+   *        the cancelled ones, in no particular order
+   *
+   * Lets a checkpoint check that it knows every pending event.
+   */
+  static void GetEvents (std::vector<EventId> &events);
+
   /**
    * \param time delay until the event expires
    * \param event the event to schedule
@@ -37,7 +37,7 @@ class ObjectBase;
  * This class abstracts the kind of trace source to which we want to connect
  * and provides services to Connect and Disconnect a sink to a trace source.
  */
-class TraceSourceAccessor : public SimpleRefCount<TraceSourceAccessor>
+class TraceSourceAccessor : public AtomicRefCount<TraceSourceAccessor>
 {
 public:
   TraceSourceAccessor ();
@@ -56,7 +56,7 @@ GlobalRouteManager::InitializeRoutes (void)
 uint32_t
 GlobalRouteManager::AllocateRouterId (void)
 {
-  static uint32_t routerId = 0;
+  static thread_local uint32_t routerId = 0; // per thread, like the simulation
   return routerId++;
 }
 
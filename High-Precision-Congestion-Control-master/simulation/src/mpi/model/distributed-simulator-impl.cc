@@ -30,6 +30,9 @@
 #include "ns3/log.h"
 
 #include <math.h>
+#ifdef NS3_EVENT_PROFILE
+#include <iostream>
+#endif
 
 #ifdef NS3_MPI
 #include <mpi.h>
@@ -103,6 +106,7 @@ DistributedSimulatorImpl::DistributedSimulatorImpl ()
   m_currentUid = 0;
   m_currentTs = 0;
   m_currentContext = 0xffffffff;
+  m_eventCount = 0;
   m_unscheduledEvents = 0;
   m_events = 0;
 }
@@ -137,6 +141,9 @@ DistributedSimulatorImpl::Destroy ()
           ev->Invoke ();
         }
     }
+#ifdef NS3_EVENT_PROFILE
+  m_profiler.Report (std::cout, m_myId);
+#endif
 
   MpiInterface::Destroy ();
 }
@@ -243,7 +250,12 @@ DistributedSimulatorImpl::ProcessOneEvent (void)
   m_currentTs = next.key.m_ts;
   m_currentContext = next.key.m_context;
   m_currentUid = next.key.m_uid;
+  m_eventCount++;
+#ifdef NS3_EVENT_PROFILE
+  m_profiler.Invoke (next.impl);
+#else
   next.impl->Invoke ();
+#endif
   next.impl->Unref ();
 }
 
@@ -401,6 +413,37 @@ DistributedSimulatorImpl::ScheduleDestroy (EventImpl *event)
   return id;
 }
 
+EventId
+DistributedSimulatorImpl::Reserve (uint32_t context, Time const &time)
+{
+  Time tAbsolute = time + TimeStep (m_currentTs);
+  NS_ASSERT (tAbsolute >= TimeStep (m_currentTs));
+  EventId slot (0, static_cast<uint64_t> (tAbsolute.GetTimeStep ()), context, m_uid);
+  m_uid++;
+  return slot;
+}
+
+EventId
+DistributedSimulatorImpl::ScheduleReserved (const EventId &slot, EventImpl *event)
+{
+  NS_ASSERT_MSG (!IsPassed (slot), "Simulator::ScheduleReserved: the slot has passed");
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = slot.GetTs ();
+  ev.key.m_context = slot.GetContext ();
+  ev.key.m_uid = slot.GetUid ();
+  m_unscheduledEvents++;
+  m_events->Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+bool
+DistributedSimulatorImpl::IsPassed (const EventId &slot) const
+{
+  return slot.GetTs () < m_currentTs
+         || (slot.GetTs () == m_currentTs && slot.GetUid () <= m_currentUid);
+}
+
 Time
 DistributedSimulatorImpl::Now (void) const
 {
@@ -510,4 +553,10 @@ DistributedSimulatorImpl::GetContext (void) const
   return m_currentContext;
 }
 
+uint64_t
+DistributedSimulatorImpl::GetEventCount (void) const
+{
+  return m_eventCount;
+}
+
 } // namespace ns3
@@ -22,6 +22,7 @@
 #include "ns3/simulator-impl.h"
 #include "ns3/scheduler.h"
 #include "ns3/event-impl.h"
+#include "ns3/event-profiler.h"
 #include "ns3/ptr.h"
 
 #include <list>
@@ -115,6 +116,10 @@ public:
   virtual void SetScheduler (ObjectFactory schedulerFactory);
   virtual uint32_t GetSystemId (void) const;
   virtual uint32_t GetContext (void) const;
+  virtual uint64_t GetEventCount (void) const;
+  virtual EventId Reserve (uint32_t context, Time const &time);
+  virtual EventId ScheduleReserved (const EventId &slot, EventImpl *event);
+  virtual bool IsPassed (const EventId &slot) const;
 
 private:
   virtual void DoDispose (void);
@@ -132,6 +137,10 @@ private:
   uint32_t m_currentUid;
   uint64_t m_currentTs;
   uint32_t m_currentContext;
+  uint64_t m_eventCount;
+#ifdef NS3_EVENT_PROFILE
+  EventProfiler m_profiler;
+#endif
   // number of events that have been inserted but not yet scheduled,
   // not counting the "destroy" events; this is used for validation
   int m_unscheduledEvents;
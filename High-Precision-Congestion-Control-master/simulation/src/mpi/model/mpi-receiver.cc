@@ -20,6 +20,8 @@
 
 namespace ns3 {
 
+NS_OBJECT_ENSURE_REGISTERED (MpiReceiver);
+
 TypeId
 MpiReceiver::GetTypeId (void)
 {
@@ -20,6 +20,7 @@
 #include "buffer.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/mem-profiler.h"
 
 NS_LOG_COMPONENT_DEFINE ("Buffer");
 
@@ -45,8 +46,10 @@ static struct Zeroes
 
 namespace ns3 {
 
+// includes the buffers kept in g_freeList
+NS_MEM_CATEGORY (g_memBufferData, "ns3::Buffer::Data");
 
-uint32_t Buffer::g_recommendedStart = 0;
+thread_local uint32_t Buffer::g_recommendedStart = 0;
 #ifdef BUFFER_FREE_LIST
 /* The following macros are pretty evil but they are needed to allow us to
  * keep track of 3 possible states for the g_freeList variable:
@@ -71,9 +74,9 @@ uint32_t Buffer::g_recommendedStart = 0;
 #define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
 #define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
 #define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
-struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
+thread_local uint32_t Buffer::g_maxSize = 0;
+thread_local Buffer::FreeList *Buffer::g_freeList = 0;
+thread_local struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
 
 Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
 {
@@ -116,6 +119,9 @@ Buffer::Create (uint32_t dataSize)
   if (IS_UNINITIALIZED (g_freeList))
     {
       g_freeList = new Buffer::FreeList ();
+      // a thread_local is only constructed, and so destroyed at the
+      // exit of the thread, if the thread uses it
+      (void) &g_localStaticDestructor;
     }
   else if (IS_INITIALIZED (g_freeList))
     {
@@ -160,6 +166,7 @@ Buffer::Allocate (uint32_t reqSize)
   NS_ASSERT (reqSize >= 1);
   uint32_t size = reqSize - 1 + sizeof (struct Buffer::Data);
   uint8_t *b = new uint8_t [size];
+  NS_MEM_ALLOC (g_memBufferData, size);
   struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data*>(b);
   data->m_size = reqSize;
   data->m_count = 1;
@@ -170,6 +177,7 @@ void
 Buffer::Deallocate (struct Buffer::Data *data)
 {
   NS_ASSERT (data->m_count == 0);
+  NS_MEM_FREE (g_memBufferData, data->m_size - 1 + sizeof (struct Buffer::Data));
   uint8_t *buf = reinterpret_cast<uint8_t *> (data);
   delete [] buf;
 }
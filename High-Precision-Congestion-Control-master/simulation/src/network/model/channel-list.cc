@@ -79,7 +79,7 @@ ChannelListPriv::Get (void)
 Ptr<ChannelListPriv> *
 ChannelListPriv::DoGet (void)
 {
-  static Ptr<ChannelListPriv> ptr = 0;
+  static thread_local Ptr<ChannelListPriv> ptr = 0; // one per simulation thread
   if (ptr == 0)
     {
       ptr = CreateObject<ChannelListPriv> ();
@@ -79,7 +79,7 @@ NodeListPriv::Get (void)
 Ptr<NodeListPriv> *
 NodeListPriv::DoGet (void)
 {
-  static Ptr<NodeListPriv> ptr = 0;
+  static thread_local Ptr<NodeListPriv> ptr = 0; // one per simulation thread
   if (ptr == 0)
     {
       ptr = CreateObject<NodeListPriv> ();
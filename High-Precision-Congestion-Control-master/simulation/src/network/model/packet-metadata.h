@@ -341,17 +341,19 @@ public:
   static struct PacketMetadata::Data *Allocate (uint32_t n);
   static void Deallocate (struct PacketMetadata::Data *data);
 
-  static DataFreeList m_freeList;
+  // the free list and the uid of the chunks are per thread, like the
+  // simulation (see Simulator); m_enable and m_enableChecking are not
+  static thread_local DataFreeList m_freeList;
   static bool m_enable;
   static bool m_enableChecking;
 
   // set to true when adding metadata to a packet is skipped because
   // m_enable is false; used to detect enabling of metadata in the
   // middle of a simulation, which isn't allowed.
-  static bool m_metadataSkipped;
+  static thread_local bool m_metadataSkipped;
 
-  static uint32_t m_maxSize;
-  static uint16_t m_chunkUid;
+  static thread_local uint32_t m_maxSize;
+  static thread_local uint16_t m_chunkUid;
 
   struct Data *m_data;
   /**
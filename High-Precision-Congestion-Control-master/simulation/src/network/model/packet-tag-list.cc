@@ -22,12 +22,16 @@
 #include "tag.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
+#include "ns3/mem-profiler.h"
 #include <string.h>
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
 namespace ns3 {
 
+// the tags held by free lists are counted until they are deleted
+NS_MEM_CATEGORY (g_memTagData, "ns3::PacketTagList::TagData");
+
 #ifdef USE_FREE_LIST
 
 struct PacketTagList::TagData *PacketTagList::g_free = 0;
@@ -47,6 +51,7 @@ PacketTagList::AllocData (void) const
   else 
     {
       retval = new struct PacketTagList::TagData ();
+      NS_MEM_ALLOC (g_memTagData, sizeof (struct TagData));
     }
   return retval;
 }
@@ -57,6 +62,7 @@ PacketTagList::FreeData (struct TagData *data) const
   NS_LOG_FUNCTION (g_nfree << data);
   if (g_nfree > 1000) 
     {
+      NS_MEM_FREE (g_memTagData, sizeof (struct TagData));
       delete data;
       return;
     }
@@ -72,6 +78,7 @@ PacketTagList::AllocData (void) const
   NS_LOG_FUNCTION_NOARGS ();
   struct PacketTagList::TagData *retval;
   retval = new struct PacketTagList::TagData ();
+  NS_MEM_ALLOC (g_memTagData, sizeof (struct TagData));
   return retval;
 }
 
@@ -79,6 +86,7 @@ void
 PacketTagList::FreeData (struct TagData *data) const
 {
   NS_LOG_FUNCTION (data);
+  NS_MEM_FREE (g_memTagData, sizeof (struct TagData));
   delete data;
 }
 #endif
@@ -21,6 +21,7 @@
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/mem-profiler.h"
 #include <string>
 #include <stdarg.h>
 
@@ -28,7 +29,8 @@ NS_LOG_COMPONENT_DEFINE ("Packet");
 
 namespace ns3 {
 
-uint32_t Packet::m_globalUid = 0;
+thread_local uint32_t Packet::m_globalUid = 0;
+NS_MEM_CATEGORY (g_memPacket, "ns3::Packet");
 
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
@@ -136,8 +138,10 @@ Packet::Packet ()
      * global UID
      */
     m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
-    m_nixVector (0)
+    m_nixVector (0),
+    m_switchMeta ()
 {
+  NS_MEM_ALLOC (g_memPacket, sizeof (Packet));
   m_globalUid++;
 }
 
@@ -145,12 +149,21 @@ Packet::Packet (const Packet &o)
   : m_buffer (o.m_buffer),
     m_byteTagList (o.m_byteTagList),
     m_packetTagList (o.m_packetTagList),
-    m_metadata (o.m_metadata)
+    m_metadata (o.m_metadata),
+    m_switchMeta (o.m_switchMeta)
 {
+  NS_MEM_ALLOC (g_memPacket, sizeof (Packet));
   o.m_nixVector ? m_nixVector = o.m_nixVector->Copy ()
     : m_nixVector = 0;
 }
 
+#ifdef NS3_MEM_PROFILE
+Packet::~Packet ()
+{
+  NS_MEM_FREE (g_memPacket, sizeof (Packet));
+}
+#endif
+
 Packet &
 Packet::operator = (const Packet &o)
 {
@@ -162,6 +175,7 @@ Packet::operator = (const Packet &o)
   m_byteTagList = o.m_byteTagList;
   m_packetTagList = o.m_packetTagList;
   m_metadata = o.m_metadata;
+  m_switchMeta = o.m_switchMeta;
   o.m_nixVector ? m_nixVector = o.m_nixVector->Copy () 
     : m_nixVector = 0;
   return *this;
@@ -178,8 +192,10 @@ Packet::Packet (uint32_t size)
      * global UID
      */
     m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
-    m_nixVector (0)
+    m_nixVector (0),
+    m_switchMeta ()
 {
+  NS_MEM_ALLOC (g_memPacket, sizeof (Packet));
   m_globalUid++;
 }
 Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
@@ -187,8 +203,10 @@ Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
     m_byteTagList (),
     m_packetTagList (),
     m_metadata (0,0),
-    m_nixVector (0)
+    m_nixVector (0),
+    m_switchMeta ()
 {
+  NS_MEM_ALLOC (g_memPacket, sizeof (Packet));
   NS_ASSERT (magic);
   Deserialize (buffer, size);
 }
@@ -204,8 +222,10 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
      * global UID
      */
     m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
-    m_nixVector (0)
+    m_nixVector (0),
+    m_switchMeta ()
 {
+  NS_MEM_ALLOC (g_memPacket, sizeof (Packet));
   m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
@@ -218,8 +238,10 @@ Packet::Packet (const Buffer &buffer,  const ByteTagList &byteTagList,
     m_byteTagList (byteTagList),
     m_packetTagList (packetTagList),
     m_metadata (metadata),
-    m_nixVector (0)
+    m_nixVector (0),
+    m_switchMeta ()
 {
+  NS_MEM_ALLOC (g_memPacket, sizeof (Packet));
 }
 
 Ptr<Packet>
@@ -230,6 +230,9 @@ public:
   Packet ();
   Packet (const Packet &o);
   Packet &operator = (const Packet &o);
+#ifdef NS3_MEM_PROFILE
+  ~Packet ();
+#endif
   /**
    * Create a packet with a zero-filled payload.
    * The memory necessary for the payload is not allocated:
@@ -574,6 +577,22 @@ public:
 
   uint8_t* GetBuffer() const;
 
+  /**
+   * \brief Per-hop state of the switch pipeline, stored inline in the packet.
+   *
+   * The switch used to carry the ingress port in a FlowIdTag, which costs an
+   * allocation and a walk (and copy-on-write) of the packet tag list at every
+   * add/peek/remove. This slot is a plain struct instead. It is copied with
+   * the packet but not serialized, so it is only meaningful inside the node
+   * that wrote it.
+   */
+  struct SwitchMeta
+  {
+    uint32_t inDev;      //!< ifindex the packet was received on
+  };
+  inline SwitchMeta& GetSwitchMeta (void);
+  inline const SwitchMeta& GetSwitchMeta (void) const;
+
 private:
   Packet (const Buffer &buffer, const ByteTagList &byteTagList, 
           const PacketTagList &packetTagList, const PacketMetadata &metadata);
@@ -588,7 +607,9 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector;
 
-  static uint32_t m_globalUid;
+  SwitchMeta m_switchMeta;
+
+  static thread_local uint32_t m_globalUid; // per thread, like the simulation
 };
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet);
@@ -649,6 +670,18 @@ Packet::GetSize (void) const
   return m_buffer.GetSize ();
 }
 
+Packet::SwitchMeta&
+Packet::GetSwitchMeta (void)
+{
+  return m_switchMeta;
+}
+
+const Packet::SwitchMeta&
+Packet::GetSwitchMeta (void) const
+{
+  return m_switchMeta;
+}
+
 
 
 } // namespace ns3
@@ -24,6 +24,7 @@
 #include "ns3/simulator.h"
 #include "drop-tail-queue.h"
 #include "broadcom-egress-queue.h"
+#include "checkpoint.h"
 
 NS_LOG_COMPONENT_DEFINE("BEgressQueue");
 
@@ -56,6 +57,7 @@ namespace ns3 {
 		NS_LOG_FUNCTION_NOARGS();
 		m_bytesInQueueTotal = 0;
 		m_rrlast = 0;
+		m_qlast = 0;
 		for (uint32_t i = 0; i < fCnt; i++)
 		{
 			m_bytesInQueue[i] = 0;
@@ -241,4 +243,50 @@ namespace ns3 {
 		return m_qlast;
 	}
 
+	void
+		BEgressQueue::Save(CheckpointWriter &w) const
+	{
+		NS_LOG_FUNCTION(this);
+		// only a few of the fCnt sub-queues are ever used; the others are as created
+		std::vector<uint32_t> used;
+		for (uint32_t i = 0; i < fCnt; i++)
+			if (m_queues[i]->GetTotalReceivedPackets() > 0 || m_queues[i]->GetTotalDroppedPackets() > 0)
+				used.push_back(i);
+		w.Put((uint32_t)used.size());
+		for (uint32_t i = 0; i < used.size(); i++){
+			w.Put(used[i]);
+			m_queues[used[i]]->Save(w);
+			w.Put(m_bytesInQueue[used[i]]);
+		}
+		w.Put(m_bytesInQueueTotal);
+		w.Put(m_rrlast);
+		w.Put(m_qlast);
+		SaveCounters(w);
+	}
+
+	void
+		BEgressQueue::Restore(CheckpointReader &r)
+	{
+		NS_LOG_FUNCTION(this);
+		uint32_t nUsed = r.Get<uint32_t>();
+		for (uint32_t i = 0; i < nUsed && !r.Failed(); i++){
+			uint32_t q = r.Get<uint32_t>();
+			if (q >= fCnt){
+				r.Fail("the checkpoint has a queue out of range");
+				return;
+			}
+			m_queues[q]->Restore(r);
+			r.Get(m_bytesInQueue[q]);
+		}
+		r.Get(m_bytesInQueueTotal);
+		r.Get(m_rrlast);
+		r.Get(m_qlast);
+		// the packets are in the sub-queues, so are what counts them
+		m_nBytes = m_bytesInQueueTotal;
+		m_nPackets = 0;
+		for (uint32_t i = 0; i < fCnt; i++)
+			m_nPackets += m_queues[i]->GetNPackets();
+		RestoreCounters(r);
+	}
+
 }
@@ -42,6 +42,8 @@ namespace ns3 {
 		uint32_t GetNBytes(uint32_t qIndex) const;
 		uint32_t GetNBytesTotal() const;
 		uint32_t GetLastQueue();
+		virtual void Save(CheckpointWriter &w) const;
+		virtual void Restore(CheckpointReader &r);
 
 		TracedCallback<Ptr<const Packet>, uint32_t> m_traceBeqEnqueue;
 		TracedCallback<Ptr<const Packet>, uint32_t> m_traceBeqDequeue;
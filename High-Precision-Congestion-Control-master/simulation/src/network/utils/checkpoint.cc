@@ -0,0 +1,362 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <cstring>
+#include <sstream>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "checkpoint.h"
+
+NS_LOG_COMPONENT_DEFINE ("Checkpoint");
+
+namespace ns3 {
+
+// what a cancelled event nobody holds is restored as
+static void
+CheckpointPlaceholder (void)
+{
+}
+
+// what PutEvent saves after the place of the event
+enum CheckpointEventState
+{
+  EVENT_NONE = 0,      // not pending (run, or never scheduled)
+  EVENT_PENDING = 1,
+  EVENT_CANCELLED = 2, // pending but cancelled
+};
+
+CheckpointWriter::CheckpointWriter ()
+{
+  Put (Simulator::GetClock ());
+  std::vector<EventId> events;
+  Simulator::GetEvents (events);
+  for (uint32_t i = 0; i < events.size (); i++)
+    {
+      PendingEvent e;
+      e.id = events[i];
+      e.claimed = false;
+      m_events[events[i].GetUid ()] = e;
+    }
+}
+
+void
+CheckpointWriter::PutBytes (const void *data, uint32_t size)
+{
+  m_data.append (static_cast<const char*> (data), size);
+}
+
+void
+CheckpointWriter::PutTime (Time t)
+{
+  Put (t.GetTimeStep ());
+}
+
+void
+CheckpointWriter::PutSlot (const EventId &slot)
+{
+  Put (slot.GetTs ());
+  Put (slot.GetContext ());
+  Put (slot.GetUid ());
+}
+
+void
+CheckpointWriter::PutEvent (const EventId &ev)
+{
+  PutSlot (ev);
+  uint8_t state = EVENT_NONE;
+  std::unordered_map<uint32_t, PendingEvent>::iterator it = m_events.find (ev.GetUid ());
+  if (it != m_events.end () && it->second.id.GetTs () == ev.GetTs ())
+    {
+      if (it->second.claimed)
+        {
+          std::ostringstream why;
+          why << "the event at " << ev.GetTs () << " (uid " << ev.GetUid () << ") is saved twice";
+          Fail (why.str ());
+        }
+      it->second.claimed = true;
+      state = it->second.id.PeekEventImpl ()->IsCancelled () ? EVENT_CANCELLED : EVENT_PENDING;
+    }
+  Put (state);
+}
+
+void
+CheckpointWriter::PutPacket (Ptr<const Packet> p)
+{
+  if (p == 0)
+    {
+      Put ((uint32_t)0);
+      return;
+    }
+  std::unordered_map<const Packet*, uint32_t>::iterator it = m_packets.find (PeekPointer (p));
+  if (it != m_packets.end ())
+    {
+      Put (it->second + 1);
+      return;
+    }
+  uint32_t index = m_packets.size ();
+  m_packets[PeekPointer (p)] = index;
+  Put (index + 1);
+  if (p->GetPacketTagIterator ().HasNext () || p->GetByteTagIterator ().HasNext ())
+    {
+      Fail ("a packet has tags, which are not saved");
+    }
+  // Packet::Serialize writes 32-bit words
+  uint32_t size = p->GetSerializedSize ();
+  std::vector<uint32_t> buffer ((size + 3) / 4);
+  if (p->Serialize (reinterpret_cast<uint8_t*> (&buffer[0]), size) == 0)
+    {
+      Fail ("a packet cannot be serialized");
+    }
+  Put (size);
+  PutBytes (&buffer[0], size);
+  Put (p->GetSwitchMeta ());
+}
+
+void
+CheckpointWriter::PutStream (Ptr<const RandomVariableStream> v)
+{
+  // the other variables keep draws or parameters out of the stream
+  if (v->GetInstanceTypeId () != UniformRandomVariable::GetTypeId ())
+    {
+      Fail ("a " + v->GetInstanceTypeId ().GetName () + " is saved, only the stream of a UniformRandomVariable is");
+    }
+  uint32_t state[6];
+  v->GetState (state);
+  PutBytes (state, sizeof (state));
+}
+
+void
+CheckpointWriter::Fail (std::string why)
+{
+  if (m_error.empty ())
+    {
+      m_error = why;
+    }
+}
+
+bool
+CheckpointWriter::Failed (void) const
+{
+  return !m_error.empty ();
+}
+
+const std::string&
+CheckpointWriter::GetError (void) const
+{
+  return m_error;
+}
+
+bool
+CheckpointWriter::Finish (void)
+{
+  std::vector<EventId> cancelled;
+  uint32_t lost = 0;
+  EventId first;
+  for (std::unordered_map<uint32_t, PendingEvent>::iterator it = m_events.begin (); it != m_events.end (); it++)
+    {
+      if (it->second.claimed)
+        {
+          continue;
+        }
+      if (it->second.id.PeekEventImpl ()->IsCancelled ())
+        {
+          cancelled.push_back (it->second.id);
+        }
+      else if (lost++ == 0 || it->second.id.GetUid () < first.GetUid ())
+        {
+          first = it->second.id;
+        }
+    }
+  if (lost > 0)
+    {
+      std::ostringstream why;
+      why << lost << " pending events are held by no saved component, the first at "
+          << first.GetTs () << " (context " << first.GetContext () << ", uid " << first.GetUid () << ")";
+      Fail (why.str ());
+    }
+  Put ((uint32_t)cancelled.size ());
+  for (uint32_t i = 0; i < cancelled.size (); i++)
+    {
+      PutSlot (cancelled[i]);
+    }
+  return !Failed ();
+}
+
+const std::string&
+CheckpointWriter::GetData (void) const
+{
+  return m_data;
+}
+
+uint32_t
+CheckpointWriter::GetNEvents (void) const
+{
+  return m_events.size ();
+}
+
+uint32_t
+CheckpointWriter::GetNPackets (void) const
+{
+  return m_packets.size ();
+}
+
+CheckpointReader::CheckpointReader (const std::string &data)
+  : m_data (data),
+    m_pos (0)
+{
+}
+
+void
+CheckpointReader::Begin (void)
+{
+  Simulator::Clock clock = Get<Simulator::Clock> ();
+  std::vector<EventId> events;
+  Simulator::GetEvents (events);
+  if (!events.empty ())
+    {
+      Fail ("the simulation to restore into has pending events");
+    }
+  else if (clock.ts < (uint64_t)Simulator::Now ().GetTimeStep ())
+    {
+      Fail ("the simulation to restore into is past the checkpoint");
+    }
+  if (!Failed ())
+    {
+      Simulator::SetClock (clock);
+    }
+}
+
+void
+CheckpointReader::GetBytes (void *data, uint32_t size)
+{
+  if (Failed () || m_data.size () - m_pos < size)
+    {
+      Fail ("the checkpoint is truncated");
+      memset (data, 0, size);
+      return;
+    }
+  memcpy (data, m_data.data () + m_pos, size);
+  m_pos += size;
+}
+
+Time
+CheckpointReader::GetTime (void)
+{
+  return TimeStep (Get<int64_t> ());
+}
+
+EventId
+CheckpointReader::GetSlot (void)
+{
+  uint64_t ts = Get<uint64_t> ();
+  uint32_t context = Get<uint32_t> ();
+  uint32_t uid = Get<uint32_t> ();
+  return EventId (0, ts, context, uid);
+}
+
+EventId
+CheckpointReader::GetEvent (EventImpl *event)
+{
+  EventId slot = GetSlot ();
+  uint8_t state = Get<uint8_t> ();
+  if (state != EVENT_NONE && Simulator::IsPassed (slot))
+    {
+      Fail ("a pending event of the checkpoint is before its clock");
+    }
+  if (Failed () || state == EVENT_NONE)
+    {
+      event->Unref ();
+      return slot;
+    }
+  EventId id = Simulator::ScheduleReserved (slot, event);
+  if (state == EVENT_CANCELLED)
+    {
+      Simulator::Cancel (id);
+    }
+  return id;
+}
+
+Ptr<Packet>
+CheckpointReader::GetPacket (void)
+{
+  uint32_t index = Get<uint32_t> ();
+  if (index == 0)
+    {
+      return 0;
+    }
+  if (index <= m_packets.size ())
+    {
+      return m_packets[index - 1];
+    }
+  if (index != m_packets.size () + 1)
+    {
+      Fail ("a packet of the checkpoint is out of order");
+      return 0;
+    }
+  uint32_t size = Get<uint32_t> ();
+  if (Failed () || m_data.size () - m_pos < size)
+    {
+      Fail ("the checkpoint is truncated");
+      return 0;
+    }
+  std::vector<uint32_t> buffer ((size + 3) / 4);
+  GetBytes (&buffer[0], size);
+  Ptr<Packet> p = Create<Packet> (reinterpret_cast<const uint8_t*> (&buffer[0]), size, true);
+  p->GetSwitchMeta () = Get<Packet::SwitchMeta> ();
+  m_packets.push_back (p);
+  return p;
+}
+
+void
+CheckpointReader::GetStream (Ptr<RandomVariableStream> v)
+{
+  uint32_t state[6];
+  GetBytes (state, sizeof (state));
+  if (!Failed ())
+    {
+      v->SetState (state);
+    }
+}
+
+void
+CheckpointReader::Fail (std::string why)
+{
+  if (m_error.empty ())
+    {
+      m_error = why;
+    }
+}
+
+bool
+CheckpointReader::Failed (void) const
+{
+  return !m_error.empty ();
+}
+
+const std::string&
+CheckpointReader::GetError (void) const
+{
+  return m_error;
+}
+
+bool
+CheckpointReader::Finish (void)
+{
+  uint32_t n = Get<uint32_t> ();
+  for (uint32_t i = 0; i < n && !Failed (); i++)
+    {
+      EventId slot = GetSlot ();
+      if (Simulator::IsPassed (slot))
+        {
+          Fail ("a pending event of the checkpoint is before its clock");
+          break;
+        }
+      Simulator::Cancel (Simulator::ScheduleReserved (slot, MakeEvent (&CheckpointPlaceholder)));
+    }
+  if (!Failed () && m_pos != m_data.size ())
+    {
+      Fail ("the checkpoint has more data than the setup restores");
+    }
+  return !Failed ();
+}
+
+} // namespace ns3
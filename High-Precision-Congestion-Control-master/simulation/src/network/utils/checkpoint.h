@@ -0,0 +1,161 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <unordered_map>
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/event-impl.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ * \brief Saves the state of a running simulation into a byte string.
+ *
+ * A checkpoint is restored by a CheckpointReader in a new process that
+ * has built the same topology but has not run it: each component reads
+ * back, in the order it wrote them, the values it put here. The clock and
+ * every pending event are saved too, so the restored simulation goes on
+ * with the same events in the same order, i.e. produces what the saved
+ * one would have produced from there.
+ *
+ * An event is saved by its place (see Simulator::Reserve) by the component
+ * that holds its EventId, and is scheduled again there by the same
+ * component on restore, with the callback it knows. The writer takes the
+ * list of pending events when it is created, and Finish fails if an event
+ * that is not cancelled was claimed by no component: such an event would
+ * be lost. Cancelled events nobody holds are kept as placeholders, so the
+ * event count goes on the same.
+ *
+ * A packet is saved once, however many queues, links and devices hold it,
+ * and restored as one packet. Its packet and byte tags are not saved, so
+ * a packet with tags makes the checkpoint fail.
+ */
+class CheckpointWriter
+{
+public:
+  /** Saves the clock and takes the list of pending events. */
+  CheckpointWriter ();
+
+  /** \param v a value of a trivially copyable type, saved as its bytes */
+  template <typename T>
+  void Put (const T &v)
+  {
+    static_assert (std::is_trivially_copyable<T>::value, "CheckpointWriter::Put of a type with pointers or a destructor");
+    PutBytes (&v, sizeof (T));
+  }
+  void PutBytes (const void *data, uint32_t size);
+  void PutTime (Time t);
+  /** a place returned by Simulator::Reserve, whether an event is scheduled there or not */
+  void PutSlot (const EventId &slot);
+  /** an event, which the restored component schedules again with CheckpointReader::GetEvent */
+  void PutEvent (const EventId &ev);
+  /** a packet, possibly 0 */
+  void PutPacket (Ptr<const Packet> p);
+  /** the state of the RNG stream of a UniformRandomVariable */
+  void PutStream (Ptr<const RandomVariableStream> v);
+
+  /** Makes the checkpoint fail; the first reason is kept. */
+  void Fail (std::string why);
+  bool Failed (void) const;
+  const std::string& GetError (void) const;
+
+  /**
+   * Saves the cancelled events nobody claimed and checks that all the
+   * other pending events were claimed.
+   * \returns false if the checkpoint failed, see GetError
+   */
+  bool Finish (void);
+  /** the checkpoint, once finished */
+  const std::string& GetData (void) const;
+  uint32_t GetNEvents (void) const; // pending events
+  uint32_t GetNPackets (void) const; // distinct packets
+
+private:
+  struct PendingEvent
+  {
+    EventId id;
+    bool claimed;
+  };
+  std::string m_data;
+  std::unordered_map<uint32_t, PendingEvent> m_events; // by uid
+  std::unordered_map<const Packet*, uint32_t> m_packets; // index of each packet saved
+  std::string m_error;
+};
+
+/**
+ * \ingroup network
+ * \brief Restores a simulation saved by a CheckpointWriter, see there.
+ *
+ * A checkpoint that does not match the setup it is restored into (another
+ * topology, other CC...) is detected where the components check what they
+ * read, which then call Fail. After a failure, or at the end of the data,
+ * the reader returns zeros, so the restore runs to its end without
+ * building anything, and the caller checks Failed.
+ */
+class CheckpointReader
+{
+public:
+  CheckpointReader (const std::string &data);
+
+  /**
+   * Moves the simulator, which must have no pending event, to the clock of
+   * the checkpoint. Done before any event is restored.
+   */
+  void Begin (void);
+
+  template <typename T>
+  T Get (void)
+  {
+    static_assert (std::is_trivially_copyable<T>::value, "CheckpointReader::Get of a type with pointers or a destructor");
+    T v;
+    GetBytes (&v, sizeof (T));
+    return v;
+  }
+  template <typename T>
+  void Get (T &v)
+  {
+    v = Get<T> ();
+  }
+  void GetBytes (void *data, uint32_t size);
+  Time GetTime (void);
+  EventId GetSlot (void);
+  /**
+   * \param event the callback of the event saved with PutEvent, taken over
+   * \returns the id of the event, scheduled (and cancelled) as it was; or,
+   *          if it had run or was never scheduled, just its place
+   */
+  EventId GetEvent (EventImpl *event);
+  Ptr<Packet> GetPacket (void);
+  void GetStream (Ptr<RandomVariableStream> v);
+
+  void Fail (std::string why);
+  bool Failed (void) const;
+  const std::string& GetError (void) const;
+
+  /**
+   * Restores the placeholders of the cancelled events.
+   * \returns false if the restore failed or did not read all the data
+   */
+  bool Finish (void);
+
+private:
+  std::string m_data;
+  uint32_t m_pos;
+  std::vector<Ptr<Packet> > m_packets;
+  std::string m_error;
+};
+
+} // namespace ns3
+
+#endif /* CHECKPOINT_H */
@@ -19,7 +19,9 @@
 #include "ns3/log.h"
 #include "ns3/enum.h"
 #include "ns3/uinteger.h"
+#include "ns3/mem-profiler.h"
 #include "drop-tail-queue.h"
+#include "checkpoint.h"
 
 NS_LOG_COMPONENT_DEFINE ("DropTailQueue");
 
@@ -27,6 +29,12 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (DropTailQueue);
 
+// a BEgressQueue has 128 of them, so they add up. An empty std::deque
+// already holds a map of 8 node pointers and a 512 byte node (libstdc++),
+// which are counted with the queue; the packets are in ns3::Queue::packets
+NS_MEM_CATEGORY (g_memDropTailQueue, "ns3::DropTailQueue");
+static const uint32_t g_dropTailQueueSize = sizeof (DropTailQueue) + 8 * sizeof (void *) + 512;
+
 TypeId DropTailQueue::GetTypeId (void) 
 {
   static TypeId tid = TypeId ("ns3::DropTailQueue")
@@ -59,11 +67,13 @@ DropTailQueue::DropTailQueue () :
   m_bytesInQueue (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  NS_MEM_ALLOC (g_memDropTailQueue, g_dropTailQueueSize);
 }
 
 DropTailQueue::~DropTailQueue ()
 {
   NS_LOG_FUNCTION_NOARGS ();
+  NS_MEM_FREE (g_memDropTailQueue, g_dropTailQueueSize);
 }
 
 void
@@ -80,6 +90,35 @@ DropTailQueue::GetMode (void)
   return m_mode;
 }
 
+void
+DropTailQueue::Save (CheckpointWriter &w) const
+{
+  NS_LOG_FUNCTION (this);
+  std::queue<Ptr<Packet> > packets = m_packets;
+  w.Put ((uint32_t)packets.size ());
+  for (; !packets.empty (); packets.pop ())
+    {
+      w.PutPacket (packets.front ());
+    }
+  SaveCounters (w);
+}
+
+void
+DropTailQueue::Restore (CheckpointReader &r)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t n = r.Get<uint32_t> ();
+  for (uint32_t i = 0; i < n && !r.Failed (); i++)
+    {
+      Ptr<Packet> p = r.GetPacket ();
+      if (p != 0)
+        {
+          Enqueue (p);
+        }
+    }
+  RestoreCounters (r);
+}
+
 bool 
 DropTailQueue::DoEnqueue (Ptr<Packet> p)
 {
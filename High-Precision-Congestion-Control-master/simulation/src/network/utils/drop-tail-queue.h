@@ -59,6 +59,9 @@ public:
    */
   DropTailQueue::QueueMode GetMode (void);
 
+  virtual void Save (CheckpointWriter &w) const;
+  virtual void Restore (CheckpointReader &r);
+
 private:
   virtual bool DoEnqueue (Ptr<Packet> p);
   virtual Ptr<Packet> DoDequeue (void);
@@ -64,6 +64,7 @@
 #include "ns3/double.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
+#include "checkpoint.h"
 
 NS_LOG_COMPONENT_DEFINE ("ErrorModel");
 
@@ -133,6 +134,18 @@ ErrorModel::IsEnabled (void) const
   return m_enable;
 }
 
+void
+ErrorModel::Save (CheckpointWriter &w) const
+{
+  w.Fail (GetInstanceTypeId ().GetName () + " cannot be checkpointed");
+}
+
+void
+ErrorModel::Restore (CheckpointReader &r)
+{
+  r.Fail (GetInstanceTypeId ().GetName () + " cannot be checkpointed");
+}
+
 //
 // RateErrorModel
 //
@@ -215,6 +228,29 @@ RateErrorModel::AssignStreams (int64_t stream)
   return 1;
 }
 
+void
+RateErrorModel::Save (CheckpointWriter &w) const
+{
+  NS_LOG_FUNCTION (this);
+  w.Put (IsEnabled ());
+  w.PutStream (m_ranvar);
+}
+
+void
+RateErrorModel::Restore (CheckpointReader &r)
+{
+  NS_LOG_FUNCTION (this);
+  if (r.Get<bool> ())
+    {
+      Enable ();
+    }
+  else
+    {
+      Disable ();
+    }
+  r.GetStream (m_ranvar);
+}
+
 bool 
 RateErrorModel::DoCorrupt (Ptr<Packet> p) 
 { 
@@ -62,6 +62,8 @@
 namespace ns3 {
 
 class Packet;
+class CheckpointWriter;
+class CheckpointReader;
 
 /**
  * \ingroup network
@@ -137,6 +139,16 @@ public:
    */
   bool IsEnabled (void) const;
 
+  /**
+   * Save the state of the model into a checkpoint. The models that do
+   * not override it make the checkpoint fail.
+   */
+  virtual void Save (CheckpointWriter &w) const;
+  /**
+   * Restore what Save saved.
+   */
+  virtual void Restore (CheckpointReader &r);
+
 private:
   /*
    * These methods must be implemented by subclasses
@@ -210,6 +222,9 @@ public:
   */
   int64_t AssignStreams (int64_t stream);
 
+  virtual void Save (CheckpointWriter &w) const;
+  virtual void Restore (CheckpointReader &r);
+
 private:
   virtual bool DoCorrupt (Ptr<Packet> p);
   virtual bool DoCorruptPkt (Ptr<Packet> p);
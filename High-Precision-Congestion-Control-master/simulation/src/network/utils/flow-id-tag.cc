@@ -82,7 +82,7 @@ FlowIdTag::GetFlowId (void) const
 uint32_t 
 FlowIdTag::AllocateFlowId (void)
 {
-  static uint32_t nextFlowId = 1;
+  static thread_local uint32_t nextFlowId = 1; // per thread, like the simulation
   uint32_t flowId = nextFlowId;
   nextFlowId++;
   return flowId;
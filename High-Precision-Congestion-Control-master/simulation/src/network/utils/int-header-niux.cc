@@ -1,10 +1,15 @@
+#include "ns3/simulator.h"
 #include "int-header-niux.h"
+#include "thread-rand.h"
 
 namespace ns3 {
 
+thread_local uint32_t MyIntHeader::version = 1;
+
 MyIntHeader::MyIntHeader() {
 	hinfo.buf = 0;
 	hinfo.totalLength = 10;
+	hinfo.version = version - 1;
 	for (int i = 0; i < idNum; ++i)
 		iinfo[i].buf = 0;
 	for (int i = 0; i < maxNum; ++i) {
@@ -20,22 +25,101 @@ MyIntHeader::MyIntHeader() {
 }
 
 uint32_t MyIntHeader::GetStaticSize() {
+	static_assert(sizeof(compactHead)+sizeof(compactDepth)*maxNum+sizeof(compactRatio)*maxNum <= sizeof(idInfo)*idNum+sizeof(depthInfo)*maxNum+sizeof(ratioInfo)*maxNum, "compact INT must not be larger than version 1");
 	return sizeof(hinfo)+sizeof(idInfo)+sizeof(dinfo)+sizeof(rinfo);
 }
 
-void MyIntHeader::PushRoute(uint8_t _id, uint8_t _port) {
+bool MyIntHeader::IsCompact() const {
+	return hinfo.version == 1;
+}
+
+uint16_t MyIntHeader::EncodeF16(uint64_t v) {
+	if (v < 4096)
+		return v;
+	uint32_t e = 64 - __builtin_clzll(v) - 12;
+	if (e > 15)
+		return 0xffff;
+	return (e << 12) | (v >> e);
+}
+
+uint64_t MyIntHeader::DecodeF16(uint16_t f) {
+	return (uint64_t)(f & 0xfff) << (f >> 12);
+}
+
+void MyIntHeader::SetSendTime(uint64_t ts) {
+	if (IsCompact())
+		chead.base = ts >> 10;
+}
+
+void MyIntHeader::CopyFormat(const MyIntHeader &ih) {
+	hinfo.version = ih.hinfo.version;
+	if (IsCompact())
+		chead.base = ih.chead.base;
+}
+
+// the send time is at most ~17 s before now, so the 24 bits are enough to place it
+uint64_t MyIntHeader::GetSendTime(uint64_t now) const {
+	uint64_t n = now >> 10;
+	return (n - ((n - chead.base) & 0xffffff)) << 10;
+}
+
+uint16_t MyIntHeader::EncodeDts(uint64_t ts, uint64_t now) const {
+	uint64_t base = GetSendTime(now);
+	return EncodeF16(ts > base ? (ts - base) >> 4 : 0); // a port's ts may lag the send time a little
+}
+
+int64_t MyIntHeader::DecodeDts(uint16_t dts, uint64_t now) const {
+	uint64_t ts = GetSendTime(now) + (DecodeF16(dts) << 4);
+	return ts < now ? ts : now;
+}
+
+void MyIntHeader::PushRoute(uint16_t _id, uint8_t _port) {
 	if (hinfo.nodeNum < idNum)
-		if (rand()%3 == 0)
-			iinfo[hinfo.nodeNum++].Set(_id, _port);
+		if (ThreadRand::Next()%3 == 0) {
+			if (IsCompact()) {
+				hinfo.nodeNum++;
+				chead.id = _id;
+				chead.port = _port;
+			}else
+				iinfo[hinfo.nodeNum++].Set(_id, _port);
+		}
+}
+
+uint16_t MyIntHeader::GetRouteId(uint32_t i) const {
+	return IsCompact() ? chead.id : iinfo[i].id;
 }
 
-int MyIntHeader::PushDepth(uint8_t _id, uint8_t _port, uint32_t _depth, uint32_t _ts, uint8_t _maxRate) {
+uint8_t MyIntHeader::GetRoutePort(uint32_t i) const {
+	return IsCompact() ? chead.port : iinfo[i].port;
+}
+
+int MyIntHeader::PushDepth(uint16_t _id, uint8_t _port, uint32_t _depth, uint64_t _ts, uint8_t _maxRate) {
 	//_depth = _depth / qlenUnit;
 	
 	if (_depth == 0) {
 		return -1;
 	}
 
+	if (IsCompact()) {
+		uint32_t idx = hinfo.depthNum;
+		if (idx == maxNum) { // replace the shallowest record, if this one is deeper
+			idx = 0;
+			for (uint32_t i = 1; i < maxNum; ++i)
+				if (cdinfo[i].depth < cdinfo[idx].depth)
+					idx = i;
+			if (EncodeF16(_depth) <= cdinfo[idx].depth)
+				return 0;
+		}else
+			hinfo.depthNum++;
+		compactDepth &d = cdinfo[idx];
+		d.id = _id;
+		d.port = _port;
+		d.maxRate = _maxRate;
+		d.depth = EncodeF16(_depth);
+		d.dts = EncodeDts(_ts, Simulator::Now().GetTimeStep());
+		return 1;
+	}
+
 	if (hinfo.depthNum < maxNum) {
 		dinfo[hinfo.depthNum++].Set(_id, _port, _depth, _ts, _maxRate);
 		return 1;
@@ -57,7 +141,27 @@ int MyIntHeader::PushDepth(uint8_t _id, uint8_t _port, uint32_t _depth, uint32_t
 	}
 }
 
-int MyIntHeader::PushRatio(uint8_t _id, uint8_t _port, uint16_t _ratio, uint32_t _ts, uint8_t _maxRate) {
+int MyIntHeader::PushRatio(uint16_t _id, uint8_t _port, uint16_t _ratio, uint64_t _ts, uint8_t _maxRate) {
+	if (IsCompact()) {
+		uint32_t idx = hinfo.ratioNum;
+		if (idx == maxNum) {
+			idx = 0;
+			for (uint32_t i = 1; i < maxNum; ++i)
+				if (crinfo[i].ratio < crinfo[idx].ratio)
+					idx = i;
+			if (_ratio <= crinfo[idx].ratio)
+				return 0;
+		}else
+			hinfo.ratioNum++;
+		compactRatio &r = crinfo[idx];
+		r.id = _id;
+		r.port = _port;
+		r.maxRate = _maxRate;
+		r.ratio = _ratio;
+		r.dts = EncodeDts(_ts, Simulator::Now().GetTimeStep());
+		return 1;
+	}
+
 	if (hinfo.ratioNum < maxNum) {
 		rinfo[hinfo.ratioNum++].Set(_id, _port, _ratio, _ts, _maxRate);
 		return 1;
@@ -79,9 +183,67 @@ int MyIntHeader::PushRatio(uint8_t _id, uint8_t _port, uint16_t _ratio, uint32_t
 	}
 }
 
+MyIntHeader::Entry MyIntHeader::GetDepth(uint32_t i) const {
+	return GetDepth(i, Simulator::Now().GetTimeStep());
+}
+
+MyIntHeader::Entry MyIntHeader::GetDepth(uint32_t i, uint64_t now) const {
+	Entry e;
+	if (IsCompact()) {
+		e.id = cdinfo[i].id;
+		e.port = cdinfo[i].port;
+		e.maxRate = cdinfo[i].maxRate;
+		e.value = DecodeF16(cdinfo[i].depth);
+		e.ts = DecodeDts(cdinfo[i].dts, now);
+	}else {
+		e.id = dinfo[i].iinfo.id;
+		e.port = dinfo[i].iinfo.port;
+		e.maxRate = dinfo[i].maxRate;
+		e.value = dinfo[i].depth;
+		int64_t age = (int64_t)(now%((1<<24)*100)) - 100*dinfo[i].ts;
+		if (age < 0)
+			age += (1<<24)*100;
+		e.ts = now - age;
+	}
+	return e;
+}
+
+MyIntHeader::Entry MyIntHeader::GetRatio(uint32_t i) const {
+	return GetRatio(i, Simulator::Now().GetTimeStep());
+}
+
+MyIntHeader::Entry MyIntHeader::GetRatio(uint32_t i, uint64_t now) const {
+	Entry e;
+	if (IsCompact()) {
+		e.id = crinfo[i].id;
+		e.port = crinfo[i].port;
+		e.maxRate = crinfo[i].maxRate;
+		e.value = crinfo[i].ratio;
+		e.ts = DecodeDts(crinfo[i].dts, now);
+	}else {
+		e.id = rinfo[i].iinfo.id;
+		e.port = rinfo[i].iinfo.port;
+		e.maxRate = rinfo[i].maxRate;
+		e.value = rinfo[i].ratio;
+		int64_t age = (int64_t)(now%((1<<24)*100)) - 100*rinfo[i].ts;
+		if (age < 0)
+			age += (1<<24)*100;
+		e.ts = now - age;
+	}
+	return e;
+}
+
 void MyIntHeader::Serialize (Buffer::Iterator start) const{
 	Buffer::Iterator i = start;
 	i.WriteU16(hinfo.buf);
+	if (IsCompact()) { // same bytes as in memory, switches update the records in place
+		i.Write(chead.buf, sizeof(chead));
+		for (int j = 0; j < maxNum; ++j)
+			i.Write(cdinfo[j].buf, sizeof(compactDepth));
+		for (int j = 0; j < maxNum; ++j)
+			i.Write(crinfo[j].buf, sizeof(compactRatio));
+		return;
+	}
 	for (int j = 0; j < idNum; ++j)
 		i.WriteU16(iinfo[j].buf);
 	for (int j = 0; j < maxNum; ++j) {
@@ -97,6 +259,14 @@ void MyIntHeader::Serialize (Buffer::Iterator start) const{
 uint32_t MyIntHeader::Deserialize (Buffer::Iterator start){
 	Buffer::Iterator i = start;
 	hinfo.buf = i.ReadU16();
+	if (IsCompact()) {
+		i.Read(chead.buf, sizeof(chead));
+		for (int j = 0; j < maxNum; ++j)
+			i.Read(cdinfo[j].buf, sizeof(compactDepth));
+		for (int j = 0; j < maxNum; ++j)
+			i.Read(crinfo[j].buf, sizeof(compactRatio));
+		return GetStaticSize();
+	}
 	for (int j = 0; j < idNum; ++j)
 		iinfo[j].buf = i.ReadU16();
 	for (int j = 0; j < maxNum; ++j) {
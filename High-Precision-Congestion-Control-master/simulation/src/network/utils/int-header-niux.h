@@ -12,7 +12,8 @@ public:
 	union {
 		struct {
 			uint16_t totalLength: 4,	// total length of this header in packet
-							 nodeNum: 4,	// nodes count for routing
+							 nodeNum: 2,	// nodes count for routing
+							 version: 2,	// encoding of the records below, see MyIntHeader::version
 							 depthNum: 4,	// nodes count for depth info
 							 ratioNum: 4;	// nodes count for ratio info
 		};
@@ -83,30 +84,120 @@ public:
 	}
 };
 
+/*
+ * Compact (version 2) records: 16-bit node id, and timestamps as a delta from the send
+ * time of the packet, which the sender stamps once in compactHead.
+ * depth and delta are 16-bit floats (see EncodeF16), exact below 4096 units.
+ */
+#pragma pack (1)
+class compactHead {
+public:
+	union {
+		struct {
+			uint64_t base: 24,	// send time, in 1024 ns units (wraps every ~17 s)
+							 id: 16,	// route
+							 port: 8;
+		};
+		uint8_t buf[6];
+	};
+};
+
+class compactDepth {
+public:
+	union {
+		struct {
+			uint64_t id: 16,
+							 port: 8,
+							 maxRate: 8,
+							 depth: 16,	// bytes, F16
+							 dts: 16;	// ts - send time, in 16 ns units, F16
+		};
+		uint8_t buf[8];
+	};
+};
+
+class compactRatio {
+public:
+	union {
+		struct {
+			uint64_t id: 16,
+							 port: 8,
+							 maxRate: 8,
+							 ratio: 16,
+							 dts: 16;
+		};
+		uint8_t buf[8];
+	};
+};
+
 class MyIntHeader {
 public:
 	static const uint32_t idNum = 1;
 	static const uint32_t maxNum = 2;
 
+	// the encoding of new headers: 1 (8-bit node id, 24-bit ts in 100 ns) or 2 (compact records)
+	// headers carry their own version, so switches and hosts decode whichever they get
+	static thread_local uint32_t version; // per simulation thread, see IntHeader::mode
+
 	// headerInfo: 2 Bytes
 	headerInfo hinfo;
-	// idInfo: 2*1 = 2 Bytes
-	idInfo iinfo[idNum];
-	// depthInfo: Max 10*2 = 20 Bytes
-	depthInfo dinfo[maxNum];
-	// ratioInfo: Max 8*2 = 16 Bytes
-	ratioInfo rinfo[maxNum];
+	union {
+		struct { // version 1
+			// idInfo: 2*1 = 2 Bytes
+			idInfo iinfo[idNum];
+			// depthInfo: Max 10*2 = 20 Bytes
+			depthInfo dinfo[maxNum];
+			// ratioInfo: Max 8*2 = 16 Bytes
+			ratioInfo rinfo[maxNum];
+		};
+		struct { // version 2
+			// compactHead: 6 Bytes
+			compactHead chead;
+			// compactDepth: Max 8*2 = 16 Bytes
+			compactDepth cdinfo[maxNum];
+			// compactRatio: Max 8*2 = 16 Bytes
+			compactRatio crinfo[maxNum];
+		};
+	};
+
+	// a depth/ratio record, decoded from either version
+	struct Entry {
+		uint16_t id;
+		uint8_t port;
+		uint8_t maxRate;
+		uint32_t value; // depth (B) or ratio
+		int64_t ts; // absolute time (ns) of the measurement
+	};
 
 	//static const uint32_t qlenUnit = 80;
 
 	MyIntHeader();
 	static uint32_t GetStaticSize();
-	void PushRoute(uint8_t _id, uint8_t _port);
-	int PushDepth(uint8_t _id, uint8_t _port, uint32_t _depth, uint32_t _ts, uint8_t _maxRate);
-	int PushRatio(uint8_t _id, uint8_t _port, uint16_t _ratio, uint32_t _ts, uint8_t _maxRate);
+	bool IsCompact() const;
+	void SetSendTime(uint64_t ts); // stamped by the sender, the base of the compact timestamps
+	void CopyFormat(const MyIntHeader &ih); // version and send time, for a header rebuilt from a received one
+	void PushRoute(uint16_t _id, uint8_t _port);
+	int PushDepth(uint16_t _id, uint8_t _port, uint32_t _depth, uint64_t _ts, uint8_t _maxRate);
+	int PushRatio(uint16_t _id, uint8_t _port, uint16_t _ratio, uint64_t _ts, uint8_t _maxRate);
+	uint16_t GetRouteId(uint32_t i) const;
+	uint8_t GetRoutePort(uint32_t i) const;
+	Entry GetDepth(uint32_t i) const;
+	Entry GetRatio(uint32_t i) const;
+	// the same, with the current time (ns) the timestamps are unwrapped against
+	Entry GetDepth(uint32_t i, uint64_t now) const;
+	Entry GetRatio(uint32_t i, uint64_t now) const;
 	void Serialize (Buffer::Iterator start) const;
 	uint32_t Deserialize (Buffer::Iterator start);
+
+	static uint16_t EncodeF16(uint64_t v); // 4-bit exponent, 12-bit mantissa, rounded down, saturates at 4095<<15
+	static uint64_t DecodeF16(uint16_t f);
+
+private:
+	uint64_t GetSendTime(uint64_t now) const;
+	uint16_t EncodeDts(uint64_t ts, uint64_t now) const;
+	int64_t DecodeDts(uint16_t dts, uint64_t now) const;
 };
+#pragma pack ()
 
 }
 
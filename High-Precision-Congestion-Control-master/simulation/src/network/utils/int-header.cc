@@ -3,10 +3,10 @@
 namespace ns3 {
 
 const uint64_t IntHop::lineRateValues[8] = {25000000000lu,50000000000lu,100000000000lu,200000000000lu,400000000000lu,0,0,0};
-uint32_t IntHop::multi = 1;
+thread_local uint32_t IntHop::multi = 1;
 
-IntHeader::Mode IntHeader::mode = NONE;
-int IntHeader::pint_bytes = 2;
+thread_local IntHeader::Mode IntHeader::mode = NONE;
+thread_local int IntHeader::pint_bytes = 2;
 
 IntHeader::IntHeader() : nhop(0) {
 	for (uint32_t i = 0; i < maxHop; i++)
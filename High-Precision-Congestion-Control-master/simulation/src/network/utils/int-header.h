@@ -25,7 +25,7 @@ public:
 
 	static const uint32_t byteUnit = 128;
 	static const uint32_t qlenUnit = 80;
-	static uint32_t multi;
+	static thread_local uint32_t multi; // per simulation thread, like mode
 
 	uint64_t GetLineRate(){
 		return lineRateValues[lineRate];
@@ -82,8 +82,9 @@ public:
 		PINT = 2,
 		NONE
 	};
-	static Mode mode;
-	static int pint_bytes;
+	// set by the simulation script; per thread, as each thread may run its own simulation (see Simulator)
+	static thread_local Mode mode;
+	static thread_local int pint_bytes;
 
 	// Note: the structure of IntHeader must have no internal padding, because we will directly transform the part of packet buffer to IntHeader*
 	union{
@@ -118,7 +118,7 @@ Mac48Address::ConvertFrom (const Address &address)
 Mac48Address 
 Mac48Address::Allocate (void)
 {
-  static uint64_t id = 0;
+  static thread_local uint64_t id = 0; // per thread, like the simulation
   id++;
   Mac48Address address;
   address.m_address[0] = (id >> 40) & 0xff;
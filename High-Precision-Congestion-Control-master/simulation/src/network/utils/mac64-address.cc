@@ -117,7 +117,7 @@ Mac64Address::ConvertTo (void) const
 Mac64Address 
 Mac64Address::Allocate (void)
 {
-  static uint64_t id = 0;
+  static thread_local uint64_t id = 0; // per thread, like the simulation
   id++;
   Mac64Address address;
   address.m_address[0] = (id >> 56) & 0xff;
@@ -18,7 +18,9 @@
 #include <stdio.h>
 #include "ns3/log.h"
 #include "ns3/trace-source-accessor.h"
+#include "ns3/mem-profiler.h"
 #include "queue.h"
+#include "checkpoint.h"
 
 NS_LOG_COMPONENT_DEFINE ("Queue");
 
@@ -26,6 +28,10 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (Queue);
 
+// the packets held by queues and their size; their memory is counted by
+// ns3::Packet and ns3::Buffer::Data
+NS_MEM_CATEGORY (g_memQueued, "ns3::Queue::packets", false);
+
 TypeId 
 Queue::GetTypeId (void)
 {
@@ -78,6 +84,7 @@ Queue::Enqueue (Ptr<Packet> p)
 
       m_nPackets++;
       m_nTotalReceivedPackets++;
+      NS_MEM_ALLOC (g_memQueued, size);
     }
   return retval;
 }
@@ -99,6 +106,7 @@ Queue::Dequeue (void)
 
       m_nBytes -= packet->GetSize ();
       m_nPackets--;
+      NS_MEM_FREE (g_memQueued, packet->GetSize ());
 
       NS_LOG_LOGIC ("m_traceDequeue (packet)");
       m_traceDequeue (packet);
@@ -202,4 +210,42 @@ Queue::Drop (Ptr<Packet> p)
   m_traceDrop (p);
 }
 
+void
+Queue::Save (CheckpointWriter &w) const
+{
+  w.Fail (GetInstanceTypeId ().GetName () + " cannot be checkpointed");
+}
+
+void
+Queue::Restore (CheckpointReader &r)
+{
+  r.Fail (GetInstanceTypeId ().GetName () + " cannot be checkpointed");
+}
+
+void
+Queue::SaveCounters (CheckpointWriter &w) const
+{
+  w.Put (m_nBytes);
+  w.Put (m_nTotalReceivedBytes);
+  w.Put (m_nPackets);
+  w.Put (m_nTotalReceivedPackets);
+  w.Put (m_nTotalDroppedBytes);
+  w.Put (m_nTotalDroppedPackets);
+}
+
+void
+Queue::RestoreCounters (CheckpointReader &r)
+{
+  uint32_t nBytes = r.Get<uint32_t> ();
+  r.Get (m_nTotalReceivedBytes);
+  uint32_t nPackets = r.Get<uint32_t> ();
+  r.Get (m_nTotalReceivedPackets);
+  r.Get (m_nTotalDroppedBytes);
+  r.Get (m_nTotalDroppedPackets);
+  if (nBytes != m_nBytes || nPackets != m_nPackets)
+    {
+      r.Fail ("the packets of a queue do not add up to its counters");
+    }
+}
+
 } // namespace ns3
@@ -32,6 +32,9 @@
 
 namespace ns3 {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 /**
  * \ingroup network
  * \defgroup queue Queue
@@ -115,6 +118,17 @@ public:
    */
   void ResetStatistics (void);
 
+  /**
+   * Save the packets and the counters of the queue into a checkpoint.
+   * Only the queues that override it can be saved; the others make the
+   * checkpoint fail.
+   */
+  virtual void Save (CheckpointWriter &w) const;
+  /**
+   * Restore what Save saved into an empty queue.
+   */
+  virtual void Restore (CheckpointReader &r);
+
   /**
    * \brief Enumeration of the modes supported in the class.
    *
@@ -158,6 +172,9 @@ private:
 protected:
   // called by subclasses to notify parent of packet drops.
   void Drop (Ptr<Packet> packet);
+  // the counters, saved after the packets: re-enqueueing them counts them
+  void SaveCounters (CheckpointWriter &w) const;
+  void RestoreCounters (CheckpointReader &r);
 
 protected:
   TracedCallback<Ptr<const Packet> > m_traceEnqueue;
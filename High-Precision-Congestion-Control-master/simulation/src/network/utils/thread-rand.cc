@@ -0,0 +1,70 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "thread-rand.h"
+#include "checkpoint.h"
+
+namespace ns3 {
+
+// zero-initialized, so each thread seeds its own stream on first use
+thread_local ThreadRand::State ThreadRand::m_state;
+
+void
+ThreadRand::Seed (uint32_t seed)
+{
+  State &s = m_state;
+  int32_t x[34];
+  x[0] = seed;
+  for (int k = 1; k < 31; k++)
+    {
+      int64_t v = (16807LL * x[k - 1]) % 2147483647;
+      if (v < 0)
+        {
+          v += 2147483647;
+        }
+      x[k] = v;
+    }
+  for (int k = 31; k < 34; k++)
+    {
+      x[k] = x[k - 31];
+    }
+  for (int k = 0; k < 34; k++)
+    {
+      s.r[k] = x[k];
+    }
+  s.i = 0;
+  s.seeded = true;
+  // glibc discards the first 310 outputs
+  for (int k = 34; k < 344; k++)
+    {
+      Next ();
+    }
+}
+
+int32_t
+ThreadRand::Next (void)
+{
+  State &s = m_state;
+  if (!s.seeded)
+    {
+      Seed (1);
+    }
+  // r[n] = r[n-31] + r[n-3] over a ring of the last 34 values
+  uint32_t v = s.r[(s.i + 3) % 34] + s.r[(s.i + 31) % 34];
+  s.r[s.i] = v;
+  s.i = (s.i + 1) % 34;
+  return v >> 1;
+}
+
+void
+ThreadRand::Save (CheckpointWriter &w)
+{
+  w.Put (m_state);
+}
+
+void
+ThreadRand::Restore (CheckpointReader &r)
+{
+  r.Get (m_state);
+}
+
+} // namespace ns3
@@ -0,0 +1,47 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#ifndef THREAD_RAND_H
+#define THREAD_RAND_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * \ingroup network
+ * \brief A rand() with one stream per thread.
+ *
+ * The PINT sampling and the INT route sampling used the libc rand(), whose
+ * state is shared by the whole process, so the runs of a batch drew from
+ * one stream and their results depended on how the threads interleaved.
+ * This generator is the glibc one (TYPE_3, seed 1, i.e. what rand() returns
+ * when srand is never called), so a single run draws exactly the numbers it
+ * drew before, and each thread starts from the same seed.
+ */
+class ThreadRand
+{
+public:
+  /** \returns a value in [0, RAND_MAX], like rand() */
+  static int32_t Next (void);
+  /** restart the stream of the calling thread from seed */
+  static void Seed (uint32_t seed);
+  /** save and restore the stream of the calling thread */
+  static void Save (CheckpointWriter &w);
+  static void Restore (CheckpointReader &r);
+
+private:
+  struct State
+  {
+    uint32_t r[34];
+    uint32_t i;
+    bool seeded;
+  };
+  static thread_local State m_state;
+};
+
+} // namespace ns3
+
+#endif /* THREAD_RAND_H */
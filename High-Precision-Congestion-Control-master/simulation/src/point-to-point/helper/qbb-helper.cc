@@ -19,6 +19,8 @@
  */
 
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 #include "ns3/abort.h"
 #include "ns3/log.h"
@@ -36,9 +38,12 @@
 #include "ns3/mpi-receiver.h"
 
 #include "ns3/trace-helper.h"
+#include "ns3/trace-filter.h"
+#include "ns3/ppp-header.h"
 #include "point-to-point-helper.h"
 #include "qbb-helper.h"
 #include "ns3/custom-header.h"
+#include "ns3/enc-header.h"
 #include "ns3/trace-format.h"
 
 NS_LOG_COMPONENT_DEFINE ("QbbHelper");
@@ -51,6 +56,8 @@ QbbHelper::QbbHelper ()
   m_deviceFactory.SetTypeId ("ns3::QbbNetDevice");
   m_channelFactory.SetTypeId ("ns3::QbbChannel");
   m_remoteChannelFactory.SetTypeId ("ns3::QbbRemoteChannel");
+  m_traceSample = 1;
+  m_traceSamplePerFlow = false;
 }
 
 void 
@@ -310,16 +317,104 @@ QbbHelper::Install (std::string aName, std::string bName)
   return Install (a, b);
 }
 
-void QbbHelper::GetTraceFromPacket(TraceFormat &tr, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx, Event event, bool hasL2){
-	CustomHeader hdr((hasL2?CustomHeader::L2_Header:0) | CustomHeader::L3_Header | CustomHeader::L4_Header);
-	p->PeekHeader(hdr);
+/**
+ * The output file and what to keep, shared by the callbacks of all traced devices
+ */
+class TraceCapture : public SimpleRefCount<TraceCapture>{
+public:
+	Ptr<TraceWriter> writer;
+	::TraceFilter filter;
+	uint32_t sample; // keep 1 in sample
+	bool perFlow;
+
+	~TraceCapture(){
+		if (filter.root){
+			filter.root->clear();
+			delete filter.root;
+		}
+	}
+};
 
+void QbbHelper::SetTraceFilter(std::string expr){
+	m_traceFilter = expr;
+}
+
+void QbbHelper::SetTraceSampling(uint32_t n, bool perFlow){
+	m_traceSample = n > 0 ? n : 1;
+	m_traceSamplePerFlow = perFlow;
+}
+
+void QbbHelper::GetEventTrace(TraceFormat &tr, Ptr<QbbNetDevice> dev, uint32_t qidx, Event event){
 	tr.event = event;
 	tr.node = dev->GetNode()->GetId();
 	tr.nodeType = dev->GetNode()->GetNodeType();
 	tr.intf = dev->GetIfIndex();
 	tr.qidx = qidx;
 	tr.time = Simulator::Now().GetTimeStep();
+	tr.qlen = dev->GetQueue()->GetNBytes(qidx);
+}
+
+void QbbHelper::PeekTrace(TraceFormat &tr, Ptr<const Packet> p, bool hasL2){
+	// ppp, ip without options, then the first 4 bytes of L4 (ports)
+	uint8_t buf[64];
+	uint32_t l2 = hasL2 ? PppHeader::GetStaticSize() : 0;
+	uint32_t n = p->CopyData(buf, l2 + 24);
+	tr.size = p->GetSize();
+	tr.data.sport = tr.data.dport = 0;
+	if (n < l2 + 20){
+		tr.l3Prot = 0;
+		tr.sip = tr.dip = 0;
+		return;
+	}
+	uint8_t *ip = buf + l2;
+	tr.ecn = ip[1] & 0x3;
+	tr.l3Prot = ip[9];
+	tr.sip = (uint32_t)ip[12] << 24 | (uint32_t)ip[13] << 16 | (uint32_t)ip[14] << 8 | ip[15];
+	tr.dip = (uint32_t)ip[16] << 24 | (uint32_t)ip[17] << 16 | (uint32_t)ip[18] << 8 | ip[19];
+	if (n < l2 + 24)
+		return;
+	switch (tr.l3Prot){
+		case 0x6:
+		case 0x11:
+			tr.data.sport = ip[20] << 8 | ip[21];
+			tr.data.dport = ip[22] << 8 | ip[23];
+			break;
+		case 0xFC:
+		case 0xFD:
+			// qbbHeader writes the ports in host order
+			memcpy(&tr.ack.sport, ip + 20, 2);
+			memcpy(&tr.ack.dport, ip + 22, 2);
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * Hash of the packet for sampling. It only uses fields that do not change
+ * hop by hop, so a packet is kept or dropped at every hop alike. The flow key
+ * is symmetric, so a flow's ACKs are sampled together with its data.
+ */
+static uint64_t TraceSampleHash(TraceFormat &tr, Ptr<const Packet> p, bool hasL2, bool perFlow){
+	uint64_t a = (uint64_t)tr.sip << 16 | tr.data.sport, b = (uint64_t)tr.dip << 16 | tr.data.dport;
+	uint64_t h = std::min(a, b) * 0x9e3779b97f4a7c15lu ^ std::max(a, b);
+	if (!perFlow){
+		uint8_t buf[32];
+		uint32_t l2 = hasL2 ? PppHeader::GetStaticSize() : 0;
+		if (p->CopyData(buf, l2 + 6) == l2 + 6)
+			h ^= (uint64_t)(buf[l2 + 4] << 8 | buf[l2 + 5]) << 40; // ip id
+	}
+	// splitmix64 finalizer
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9lu;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111eblu;
+	return h ^ (h >> 31);
+}
+
+void QbbHelper::GetTraceFromPacket(TraceFormat &tr, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx, Event event, bool hasL2){
+	CustomHeader hdr((hasL2?CustomHeader::L2_Header:0) | CustomHeader::L3_Header | CustomHeader::L4_Header);
+	p->PeekHeader(hdr);
+
+	GetEventTrace(tr, dev, qidx, event);
 	tr.sip = hdr.sip;
 	tr.dip = hdr.dip;
 	tr.l3Prot = hdr.l3Prot;
@@ -342,8 +437,8 @@ void QbbHelper::GetTraceFromPacket(TraceFormat &tr, Ptr<QbbNetDevice> dev, Ptr<c
 		case 0xFD:
 			tr.ack.sport = hdr.ack.sport;
 			tr.ack.dport = hdr.ack.dport;
-			tr.ack.flags = hdr.ack.flags;
-			tr.ack.pg = hdr.ack.pg;
+			tr.ack.flags = hdr.ack.flags & encHeader::FLAG_MASK; // without the rx qp id
+			tr.ack.pg = hdr.ack.pg; // the tx qp id (see RdmaHw::ReceiveTcp)
 			tr.ack.seq = hdr.ack.seq;
 			tr.ack.ts = hdr.ack.ih.GetTs();
 			break;
@@ -363,51 +458,82 @@ void QbbHelper::GetTraceFromPacket(TraceFormat &tr, Ptr<QbbNetDevice> dev, Ptr<c
 			break;
 	}
 	tr.size = p->GetSize();//hdr.m_payloadSize;
-	tr.qlen = dev->GetQueue()->GetNBytes(qidx);
 }
 
-void QbbHelper::PacketEventCallback(FILE *file, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx, Event event, bool hasL2){
+void QbbHelper::PacketEventCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx, Event event, bool hasL2){
 	TraceFormat tr;
+	// test the filter on what is known so far, and only parse the packet if it may pass
+	GetEventTrace(tr, dev, qidx, event);
+	int res = cap->filter.test(tr, ::TraceFilter::EVENT);
+	if (res == ::TraceFilter::FAIL)
+		return;
+	if (res == ::TraceFilter::UNKNOWN || cap->sample > 1){
+		PeekTrace(tr, p, hasL2);
+		if (cap->sample > 1 && TraceSampleHash(tr, p, hasL2, cap->perFlow) % cap->sample != 0)
+			return;
+		if (res == ::TraceFilter::UNKNOWN){
+			res = cap->filter.test(tr, ::TraceFilter::PEEK);
+			if (res == ::TraceFilter::FAIL)
+				return;
+		}
+	}
 	GetTraceFromPacket(tr, dev, p, qidx, event, hasL2);
-	tr.Serialize(file);
+	if (res == ::TraceFilter::UNKNOWN && !cap->filter.test(tr))
+		return;
+	cap->writer->Write(&tr, sizeof(tr));
 }
 
-void QbbHelper::MacRxDetailCallback (FILE* file, Ptr<QbbNetDevice> dev, Ptr<const Packet> p){
-	PacketEventCallback(file, dev, p, 0, Recv, true);
+void QbbHelper::MacRxDetailCallback (Ptr<TraceCapture> cap, Ptr<QbbNetDevice> dev, Ptr<const Packet> p){
+	PacketEventCallback(cap, dev, p, 0, Recv, true);
 }
 
-void QbbHelper::EnqueueDetailCallback(FILE* file, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx){
-	PacketEventCallback(file, dev, p, qidx, Enqu, true);
+void QbbHelper::EnqueueDetailCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx){
+	PacketEventCallback(cap, dev, p, qidx, Enqu, true);
 }
 
-void QbbHelper::DequeueDetailCallback(FILE* file, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx){
-	PacketEventCallback(file, dev, p, qidx, Dequ, true);
+void QbbHelper::DequeueDetailCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx){
+	PacketEventCallback(cap, dev, p, qidx, Dequ, true);
 }
 
-void QbbHelper::DropDetailCallback(FILE* file, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx){
-	PacketEventCallback(file, dev, p, qidx, Drop, true);
+void QbbHelper::DropDetailCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, uint32_t qidx){
+	PacketEventCallback(cap, dev, p, qidx, Drop, true);
 }
 
-void QbbHelper::QpDequeueCallback(FILE *file, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, Ptr<RdmaQueuePair> qp){
-	TraceFormat tr;
-	GetTraceFromPacket(tr, dev, p, qp->m_pg, Dequ, true);
-	tr.Serialize(file);
+void QbbHelper::QpDequeueCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice> dev, Ptr<const Packet> p, Ptr<RdmaQueuePair> qp){
+	PacketEventCallback(cap, dev, p, qp->m_pg, Dequ, true);
 }
 
-void QbbHelper::EnableTracingDevice(FILE *file, Ptr<QbbNetDevice> nd){
+void QbbHelper::EnableTracingDevice(Ptr<TraceCapture> cap, Ptr<QbbNetDevice> nd){
 	uint32_t nodeid = nd->GetNode ()->GetId ();
 	uint32_t deviceid = nd->GetIfIndex ();
 	std::ostringstream oss;
 
+	// do not connect the sources whose events can never pass the filter
+	TraceFormat tr;
+	tr.node = nodeid;
+	tr.nodeType = nd->GetNode()->GetNodeType();
+	tr.intf = deviceid;
+	bool traced[5];
+	const uint8_t events[5] = {Recv, Enqu, Dequ, Drop, Dequ};
+	for (uint32_t i = 0; i < 5; i++){
+		tr.event = events[i];
+		traced[i] = cap->filter.test(tr, ::TraceFilter::DEVICE) != ::TraceFilter::FAIL;
+	}
+
 	#if 1
-	nd->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&QbbHelper::MacRxDetailCallback, file, nd));
+	if (traced[0])
+		nd->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&QbbHelper::MacRxDetailCallback, cap, nd));
 	//oss << "/NodeList/" << nd->GetNode ()->GetId () << "/DeviceList/" << deviceid << "/$ns3::QbbNetDevice/MacRx";
 	//Config::ConnectWithoutContext (oss.str (), MakeBoundCallback (&QbbHelper::MacRxDetailCallback, file, nd));
 
-	nd->TraceConnectWithoutContext("QbbEnqueue", MakeBoundCallback (&QbbHelper::EnqueueDetailCallback, file, nd));
-	nd->TraceConnectWithoutContext("QbbDequeue", MakeBoundCallback (&QbbHelper::DequeueDetailCallback, file, nd));
-	nd->TraceConnectWithoutContext("QbbDrop", MakeBoundCallback (&QbbHelper::DropDetailCallback, file, nd));
-	nd->TraceConnectWithoutContext("RdmaQpDequeue", MakeBoundCallback (&QbbHelper::QpDequeueCallback, file, nd));
+	if (traced[1])
+		nd->TraceConnectWithoutContext("QbbEnqueue", MakeBoundCallback (&QbbHelper::EnqueueDetailCallback, cap, nd));
+	if (traced[2])
+		nd->TraceConnectWithoutContext("QbbDequeue", MakeBoundCallback (&QbbHelper::DequeueDetailCallback, cap, nd));
+	if (traced[3])
+		nd->TraceConnectWithoutContext("QbbDrop", MakeBoundCallback (&QbbHelper::DropDetailCallback, cap, nd));
+	if (traced[4])
+		nd->TraceConnectWithoutContext("RdmaQpDequeue", MakeBoundCallback (&QbbHelper::QpDequeueCallback, cap, nd));
 	#endif
 	//nd->GetQueue()->TraceConnectWithoutContext("BeqEnqueue", MakeBoundCallback (&QbbHelper::EnqueueDetailCallback, file, nd));
 	//oss.str ("");
@@ -430,7 +556,15 @@ void QbbHelper::EnableTracingDevice(FILE *file, Ptr<QbbNetDevice> nd){
 	//Config::ConnectWithoutContext (oss.str (), MakeBoundCallback (&QbbHelper::DequeueDetailCallback, file, nd));
 }
 
-void QbbHelper::EnableTracing(FILE *file, NodeContainer node_container){
+void QbbHelper::EnableTracing(Ptr<TraceWriter> writer, NodeContainer node_container){
+  Ptr<TraceCapture> cap = Create<TraceCapture>();
+  cap->writer = writer;
+  cap->sample = m_traceSample;
+  cap->perFlow = m_traceSamplePerFlow;
+  if (!m_traceFilter.empty()){
+    cap->filter.parse(m_traceFilter);
+    NS_ABORT_MSG_IF(cap->filter.root == NULL, "cannot parse trace filter: " << m_traceFilter);
+  }
   NetDeviceContainer devs;
   for (NodeContainer::Iterator i = node_container.Begin (); i != node_container.End (); ++i)
     {
@@ -438,7 +572,7 @@ void QbbHelper::EnableTracing(FILE *file, NodeContainer node_container){
       for (uint32_t j = 0; j < node->GetNDevices (); ++j)
         {
 			if (node->GetDevice(j)->IsQbb())
-				EnableTracingDevice(file, DynamicCast<QbbNetDevice>(node->GetDevice(j)));
+				EnableTracingDevice(cap, DynamicCast<QbbNetDevice>(node->GetDevice(j)));
         }
     }
 }
@@ -29,6 +29,7 @@
 #include "ns3/trace-helper.h"
 #include "ns3/trace-format.h"
 #include "ns3/qbb-net-device.h"
+#include "ns3/trace-writer.h"
 
 namespace ns3 {
 
@@ -43,6 +44,8 @@ class Node;
  * PcapUserHelperForDevice and AsciiTraceUserHelperForDevice are
  * "mixins".
  */
+class TraceCapture;
+
 class QbbHelper : public PcapHelperForDevice, public AsciiTraceHelperForDevice
 {
 public:
@@ -147,17 +150,34 @@ public:
    */
   NetDeviceContainer Install (std::string aNode, std::string bNode);
 
+  static void GetEventTrace(TraceFormat &tr, Ptr<QbbNetDevice>, uint32_t qidx, Event event); // the fields known without the packet
+  static void PeekTrace(TraceFormat &tr, Ptr<const Packet> p, bool hasL2); // addresses, ports and l3Prot, from fixed offsets
   static void GetTraceFromPacket(TraceFormat &tr, Ptr<QbbNetDevice>, Ptr<const Packet> p, uint32_t qidx, Event event, bool hasL2);
-  static void PacketEventCallback(FILE *file, Ptr<QbbNetDevice>, Ptr<const Packet>, uint32_t qidx, Event event, bool hasL2);
-  static void MacRxDetailCallback (FILE* file, Ptr<QbbNetDevice>, Ptr<const Packet> p);
-  static void EnqueueDetailCallback(FILE* file, Ptr<QbbNetDevice>, Ptr<const Packet> p, uint32_t qidx);
-  static void DequeueDetailCallback(FILE* file, Ptr<QbbNetDevice>, Ptr<const Packet> p, uint32_t qidx);
-  static void DropDetailCallback(FILE* file, Ptr<QbbNetDevice>, Ptr<const Packet> p, uint32_t qidx);
-  static void QpDequeueCallback(FILE *file, Ptr<QbbNetDevice>, Ptr<const Packet>, Ptr<RdmaQueuePair>);
+  static void PacketEventCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice>, Ptr<const Packet>, uint32_t qidx, Event event, bool hasL2);
+  static void MacRxDetailCallback (Ptr<TraceCapture> cap, Ptr<QbbNetDevice>, Ptr<const Packet> p);
+  static void EnqueueDetailCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice>, Ptr<const Packet> p, uint32_t qidx);
+  static void DequeueDetailCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice>, Ptr<const Packet> p, uint32_t qidx);
+  static void DropDetailCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice>, Ptr<const Packet> p, uint32_t qidx);
+  static void QpDequeueCallback(Ptr<TraceCapture> cap, Ptr<QbbNetDevice>, Ptr<const Packet>, Ptr<RdmaQueuePair>);
+
+  void EnableTracingDevice(Ptr<TraceCapture> cap, Ptr<QbbNetDevice>);
 
-  void EnableTracingDevice(FILE *file, Ptr<QbbNetDevice>);
+  void EnableTracing(Ptr<TraceWriter> writer, NodeContainer node_container);
 
-  void EnableTracing(FILE *file, NodeContainer node_container);
+  /**
+   * \brief Only trace the events that pass expr (analysis/trace_filter.hpp grammar, e.g. "flow=0x0b000101,0x0b000201,10000,100&event=2").
+   *
+   * The filter is tested in stages, on what is known so far: trace sources whose
+   * node/intf/event can never pass are not connected, and the packet is only
+   * parsed if the time/queue and address/port fields have not rejected it.
+   * Call before EnableTracing.
+   */
+  void SetTraceFilter(std::string expr);
+  /**
+   * \brief Keep 1 in n packets (or flows, if perFlow), chosen by a hash of the packet so that
+   * a packet (or flow) kept at one hop is kept at every hop. Call before EnableTracing.
+   */
+  void SetTraceSampling(uint32_t n, bool perFlow);
 
 private:
   /**
@@ -195,6 +215,10 @@ private:
   ObjectFactory m_channelFactory;
   ObjectFactory m_remoteChannelFactory;
   ObjectFactory m_deviceFactory;
+
+  std::string m_traceFilter;
+  uint32_t m_traceSample;
+  bool m_traceSamplePerFlow;
 };
 
 } // namespace ns3
@@ -0,0 +1,188 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <algorithm>
+#include "ns3/mem-profiler.h"
+#include "record-sink.h"
+#include "record-format.h"
+
+namespace ns3 {
+
+std::atomic<RecordSink*> RecordSink::s_open[RecordSink::MaxOpen];
+SystemMutex RecordSink::s_openMutex;
+
+NS_MEM_CATEGORY(g_memRecordSink, "ns3::RecordSink"); // with its buffer
+
+RecordSink::RecordSink()
+	: m_fd(-1), m_binary(false), m_bufSize(0), m_pos(0), m_bytes(0){
+	NS_MEM_ALLOC(g_memRecordSink, sizeof(RecordSink));
+}
+
+RecordSink::~RecordSink(){
+	Close();
+	NS_MEM_FREE(g_memRecordSink, sizeof(RecordSink) + m_buf.capacity());
+}
+
+bool RecordSink::Open(std::string file, bool binary, uint16_t kind, uint32_t bufSize){
+	m_fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (m_fd < 0)
+		return false;
+	m_binary = binary;
+	m_bufSize = std::max(bufSize, 4096u);
+	NS_MEM_FREE(g_memRecordSink, m_buf.capacity(), 0);
+	m_buf.resize(m_bufSize);
+	NS_MEM_ALLOC(g_memRecordSink, m_buf.capacity(), 0);
+	m_pos = 0;
+	m_bytes = 0;
+	{
+		CriticalSection cs(s_openMutex);
+		uint32_t i = 0;
+		while (i < MaxOpen && s_open[i].load() != NULL)
+			i++;
+		if (i < MaxOpen)
+			s_open[i].store(this);
+		else
+			fprintf(stderr, "RecordSink: more than %u open sinks, %s is not flushed at exit\n", MaxOpen, file.c_str());
+	}
+	if (m_binary){
+		RecordFileHeader h;
+		h.magic = RecordMagic;
+		h.version = RecordVersion;
+		h.kind = kind;
+		Write(&h, sizeof(h));
+	}
+	return true;
+}
+
+void RecordSink::Close(void){
+	if (m_fd < 0)
+		return;
+	Flush();
+	{
+		CriticalSection cs(s_openMutex);
+		for (uint32_t i = 0; i < MaxOpen; i++)
+			if (s_open[i].load() == this)
+				s_open[i].store(NULL);
+	}
+	close(m_fd);
+	m_fd = -1;
+}
+
+bool RecordSink::IsBinary(void) const{
+	return m_binary;
+}
+
+void RecordSink::Printf(const char *fmt, ...){
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(m_buf.data() + m_pos, m_bufSize - m_pos, fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return;
+	if (m_pos + n < m_bufSize){ // vsnprintf also wants room for the '\0'
+		m_pos += n;
+		return;
+	}
+	// does not fit: format it again after the flush, or apart if longer than the buffer
+	Flush();
+	std::vector<char> big;
+	char *dst = m_buf.data();
+	if ((uint32_t)n >= m_bufSize){
+		big.resize(n + 1);
+		dst = big.data();
+	}
+	va_start(ap, fmt);
+	vsnprintf(dst, n + 1, fmt, ap);
+	va_end(ap);
+	if (dst == m_buf.data())
+		m_pos = n;
+	else
+		WriteOut(dst, n);
+}
+
+void RecordSink::Flush(void){
+	if (m_fd < 0 || m_pos == 0)
+		return;
+	WriteOut(m_buf.data(), m_pos);
+	m_pos = 0;
+}
+
+void RecordSink::WriteSlow(const void *data, uint32_t size){
+	Flush();
+	if (size <= m_bufSize){
+		memcpy(m_buf.data(), data, size);
+		m_pos = size;
+	}else
+		WriteOut((const char*)data, size);
+}
+
+void RecordSink::WriteOut(const char *data, uint32_t size){
+	for (uint32_t done = 0; done < size; ){
+		ssize_t n = write(m_fd, data + done, size - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0){
+			perror("RecordSink: write");
+			return;
+		}
+		done += n;
+	}
+	m_bytes += size;
+}
+
+uint64_t RecordSink::GetWrittenBytes(void) const{
+	return m_bytes + m_pos;
+}
+
+void RecordSink::FlushAll(void){
+	CriticalSection cs(s_openMutex);
+	DoFlushAll();
+}
+
+void RecordSink::DoFlushAll(void){
+	for (uint32_t i = 0; i < MaxOpen; i++){
+		RecordSink *s = s_open[i].load();
+		if (s != NULL)
+			s->Flush();
+	}
+}
+
+void RecordSink::HandleSignal(int sig){
+	// async-signal-safe only: the interrupted thread may hold s_openMutex or be
+	// inside malloc or stdio, so no lock, no Flush (perror) and no allocation
+	for (uint32_t i = 0; i < MaxOpen; i++){
+		RecordSink *s = s_open[i].load(std::memory_order_relaxed);
+		if (s == NULL)
+			continue;
+		const char *data = s->m_buf.data();
+		for (uint32_t done = 0, size = s->m_pos; done < size; ){
+			ssize_t n = write(s->m_fd, data + done, size - done);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				break;
+			done += n;
+		}
+	}
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+void RecordSink::InstallExitHandlers(void){
+	static bool installed = false;
+	CriticalSection cs(s_openMutex);
+	if (installed)
+		return;
+	installed = true;
+	atexit(&RecordSink::FlushAll);
+	signal(SIGINT, &RecordSink::HandleSignal);
+	signal(SIGTERM, &RecordSink::HandleSignal);
+	signal(SIGHUP, &RecordSink::HandleSignal);
+	signal(SIGABRT, &RecordSink::HandleSignal);
+}
+
+} // namespace ns3
@@ -0,0 +1,73 @@
+#ifndef RECORD_SINK_H
+#define RECORD_SINK_H
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "ns3/simple-ref-count.h"
+#include "ns3/system-mutex.h"
+
+namespace ns3 {
+
+/**
+ * \brief Buffered output of the records of a run (FCT, PFC, qlen).
+ *
+ * Records are formatted (text) or copied (binary, see record-format.h) into
+ * a large user-space buffer, which is written with one write() when it is
+ * full and at Close, instead of one stdio call (and flush) per record.
+ *
+ * Open sinks are also flushed at exit and on SIGINT, SIGTERM, SIGHUP and
+ * SIGABRT (a failed assert) once InstallExitHandlers has been called, so a
+ * run that is stopped keeps the records it produced (at worst the last one
+ * is cut). The signal handler only calls write(2), so it walks a fixed table
+ * of the open sinks instead of taking the lock. The table is shared by the
+ * simulations that run in the threads of a batch; each sink itself belongs
+ * to one of them.
+ */
+class RecordSink : public SimpleRefCount<RecordSink>{
+public:
+	RecordSink();
+	~RecordSink();
+
+	// binary files start with a RecordFileHeader of the given RecordKind
+	bool Open(std::string file, bool binary, uint16_t kind, uint32_t bufSize = 1 << 20);
+	void Close(void); // write what is buffered and close the file
+	bool IsBinary(void) const;
+
+	inline void Write(const void *data, uint32_t size){
+		if (m_pos + size <= m_bufSize){
+			memcpy(&m_buf[m_pos], data, size);
+			m_pos += size;
+		}else
+			WriteSlow(data, size);
+	}
+	void Printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+	void Flush(void);
+
+	uint64_t GetWrittenBytes(void) const;
+
+	static void InstallExitHandlers(void);
+	static void FlushAll(void); // flush every open sink
+
+private:
+	void WriteSlow(const void *data, uint32_t size);
+	void WriteOut(const char *data, uint32_t size);
+	static void HandleSignal(int sig);
+	static void DoFlushAll(void);
+
+	int m_fd;
+	bool m_binary;
+	std::vector<char> m_buf;
+	uint32_t m_bufSize, m_pos;
+	uint64_t m_bytes;
+
+	static const uint32_t MaxOpen = 1024;
+	static std::atomic<RecordSink*> s_open[MaxOpen]; // NULL for a free slot
+	static SystemMutex s_openMutex;
+};
+
+} // namespace ns3
+
+#endif /* RECORD_SINK_H */
@@ -0,0 +1,69 @@
+#include "ns3/simulator.h"
+#include "ns3/checkpoint.h"
+#include "stats-registry.h"
+
+namespace ns3 {
+
+void StatsRegistry::Register(std::string name, const uint64_t *counter){
+	Entry e = {name, counter, true, 0};
+	m_entries.push_back(e);
+}
+
+void StatsRegistry::Register(std::string name, const uint32_t *counter){
+	Entry e = {name, counter, false, 0};
+	m_entries.push_back(e);
+}
+
+uint32_t StatsRegistry::GetN(void) const{
+	return m_entries.size();
+}
+
+void StatsRegistry::Sample(FILE *fout){
+	bool header = false;
+	for (auto &e : m_entries){
+		uint64_t v = e.wide ? *(const uint64_t*)e.counter : *(const uint32_t*)e.counter;
+		if (v == e.last)
+			continue;
+		if (!header){
+			fprintf(fout, "time: %lu\n", Simulator::Now().GetTimeStep());
+			header = true;
+		}
+		fprintf(fout, "%s %lu\n", e.name.c_str(), v);
+		e.last = v;
+	}
+	if (header)
+		fflush(fout);
+}
+
+void StatsRegistry::StartSampling(FILE *fout, Time interval, Time end){
+	m_fout = fout;
+	m_interval = interval;
+	m_end = end;
+	m_event = Simulator::Schedule(interval, &StatsRegistry::PeriodicSample, this);
+}
+
+void StatsRegistry::PeriodicSample(void){
+	Sample(m_fout);
+	if (Simulator::Now() + m_interval <= m_end)
+		m_event = Simulator::Schedule(m_interval, &StatsRegistry::PeriodicSample, this);
+}
+
+void StatsRegistry::Save(CheckpointWriter &w) const{
+	w.Put((uint32_t)m_entries.size());
+	for (auto &e : m_entries)
+		w.Put(e.last);
+	w.PutEvent(m_event);
+}
+
+void StatsRegistry::Restore(CheckpointReader &r, FILE *fout, Time interval, Time end){
+	if (r.Get<uint32_t>() != m_entries.size())
+		r.Fail("the checkpoint has other counters");
+	for (auto &e : m_entries)
+		r.Get(e.last);
+	m_fout = fout;
+	m_interval = interval;
+	m_end = end;
+	m_event = r.GetEvent(MakeEvent(&StatsRegistry::PeriodicSample, this));
+}
+
+} // namespace ns3
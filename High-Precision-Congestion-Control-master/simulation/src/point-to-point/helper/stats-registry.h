@@ -0,0 +1,60 @@
+#ifndef STATS_REGISTRY_H
+#define STATS_REGISTRY_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+
+namespace ns3 {
+
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * \brief Named view of plain counters, sampled periodically into a time series.
+ *
+ * Components only increment their own integer members on the packet path;
+ * nothing is called per packet. The registry keeps a pointer to each counter
+ * and, at every sample, writes the counters that changed since the previous
+ * sample:
+ *
+ *   time: <ns>
+ *   <name> <value>
+ *   ...
+ *
+ * Counters must outlive the registry (or the sampling).
+ */
+class StatsRegistry{
+public:
+	void Register(std::string name, const uint64_t *counter);
+	void Register(std::string name, const uint32_t *counter);
+	uint32_t GetN(void) const;
+
+	void Sample(FILE *fout); // write the counters that changed since the last sample
+	void StartSampling(FILE *fout, Time interval, Time end); // sample every interval until end
+
+	// the last values and the next sample; a restored registry samples into fout
+	void Save(CheckpointWriter &w) const;
+	void Restore(CheckpointReader &r, FILE *fout, Time interval, Time end);
+
+private:
+	struct Entry{
+		std::string name;
+		const void *counter;
+		bool wide; // uint64_t counter, otherwise uint32_t
+		uint64_t last;
+	};
+	void PeriodicSample(void);
+
+	std::vector<Entry> m_entries;
+	FILE *m_fout;
+	Time m_interval, m_end;
+	EventId m_event; // the next periodic sample
+};
+
+} // namespace ns3
+
+#endif /* STATS_REGISTRY_H */
@@ -0,0 +1,261 @@
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "topology-partitioner.h"
+
+namespace ns3 {
+
+TopologyPartitioner::TopologyPartitioner() : m_lookahead(0), m_mtu(1000){
+}
+
+void TopologyPartitioner::SetMtu(uint32_t mtu){
+	m_mtu = mtu;
+}
+
+void TopologyPartitioner::AddNode(uint32_t id, uint32_t type){
+	if (m_type.size() < id + 1){
+		m_type.resize(id + 1, 0);
+		m_adj.resize(id + 1);
+	}
+	m_type[id] = type;
+}
+
+void TopologyPartitioner::AddLink(uint32_t a, uint32_t b, uint64_t delay, uint64_t bps){
+	if (m_type.size() < std::max(a, b) + 1){
+		m_type.resize(std::max(a, b) + 1, 0);
+		m_adj.resize(std::max(a, b) + 1);
+	}
+	Link l = {a, b, delay, bps};
+	m_adj[a].push_back(m_links.size());
+	m_adj[b].push_back(m_links.size());
+	m_links.push_back(l);
+}
+
+void TopologyPartitioner::AddFlow(uint32_t src, uint32_t dst, uint64_t bytes){
+	Flow f = {src, dst, bytes};
+	m_flows.push_back(f);
+}
+
+bool TopologyPartitioner::ReadTopology(std::string file){
+	std::ifstream topof(file.c_str());
+	if (!topof.is_open())
+		return false;
+	uint32_t node_num, switch_num, en_num, link_num;
+	topof >> node_num >> switch_num >> en_num >> link_num;
+	for (uint32_t i = 0; i < node_num; i++)
+		AddNode(i, 0);
+	for (uint32_t i = 0; i < switch_num; i++){
+		uint32_t sid;
+		topof >> sid;
+		AddNode(sid, 1);
+	}
+	for (uint32_t i = 0; i < en_num; i++){
+		uint32_t eid;
+		topof >> eid;
+		AddNode(eid, 2);
+	}
+	for (uint32_t i = 0; i < link_num; i++){
+		uint32_t src, dst;
+		std::string data_rate, link_delay;
+		double error_rate;
+		topof >> src >> dst >> data_rate >> link_delay >> error_rate;
+		AddLink(src, dst, Time(link_delay).GetNanoSeconds(), DataRate(data_rate).GetBitRate());
+	}
+	return true;
+}
+
+bool TopologyPartitioner::ReadFlows(std::string file){
+	std::ifstream flowf(file.c_str());
+	if (!flowf.is_open())
+		return false;
+	uint32_t flow_num;
+	flowf >> flow_num;
+	for (uint32_t i = 0; i < flow_num; i++){
+		uint32_t src, dst, pg, dport;
+		uint64_t size;
+		double start_time;
+		flowf >> src >> dst >> pg >> dport >> size >> start_time;
+		AddFlow(src, dst, size);
+	}
+	return true;
+}
+
+void TopologyPartitioner::EstimateLoad(void){
+	uint32_t node_num = m_type.size();
+	m_load.assign(node_num, 1); // every node costs something even without traffic
+
+	// group flows by destination, so one BFS per destination gives the paths of all its flows
+	std::vector<std::vector<uint32_t> > by_dst(node_num);
+	for (uint32_t i = 0; i < m_flows.size(); i++)
+		if (m_flows[i].dst < node_num && m_flows[i].src < node_num)
+			by_dst[m_flows[i].dst].push_back(i);
+
+	std::vector<int> parent(node_num);
+	std::vector<uint32_t> q;
+	for (uint32_t dst = 0; dst < node_num; dst++){
+		if (by_dst[dst].empty())
+			continue;
+		// BFS from the destination; like CalculateRoute, hosts are never used as middle points
+		std::fill(parent.begin(), parent.end(), -2);
+		q.clear();
+		q.push_back(dst);
+		parent[dst] = -1;
+		for (uint32_t i = 0; i < q.size(); i++){
+			uint32_t now = q[i];
+			if (now != dst && m_type[now] == 0)
+				continue;
+			for (uint32_t l : m_adj[now]){
+				uint32_t next = m_links[l].a == now ? m_links[l].b : m_links[l].a;
+				if (parent[next] == -2){
+					parent[next] = now;
+					q.push_back(next);
+				}
+			}
+		}
+		for (uint32_t f : by_dst[dst]){
+			double pkts = m_flows[f].bytes / m_mtu + 1;
+			for (int now = m_flows[f].src; now >= 0 && parent[now] != -2; now = parent[now])
+				m_load[now] += pkts * 2; // data and ACK
+		}
+	}
+}
+
+double TopologyPartitioner::Assign(uint64_t threshold, uint32_t nparts, std::vector<uint32_t> &part){
+	uint32_t node_num = m_type.size();
+
+	// contract the links that must not be cut
+	std::vector<uint32_t> root(node_num);
+	for (uint32_t i = 0; i < node_num; i++)
+		root[i] = i;
+	std::function<uint32_t(uint32_t)> find = [&](uint32_t x){
+		while (root[x] != x)
+			x = root[x] = root[root[x]];
+		return x;
+	};
+	for (auto &l : m_links)
+		if (l.delay < threshold)
+			root[find(l.a)] = find(l.b);
+
+	std::vector<double> comp_load(node_num, 0);
+	std::vector<std::vector<uint32_t> > members(node_num);
+	double total = 0;
+	for (uint32_t i = 0; i < node_num; i++){
+		comp_load[find(i)] += m_load[i];
+		members[find(i)].push_back(i);
+		total += m_load[i];
+	}
+
+	// visit the components in BFS order, so consecutive components are neighbors and
+	// cutting the order into nparts chunks keeps each chunk mostly connected
+	std::vector<int> comp_part(node_num, -1);
+	std::vector<bool> visited(node_num, false);
+	std::vector<double> part_load(nparts, 0);
+	std::vector<uint32_t> q;
+	uint32_t p = 0;
+	double remain = total;
+	for (uint32_t s = 0; s < node_num; s++){
+		if (visited[find(s)])
+			continue;
+		q.clear();
+		q.push_back(find(s));
+		visited[find(s)] = true;
+		for (uint32_t i = 0; i < q.size(); i++){
+			uint32_t c = q[i];
+			double target = remain / (nparts - p);
+			if (part_load[p] > 0 && part_load[p] + comp_load[c] / 2 > target && p + 1 < nparts){
+				remain -= part_load[p];
+				p++;
+			}
+			comp_part[c] = p;
+			part_load[p] += comp_load[c];
+			for (uint32_t u : members[c])
+				for (uint32_t l : m_adj[u]){
+					uint32_t v = find(m_links[l].a == u ? m_links[l].b : m_links[l].a);
+					if (!visited[v]){
+						visited[v] = true;
+						q.push_back(v);
+					}
+				}
+		}
+	}
+
+	part.resize(node_num);
+	for (uint32_t i = 0; i < node_num; i++)
+		part[i] = comp_part[find(i)];
+	return *std::max_element(part_load.begin(), part_load.end());
+}
+
+std::vector<uint32_t> TopologyPartitioner::Partition(uint32_t nparts, double imbalance){
+	std::vector<uint32_t> part(m_type.size(), 0);
+	m_lookahead = 0xfffffffffffffffflu;
+	if (nparts <= 1)
+		return part;
+
+	EstimateLoad();
+	double total = 0;
+	for (double l : m_load)
+		total += l;
+	double cap = (1 + imbalance) * total / nparts;
+
+	// try the delay thresholds from the largest; the smallest one allows cutting any link
+	std::vector<uint64_t> thresholds;
+	for (auto &l : m_links)
+		thresholds.push_back(l.delay);
+	std::sort(thresholds.begin(), thresholds.end());
+	thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+	double best = -1;
+	for (int i = (int)thresholds.size() - 1; i >= 0; i--){
+		std::vector<uint32_t> cur;
+		double max_load = Assign(thresholds[i], nparts, cur);
+		if (best < 0 || max_load < best){
+			best = max_load;
+			part = cur;
+		}
+		if (max_load <= cap)
+			break;
+	}
+
+	for (auto &l : m_links)
+		if (part[l.a] != part[l.b] && l.delay < m_lookahead)
+			m_lookahead = l.delay;
+	return part;
+}
+
+uint64_t TopologyPartitioner::GetLookahead(void) const{
+	return m_lookahead;
+}
+
+double TopologyPartitioner::GetLoad(uint32_t id) const{
+	return id < m_load.size() ? m_load[id] : 0;
+}
+
+bool TopologyPartitioner::ReadMap(std::string file, std::vector<uint32_t> &map){
+	std::ifstream fin(file.c_str());
+	if (!fin.is_open())
+		return false;
+	uint32_t node_num;
+	if (!(fin >> node_num))
+		return false;
+	map.assign(node_num, 0);
+	for (uint32_t i = 0; i < node_num; i++){
+		uint32_t id, p;
+		if (!(fin >> id >> p) || id >= node_num)
+			return false;
+		map[id] = p;
+	}
+	return true;
+}
+
+bool TopologyPartitioner::WriteMap(std::string file, const std::vector<uint32_t> &map){
+	std::ofstream fout(file.c_str());
+	if (!fout.is_open())
+		return false;
+	fout << map.size() << '\n';
+	for (uint32_t i = 0; i < map.size(); i++)
+		fout << i << ' ' << map[i] << '\n';
+	return true;
+}
+
+} // namespace ns3
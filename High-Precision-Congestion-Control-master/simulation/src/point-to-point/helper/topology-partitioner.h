@@ -0,0 +1,66 @@
+#ifndef TOPOLOGY_PARTITIONER_H
+#define TOPOLOGY_PARTITIONER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Split the topology into partitions (one per MPI rank) for distributed runs.
+ *
+ * A rank can only run ahead of its peers by the smallest delay of the links
+ * that cross ranks (the lookahead), so the partitioner looks for the largest
+ * delay threshold such that only cutting links at or above it still gives
+ * partitions whose estimated event load is within the imbalance bound.
+ *
+ * The event load of a node is estimated from the flows that cross it: each
+ * flow adds its packet count (data + ACK) to every node on its shortest path.
+ */
+class TopologyPartitioner{
+public:
+	TopologyPartitioner();
+
+	void SetMtu(uint32_t mtu);
+	void AddNode(uint32_t id, uint32_t type); // type: 0 host, 1 switch, 2 border router (as Node::GetNodeType)
+	void AddLink(uint32_t a, uint32_t b, uint64_t delay, uint64_t bps); // delay in ns
+	void AddFlow(uint32_t src, uint32_t dst, uint64_t bytes);
+	bool ReadTopology(std::string file); // same format as TOPOLOGY_FILE
+	bool ReadFlows(std::string file); // same format as FLOW_FILE
+
+	// node -> partition, with max partition load <= (1 + imbalance) * average load
+	std::vector<uint32_t> Partition(uint32_t nparts, double imbalance);
+	uint64_t GetLookahead(void) const; // min delay (ns) of the links cut by the last Partition()
+	double GetLoad(uint32_t id) const;
+
+	// map file: "<node_num>\n" followed by "<node> <partition>\n" per node
+	static bool ReadMap(std::string file, std::vector<uint32_t> &map);
+	static bool WriteMap(std::string file, const std::vector<uint32_t> &map);
+
+private:
+	struct Link{
+		uint32_t a, b;
+		uint64_t delay, bps;
+	};
+	struct Flow{
+		uint32_t src, dst;
+		uint64_t bytes;
+	};
+
+	void EstimateLoad(void);
+	// assign the nodes to partitions, never cutting a link with delay < threshold; returns max partition load
+	double Assign(uint64_t threshold, uint32_t nparts, std::vector<uint32_t> &part);
+
+	std::vector<uint32_t> m_type;
+	std::vector<Link> m_links;
+	std::vector<Flow> m_flows;
+	std::vector<std::vector<uint32_t> > m_adj; // m_adj[i] is the ids of the links of node i
+	std::vector<double> m_load;
+	uint64_t m_lookahead;
+	uint32_t m_mtu;
+};
+
+} // namespace ns3
+
+#endif /* TOPOLOGY_PARTITIONER_H */
@@ -0,0 +1,225 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include "ns3/callback.h"
+#include "ns3/mem-profiler.h"
+#include "trace-writer.h"
+
+namespace ns3 {
+
+static const uint32_t kAlign = 4096; // O_DIRECT needs page aligned buffers, sizes and offsets
+
+NS_MEM_CATEGORY(g_memTraceWriter, "ns3::TraceWriter"); // with its buffers
+
+TraceWriter::TraceWriter()
+	: m_fd(-1), m_direct(false), m_bufSize(0), m_carryLen(0), m_cur(NULL), m_pos(0), m_cap(0), m_head(0),
+	  m_published(0), m_tail(0), m_stop(false),
+	  m_bytes(0), m_dropped(0), m_droppedBytes(0), m_stalls(0), m_maxQueued(0){
+	NS_MEM_ALLOC(g_memTraceWriter, sizeof(TraceWriter));
+}
+
+TraceWriter::~TraceWriter(){
+	Close();
+	for (uint32_t i = 0; i < m_buf.size(); i++)
+		free(m_buf[i]);
+	NS_MEM_FREE(g_memTraceWriter, sizeof(TraceWriter) + (uint64_t)m_buf.size() * m_bufSize);
+}
+
+bool TraceWriter::Open(std::string file, uint32_t bufSize, uint32_t nBuf, bool direct){
+	Close();
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	m_direct = false;
+#ifdef O_DIRECT
+	if (direct){
+		m_fd = open(file.c_str(), flags | O_DIRECT, 0644);
+		if (m_fd >= 0)
+			m_direct = true;
+		else
+			printf("Warning: %s does not support O_DIRECT, using buffered writes\n", file.c_str());
+	}
+#endif
+	if (m_fd < 0)
+		m_fd = open(file.c_str(), flags, 0644);
+	if (m_fd < 0)
+		return false;
+
+	for (uint32_t i = 0; i < m_buf.size(); i++) // of a previous Open
+		free(m_buf[i]);
+	NS_MEM_FREE(g_memTraceWriter, (uint64_t)m_buf.size() * m_bufSize, 0);
+	m_bufSize = (std::max(bufSize, kAlign) + kAlign - 1) / kAlign * kAlign;
+	m_buf.resize(std::max(nBuf, 2u));
+	m_len.resize(m_buf.size());
+	for (uint32_t i = 0; i < m_buf.size(); i++){
+		void *b;
+		if (posix_memalign(&b, kAlign, m_bufSize) != 0){
+			for (uint32_t j = 0; j < i; j++)
+				free(m_buf[j]);
+			m_buf.clear();
+			close(m_fd);
+			m_fd = -1;
+			return false;
+		}
+		m_buf[i] = (uint8_t*)b;
+	}
+	NS_MEM_ALLOC(g_memTraceWriter, (uint64_t)m_buf.size() * m_bufSize, 0);
+	m_carry.resize(kAlign);
+	m_carryLen = 0;
+	m_head = 0;
+	m_published.store(0);
+	m_tail.store(0);
+	m_stop.store(false);
+	Acquire();
+#ifdef HAVE_PTHREAD_H
+	m_thread = Create<SystemThread>(MakeCallback(&TraceWriter::Run, this));
+	m_thread->Start();
+#endif
+	return true;
+}
+
+void TraceWriter::Close(void){
+	if (m_fd < 0)
+		return;
+	if (m_cap > 0 && m_pos > 0)
+		Submit();
+	m_cap = 0;
+#ifdef HAVE_PTHREAD_H
+	m_stop.store(true);
+	m_cond.SetCondition(true);
+	m_cond.Signal();
+	m_thread->Join();
+	m_thread = 0;
+#endif
+	if (m_carryLen > 0){ // the end of the file is not a whole page
+#ifdef O_DIRECT
+		fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+#endif
+		WriteOut(m_carry.data(), m_carryLen);
+		m_bytes += m_carryLen;
+		m_carryLen = 0;
+	}
+	m_direct = false;
+	close(m_fd);
+	m_fd = -1;
+}
+
+void TraceWriter::WriteSlow(const void *data, uint32_t size){
+	// bytes the next buffer starts with
+	uint32_t carry = m_direct && m_cap > 0 ? m_pos % kAlign : m_carryLen;
+	if (carry + size <= m_bufSize){
+		if (m_cap > 0){ // the current buffer is full
+			Submit();
+			if (!Acquire())
+				m_stalls++;
+		}else
+			Acquire();
+		if (m_cap > 0){
+			memcpy(m_cur + m_pos, data, size);
+			m_pos += size;
+			return;
+		}
+	}
+	m_dropped++;
+	m_droppedBytes += size;
+}
+
+void TraceWriter::Submit(void){
+	uint32_t len = m_pos;
+	if (m_direct){ // O_DIRECT writes whole pages: the rest goes to the next buffer
+		len = m_pos / kAlign * kAlign;
+		m_carryLen = m_pos - len;
+		memcpy(m_carry.data(), m_cur + len, m_carryLen);
+	}
+	m_len[m_head % m_buf.size()] = len;
+	m_bytes += len;
+	m_head++;
+	m_cap = 0;
+#ifdef HAVE_PTHREAD_H
+	m_published.store(m_head, std::memory_order_release);
+	uint32_t queued = m_head - m_tail.load(std::memory_order_acquire);
+	if (queued > m_maxQueued)
+		m_maxQueued = queued;
+	m_cond.SetCondition(true);
+	m_cond.Signal();
+#else
+	// no threads: write in place
+	WriteOut(m_cur, len);
+	m_published.store(m_head);
+	m_tail.store(m_head);
+	m_maxQueued = 1;
+#endif
+}
+
+bool TraceWriter::Acquire(void){
+	if (m_head - m_tail.load(std::memory_order_acquire) >= m_buf.size()){
+		m_cap = 0;
+		return false;
+	}
+	m_cur = m_buf[m_head % m_buf.size()];
+	memcpy(m_cur, m_carry.data(), m_carryLen);
+	m_pos = m_carryLen;
+	m_carryLen = 0;
+	m_cap = m_bufSize;
+	return true;
+}
+
+void TraceWriter::WriteOut(uint8_t *buf, uint32_t len){
+	// with direct I/O, len is a whole number of pages but for the end of the file (see Close)
+	for (uint32_t done = 0; done < len; ){
+		ssize_t n = write(m_fd, buf + done, len - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0){
+			perror("TraceWriter: write");
+			return;
+		}
+		done += n;
+	}
+}
+
+void TraceWriter::Run(void){
+#ifdef HAVE_PTHREAD_H
+	while (true){
+		uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		m_cond.SetCondition(false);
+		if (tail == m_published.load(std::memory_order_acquire)){
+			if (m_stop.load())
+				break;
+			m_cond.TimedWait(10000000); // a missed signal only costs this much
+			continue;
+		}
+		uint32_t i = tail % m_buf.size();
+		WriteOut(m_buf[i], m_len[i]);
+		m_tail.store(tail + 1, std::memory_order_release);
+	}
+#endif
+}
+
+uint64_t TraceWriter::GetWrittenBytes(void) const{
+	return m_bytes;
+}
+
+uint64_t TraceWriter::GetDropped(void) const{
+	return m_dropped;
+}
+
+uint64_t TraceWriter::GetDroppedBytes(void) const{
+	return m_droppedBytes;
+}
+
+uint64_t TraceWriter::GetStalls(void) const{
+	return m_stalls;
+}
+
+uint32_t TraceWriter::GetMaxQueued(void) const{
+	return m_maxQueued;
+}
+
+void TraceWriter::PrintStats(FILE *fout) const{
+	fprintf(fout, "trace: %lu bytes, %lu records (%lu bytes) dropped, %lu stalls, max %u/%lu buffers queued\n",
+			m_bytes, m_dropped, m_droppedBytes, m_stalls, m_maxQueued, m_buf.size());
+}
+
+} // namespace ns3
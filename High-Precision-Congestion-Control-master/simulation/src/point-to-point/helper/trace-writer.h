@@ -0,0 +1,93 @@
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "ns3/core-config.h"
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#include "ns3/system-condition.h"
+#endif
+
+namespace ns3 {
+
+/**
+ * \brief Append-only binary output written by a background thread.
+ *
+ * Records are copied into the current buffer; full buffers are handed to the
+ * writer thread through a ring of nBuf buffers, indexed by two atomic
+ * counters, so the producer never takes a lock per record and never waits
+ * for the disk. When all buffers are waiting to be written (the disk is
+ * slower than the simulation) the records are dropped and counted instead.
+ *
+ * There is a single producer: the simulator thread of this process (each MPI
+ * rank opens its own file).
+ *
+ * With direct I/O the file is opened with O_DIRECT and written in whole
+ * pages: a buffer is submitted up to its last page boundary and the rest of
+ * it starts the next buffer, so only the end of the file, at Close, is
+ * written through the page cache.
+ */
+class TraceWriter : public SimpleRefCount<TraceWriter>{
+public:
+	TraceWriter();
+	~TraceWriter();
+
+	bool Open(std::string file, uint32_t bufSize = 4 << 20, uint32_t nBuf = 8, bool direct = false); // closes the current file first, if any
+	void Close(void); // write what is buffered, stop the thread and close the file
+
+	inline void Write(const void *data, uint32_t size){
+		if (m_pos + size <= m_cap){
+			memcpy(m_cur + m_pos, data, size);
+			m_pos += size;
+		}else
+			WriteSlow(data, size);
+	}
+
+	uint64_t GetWrittenBytes(void) const; // bytes handed to the writer
+	uint64_t GetDropped(void) const; // records dropped because no buffer was free
+	uint64_t GetDroppedBytes(void) const;
+	uint64_t GetStalls(void) const; // times the producer found all buffers full
+	uint32_t GetMaxQueued(void) const; // most buffers waiting for the disk at once
+	void PrintStats(FILE *fout) const;
+
+private:
+	void WriteSlow(const void *data, uint32_t size);
+	void Submit(void); // hand the current buffer to the writer thread
+	bool Acquire(void); // take the next free buffer, false if there is none
+	void WriteOut(uint8_t *buf, uint32_t len);
+	void Run(void); // writer thread
+
+	int m_fd;
+	bool m_direct;
+	uint32_t m_bufSize;
+	std::vector<uint8_t*> m_buf;
+	std::vector<uint32_t> m_len; // bytes in each submitted buffer
+	std::vector<uint8_t> m_carry; // with direct I/O, the unaligned end of the last submitted buffer
+	uint32_t m_carryLen;
+
+	// producer side
+	uint8_t *m_cur;
+	uint32_t m_pos, m_cap; // m_cap is 0 while no buffer is free
+	uint64_t m_head; // buffers submitted; only the producer writes it
+	std::atomic<uint64_t> m_published; // m_head as seen by the writer thread
+	std::atomic<uint64_t> m_tail; // buffers written to disk; only the writer thread writes it
+	std::atomic<bool> m_stop;
+
+	uint64_t m_bytes, m_dropped, m_droppedBytes, m_stalls;
+	uint32_t m_maxQueued;
+
+#ifdef HAVE_PTHREAD_H
+	Ptr<SystemThread> m_thread;
+	SystemCondition m_cond;
+#endif
+};
+
+} // namespace ns3
+
+#endif /* TRACE_WRITER_H */
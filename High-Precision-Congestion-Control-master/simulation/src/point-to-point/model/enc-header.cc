@@ -4,6 +4,7 @@
 #include "ns3/buffer.h"
 #include "ns3/address-utils.h"
 #include "ns3/log.h"
+#include "ns3/assert.h"
 
 NS_LOG_COMPONENT_DEFINE("encHeader");
 
@@ -48,6 +49,11 @@ namespace ns3 {
 		encHeader::SetFlags(flag);
 	}
 
+	void encHeader::SetRxQpId(uint16_t id) {
+		NS_ASSERT(id <= MAX_RX_QP_ID);
+		flags = (flags & FLAG_MASK) | (id << RX_QP_ID_SHIFT);
+	}
+
 	uint16_t encHeader::GetSport() const{
 		return sport;
 	}
@@ -58,6 +64,12 @@ namespace ns3 {
 	uint16_t encHeader::GetFlags() const{
         return flags;
     }
+	uint16_t encHeader::GetRxQpId() const{
+		return GetRxQpId(flags);
+	}
+	uint16_t encHeader::GetRxQpId(uint16_t flags){
+		return flags >> RX_QP_ID_SHIFT;
+	}
 	uint16_t encHeader::GetPG() const
 	{
 		return m_pg;
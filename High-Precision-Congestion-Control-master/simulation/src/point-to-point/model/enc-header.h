@@ -27,6 +27,16 @@ public:
   enum {
 	  FLAG_CNP = 0
   };
+  /**
+   * The flags field: bit 0 is set on the ACKs built by an EnquserverNode for
+   * another host, bit 1 is FIN, and bits 2..15 carry the qp id of the
+   * receiver (see SetRxQpId).
+   */
+  enum {
+	  FLAG_MASK = 0x3,
+	  RX_QP_ID_SHIFT = 2,
+	  MAX_RX_QP_ID = 0x3fff
+  };
   encHeader (uint16_t pg);
   encHeader ();
   virtual ~encHeader ();
@@ -42,6 +52,13 @@ public:
   void SetDport(uint32_t _dport);
   void SetMyIntHeader(const MyIntHeader &_ih);
   void SetFin(bool fin);
+  /**
+   * \param id the dense id of the receiver's qp plus one, 0 if it has none;
+   * echoed in the sender's data packets so the receiver can find the qp
+   * without a hash lookup. The PG field of an ACK likewise echoes the id of
+   * the sender's qp.
+   */
+  void SetRxQpId(uint16_t id);
 
 //Getters
   /**
@@ -52,6 +69,8 @@ public:
   uint16_t GetFlags() const;
   uint16_t GetSport() const;
   uint16_t GetDport() const;
+  uint16_t GetRxQpId() const;
+  static uint16_t GetRxQpId(uint16_t flags); // the id in a flags field read by MyCustomHeader
 
   static TypeId GetTypeId (void);
   virtual TypeId GetInstanceTypeId (void) const;
@@ -17,10 +17,14 @@
 #include "qbb-net-device.h"
 #include "ppp-header.h"
 #include "ns3/int-header-niux.h"
+#include "ns3/thread-rand.h"
+#include "ns3/checkpoint.h"
 #include <cmath>
 
 namespace ns3 {
 
+NS_OBJECT_ENSURE_REGISTERED(EnquserverNode);
+
 TypeId EnquserverNode::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::EnquserverNode")
@@ -51,6 +55,14 @@ TypeId EnquserverNode::GetTypeId (void)
 }
 
 EnquserverNode::EnquserverNode(){
+    Construct();
+}
+
+EnquserverNode::EnquserverNode(uint32_t systemId) : Node(systemId){
+    Construct();
+}
+
+void EnquserverNode::Construct(void){
     m_ecmpSeed = m_id;
     m_node_type = 2;
     // std::cout << "Current node type: " << m_node_type << std::endl;
@@ -138,7 +150,7 @@ void EnquserverNode::GetShareTable(Ptr<const Packet>p, MyCustomHeader &ch){
         else if (ch.ack.ih.hinfo.nodeNum ==1) {
             bool found = false;
             for (m_sharedTableEntry& p : m_sharedTable) {
-                if (p.rid == ch.ack.ih.iinfo[0].id && p.port == ch.ack.ih.iinfo[0].port) {
+                if (p.rid == ch.ack.ih.GetRouteId(0) && p.port == ch.ack.ih.GetRoutePort(0)) {
                     found = true;
                     bool flowFound = false;
                     for (flowInfo& info : p.flowInfos)
@@ -161,7 +173,7 @@ void EnquserverNode::GetShareTable(Ptr<const Packet>p, MyCustomHeader &ch){
             if (!found) {
                 std::vector<flowInfo> info;
                 info.push_back({ch.dip,ch.sip,ch.tcp.dport,ch.tcp.sport}); //将四元组信息添加到Info中
-                m_sharedTable.push_back({ch.ack.ih.iinfo[0].id, ch.ack.ih.iinfo[0].port,info});
+                m_sharedTable.push_back({ch.ack.ih.GetRouteId(0), ch.ack.ih.GetRoutePort(0),info});
             }
         }
     }
@@ -186,6 +198,11 @@ void EnquserverNode::MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device,
     //     std::cout << std::endl; // 在每个 m_sharedTableEntry 之后添加一个空行以增加可读性
     // }
     if (ch.ack.ih.hinfo.depthNum !=0 || ch.ack.ih.hinfo.ratioNum!=0 ){
+        MyIntHeader::Entry dinfo[MyIntHeader::maxNum], rinfo[MyIntHeader::maxNum];
+        for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i)
+            dinfo[i] = ch.ack.ih.GetDepth(i);
+        for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i)
+            rinfo[i] = ch.ack.ih.GetRatio(i);
         // std::cout<<"depthNum size:"<<ch.ack.ih.hinfo.depthNum<<std::endl;
         // std::cout<<"ratioNum size:"<<ch.ack.ih.hinfo.ratioNum<<std::endl;
         std::vector<m_sharedTableEntry> matchedEntries;//根据从数据包获取的路由器二元组信息，和共享链路表比配，获取数据包中路由节点二元组对应的所有主机地址四元组
@@ -195,7 +212,7 @@ void EnquserverNode::MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device,
                 // std::cout<<"sharedTable routerID:"<<sharedEntry.rid<<std::endl;
                 // std::cout<<"depth routerPORT:"<<ch.ack.ih.dinfo[i].iinfo.port<<std::endl;
                 // std::cout<<"sharedTable routerPORT:"<<sharedEntry.port<<std::endl;
-                if (ch.ack.ih.dinfo[i].iinfo.id == sharedEntry.rid && ch.ack.ih.dinfo[i].iinfo.port == sharedEntry.port) {
+                if (dinfo[i].id == sharedEntry.rid && dinfo[i].port == sharedEntry.port) {
                     matchedEntries.push_back(sharedEntry);
 
                 }
@@ -203,7 +220,7 @@ void EnquserverNode::MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device,
         }
         for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) {
             for (const auto& sharedEntry : m_sharedTable) {
-                if (ch.ack.ih.rinfo[i].iinfo.id == sharedEntry.rid && ch.ack.ih.rinfo[i].iinfo.port == sharedEntry.port) {
+                if (rinfo[i].id == sharedEntry.rid && rinfo[i].port == sharedEntry.port) {
                     matchedEntries.push_back(sharedEntry);
                 }
             }
@@ -256,11 +273,12 @@ void EnquserverNode::MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device,
                     encH.SetDport(info.fInfo.sport);
                     
                     MyIntHeader ih;
+                    ih.CopyFormat(ch.ack.ih);
                     for (const auto& pair : info.rIdAndPort) {
                         bool isFind = 0;
                         for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i){
-                            if (pair.first == ch.ack.ih.dinfo[i].iinfo.id && pair.second == ch.ack.ih.dinfo[i].iinfo.port) {
-                                ih.PushDepth(ch.ack.ih.dinfo[i].iinfo.id,ch.ack.ih.dinfo[i].iinfo.port,ch.ack.ih.dinfo[i].depth,ch.ack.ih.dinfo[i].ts,ch.ack.ih.dinfo[i].maxRate);
+                            if (pair.first == dinfo[i].id && pair.second == dinfo[i].port) {
+                                ih.PushDepth(dinfo[i].id,dinfo[i].port,dinfo[i].value,dinfo[i].ts,dinfo[i].maxRate);
                                 isFind = 1;
                                 break;
                             }
@@ -269,8 +287,8 @@ void EnquserverNode::MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device,
                             break;
                         }
                         for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i){
-                            if (pair.first == ch.ack.ih.rinfo[i].iinfo.id && pair.second == ch.ack.ih.rinfo[i].iinfo.port) {
-                                ih.PushDepth(ch.ack.ih.rinfo[i].iinfo.id,ch.ack.ih.rinfo[i].iinfo.port,ch.ack.ih.rinfo[i].ratio,ch.ack.ih.rinfo[i].ts,ch.ack.ih.rinfo[i].maxRate);
+                            if (pair.first == rinfo[i].id && pair.second == rinfo[i].port) {
+                                ih.PushDepth(rinfo[i].id,rinfo[i].port,rinfo[i].value,rinfo[i].ts,rinfo[i].maxRate);
                                 break;
                             }
                         }
@@ -511,11 +529,37 @@ int EnquserverNode::log2apprx(int x, int b, int m, int l){
         x += + (1 << (msb - m - 1));
         #else
         int mask = (1 << (msb-m)) - 1;
-        if ((x0 & mask) > (rand() & mask))
+        if ((x0 & mask) > (ThreadRand::Next() & mask))
             x += 1<<(msb-m);
         #endif
     }
     return int(log2(x) * (1<<logres_shift(b, l)));
 }
 
+void EnquserverNode::Save(CheckpointWriter &w) const{
+    w.Put((uint32_t)m_sharedTable.size());
+    for (uint32_t i = 0; i < m_sharedTable.size(); i++){
+        const m_sharedTableEntry &e = m_sharedTable[i];
+        w.Put(e.rid);
+        w.Put(e.port);
+        w.Put((uint32_t)e.flowInfos.size());
+        for (uint32_t j = 0; j < e.flowInfos.size(); j++)
+            w.Put(e.flowInfos[j]);
+    }
+    m_mmu->Save(w);
+}
+
+void EnquserverNode::Restore(CheckpointReader &r){
+    m_sharedTable.resize(r.Get<uint32_t>());
+    for (uint32_t i = 0; i < m_sharedTable.size() && !r.Failed(); i++){
+        m_sharedTableEntry &e = m_sharedTable[i];
+        r.Get(e.rid);
+        r.Get(e.port);
+        e.flowInfos.resize(r.Get<uint32_t>());
+        for (uint32_t j = 0; j < e.flowInfos.size() && !r.Failed(); j++)
+            r.Get(e.flowInfos[j]);
+    }
+    m_mmu->Restore(r);
+}
+
 } /* namespace ns3 */
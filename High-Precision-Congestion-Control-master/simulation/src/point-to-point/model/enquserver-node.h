@@ -22,6 +22,8 @@
 namespace ns3 {
 
 class Packet;
+class CheckpointWriter;
+class CheckpointReader;
 
 class EnquserverNode : public Node{
     static const uint32_t pCnt = 257;    // Number of ports used
@@ -105,6 +107,7 @@ private:
     static uint32_t EcmpHash(const uint8_t* key, size_t len, uint32_t seed);
     void CheckAndSendPfc(uint32_t inDev, uint32_t qIndex);
     void CheckAndSendResume(uint32_t inDev, uint32_t qIndex);
+    void Construct(void);
     void GetShareTable(Ptr<const Packet>p, MyCustomHeader &ch);//获取共享链路表的函数，参数为数据包包头的广域网节点ID，目的地址端口号
 //    void MatchSharedTableSendToRelatedSender(Ptr<Packet>p, MyCustomHeader &ch);
     //对携带链路信息的数据包中的信息和共享链路表进行查找匹配，返回HeaderLinkInfo结构体类型中的数据
@@ -114,11 +117,15 @@ public:
 
     static TypeId GetTypeId (void);
     EnquserverNode();
+    EnquserverNode(uint32_t systemId); // systemId: the MPI rank that owns this node
     void SetEcmpSeed(uint32_t seed);
     void AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx);
     void ClearTable();
 //    bool SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, MyCustomHeader &ch);
     void MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device, Ptr<Packet>p, MyCustomHeader &ch);
+    // save the shared link table and the MMU into a checkpoint
+    void Save(CheckpointWriter &w) const;
+    void Restore(CheckpointReader &r);
 
     // for approximate calc in PINT
     int logres_shift(int b, int l);
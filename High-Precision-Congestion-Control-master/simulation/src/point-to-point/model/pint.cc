@@ -3,11 +3,12 @@
 #include <cstdio>
 
 #include "pint.h"
+#include "ns3/thread-rand.h"
 
 namespace ns3{
 
-double Pint::log_base = 1.05;
-double Pint::log_factor = 1 / log(log_base);
+thread_local double Pint::log_base = 1.05;
+thread_local double Pint::log_factor = 1 / log(log_base);
 
 void Pint::set_log_base(double base){
 	log_base = base;
@@ -33,7 +34,7 @@ uint16_t Pint::encode_u(double u){
 	double upper = pow(log_base, p_upper), lower = pow(log_base, p_lower);
 	if (p_upper == p_lower)
 		upper *= log_base;
-	uint16_t p = (rand() % 65536 < (u_toInt - lower) / (upper - lower) * 65536) ? p_upper : p_lower;
+	uint16_t p = (ThreadRand::Next() % 65536 < (u_toInt - lower) / (upper - lower) * 65536) ? p_upper : p_lower;
 	return p;
 }
 
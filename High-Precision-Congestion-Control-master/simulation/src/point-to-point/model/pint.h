@@ -7,7 +7,7 @@ namespace ns3{
 class Pint{
 public:
 	static const uint32_t max_concurrent = 512; // max number of concurrent flows
-	static double log_base, log_factor; // used for PINT
+	static thread_local double log_base, log_factor; // used for PINT, per simulation thread
 	static void set_log_base(double base);
 	static int get_n_bits();
 	static int get_n_bytes();
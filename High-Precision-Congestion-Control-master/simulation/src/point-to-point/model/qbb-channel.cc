@@ -22,6 +22,7 @@
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
+#include "ns3/checkpoint.h"
 #include <iostream>
 #include <fstream>
 
@@ -98,16 +99,78 @@ QbbChannel::TransmitStart (
   NS_ASSERT (m_link[1].m_state != INITIALIZING);
 
   uint32_t wire = src == m_link[0].m_src ? 0 : 1;
+  Link &link = m_link[wire];
 
-  Simulator::ScheduleWithContext (m_link[wire].m_dst->GetNode ()->GetId (),
-                                  txTime + m_delay, &QbbNetDevice::Receive,
-                                  m_link[wire].m_dst, p);
+  EventId rx = Simulator::ReserveWithContext (link.m_dst->GetNode ()->GetId (),
+                                             txTime + m_delay);
+  NS_ASSERT (link.m_inFlight.empty () || link.m_inFlight.back ().first.GetTs () < rx.GetTs ());
+  link.m_inFlight.push_back (std::make_pair (rx, p));
+  if (link.m_inFlight.size () == 1)
+    {
+      Simulator::ScheduleReserved (rx, MakeEvent (&QbbChannel::Deliver, this, wire));
+    }
 
   // Call the tx anim callback on the net device
   m_txrxQbb (p, src, m_link[wire].m_dst, txTime, txTime + m_delay);
   return true;
 }
 
+void
+QbbChannel::Deliver (uint32_t wire)
+{
+  Link &link = m_link[wire];
+  NS_ASSERT (!link.m_inFlight.empty () && link.m_inFlight.front ().first.GetTs () == (uint64_t)Simulator::Now ().GetTimeStep ());
+  Ptr<Packet> p = link.m_inFlight.front ().second;
+  link.m_inFlight.pop_front ();
+  if (!link.m_inFlight.empty ())
+    {
+      Simulator::ScheduleReserved (link.m_inFlight.front ().first,
+                                   MakeEvent (&QbbChannel::Deliver, this, wire));
+    }
+  link.m_dst->Receive (p);
+}
+
+void
+QbbChannel::Save (CheckpointWriter &w) const
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t wire = 0; wire < N_DEVICES; wire++)
+    {
+      const Link &link = m_link[wire];
+      w.Put ((uint32_t)link.m_inFlight.size ());
+      for (uint32_t i = 0; i < link.m_inFlight.size (); i++)
+        {
+          // only the head is scheduled, the others are just their slot
+          if (i == 0)
+            {
+              w.PutEvent (link.m_inFlight[i].first);
+            }
+          else
+            {
+              w.PutSlot (link.m_inFlight[i].first);
+            }
+          w.PutPacket (link.m_inFlight[i].second);
+        }
+    }
+}
+
+void
+QbbChannel::Restore (CheckpointReader &r)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t wire = 0; wire < N_DEVICES; wire++)
+    {
+      Link &link = m_link[wire];
+      NS_ASSERT (link.m_inFlight.empty ());
+      uint32_t n = r.Get<uint32_t> ();
+      for (uint32_t i = 0; i < n && !r.Failed (); i++)
+        {
+          EventId rx = i == 0 ? r.GetEvent (MakeEvent (&QbbChannel::Deliver, this, wire)) : r.GetSlot ();
+          link.m_inFlight.push_back (std::make_pair (rx, r.GetPacket ()));
+        }
+    }
+}
+
 uint32_t 
 QbbChannel::GetNDevices (void) const
 {
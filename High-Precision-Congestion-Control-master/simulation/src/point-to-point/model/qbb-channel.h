@@ -20,10 +20,12 @@
 #define QBB_CHANNEL_H
 
 #include <list>
+#include <deque>
 #include "ns3/channel.h"
 #include "ns3/point-to-point-channel.h"
 #include "ns3/ptr.h"
 #include "ns3/nstime.h"
+#include "ns3/event-id.h"
 #include "ns3/data-rate.h"
 #include "ns3/traced-callback.h"
 
@@ -31,6 +33,8 @@ namespace ns3 {
 
 class QbbNetDevice;
 class Packet;
+class CheckpointWriter;
+class CheckpointReader;
 
 /**
  * \ingroup point-to-point
@@ -99,6 +103,16 @@ public:
    */
   Time GetDelay (void) const;
 
+  /*
+   * \brief Save the packets on the wires and their arrival into a checkpoint
+   */
+  void Save (CheckpointWriter &w) const;
+
+  /*
+   * \brief Restore what Save saved into a channel with nothing in flight
+   */
+  void Restore (CheckpointReader &r);
+
 protected:
   /*
    * \brief Check to make sure the link is initialized
@@ -126,6 +140,12 @@ private:
   // Each point to point link has exactly two net devices
   static const int N_DEVICES = 2;
 
+  /*
+   * \brief Deliver the packet at the head of the wire to its destination
+   * \param wire the wire
+   */
+  void Deliver (uint32_t wire);
+
   Time          m_delay;
   int32_t       m_nDevices;
 
@@ -160,6 +180,10 @@ public:
     WireState                  m_state;
     Ptr<QbbNetDevice> m_src;
     Ptr<QbbNetDevice> m_dst;
+    // Packets on the wire with the slot reserved for their arrival
+    // (Simulator::ReserveWithContext). A wire delivers in the order it
+    // transmits, so only the head has its delivery event scheduled.
+    std::deque<std::pair<EventId, Ptr<Packet> > > m_inFlight;
   };
 
   Link    m_link[N_DEVICES];
@@ -37,7 +37,6 @@
 #include "ns3/point-to-point-channel.h"
 #include "ns3/qbb-channel.h"
 #include "ns3/random-variable.h"
-#include "ns3/flow-id-tag.h"
 #include "ns3/qbb-header.h"
 #include "ns3/error-model.h"
 #include "ns3/cn-header.h"
@@ -47,6 +46,7 @@
 #include "ns3/pointer.h"
 #include "ns3/custom-header.h"
 #include "ns3/custom-header-niux.h"
+#include "ns3/checkpoint.h"
 
 #include <iostream>
 
@@ -54,8 +54,10 @@ NS_LOG_COMPONENT_DEFINE("QbbNetDevice");
 
 namespace ns3 {
     
-    uint32_t RdmaEgressQueue::ack_q_idx = 3;
+    thread_local uint32_t RdmaEgressQueue::ack_q_idx = 3;
     // RdmaEgressQueue
+    NS_OBJECT_ENSURE_REGISTERED(RdmaEgressQueue);
+
     TypeId RdmaEgressQueue::GetTypeId (void)
     {
         static TypeId tid = TypeId ("ns3::RdmaEgressQueue")
@@ -98,18 +100,20 @@ namespace ns3 {
             return -1;
 
         // no pkt in highest priority queue, do rr for each qp
+        // only the scheduling state in the group's contiguous table is read here, not the qp objects
         int res = -1024;
         uint32_t fcount = m_qpGrp->GetN();//qp的数量
         uint32_t min_finish_id = 0xffffffff;
+        int64_t now = Simulator::Now().GetTimeStep();
         for (qIndex = 1; qIndex <= fcount; qIndex++){
             uint32_t idx = (qIndex + m_rrlast) % fcount;
-            Ptr<RdmaQueuePair> qp = m_qpGrp->Get(idx);
-            if (!paused[qp->m_pg] && qp->GetBytesLeft() > 0 && !qp->IsWinBound()){
-                if (m_qpGrp->Get(idx)->m_nextAvail.GetTimeStep() > Simulator::Now().GetTimeStep()) //not available now
+            const RdmaQpHot &qp = m_qpGrp->GetHot(idx);
+            if (!paused[qp.m_pg] && qp.GetBytesLeft() > 0 && !qp.IsWinBound()){
+                if (qp.m_nextAvail.GetTimeStep() > now) //not available now
                     continue;
                 res = idx;
                 break;
-            }else if (qp->IsFinished()){
+            }else if (qp.IsFinished()){
                 min_finish_id = idx < min_finish_id ? idx : min_finish_id;
             }
         }
@@ -118,13 +122,17 @@ namespace ns3 {
         if (min_finish_id < 0xffffffff){
             int nxt = min_finish_id;
             auto &qps = m_qpGrp->m_qps;
-            for (int i = min_finish_id + 1; i < fcount; i++) if (!qps[i]->IsFinished()){
+            auto &hot = m_qpGrp->m_hot;
+            for (int i = min_finish_id; i < fcount; i++) if (!hot[i]->IsFinished()){
                 if (i == res) // update res to the idx after removing finished qp
                     res = nxt;
                 qps[nxt] = qps[i];
+                hot[nxt] = hot[i];
                 nxt++;
-            }
+            }else
+                m_qpGrp->RemoveAvail(PeekPointer(qps[i]));
             qps.resize(nxt);
+            hot.resize(nxt);
         }
         return res;
     }
@@ -135,7 +143,7 @@ namespace ns3 {
 
     uint32_t RdmaEgressQueue::GetNBytes(uint32_t qIndex){
         NS_ASSERT_MSG(qIndex < m_qpGrp->GetN(), "RdmaEgressQueue::GetNBytes: qIndex >= m_qpGrp->GetN()");
-        return m_qpGrp->Get(qIndex)->GetBytesLeft();
+        return m_qpGrp->GetHot(qIndex).GetBytesLeft();
     }
 
     uint32_t RdmaEgressQueue::GetFlowCount(void){
@@ -146,9 +154,22 @@ namespace ns3 {
         return m_qpGrp->Get(i);
     }
  
+    void RdmaEgressQueue::Save(CheckpointWriter &w) const{
+        w.Put(m_qlast);
+        w.Put(m_rrlast);
+        m_ackQ->Save(w);
+    }
+
+    void RdmaEgressQueue::Restore(CheckpointReader &r){
+        r.Get(m_qlast);
+        r.Get(m_rrlast);
+        m_ackQ->Restore(r);
+    }
+
     void RdmaEgressQueue::RecoverQueue(uint32_t i){
         NS_ASSERT_MSG(i < m_qpGrp->GetN(), "RdmaEgressQueue::RecoverQueue: qIndex >= m_qpGrp->GetN()");
         m_qpGrp->Get(i)->snd_nxt = m_qpGrp->Get(i)->snd_una;
+        m_qpGrp->UpdateAvail(PeekPointer(m_qpGrp->Get(i)));
     }
 
     void RdmaEgressQueue::EnqueueHighPrioQ(Ptr<Packet> p){
@@ -247,12 +268,26 @@ namespace ns3 {
         QbbNetDevice::TransmitComplete(void)
     {
         NS_LOG_FUNCTION(this);
+        FinishTransmit();
+        DequeueAndTransmit();
+    }
+
+    void
+        QbbNetDevice::FinishTransmit(void)
+    {
         NS_ASSERT_MSG(m_txMachineState == BUSY, "Must be BUSY if transmitting");
         m_txMachineState = READY;
         NS_ASSERT_MSG(m_currentPkt != 0, "QbbNetDevice::TransmitComplete(): m_currentPkt zero");
         m_phyTxEndTrace(m_currentPkt);
         m_currentPkt = 0;
-        DequeueAndTransmit();
+    }
+
+    bool
+        QbbNetDevice::MayTransmit(void)
+    {
+        if (m_node->GetNodeType() == 0) // a NIC without qps only sends what is in its high prio queue
+            return m_rdmaEQ->GetFlowCount() > 0 || m_rdmaEQ->m_ackQ->GetNPackets() > 0;
+        return m_queue->GetNBytesTotal() > 0;
     }
 
     void
@@ -261,7 +296,16 @@ namespace ns3 {
 
         NS_LOG_FUNCTION(this);
         if (!m_linkUp) return; // if link is down, return
-        if (m_txMachineState == BUSY) return;    // Quit if channel busy
+        if (m_txMachineState == BUSY){
+            if (!m_txComplete.IsExpired())
+                return;    // Quit if channel busy
+            // TransmitStart did not schedule the end of the transmission
+            if (!Simulator::IsPassed(m_txEnd)){
+                m_txComplete = Simulator::ScheduleReserved(m_txEnd, MakeEvent(&QbbNetDevice::TransmitComplete, this));
+                return;
+            }
+            FinishTransmit();
+        }
         Ptr<Packet> p;
         if (m_node->GetNodeType() == 0){ //主机端
             int qIndex = m_rdmaEQ->GetNextQindex(m_paused);//从qpGroup中获取到该条流的索引
@@ -284,13 +328,7 @@ namespace ns3 {
                 m_rdmaPktSent(lastQp, p, m_tInterframeGap);
             }else { // no packet to send
                 NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
-                Time t = Simulator::GetMaximumSimulationTime();
-                for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++){
-                    Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-                    if (qp->GetBytesLeft() == 0)
-                        continue;
-                    t = Min(qp->m_nextAvail, t);
-                }
+                Time t = m_rdmaEQ->m_qpGrp->GetNextAvail();
                 if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() && t > Simulator::Now()){
                     m_nextSend = Simulator::Schedule(t - Simulator::Now(), &QbbNetDevice::DequeueAndTransmit, this);
                 }
@@ -301,33 +339,15 @@ namespace ns3 {
             if (p != 0){
                 m_snifferTrace(p);
                 m_promiscSnifferTrace(p);
-                Ipv4Header h;
-                Ptr<Packet> packet = p->Copy();
-                uint16_t protocol = 0;
-                ProcessHeader(packet, protocol);// 为什么要copy一份packet
-                packet->RemoveHeader(h);
-                FlowIdTag t;
                 uint32_t qIndex = m_queue->GetLastQueue();
-                if (qIndex == 0){//this is a pause or cnp, send it immediately!
-                    m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);//将INT的信息写入到buffer中
-                    p->RemovePacketTag(t);
-                }else{
-                    m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);
-                    p->RemovePacketTag(t);
-                }
+                m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);//将INT的信息写入到buffer中
                 m_traceDequeue(p, qIndex);
                 TransmitStart(p);
                 return;
             }else{ //No queue can deliver any packet
                 NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
                 if (m_node->GetNodeType() == 0 && m_qcnEnabled){ //nothing to send, possibly due to qcn flow control, if so reschedule sending
-                    Time t = Simulator::GetMaximumSimulationTime();
-                    for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++){
-                        Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-                        if (qp->GetBytesLeft() == 0)
-                            continue;
-                        t = Min(qp->m_nextAvail, t);
-                    }
+                    Time t = m_rdmaEQ->m_qpGrp->GetNextAvail();
                     if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() && t > Simulator::Now()){
                         m_nextSend = Simulator::Schedule(t - Simulator::Now(), &QbbNetDevice::DequeueAndTransmit, this);
                     }
@@ -338,12 +358,6 @@ namespace ns3 {
             if (p != 0){
                 m_snifferTrace(p);
                 m_promiscSnifferTrace(p);
-                Ipv4Header h;
-                Ptr<Packet> packet = p->Copy();
-                uint16_t protocol = 0;
-                ProcessHeader(packet, protocol);// 为什么要copy一份packet
-                packet->RemoveHeader(h);
-                FlowIdTag t;
                 uint32_t qIndex = m_queue->GetLastQueue();
                 m_traceDequeue(p, qIndex);
                 TransmitStart(p);
@@ -351,13 +365,7 @@ namespace ns3 {
             }else{ //No queue can deliver any packet
                 NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
                 if (m_node->GetNodeType() == 0 && m_qcnEnabled){ //nothing to send, possibly due to qcn flow control, if so reschedule sending
-                    Time t = Simulator::GetMaximumSimulationTime();
-                    for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++){
-                        Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-                        if (qp->GetBytesLeft() == 0)
-                            continue;
-                        t = Min(qp->m_nextAvail, t);
-                    }
+                    Time t = m_rdmaEQ->m_qpGrp->GetNextAvail();
                     if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() && t > Simulator::Now()){
                         m_nextSend = Simulator::Schedule(t - Simulator::Now(), &QbbNetDevice::DequeueAndTransmit, this);
                     }
@@ -414,7 +422,7 @@ namespace ns3 {
             }*/
         }else { // non-PFC packets (data, ACK, NACK, CNP...)
             if (m_node->GetNodeType() == 1){ // switch
-                packet->AddPacketTag(FlowIdTag(m_ifIndex));
+                packet->GetSwitchMeta().inDev = m_ifIndex;
                 m_node->SwitchReceiveFromDevice(this, packet, ch);
             }else if(m_node->GetNodeType() == 2){ //出入口路由器
                 m_node->MatchSharedTableSendToRelatedSender(this, packet, ch);//生成共享链路表，和共享链路表匹配，调用sendtodev-switchsend
@@ -486,8 +494,11 @@ namespace ns3 {
         Time txTime = Seconds(m_bps.CalculateTxTime(p->GetSize()));
 				// 向上取整1ns
         Time txCompleteTime = txTime + m_tInterframeGap + NanoSeconds(1);
-        NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.GetSeconds() << "sec");
-        Simulator::Schedule(txCompleteTime, &QbbNetDevice::TransmitComplete, this);
+        m_txEnd = Simulator::Reserve(txCompleteTime);
+        if (MayTransmit()){
+            NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.GetSeconds() << "sec");
+            m_txComplete = Simulator::ScheduleReserved(m_txEnd, MakeEvent(&QbbNetDevice::TransmitComplete, this));
+        }
 
         bool result = m_channel->TransmitStart(p, this, txTime);
         if (result == false)
@@ -509,6 +520,7 @@ namespace ns3 {
 
    void QbbNetDevice::NewQp(Ptr<RdmaQueuePair> qp){
        qp->m_nextAvail = Simulator::Now();
+       m_rdmaEQ->m_qpGrp->UpdateAvail(PeekPointer(qp));
        DequeueAndTransmit();
    }
    void QbbNetDevice::ReassignedQp(Ptr<RdmaQueuePair> qp){
@@ -558,9 +570,47 @@ namespace ns3 {
         m_linkUp = false;
     }
 
+    void QbbNetDevice::Save(CheckpointWriter &w) const{
+        w.Put(m_txMachineState);
+        w.PutPacket(m_currentPkt);
+        w.Put(m_linkUp);
+        w.PutBytes(m_paused, sizeof(m_paused));
+        w.PutSlot(m_txEnd);
+        w.PutEvent(m_txComplete);
+        w.PutEvent(m_nextSend);
+        w.Put(m_queue != 0);
+        if (m_queue != 0)
+            m_queue->Save(w);
+        m_rdmaEQ->Save(w);
+        w.Put(m_receiveErrorModel != 0);
+        if (m_receiveErrorModel != 0)
+            m_receiveErrorModel->Save(w); // may be shared with other devices, saving it again is harmless
+    }
+
+    void QbbNetDevice::Restore(CheckpointReader &r){
+        r.Get(m_txMachineState);
+        m_currentPkt = r.GetPacket();
+        r.Get(m_linkUp);
+        r.GetBytes(m_paused, sizeof(m_paused));
+        m_txEnd = r.GetSlot();
+        m_txComplete = r.GetEvent(MakeEvent(&QbbNetDevice::TransmitComplete, this));
+        m_nextSend = r.GetEvent(MakeEvent(&QbbNetDevice::DequeueAndTransmit, this));
+        if (r.Get<bool>() != (m_queue != 0))
+            r.Fail("the devices of the checkpoint have other queues");
+        else if (m_queue != 0)
+            m_queue->Restore(r);
+        m_rdmaEQ->Restore(r);
+        if (r.Get<bool>() != (m_receiveErrorModel != 0))
+            r.Fail("the devices of the checkpoint have other error models");
+        else if (m_receiveErrorModel != 0)
+            m_receiveErrorModel->Restore(r);
+    }
+
     void QbbNetDevice::UpdateNextAvail(Time t){
         if (!m_nextSend.IsExpired() && t < m_nextSend.GetTs()){
             Simulator::Cancel(m_nextSend);
+            if (!m_txComplete.IsExpired() && t.GetTimeStep() <= (int64_t)m_txEnd.GetTs())
+                return; // the end of the current transmission dequeues first anyway
             Time delta = t < Simulator::Now() ? Time(0) : t - Simulator::Now();
             m_nextSend = Simulator::Schedule(delta, &QbbNetDevice::DequeueAndTransmit, this);
         }
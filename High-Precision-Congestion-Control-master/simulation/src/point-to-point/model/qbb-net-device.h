@@ -36,10 +36,13 @@
 
 namespace ns3 {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class RdmaEgressQueue : public Object{
 public:
     static const uint32_t qCnt = 8;
-    static uint32_t ack_q_idx;
+    static thread_local uint32_t ack_q_idx; // per simulation thread
     int m_qlast;
     uint32_t m_rrlast;
     Ptr<DropTailQueue> m_ackQ; // highest priority queue
@@ -60,6 +63,9 @@ public:
     void RecoverQueue(uint32_t i);
     void EnqueueHighPrioQ(Ptr<Packet> p);
     void CleanHighPrio(TracedCallback<Ptr<const Packet>, uint32_t> dropCb);
+    // the qp group is saved by RdmaHw
+    void Save(CheckpointWriter &w) const;
+    void Restore(CheckpointReader &r);
 
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceRdmaEnqueue;
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceRdmaDequeue;
@@ -128,6 +134,14 @@ public:
 
     void SendPfc(uint32_t qIndex, uint32_t type); // type: 0 = pause, 1 = resume
 
+    /**
+     * Save the transmit state, the pending transmission events and the
+     * queued packets into a checkpoint; the qps are saved by RdmaHw and the
+     * packets on the wire by the channel.
+     */
+    void Save(CheckpointWriter &w) const;
+    void Restore(CheckpointReader &r);
+
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceEnqueue;
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceDequeue;
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceDrop;
@@ -143,6 +157,12 @@ protected:
   /// Reset the channel into READY state and try transmit again
   virtual void TransmitComplete(void);
 
+  /// Reset the channel into READY state (the end of m_currentPkt)
+  void FinishTransmit(void);
+
+  /// Whether the device may have a packet to send at the end of the current transmission
+  bool MayTransmit(void);
+
   /// Look for an available packet and send it using TransmitStart(p)
   virtual void DequeueAndTransmit(void);
 
@@ -169,6 +189,17 @@ protected:
 
   /* RP parameters */
   EventId  m_nextSend;        //< The next send event
+  /*
+   * End of the current transmission, reserved in the event list
+   * (Simulator::Reserve). The TransmitComplete event is only scheduled
+   * there if the device may have something to send then (MayTransmit);
+   * otherwise the device stays BUSY until something calls
+   * DequeueAndTransmit, which schedules it in the reserved slot or, if
+   * the slot has passed, finishes the transmission in place. Either way
+   * the events run in the same order as if it had always been scheduled.
+   */
+  EventId m_txEnd;
+  EventId m_txComplete;
   /* State variable for rate-limited queues */
 
   //qcn
@@ -0,0 +1,139 @@
+#ifndef QP_HASH_MAP_H
+#define QP_HASH_MAP_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+/**
+ * \brief Open addressing hash map from a 64-bit qp key to a value.
+ *
+ * Used by RdmaHw for the qp lookups that cannot use a qp id. Keys and values
+ * are kept in two flat arrays, a power of two in size and at most half full,
+ * probed linearly. Erase shifts the following entries back instead of leaving
+ * tombstones, so a lookup always stops at the first empty slot.
+ *
+ * The all-ones key marks an empty slot; the qp keys of RdmaHw never use it
+ * (it would need the broadcast address).
+ */
+template <typename V>
+class QpHashMap {
+public:
+    static const uint64_t EMPTY = ~(uint64_t)0;
+
+    QpHashMap() : m_n(0) {
+        Resize(16);
+    }
+
+    uint32_t size() const { return m_n; }
+
+    // the value of key, NULL if there is none
+    V* Find(uint64_t key){
+        for (uint32_t i = Hash(key); ; i = (i + 1) & m_mask){
+            if (m_key[i] == key)
+                return &m_val[i];
+            if (m_key[i] == EMPTY)
+                return NULL;
+        }
+    }
+
+    // the value of key, inserted if there is none
+    V& operator[](uint64_t key){
+        NS_ASSERT(key != EMPTY);
+        uint32_t i = Hash(key);
+        for (; m_key[i] != EMPTY; i = (i + 1) & m_mask){
+            if (m_key[i] == key)
+                return m_val[i];
+        }
+        if ((m_n + 1) * 2 > m_key.size()){
+            Resize(m_key.size() * 2);
+            return (*this)[key];
+        }
+        m_key[i] = key;
+        m_n++;
+        return m_val[i];
+    }
+
+    bool Erase(uint64_t key){
+        uint32_t i = Hash(key);
+        for (; m_key[i] != key; i = (i + 1) & m_mask){
+            if (m_key[i] == EMPTY)
+                return false;
+        }
+        // move back each following entry of the run that may live in the hole,
+        // i.e. whose home slot is not between the hole and its slot
+        for (uint32_t j = (i + 1) & m_mask; m_key[j] != EMPTY; j = (j + 1) & m_mask){
+            uint32_t home = Hash(m_key[j]);
+            if (((j - home) & m_mask) >= ((j - i) & m_mask)){
+                m_key[i] = m_key[j];
+                m_val[i] = m_val[j];
+                i = j;
+            }
+        }
+        m_key[i] = EMPTY;
+        m_val[i] = V();
+        m_n--;
+        return true;
+    }
+
+    /*
+     * The layout of the table, for a checkpoint: ForEach walks it in slot
+     * order, so a restored map must have its entries in the same slots.
+     */
+    uint32_t capacity() const { return m_key.size(); }
+    uint64_t KeyAt(uint32_t i) const { return m_key[i]; } // EMPTY if none
+    const V& ValueAt(uint32_t i) const { return m_val[i]; }
+    // empty the map, with n slots (a power of two)
+    void Clear(uint32_t n){
+        m_key.clear();
+        m_val.clear();
+        Resize(n);
+    }
+    // put an entry in the slot it had, see KeyAt
+    void SetAt(uint32_t i, uint64_t key, const V &v){
+        NS_ASSERT(key != EMPTY && m_key[i] == EMPTY);
+        m_key[i] = key;
+        m_val[i] = v;
+        m_n++;
+    }
+
+    template <typename F>
+    void ForEach(F f){
+        for (uint32_t i = 0; i < m_key.size(); i++){
+            if (m_key[i] != EMPTY)
+                f(m_val[i]);
+        }
+    }
+
+private:
+    inline uint32_t Hash(uint64_t key) const {
+        return (key * 0x9e3779b97f4a7c15ull) >> m_shift;
+    }
+
+    void Resize(uint32_t n){
+        std::vector<uint64_t> key(n, (uint64_t)EMPTY); // a copy, EMPTY has no definition
+        std::vector<V> val(n);
+        key.swap(m_key);
+        val.swap(m_val);
+        m_mask = n - 1;
+        m_shift = 64;
+        for (; n > 1; n >>= 1)
+            m_shift--;
+        m_n = 0;
+        for (uint32_t i = 0; i < key.size(); i++){
+            if (key[i] != EMPTY)
+                (*this)[key[i]] = val[i];
+        }
+    }
+
+    uint32_t m_n; // number of entries
+    uint32_t m_mask, m_shift;
+    std::vector<uint64_t> m_key;
+    std::vector<V> m_val;
+};
+
+} // namespace ns3
+
+#endif /* QP_HASH_MAP_H */
@@ -0,0 +1,97 @@
+#ifndef RATE_RATIO_ESTIMATOR_H
+#define RATE_RATIO_ESTIMATOR_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \brief Division by a divisor fixed at setup, with a multiply and shifts.
+ *
+ * Init(d) precomputes the reciprocal of d (Granlund and Montgomery,
+ * "Division by invariant integers using multiplication"), after which
+ * Div(n) == n / d for every 64-bit n: the result is exact, not a fixed-point
+ * approximation, so replacing a division by it does not change anything.
+ */
+class ReciprocalDivider{
+public:
+	ReciprocalDivider() : m_mul(0), m_sh1(0), m_sh2(0) {}
+
+	void Init(uint64_t d){
+		uint32_t l = 0; // ceil(log2(d))
+		while (l < 64 && ((unsigned __int128)1 << l) < d)
+			l++;
+		m_mul = (uint64_t)(((((unsigned __int128)1 << l) - d) << 64) / d + 1);
+		m_sh1 = l < 1 ? l : 1;
+		m_sh2 = l > 1 ? l - 1 : 0;
+	}
+	inline uint64_t Div(uint64_t n) const{
+		uint64_t q = (uint64_t)(((unsigned __int128)m_mul * n) >> 64);
+		return (q + ((n - q) >> m_sh1)) >> m_sh2;
+	}
+
+private:
+	uint64_t m_mul;
+	uint32_t m_sh1, m_sh2;
+};
+
+/**
+ * \brief Tx rate of a switch port, measured over windows of packets.
+ *
+ * A window closes after 10 packets or once it spans 1000 * (1e11 / port
+ * rate) ns (10 us at 10 Gbps); the rate of the window is then the rate until
+ * the next one closes. Times include the serialization of the packet being
+ * dequeued. The divisions by the port rate are done with the reciprocals
+ * computed in SetMaxRate, so the only division left is the one by the
+ * length of the window, once per window.
+ */
+class RateRatioEstimator{
+public:
+	static const uint32_t windowPkts = 10;
+	static const uint64_t ratioScale = 10000; // GetRatio() is in 1/10000 of the port rate
+
+	RateRatioEstimator() : m_maxRate(0), m_window(0), m_txBytes(0), m_lastTs(0), m_rate(0), m_cnt(0) {}
+
+	void SetMaxRate(uint64_t bps){
+		m_maxRate = bps;
+		m_perRate.Init(bps);
+		m_window = 1000 * (100000000000lu / bps);
+	}
+	uint64_t GetMaxRate(void) const{
+		return m_maxRate;
+	}
+
+	// a packet of size bytes leaves the port at now (ns)
+	inline void Dequeue(uint64_t now, uint32_t size){
+		m_txBytes += size;
+		++m_cnt;
+		uint64_t ts = now + m_perRate.Div((uint64_t)size * 8 * 1000000000);
+		uint64_t dt = ts - m_lastTs;
+		if (m_cnt == windowPkts || dt >= m_window){
+			m_rate = m_txBytes * 8 * 1000000000 / dt;
+			m_lastTs = ts;
+			m_txBytes = 0;
+			m_cnt = 0;
+		}
+	}
+	inline uint64_t GetRate(void) const{ // bps
+		return m_rate;
+	}
+	inline uint64_t GetRatio(void) const{ // may exceed ratioScale
+		return m_perRate.Div(m_rate * ratioScale);
+	}
+	inline uint64_t GetLastTs(void) const{ // end of the last window, ns
+		return m_lastTs;
+	}
+
+private:
+	uint64_t m_maxRate;
+	ReciprocalDivider m_perRate;
+	uint64_t m_window; // ns
+	uint64_t m_txBytes, m_lastTs, m_rate;
+	uint32_t m_cnt;
+};
+
+} // namespace ns3
+
+#endif /* RATE_RATIO_ESTIMATOR_H */
@@ -0,0 +1,220 @@
+#include <iostream>
+#include <ns3/simulator.h>
+#include "rdma-cc-fidcc.h"
+#include "rdma-hw.h"
+#include "enc-header.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED(RdmaCcFidcc);
+
+TypeId RdmaCcFidcc::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::RdmaCcFidcc")
+        .SetParent<RdmaCc> ()
+        .AddConstructor<RdmaCcFidcc> ()
+        ;
+    return tid;
+}
+
+void RdmaCcFidcc::NewQp(Ptr<RdmaQueuePair> qp, DataRate lineRate){
+    GetState(qp).m_currentWinSize = qp->m_win/10;
+}
+
+void RdmaCcFidcc::HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+    Feedback fb;
+    DecodeFeedback(ch, fb);
+    HandleFeedback(qp, p, ch, fb);
+}
+
+void RdmaCcFidcc::DecodeFeedback(MyCustomHeader &ch, Feedback &fb){
+    MyIntHeader &ih = ch.ack.ih;
+    uint32_t n = 0;
+    if (ih.hinfo.depthNum != 0){
+        fb.type = Feedback::DEPTH;
+        n = ih.hinfo.depthNum;
+    }else if (ih.hinfo.ratioNum != 0){
+        fb.type = Feedback::RATIO;
+        n = ih.hinfo.ratioNum;
+    }else
+        fb.type = Feedback::NONE;
+    // a single pass for the largest value, the timestamps come back in absolute ns whatever the INT version
+    uint64_t now = Simulator::Now().GetTimeStep();
+    fb.value = 0;
+    fb.maxRate = 0;
+    fb.ts = now;
+    for (uint32_t i = 0; i < n; i++){
+        MyIntHeader::Entry e = fb.type == Feedback::DEPTH ? ih.GetDepth(i, now) : ih.GetRatio(i, now);
+        if (i == 0 || e.value >= fb.value){
+            fb.value = e.value;
+            fb.maxRate = e.maxRate;
+            fb.ts = e.ts;
+        }
+    }
+    fb.age = now - fb.ts;
+    fb.other = (ch.ack.flags & encHeader::FLAG_MASK) == 1;
+}
+
+void RdmaCcFidcc::HandleFeedback(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch, const Feedback &fb){
+    RdmaQpMycc &cc = GetState(qp);
+    //可能是自身的ack数据包，也可能是同set主机的ack数据包
+    //如果是第一个窗口或者当前窗口和上一个窗口的大小未发生改变的情况，此时不考虑过度反应
+    bool steady = cc.m_lastUpdateSeq == 0 || cc.m_currentWinSize == cc.m_lastWinSize;
+    //当前窗口的大小小于上一个窗口的大小，防止对同一个拥塞事件作出反应；大于时防止对同一个空闲事件作出反应
+    bool decreased = cc.m_currentWinSize < cc.m_lastWinSize;
+    // the reports of the other hosts of the set only count a third of an RTT after the last update
+    uint64_t afterUpdate = cc.m_lastUpdateTime + qp->m_baseRtt/3;
+
+    if (fb.type == Feedback::DEPTH){//数据包携带了队列长度信息
+        bool take = fb.age < cc.m_congestTimeStamp || cc.m_congestTimeStamp == 0;
+        if (!steady && decreased)
+            take = take && fb.other && fb.ts > afterUpdate;
+        else if (!steady)
+            take = take && fb.ts > cc.m_lastUpdateIdleTime;
+        if (take){
+            cc.m_depth = fb.value;
+            cc.m_congestTimeStamp = fb.age;
+            cc.m_dTs = fb.ts;
+            cc.m_max_dRate = fb.maxRate;
+        }
+    }else if (fb.type == Feedback::RATIO){//数据包只携带了速率比值信息
+        bool take = fb.age < cc.m_idleTimeStamp || cc.m_idleTimeStamp == 0;
+        if (!steady && decreased)
+            take = take && fb.ts > cc.m_lastUpdateCongestTime;
+        else if (!steady)
+            take = take && fb.other && fb.ts > afterUpdate;
+        if (take){
+            cc.m_ratio = fb.value;
+            cc.m_idleTimeStamp = fb.age;
+            cc.m_rTs = fb.ts;
+            cc.m_max_rRate = fb.maxRate;
+        }
+    }
+    
+    if ((ch.ack.flags & encHeader::FLAG_MASK) == 0) {//自身的数据包并且一个完整的RTT窗口之后，更新发送速率
+        // std::cout<<"current depth:"<<cc.m_depth<<std::endl;
+        // std::cout<<"current ratio:"<<cc.m_ratio<<std::endl;
+
+        DataRate new_rate;
+        uint32_t ack_seq = ch.ack.seq;
+        uint32_t next_seq = qp->snd_nxt;//snd_nxt为下一个发送的位置，它指向未发送但可以发送的第一个字节的序列号。
+        if (ack_seq > cc.m_lastUpdateSeq && cc.m_lastUpdateSeq != 0) { //一个完整RTT的窗口，此时更新发送速率
+        // std::cout<<"current node:"<< m_hw->m_node->GetId()<<" one window"<<std::endl;
+        // std::cout<<"current node:"<< m_hw->m_node->GetId()<<" m_dTs:"<<cc.m_dTs<<" m_rTs:"<<cc.m_rTs<<std::endl;
+            //todo:计算速率
+            // if (m_hw->m_node->GetId() == 5)
+            // {
+            //     std::cout<<"current_node:"<< m_hw->m_node->GetId()<<" currentTime:"<< Simulator::Now().GetTimeStep()<<std::endl;
+            // }
+            // exit(0);
+            
+            if ((cc.m_dTs != 0 || cc.m_rTs != 0) && cc.m_dTs > cc.m_rTs ) {//在一个窗口内拥塞事件最后发生
+                // std::cout<<"current node:"<< m_hw->m_node->GetId()<<" decrease rate"<<std::endl;
+                cc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
+                cc.m_lastUpdateSeq = next_seq;
+                //1std::cout<<"next_seq:"<<next_seq<<std::endl;
+                cc.m_lastWinSize = cc.m_currentWinSize;
+                cc.m_lastUpdateCongestTime = cc.m_dTs;
+
+                //1std::cout<<"next_seq:"<<next_seq<<std::endl;
+                // xiugai
+                double alpha = (cc.m_depth/(double)(cc.m_depth + (10 * qp->m_baseRtt)/8));
+                
+                // std::cout<<"cc.m_depth:"<<cc.m_depth<<" cc.m_max_dRate:"<<cc.m_max_dRate<<" qp->m_baseRtt:"<<qp->m_baseRtt<<std::endl;
+                cc.m_currentWinSize = cc.m_currentWinSize * (1-alpha);
+                new_rate = qp->m_rate * (1-alpha);
+                
+                //更新速率
+                if (new_rate < m_hw->m_minRate/1000)
+                    new_rate = m_hw->m_minRate/1000;
+                if (new_rate > qp->m_max_rate)
+                    new_rate = qp->m_max_rate;
+                qp->m_rate = new_rate;
+                // ChangeRate(qp, new_rate);
+                //1std::cout<<"***************alpha***********************:"<<alpha<<std::endl;
+                // std::cout<<"current_node:"<< m_hw->m_node->GetId() << " congestTimeStamp:"<< cc.m_congestTimeStamp <<std::endl;
+                std::cout<<"current_time:"<<Simulator::Now().GetTimeStep()<<" current_node:"<< m_hw->m_node->GetId() << " congestion"<<" current_rate:" <<  qp->m_rate <<"   depth:"<<cc.m_depth<<" baseRtt:"<<qp->m_baseRtt<<" alpha:"<<alpha<<" current_windows:"<<cc.m_currentWinSize<<std::endl;
+                //重置下面的变量
+                cc.m_congestTimeStamp = 0;
+                cc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+//                    cc.m_dIsOwn = 3;
+//                    cc.m_rIsOwn = 3;
+                cc.m_depth = 0;
+                cc.m_ratio = 10000;
+                cc.m_dTs = 0;//发生拥塞时的时间
+                cc.m_rTs = 0;
+
+
+                
+            }else if((cc.m_dTs != 0 || cc.m_rTs != 0) && cc.m_dTs < cc.m_rTs && cc.m_ratio != 10000){//在一个窗口内空闲事件最后发生
+                // std::cout<<"current node:"<< m_hw->m_node->GetId()<<" increase rate"<<std::endl;
+                cc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
+                cc.m_lastUpdateSeq = next_seq;
+                cc.m_lastWinSize = cc.m_currentWinSize;
+                cc.m_lastUpdateIdleTime = cc.m_rTs;
+                if (cc.m_ratio!=0)
+                {
+                    // std::cout<<"m_hw->m_rai:"<<m_hw->m_rai.GetBitRate()<<"m_hw->m_rai's BDP:"<<m_hw->m_rai.GetBitRate()*qp->m_baseRtt/1000000000<<std::endl;
+                    cc.m_currentWinSize = 0.95*(double)cc.m_currentWinSize/((double)cc.m_ratio/10000)+m_hw->m_rai.GetBitRate()*qp->m_baseRtt/100000000;
+                    new_rate = 0.95*qp->m_rate/((double)cc.m_ratio/10000)+m_hw->m_rai.GetBitRate()*1.6;
+                    // new_rate = cc.m_currentWinSize / qp->m_baseRtt;
+                    if (new_rate < m_hw->m_minRate/1000)
+                        new_rate = m_hw->m_minRate/1000;
+                    if (new_rate > qp->m_max_rate)
+                        new_rate = qp->m_max_rate;
+                    // ChangeRate(qp, new_rate);
+                    qp->m_rate = new_rate;
+                    std::cout<<"current_time:"<<Simulator::Now().GetTimeStep()<<" current_node:"<< m_hw->m_node->GetId() <<" idle"<<" current_rate:" << qp->m_rate<<" ratio:"<<cc.m_ratio<<" current_windows:"<<cc.m_currentWinSize<<std::endl;
+                                    // qp->m_rate = new_rate;
+                    
+                }
+                //重置下面的变量
+                    cc.m_congestTimeStamp = 0;
+                    cc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+    //                    cc.m_dIsOwn = 3;
+    //                    cc.m_rIsOwn = 3;
+                    cc.m_depth = 0;
+                    cc.m_ratio = 10000;
+                    cc.m_dTs = 0;//发生拥塞时的时间
+                    cc.m_rTs = 0;
+                
+                
+
+                
+
+            }else{
+                // std::cout<<"current node:"<< m_hw->m_node->GetId()<<" unchanged rate"<<std::endl;
+                cc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
+                cc.m_lastUpdateSeq = next_seq;
+                cc.m_lastWinSize = cc.m_currentWinSize;
+                // cc.m_lastUpdateCongestTime = cc.m_dTs;
+                std::cout<<"current_time:"<<Simulator::Now().GetTimeStep()<<" current_node:"<< m_hw->m_node->GetId() <<" normal"<<" current_rate:" << qp->m_rate<<" ratio:"<<cc.m_ratio<<"  cc.m_depth:"<<cc.m_depth <<" current_windows:"<<cc.m_currentWinSize<<std::endl;
+                cc.m_congestTimeStamp = 0;
+                cc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+//                    cc.m_dIsOwn = 3;
+//                    cc.m_rIsOwn = 3;
+                cc.m_depth = 0;
+                cc.m_ratio = 10000;
+                cc.m_dTs = 0;//发生拥塞时的时间
+                cc.m_rTs = 0;
+            }
+        }else if (cc.m_lastUpdateSeq == 0){
+            cc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
+            cc.m_lastUpdateSeq = next_seq;
+            cc.m_lastWinSize = cc.m_currentWinSize;
+            // cc.m_lastUpdateCongestTime = cc.m_dTs;
+            std::cout<<"current_time:"<<Simulator::Now().GetTimeStep()<<" current_node:"<< m_hw->m_node->GetId() <<"    first_rtt_window"<< "  ack_sip:" << ch.sip << "    ack_dip:" << ch.dip<< "  ch-ack-flag:"<< (ch.ack.flags & encHeader::FLAG_MASK)<<" current_rate:" << qp->m_rate<<" ratio:"<<cc.m_ratio<<"  cc.m_depth:"<<cc.m_depth <<" current_windows:"<<cc.m_currentWinSize<<std::endl;
+            cc.m_congestTimeStamp = 0;
+            cc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+//                    cc.m_dIsOwn = 3;
+//                    cc.m_rIsOwn = 3;
+            cc.m_depth = 0;
+            cc.m_ratio = 10000;
+            cc.m_dTs = 0;//发生拥塞时的时间
+            cc.m_rTs = 0;
+    }
+    }
+    //1std::cout<< "node:" << m_hw->m_node->GetId()<<"change windowsSIZE:"<<cc.m_currentWinSize<<std::endl;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,38 @@
+#ifndef RDMA_CC_FIDCC_H
+#define RDMA_CC_FIDCC_H
+
+#include "rdma-cc.h"
+
+namespace ns3 {
+
+/**
+ * \brief FIDCC: the window and rate of a QP follow the deepest queue and the
+ * largest rate ratio reported in the INT of its ACKs, and of the ACKs an
+ * EnquserverNode builds from the flows of the other hosts of its set.
+ *
+ * The algorithm of every CC_MODE but 1, 3, 7, 8 and 10, which are refused.
+ * A variant subclasses it and overrides HandleFeedback.
+ */
+class RdmaCcFidcc : public RdmaCcWith<RdmaQpMycc> {
+public:
+    // what the update uses of the INT records of an ACK, decoded once per ACK
+    struct Feedback {
+        enum { NONE, DEPTH, RATIO } type; // depth records if the ACK has any, else ratio records
+        uint32_t value; // the largest depth or ratio (the last hop of equal ones)
+        uint8_t maxRate;
+        uint64_t ts; // when that hop measured it (ns)
+        int64_t age; // now - ts
+        bool other; // an ACK built by an EnquserverNode for the flow of another host
+    };
+
+    static TypeId GetTypeId (void);
+    static void DecodeFeedback(MyCustomHeader &ch, Feedback &fb);
+
+    virtual void NewQp(Ptr<RdmaQueuePair> qp, DataRate lineRate);
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+    virtual void HandleFeedback(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch, const Feedback &fb);
+};
+
+} /* namespace ns3 */
+
+#endif /* RDMA_CC_FIDCC_H */
@@ -0,0 +1,28 @@
+#include "rdma-cc.h"
+
+namespace ns3 {
+
+/**************************
+ * RdmaCc
+ *************************/
+NS_OBJECT_ENSURE_REGISTERED(RdmaCc);
+
+TypeId RdmaCc::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::RdmaCc")
+        .SetParent<Object> ()
+        ;
+    return tid;
+}
+
+RdmaCc::RdmaCc() : m_hw(NULL) {
+}
+
+void RdmaCc::SetRdmaHw(RdmaHw *hw){
+    m_hw = hw;
+}
+
+void RdmaCc::QpComplete(Ptr<RdmaQueuePair> qp){
+}
+
+} /* namespace ns3 */
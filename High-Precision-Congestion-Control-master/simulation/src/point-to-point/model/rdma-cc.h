@@ -0,0 +1,57 @@
+#ifndef RDMA_CC_H
+#define RDMA_CC_H
+
+#include <ns3/object.h>
+#include <ns3/packet.h>
+#include <ns3/data-rate.h>
+#include <ns3/custom-header-niux.h>
+#include "rdma-queue-pair.h"
+
+namespace ns3 {
+
+class RdmaHw;
+
+/**
+ * \brief Congestion control algorithm of an RdmaHw.
+ *
+ * Each RdmaHw creates one, by the TypeId name in its CcAlgorithm attribute
+ * (CC_ALGORITHM in config.txt), so an algorithm is added by registering a
+ * subclass with NS_OBJECT_ENSURE_REGISTERED, without touching RdmaHw.
+ * Without CC_ALGORITHM, CC_MODE picks it (RdmaHw::GetCcAlgorithmName).
+ *
+ * The per-QP state of the algorithm lives in the RdmaQpTable of the RdmaHw,
+ * which builds it with GetQpState when a QP is created: QPs only carry the
+ * state of the algorithm that runs. Subclass RdmaCcWith<State> to get it.
+ */
+class RdmaCc : public Object {
+public:
+    static TypeId GetTypeId (void);
+    RdmaCc();
+
+    void SetRdmaHw(RdmaHw *hw);
+    virtual RdmaQpCcState GetQpState(void) const = 0;
+    // a new QP: its state is constructed, m_rate and m_max_rate are set
+    virtual void NewQp(Ptr<RdmaQueuePair> qp, DataRate lineRate) = 0;
+    // an ACK or NACK of the QP, also those an EnquserverNode builds for the flows of other hosts
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch) = 0;
+    // the QP is done and about to be deleted
+    virtual void QpComplete(Ptr<RdmaQueuePair> qp);
+
+protected:
+    RdmaHw *m_hw; // the RdmaHw it belongs to, which holds its parameters
+};
+
+template <typename State>
+class RdmaCcWith : public RdmaCc {
+public:
+    virtual RdmaQpCcState GetQpState(void) const{
+        return RdmaQpCcState::Of<State>();
+    }
+    static inline State& GetState(Ptr<RdmaQueuePair> qp){
+        return qp->GetCc<State>();
+    }
+};
+
+} /* namespace ns3 */
+
+#endif /* RDMA_CC_H */
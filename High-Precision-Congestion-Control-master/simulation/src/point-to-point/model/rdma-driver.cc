@@ -5,12 +5,16 @@ namespace ns3 {
 /***********************
  * RdmaDriver
  **********************/
+NS_OBJECT_ENSURE_REGISTERED(RdmaDriver);
+
 TypeId RdmaDriver::GetTypeId (void)
 {
 	static TypeId tid = TypeId ("ns3::RdmaDriver")
 		.SetParent<Object> ()
 		.AddTraceSource ("QpComplete", "A qp completes.",
 				MakeTraceSourceAccessor (&RdmaDriver::m_traceQpComplete))
+		.AddTraceSource ("FlowsComplete", "A batch of flows completed (RdmaHw::CompletionBatch of them, fewer when flushed).",
+				MakeTraceSourceAccessor (&RdmaDriver::m_traceFlowsComplete))
 		;
 	return tid;
 }
@@ -50,6 +54,7 @@ void RdmaDriver::Init(void){
 	// RdmaHw do setup
 	m_rdma->SetNode(m_node);
 	m_rdma->Setup(MakeCallback(&RdmaDriver::QpComplete, this));
+	m_rdma->m_flowsCompleteCallback = MakeCallback(&RdmaDriver::FlowsComplete, this);
 }
 
 void RdmaDriver::SetNode(Ptr<Node> node){
@@ -64,8 +69,25 @@ void RdmaDriver::AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address sip, Ipv4A
 	m_rdma->AddQueuePair(size, pg, sip, dip, sport, dport, win, baseRtt, notifyAppFinish);
 }
 
+void RdmaDriver::AddFlows(const std::vector<RdmaFlow> &flows){
+	if (!flows.empty())
+		m_rdma->AddFlows(&flows[0], flows.size());
+}
+
+uint16_t RdmaDriver::AddFlowNotify(RdmaHw::QpCompleteCallback cb){
+	return m_rdma->AddFlowNotify(cb);
+}
+
 void RdmaDriver::QpComplete(Ptr<RdmaQueuePair> q){
 	m_traceQpComplete(q);
 }
 
+void RdmaDriver::FlowsComplete(const RdmaFlowDone *done, uint32_t n){
+	m_traceFlowsComplete(done, n);
+}
+
+void RdmaDriver::FlushCompletions(void){
+	m_rdma->FlushCompletions();
+}
+
 } // namespace ns3
@@ -18,6 +18,7 @@ public:
 
 	// trace
 	TracedCallback<Ptr<RdmaQueuePair> > m_traceQpComplete;
+	TracedCallback<const RdmaFlowDone*, uint32_t> m_traceFlowsComplete;
 
 	static TypeId GetTypeId (void);
 	RdmaDriver();
@@ -35,8 +36,20 @@ public:
 	// add a queue pair
 	void AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport, uint32_t win, uint64_t baseRtt, Callback<void> notifyAppFinish);
 
+	// start a batch of flows in order, without an Application per flow
+	void AddFlows(const std::vector<RdmaFlow> &flows);
+
+	// register a completion callback, returns the index for RdmaFlow::notify
+	uint16_t AddFlowNotify(RdmaHw::QpCompleteCallback cb);
+
 	// callback when qp completes
 	void QpComplete(Ptr<RdmaQueuePair> q);
+
+	// callback with a batch of completed flows
+	void FlowsComplete(const RdmaFlowDone *done, uint32_t n);
+
+	// report the completed flows of the current batch now, at the end of a run
+	void FlushCompletions(void);
 };
 
 } // namespace ns3
@@ -8,15 +8,24 @@
 #include "ns3/double.h"
 #include "ns3/data-rate.h"
 #include "ns3/pointer.h"
+#include "ns3/string.h"
 #include "rdma-hw.h"
+#include "rdma-cc-fidcc.h"
 #include "ppp-header.h"
 #include "qbb-header.h"
 #include "cn-header.h"
 #include "ns3/sequence-number.h"
 #include "ns3/tcp-header.h"
+#include "ns3/log.h"
+#include "ns3/thread-rand.h"
+#include "ns3/checkpoint.h"
+
+NS_LOG_COMPONENT_DEFINE("RdmaHw");
 
 namespace ns3{
 
+NS_OBJECT_ENSURE_REGISTERED(RdmaHw);
+
 TypeId RdmaHw::GetTypeId (void)
 {
     static TypeId tid = TypeId ("ns3::RdmaHw")
@@ -36,11 +45,22 @@ TypeId RdmaHw::GetTypeId (void)
                 UintegerValue(0),
                 MakeUintegerAccessor(&RdmaHw::m_cc_mode),
                 MakeUintegerChecker<uint32_t>())
+        .AddAttribute ("CcAlgorithm",
+                "TypeId name of the RdmaCc to run, empty for the one of CcMode",
+                StringValue(""),
+                MakeStringAccessor(&RdmaHw::m_ccAlgorithm),
+                MakeStringChecker())
         .AddAttribute("NACK Generation Interval",
                 "The NACK Generation interval",
                 DoubleValue(500.0),
                 MakeDoubleAccessor(&RdmaHw::m_nack_interval),
                 MakeDoubleChecker<double>())
+        .AddAttribute("RxQpIdleTimeout",
+                "Free an rx qp that received nothing for this long, 0 to keep it until its FIN. "
+                "A sender silent for longer (link down, CC stall) loses its rx qp, so set it well above those",
+                TimeValue(Seconds(0)),
+                MakeTimeAccessor(&RdmaHw::m_rxQpIdleTimeout),
+                MakeTimeChecker())
         .AddAttribute("L2ChunkSize",
                 "Layer 2 chunk size. Disable chunk mode if equals to 0.",
                 UintegerValue(0),
@@ -176,17 +196,51 @@ TypeId RdmaHw::GetTypeId (void)
                 UintegerValue(65536),
                 MakeUintegerAccessor(&RdmaHw::pint_smpl_thresh),
                 MakeUintegerChecker<uint32_t>())
+        .AddAttribute("CompletionBatch",
+                "Completed flows reported together to the FlowsComplete callback (the rest by FlushCompletions)",
+                UintegerValue(256),
+                MakeUintegerAccessor(&RdmaHw::m_completionBatch),
+                MakeUintegerChecker<uint32_t>(1))
         ;
     return tid;
 }
 
 RdmaHw::RdmaHw(){
+    m_nackRecv = m_retxCnt = m_retxBytes = 0;
+    m_nackSent = m_outOfOrderRecv = m_duplicateRecv = 0;
+    m_rxQpLive = 0;
+    m_rxQpCreated = m_rxQpFin = m_rxQpExpired = 0;
 }
 
 void RdmaHw::SetNode(Ptr<Node> node){
     m_node = node;
 }
+std::string RdmaHw::GetCcAlgorithmName(uint32_t ccMode){
+    switch (ccMode){
+        // DCQCN, HPCC, TIMELY, DCTCP and HPCC-PINT: their updates (the *Mlx and HandleAck* methods)
+        // take the INT and CNPs of the old ACK format (CustomHeader), which the ACKs do not carry
+        case 1: case 3: case 7: case 8: case 10: return "";
+        default: return "ns3::RdmaCcFidcc";
+    }
+}
+
+void RdmaHw::InitCc(void){
+    std::string name = m_ccAlgorithm.empty() ? GetCcAlgorithmName(m_cc_mode) : m_ccAlgorithm;
+    if (name.empty())
+        NS_FATAL_ERROR("CC_MODE " << m_cc_mode << " is not supported: DCQCN, HPCC, TIMELY, DCTCP and HPCC-PINT need the INT and CNPs of the old ACK format, which the ACKs do not carry");
+    TypeId tid;
+    if (!TypeId::LookupByNameFailSafe(name, &tid) && !TypeId::LookupByNameFailSafe("ns3::" + name, &tid))
+        NS_FATAL_ERROR("unknown CC algorithm " << name);
+    ObjectFactory factory;
+    factory.SetTypeId(tid);
+    m_cc = factory.Create<RdmaCc>();
+    NS_ASSERT_MSG(m_cc != NULL, name << " is not an RdmaCc");
+    m_cc->SetRdmaHw(this);
+    m_qpTable = Create<RdmaQpTable>(m_cc->GetQpState());
+}
+
 void RdmaHw::Setup(QpCompleteCallback cb){
+    InitCc();
     for (uint32_t i = 0; i < m_nic.size(); i++){
         Ptr<QbbNetDevice> dev = m_nic[i].dev;
         if (dev == NULL)
@@ -221,25 +275,57 @@ uint64_t RdmaHw::GetQpKey(uint32_t dip, uint16_t sport, uint16_t pg){
 Ptr<RdmaQueuePair> RdmaHw::GetQp(uint32_t dip, uint16_t sport, uint16_t pg){
     uint64_t key = GetQpKey(dip, sport, pg);
 
-    auto it = m_qpMap.find(key);
-    if (it != m_qpMap.end())
-        return it->second;
+    Ptr<RdmaQueuePair> *qp = m_qpMap.Find(key);
+    if (qp != NULL)
+        return *qp;
     return NULL;
 }
+// The id is the slot of the qp in m_qpTable plus one. A qp that is deleted or
+// whose slot was reused fails the check and is looked up by key (ACKs built
+// by an EnquserverNode carry no id either).
+Ptr<RdmaQueuePair> RdmaHw::GetQpById(uint16_t id, uint32_t dip, uint16_t sport){
+    if (id != 0 && id <= m_qpById.size()){
+        RdmaQueuePair *qp = m_qpById[id - 1];
+        if (qp != NULL && qp->dip.Get() == dip && qp->sport == sport)
+            return qp;
+    }
+    return GetQp(dip, sport, 0);
+}
 void RdmaHw::AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address sip, Ipv4Address dip, uint16_t sport, uint16_t dport, uint32_t win, uint64_t baseRtt, Callback<void> notifyAppFinish){
+    RdmaFlow flow;
+    flow.size = size;
+    flow.sip = sip;
+    flow.dip = dip;
+    flow.pg = pg;
+    flow.sport = sport;
+    flow.dport = dport;
+    flow.notify = 0;
+    flow.win = win;
+    flow.baseRtt = baseRtt;
+    Ptr<RdmaQueuePair> qp = AddQueuePair(flow);
+    qp->SetAppNotifyCallback(notifyAppFinish);
+}
+
+Ptr<RdmaQueuePair> RdmaHw::AddQueuePair(const RdmaFlow &flow){
+    Ipv4Address sip = flow.sip, dip = flow.dip;
+    uint16_t pg = flow.pg, sport = flow.sport, dport = flow.dport;
     // create qp
-    Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(pg, sip, dip, sport, dport);
-    qp->SetSize(size);
-    qp->SetWin(win);
-    qp->SetBaseRtt(baseRtt);
+    Ptr<RdmaQueuePair> qp = RdmaQueuePair::Create(m_qpTable, pg, sip, dip, sport, dport);
+    qp->SetSize(flow.size);
+    qp->SetWin(flow.win);
+    qp->SetBaseRtt(flow.baseRtt);
     qp->SetVarWin(m_var_win);
-    qp->SetAppNotifyCallback(notifyAppFinish);
+    NS_ASSERT(flow.notify <= m_flowNotify.size());
+    qp->m_notify = flow.notify;
 
     // add qp
     uint32_t nic_idx = GetNicIdxOfQp(qp);
     m_nic[nic_idx].qpGrp->AddQp(qp);
     uint64_t key = GetQpKey(dip.Get(), sport, pg);
     m_qpMap[key] = qp;
+    if (qp->m_slot >= m_qpById.size())
+        m_qpById.resize(qp->m_slot + 1, NULL);
+    m_qpById[qp->m_slot] = PeekPointer(qp);
     // std::cout<<"qp pg:"<<pg<<"  qp sip:"<<sip.Get()<<"  qp dip:"<<dip.Get()<<"qp sport"<<sport<<"qp dport"<<dport<<std::endl;
 
     // set init variables
@@ -247,54 +333,62 @@ void RdmaHw::AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address sip, Ipv4Addre
     qp->m_rate = m_bps/10;
     // qp->m_rate = win/baseRtt*8/1000000000;
     qp->m_max_rate = m_bps;
-    if (m_cc_mode == 1){
-        qp->mlx.m_targetRate = m_bps;
-    }else if (m_cc_mode == 3){
-        qp->hp.m_curRate = m_bps;
-        if (m_multipleRate){
-            for (uint32_t i = 0; i < IntHeader::maxHop; i++)
-                qp->hp.hopState[i].Rc = m_bps;
-        }
-    }else if (m_cc_mode == 7){
-        qp->tmly.m_curRate = m_bps;
-    }else if (m_cc_mode == 10){
-        qp->hpccPint.m_curRate = m_bps;
-    }else
-        qp->mycc.m_currentWinSize = win/10;
+    m_cc->NewQp(qp, m_bps);
 
     // Notify Nic
     m_nic[nic_idx].dev->NewQp(qp);
-    std::cout<<"qp pg:"<<pg<<"  qp sip:"<<sip.Get()<<"  qp dip:"<<dip.Get()<<"  qp sport:"<<sport<<"  qp dport:"<<dport<<"  myccWindow:"<<qp->mycc.m_currentWinSize<<"  m_rate:"<<qp->m_rate<<std::endl;
+    // a line per flow costs more than starting it, so it is only a log message (NS_LOG=RdmaHw=logic in a debug build)
+    NS_LOG_LOGIC("qp pg:"<<pg<<"  qp sip:"<<sip.Get()<<"  qp dip:"<<dip.Get()<<"  qp sport:"<<sport<<"  qp dport:"<<dport<<"  myccWindow:"<<(DynamicCast<RdmaCcFidcc>(m_cc) != NULL ? qp->GetCc<RdmaQpMycc>().m_currentWinSize : 0)<<"  m_rate:"<<qp->m_rate);
+    return qp;
+}
 
+void RdmaHw::AddFlows(const RdmaFlow *flows, uint32_t n){
+    for (uint32_t i = 0; i < n; i++)
+        AddQueuePair(flows[i]);
+}
+
+uint16_t RdmaHw::AddFlowNotify(QpCompleteCallback cb){
+    NS_ASSERT(m_flowNotify.size() < 0xffff);
+    m_flowNotify.push_back(cb);
+    return m_flowNotify.size();
 }
 
 void RdmaHw::DeleteQueuePair(Ptr<RdmaQueuePair> qp){
     // remove qp from the m_qpMap
     uint64_t key = GetQpKey(qp->dip.Get(), qp->sport, qp->m_pg);
-    m_qpMap.erase(key);
+    m_qpMap.Erase(key);
+    m_qpById[qp->m_slot] = NULL;
 }
 
-Ptr<RdmaRxQueuePair> RdmaHw::GetRxQp(uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport, uint16_t pg, bool create){
+RdmaRxQueuePair* RdmaHw::GetRxQp(uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport, uint16_t pg, bool create){
     uint64_t key = ((uint64_t)dip << 32) | ((uint64_t)pg << 16) | (uint64_t)dport;
-    auto it = m_rxQpMap.find(key);
-    if (it != m_rxQpMap.end())
-        return it->second;
+    RdmaRxQueuePair **q = m_rxQpMap.Find(key);
+    if (q != NULL)
+        return *q;
     if (create){
         // create new rx qp
-        Ptr<RdmaRxQueuePair> qp = CreateObject<RdmaRxQueuePair>();
+        RdmaRxQueuePair *qp = m_rxQpTable.Alloc();
         // init the qp
         qp->sip = sip;
         qp->dip = dip;
         qp->sport = sport;
         qp->dport = dport;
         qp->m_ecn_source.qIndex = pg;
+        qp->m_lastActive = Simulator::Now();
+        // its id, which the sender echoes in its data packets
+        if (qp->m_slot < encHeader::MAX_RX_QP_ID)
+            qp->m_id = qp->m_slot + 1;
         // store in map
         m_rxQpMap[key] = qp;
+        m_rxQpLive++;
+        m_rxQpCreated++;
+        if (!m_rxQpIdleTimeout.IsZero() && !m_rxQpExpireEvent.IsRunning())
+            m_rxQpExpireEvent = Simulator::Schedule(m_rxQpIdleTimeout, &RdmaHw::ExpireRxQps, this);
         return qp;
     }
     return NULL;
 }
-uint32_t RdmaHw::GetNicIdxOfRxQp(Ptr<RdmaRxQueuePair> qp){
+uint32_t RdmaHw::GetNicIdxOfRxQp(RdmaRxQueuePair *qp){
     
     auto it = m_routerMap.find(qp->dip);
 
@@ -307,7 +401,37 @@ uint32_t RdmaHw::GetNicIdxOfRxQp(Ptr<RdmaRxQueuePair> qp){
 }
 void RdmaHw::DeleteRxQp(uint32_t dip, uint16_t pg, uint16_t dport){
     uint64_t key = ((uint64_t)dip << 32) | ((uint64_t)pg << 16) | (uint64_t)dport;
-    m_rxQpMap.erase(key);
+    RdmaRxQueuePair **q = m_rxQpMap.Find(key);
+    if (q == NULL)
+        return;
+    RdmaRxQueuePair *qp = *q;
+    m_rxQpMap.Erase(key);
+    m_rxQpTable.Free(qp);
+    m_rxQpLive--;
+}
+void RdmaHw::DeleteRxQp(RdmaRxQueuePair *q){
+    DeleteRxQp(q->dip, q->m_ecn_source.qIndex, q->dport);
+}
+void RdmaHw::ExpireRxQps(void){
+    Time now = Simulator::Now();
+    std::vector<RdmaRxQueuePair*> idle;
+    m_rxQpMap.ForEach([&](RdmaRxQueuePair *q){
+        if (now - q->m_lastActive >= m_rxQpIdleTimeout)
+            idle.push_back(q);
+    });
+    for (uint32_t i = 0; i < idle.size(); i++)
+        DeleteRxQp(idle[i]);
+    m_rxQpExpired += idle.size();
+    if (m_rxQpLive > 0)
+        m_rxQpExpireEvent = Simulator::Schedule(m_rxQpIdleTimeout, &RdmaHw::ExpireRxQps, this);
+}
+RdmaRxQueuePair* RdmaHw::GetRxQpById(uint16_t id, uint32_t dip, uint16_t dport){
+    if (id != 0){
+        RdmaRxQueuePair *q = m_rxQpTable.Get(id - 1);
+        if (q != NULL && q->m_id == id && q->dip == dip && q->dport == dport)
+            return q;
+    }
+    return NULL;
 }
 
 int RdmaHw::ReceiveUdp(Ptr<Packet> p, MyCustomHeader &ch){
@@ -385,7 +509,20 @@ int RdmaHw::ReceiveTcp(Ptr<Packet> p, MyCustomHeader &ch){
 		// }
 		// std::cout << std::endl;
 
-    Ptr<RdmaRxQueuePair> rxQp = GetRxQp(ch.dip, ch.sip, ch.tcp.dport, ch.tcp.sport, 0, true);
+    // the data packet carries the ids of the rx qp and of the tx qp (see GetNxtPacket)
+    uint16_t rxQpId = ch.tcp.ih_seq >> 16, txQpId = ch.tcp.ih_seq & 0xffff;
+    RdmaRxQueuePair *rxQp = GetRxQpById(rxQpId, ch.sip, ch.tcp.sport);
+    // a packet of an unknown flow starts an rx qp if it is the first one, or if the sender has no
+    // ACK yet (no rx qp id): its first packet was lost and the NACK to seq 0 makes it go back there.
+    // Otherwise it is a retransmission after the FIN freed the rx qp, dropped as a duplicate: a new
+    // rx qp would NACK the sender back to seq 0, which it has already released
+    if (rxQp == NULL)
+        rxQp = GetRxQp(ch.dip, ch.sip, ch.tcp.dport, ch.tcp.sport, 0, ch.tcp.seq == 0 || rxQpId == 0);
+    if (rxQp == NULL){
+        m_duplicateRecv++;
+        return 0;
+    }
+    rxQp->m_lastActive = Simulator::Now();
     if (ecnbits != 0){
         rxQp->m_ecn_source.ecnbits |= ecnbits;
         rxQp->m_ecn_source.qfb++;
@@ -394,16 +531,20 @@ int RdmaHw::ReceiveTcp(Ptr<Packet> p, MyCustomHeader &ch){
     rxQp->m_milestone_rx = m_ack_interval;
 
     int x = ReceiverCheckSeq(ch.tcp.seq, rxQp, payload_size);
+    bool fin = ch.tcp.tcpFlags & 0x01;
+    if (fin && x == 5)
+        x = 1; // the end of the flow is always ACKed, the rx qp is gone after it
 		//x = 1;
     // std::cout<< "tcp-seq:"<< ch.tcp.seq << std::endl;
     if (x == 1 || x == 2){ //generate ACK or NACK
 //        qbbHeader seqh;
         encHeader encH;
         encH.SetSeq(rxQp->ReceiverNextExpectedSeq);
-        encH.SetPG(0);
+        encH.SetPG(txQpId); // echo the sender's qp id, for GetQpById
         encH.SetSport(ch.tcp.dport);
         encH.SetDport(ch.tcp.sport);
-        encH.SetFin(ch.tcp.tcpFlags&0x01);//添加fin标志位
+        encH.SetFin(fin);//添加fin标志位
+        encH.SetRxQpId(rxQp->m_id);
         encH.SetMyIntHeader(ch.tcp.ih);
 //        if (ecnbits)
 //            seqh.SetCnp();
@@ -426,6 +567,11 @@ int RdmaHw::ReceiveTcp(Ptr<Packet> p, MyCustomHeader &ch){
         m_nic[nic_idx].dev->RdmaEnqueueHighPrioQ(newp);
         m_nic[nic_idx].dev->TriggerTransmit();
     }
+    // the FIN packet in order: the flow is fully received
+    if (fin && x == 1){
+        DeleteRxQp(rxQp);
+        m_rxQpFin++;
+    }
     return 0;
 }
 
@@ -457,32 +603,19 @@ int RdmaHw::ReceiveCnp(Ptr<Packet> p, CustomHeader &ch){
     if (qp->m_rate == 0)            //lazy initialization
     {
         qp->m_rate = dev->GetDataRate();
-        if (m_cc_mode == 1){
-            qp->mlx.m_targetRate = dev->GetDataRate();
-        }else if (m_cc_mode == 3){
-            qp->hp.m_curRate = dev->GetDataRate();
-            if (m_multipleRate){
-                for (uint32_t i = 0; i < IntHeader::maxHop; i++)
-                    qp->hp.hopState[i].Rc = dev->GetDataRate();
-            }
-        }else if (m_cc_mode == 7){
-            qp->tmly.m_curRate = dev->GetDataRate();
-        }else if (m_cc_mode == 10){
-            qp->hpccPint.m_curRate = dev->GetDataRate();
-        }
+        m_cc->NewQp(qp, dev->GetDataRate());
     }
     return 0;
 }
 
 int RdmaHw::ReceiveAck(Ptr<Packet> p, MyCustomHeader &ch){
-    uint16_t qIndex = ch.ack.pg;
     uint16_t port = ch.ack.dport;
     uint32_t seq = ch.ack.seq;
     //0 std::cout<< "node:" << m_node->GetId()<< "  ack sip:" << ch.sip << "    ack dip:" << ch.dip<<"  ch-ack-flag:"<< ch.ack.flags <<"    ack-seq:"<< ch.ack.seq<<std::endl;
 
     /*uint8_t cnp = (ch.ack.flags >> qbbHeader::FLAG_CNP) & 1;
     int i;*/
-    Ptr<RdmaQueuePair> qp = GetQp(ch.sip, port, qIndex);
+    Ptr<RdmaQueuePair> qp = GetQpById(ch.ack.pg, ch.sip, port);
     if (qp == NULL){
         std::cout << "ERROR: " << "node:" << m_node->GetId() << ' ' << (ch.l3Prot == 0xFC ? "ACK" : "NACK") << " NIC cannot find the flow\n";
         return 0;
@@ -503,11 +636,12 @@ int RdmaHw::ReceiveAck(Ptr<Packet> p, MyCustomHeader &ch){
         
 
     if ((ch.ack.flags&0x01) == 0) { //自身数据包
+        qp->m_rxQpId = encHeader::GetRxQpId(ch.ack.flags);
         uint32_t nic_idx = GetNicIdxOfQp(qp);
         Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
         
         
-        // std::cout<<"current node:"<< m_node->GetId() << "  ack sip:" << ch.sip << "    ack dip:" << ch.dip<< "  ch-ack-flag:"<< ch.ack.flags<<" current rate:" << qp->m_rate<<" current windows:"<<qp->mycc.m_currentWinSize<<std::endl;
+        // std::cout<<"current node:"<< m_node->GetId() << "  ack sip:" << ch.sip << "    ack dip:" << ch.dip<< "  ch-ack-flag:"<< ch.ack.flags<<" current rate:" << qp->m_rate<<" current windows:"<<qp->GetCc<RdmaQpMycc>().m_currentWinSize<<std::endl;
         if (m_ack_interval == 0)
             std::cout << "ERROR: shouldn't receive ack\n";
         else {
@@ -521,8 +655,11 @@ int RdmaHw::ReceiveAck(Ptr<Packet> p, MyCustomHeader &ch){
                 QpComplete(qp);
             }
         }
-        if (ch.l3Prot == 0xFD) // NACK
+        if (ch.l3Prot == 0xFD){ // NACK
+            qp->m_nackRecv++;
+            m_nackRecv++;
             RecoverQueue(qp);
+        }
 
         // handle cnp
         /*if (cnp){
@@ -531,23 +668,13 @@ int RdmaHw::ReceiveAck(Ptr<Packet> p, MyCustomHeader &ch){
             }
         }*/
 
-        if (m_cc_mode == 3){
-            //HandleAckHp(qp, p, ch);
-        }else if (m_cc_mode == 7){
-            //HandleAckTimely(qp, p, ch);
-        }else if (m_cc_mode == 8){
-            //HandleAckDctcp(qp, p, ch);
-        }else if (m_cc_mode == 10){
-            //HandleAckHpPint(qp, p, ch);
-        }else{
-            HandleAckMycc(qp, p, ch);
-        }
+        m_cc->HandleAck(qp, p, ch);
         // ACK may advance the on-the-fly window, allowing more packets to send
         dev->TriggerTransmit();
         
         return 0;
     }else{
-        HandleAckMycc(qp, p, ch);
+        m_cc->HandleAck(qp, p, ch);
     }
     return 0;
     
@@ -567,7 +694,7 @@ int RdmaHw::Receive(Ptr<Packet> p, MyCustomHeader &ch){
     return 0;
 }
 
-int RdmaHw::ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> qp, uint32_t size){
+int RdmaHw::ReceiverCheckSeq(uint32_t seq, RdmaRxQueuePair *qp, uint32_t size){
     uint32_t expected = qp->ReceiverNextExpectedSeq;
     if (seq == expected){
         qp->ReceiverNextExpectedSeq = expected + size;
@@ -580,8 +707,12 @@ int RdmaHw::ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> qp, uint32_t siz
             return 5;
         }
     } else if (seq > expected) {
+        qp->m_outOfOrder++;
+        m_outOfOrderRecv++;
         // Generate NACK
         if (Simulator::Now() >= qp->m_nackTimer || qp->m_lastNACK != expected){
+            qp->m_nackSent++;
+            m_nackSent++;
             qp->m_nackTimer = Simulator::Now() + MicroSeconds(m_nack_interval);
             qp->m_lastNACK = expected;
             if (m_backto0){
@@ -592,6 +723,8 @@ int RdmaHw::ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> qp, uint32_t siz
             return 4;
     }else {
         // Duplicate.
+        qp->m_duplicate++;
+        m_duplicateRecv++;
         return 3;
     }
 }
@@ -610,27 +743,53 @@ uint16_t RdmaHw::EtherToPpp (uint16_t proto){
 }
 
 void RdmaHw::RecoverQueue(Ptr<RdmaQueuePair> qp){
+    qp->m_retxCnt++;
+    qp->m_retxBytes += qp->snd_nxt - qp->snd_una;
+    m_retxCnt++;
+    m_retxBytes += qp->snd_nxt - qp->snd_una;
     qp->snd_nxt = qp->snd_una;
+    m_nic[GetNicIdxOfQp(qp)].qpGrp->UpdateAvail(PeekPointer(qp));
 }
 
 void RdmaHw::QpComplete(Ptr<RdmaQueuePair> qp){
     NS_ASSERT(!m_qpCompleteCallback.IsNull());
-    if (m_cc_mode == 1){
-        Simulator::Cancel(qp->mlx.m_eventUpdateAlpha);
-        Simulator::Cancel(qp->mlx.m_eventDecreaseRate);
-        Simulator::Cancel(qp->mlx.m_rpTimer);
-    }
+    m_cc->QpComplete(qp);
 
     // This callback will log info
-    // It may also delete the rxQp on the receiver
     m_qpCompleteCallback(qp);
 
-    qp->m_notifyAppFinish();
+    if (!qp->m_notifyAppFinish.IsNull())
+        qp->m_notifyAppFinish();
+    if (qp->m_notify != 0)
+        m_flowNotify[qp->m_notify - 1](qp);
+    if (!m_flowsCompleteCallback.IsNull()){
+        RdmaFlowDone d;
+        d.sip = qp->sip;
+        d.dip = qp->dip;
+        d.sport = qp->sport;
+        d.dport = qp->dport;
+        d.nackRecv = qp->m_nackRecv;
+        d.retxCnt = qp->m_retxCnt;
+        d.size = qp->m_size;
+        d.retxBytes = qp->m_retxBytes;
+        d.startTime = qp->startTime;
+        d.finishTime = Simulator::Now();
+        m_done.push_back(d);
+        if (m_done.size() >= m_completionBatch)
+            FlushCompletions();
+    }
 
     // delete the qp
     DeleteQueuePair(qp);
 }
 
+void RdmaHw::FlushCompletions(void){
+    if (m_done.empty())
+        return;
+    m_flowsCompleteCallback(&m_done[0], m_done.size());
+    m_done.clear();
+}
+
 void RdmaHw::SetLinkDown(Ptr<QbbNetDevice> dev){
     printf("RdmaHw: node:%u a link down\n", m_node->GetId());
 }
@@ -653,13 +812,214 @@ void RdmaHw::RedistributeQp(){
     }
 
     // redistribute qp
-    for (auto &it : m_qpMap){
-        Ptr<RdmaQueuePair> qp = it.second;
+    m_qpMap.ForEach([this](Ptr<RdmaQueuePair> qp){
         uint32_t nic_idx = GetNicIdxOfQp(qp);
         m_nic[nic_idx].qpGrp->AddQp(qp);
         // Notify Nic
         m_nic[nic_idx].dev->ReassignedQp(qp);
+    });
+}
+
+void RdmaHw::Save(CheckpointWriter &w){
+    if (!m_done.empty())
+        w.Fail("completed flows are not reported yet, FlushCompletions first");
+    std::string cc = m_cc->GetInstanceTypeId().GetName();
+    w.Put((uint32_t)cc.size());
+    w.PutBytes(cc.data(), cc.size());
+    w.Put((uint32_t)m_flowNotify.size());
+    m_qpTable->Save(w);
+
+    // the live qps: those in the map and those the NICs still hold
+    std::vector<RdmaQueuePair*> bySlot(m_qpTable->GetNSlots(), NULL);
+    m_qpMap.ForEach([&](Ptr<RdmaQueuePair> qp){
+        bySlot[qp->m_slot] = PeekPointer(qp);
+    });
+    for (uint32_t i = 0; i < m_nic.size(); i++){
+        if (m_nic[i].qpGrp == NULL)
+            continue;
+        for (uint32_t j = 0; j < m_nic[i].qpGrp->m_qps.size(); j++)
+            bySlot[m_nic[i].qpGrp->m_qps[j]->m_slot] = PeekPointer(m_nic[i].qpGrp->m_qps[j]);
+        for (uint32_t j = 0; j < m_nic[i].qpGrp->m_avail.size(); j++)
+            bySlot[m_nic[i].qpGrp->m_avail[j]->m_slot] = m_nic[i].qpGrp->m_avail[j];
+    }
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < bySlot.size(); i++)
+        n += bySlot[i] != NULL;
+    w.Put(n);
+    for (uint32_t i = 0; i < bySlot.size(); i++){
+        if (bySlot[i] == NULL)
+            continue;
+        w.Put(i);
+        bySlot[i]->Save(w);
+    }
+
+    w.Put(m_qpMap.capacity());
+    w.Put(m_qpMap.size());
+    for (uint32_t i = 0; i < m_qpMap.capacity(); i++){
+        if (m_qpMap.KeyAt(i) == QpHashMap<Ptr<RdmaQueuePair> >::EMPTY)
+            continue;
+        w.Put(i);
+        w.Put(m_qpMap.KeyAt(i));
+        w.Put(m_qpMap.ValueAt(i)->m_slot);
+    }
+    w.Put((uint32_t)m_qpById.size());
+
+    w.Put((uint32_t)m_nic.size());
+    for (uint32_t i = 0; i < m_nic.size(); i++){
+        Ptr<RdmaQueuePairGroup> grp = m_nic[i].qpGrp;
+        w.Put(grp != NULL);
+        if (grp == NULL)
+            continue;
+        w.Put((uint32_t)grp->m_qps.size());
+        for (uint32_t j = 0; j < grp->m_qps.size(); j++)
+            w.Put(grp->m_qps[j]->m_slot);
+        w.Put((uint32_t)grp->m_avail.size());
+        for (uint32_t j = 0; j < grp->m_avail.size(); j++)
+            w.Put(grp->m_avail[j]->m_slot);
+    }
+
+    m_rxQpTable.Save(w);
+    w.Put(m_rxQpMap.capacity());
+    w.Put(m_rxQpMap.size());
+    for (uint32_t i = 0; i < m_rxQpMap.capacity(); i++){
+        if (m_rxQpMap.KeyAt(i) == QpHashMap<RdmaRxQueuePair*>::EMPTY)
+            continue;
+        w.Put(i);
+        w.Put(m_rxQpMap.KeyAt(i));
+        w.Put(m_rxQpMap.ValueAt(i)->m_slot);
     }
+
+    w.Put(m_nackRecv);
+    w.Put(m_retxCnt);
+    w.Put(m_retxBytes);
+    w.Put(m_nackSent);
+    w.Put(m_outOfOrderRecv);
+    w.Put(m_duplicateRecv);
+    w.Put(m_rxQpLive);
+    w.Put(m_rxQpCreated);
+    w.Put(m_rxQpFin);
+    w.Put(m_rxQpExpired);
+    w.PutEvent(m_rxQpExpireEvent);
+}
+
+void RdmaHw::Restore(CheckpointReader &r){
+    NS_ASSERT(m_qpMap.size() == 0 && m_rxQpMap.size() == 0);
+    std::string cc(r.Get<uint32_t>(), '\0');
+    r.GetBytes(&cc[0], cc.size());
+    if (!r.Failed() && cc != m_cc->GetInstanceTypeId().GetName())
+        r.Fail("the checkpoint runs " + cc + ", this setup " + m_cc->GetInstanceTypeId().GetName());
+    if (r.Get<uint32_t>() != m_flowNotify.size())
+        r.Fail("the checkpoint has other flow completion callbacks");
+    if (r.Failed())
+        return;
+    m_qpTable->Restore(r);
+
+    std::vector<Ptr<RdmaQueuePair> > bySlot(m_qpTable->GetNSlots());
+    uint32_t n = r.Get<uint32_t>();
+    for (uint32_t k = 0; k < n && !r.Failed(); k++){
+        uint32_t slot = r.Get<uint32_t>();
+        if (slot >= bySlot.size() || bySlot[slot] != NULL){
+            r.Fail("a qp of the checkpoint is in a wrong slot");
+            return;
+        }
+        bySlot[slot] = RdmaQueuePair::Create(m_qpTable, slot);
+        bySlot[slot]->Restore(r);
+    }
+    // the qp of a saved slot, which must be one of the restored qps
+    auto qpAt = [&](uint32_t slot) -> Ptr<RdmaQueuePair> {
+        if (slot >= bySlot.size() || bySlot[slot] == NULL){
+            r.Fail("the checkpoint refers to a qp it does not have");
+            return NULL;
+        }
+        return bySlot[slot];
+    };
+
+    // the slots of a map, a power of two, and each entry in its slot
+    auto mapCapacity = [&]() -> uint32_t {
+        uint32_t cap = r.Get<uint32_t>();
+        if (cap < 16 || (cap & (cap - 1)) != 0){
+            r.Fail("a qp map of the checkpoint has a wrong size");
+            return 16;
+        }
+        return cap;
+    };
+    auto mapSlot = [&](uint32_t cap) -> uint32_t {
+        uint32_t i = r.Get<uint32_t>();
+        if (i >= cap)
+            r.Fail("a qp map of the checkpoint has an entry out of range");
+        return i;
+    };
+
+    m_qpMap.Clear(mapCapacity());
+    n = r.Get<uint32_t>();
+    for (uint32_t k = 0; k < n && !r.Failed(); k++){
+        uint32_t i = mapSlot(m_qpMap.capacity());
+        uint64_t key = r.Get<uint64_t>();
+        Ptr<RdmaQueuePair> qp = qpAt(r.Get<uint32_t>());
+        if (r.Failed())
+            return;
+        m_qpMap.SetAt(i, key, qp);
+    }
+    m_qpById.assign(r.Get<uint32_t>(), NULL);
+    m_qpMap.ForEach([&](Ptr<RdmaQueuePair> qp){
+        if (qp->m_slot < m_qpById.size())
+            m_qpById[qp->m_slot] = PeekPointer(qp);
+        else
+            r.Fail("the qp ids of the checkpoint are out of range");
+    });
+
+    if (r.Get<uint32_t>() != m_nic.size()){
+        r.Fail("the hosts of the checkpoint have other NICs");
+        return;
+    }
+    for (uint32_t i = 0; i < m_nic.size() && !r.Failed(); i++){
+        Ptr<RdmaQueuePairGroup> grp = m_nic[i].qpGrp;
+        if (r.Get<bool>() != (grp != NULL)){
+            r.Fail("the hosts of the checkpoint have other NICs");
+            return;
+        }
+        if (grp == NULL)
+            continue;
+        grp->m_qps.resize(r.Get<uint32_t>());
+        grp->m_hot.resize(grp->m_qps.size());
+        for (uint32_t j = 0; j < grp->m_qps.size() && !r.Failed(); j++){
+            grp->m_qps[j] = qpAt(r.Get<uint32_t>());
+            grp->m_hot[j] = r.Failed() ? NULL : &grp->m_qps[j]->m_hot;
+        }
+        grp->m_avail.resize(r.Get<uint32_t>());
+        for (uint32_t j = 0; j < grp->m_avail.size() && !r.Failed(); j++)
+            grp->m_avail[j] = PeekPointer(qpAt(r.Get<uint32_t>()));
+    }
+    if (r.Failed())
+        return;
+
+    m_rxQpTable.Restore(r);
+    m_rxQpMap.Clear(mapCapacity());
+    n = r.Get<uint32_t>();
+    for (uint32_t k = 0; k < n && !r.Failed(); k++){
+        uint32_t i = mapSlot(m_rxQpMap.capacity());
+        uint64_t key = r.Get<uint64_t>();
+        RdmaRxQueuePair *q = m_rxQpTable.Get(r.Get<uint32_t>());
+        if (r.Failed())
+            return;
+        if (q == NULL){
+            r.Fail("the checkpoint refers to an rx qp it does not have");
+            return;
+        }
+        m_rxQpMap.SetAt(i, key, q);
+    }
+
+    r.Get(m_nackRecv);
+    r.Get(m_retxCnt);
+    r.Get(m_retxBytes);
+    r.Get(m_nackSent);
+    r.Get(m_outOfOrderRecv);
+    r.Get(m_duplicateRecv);
+    r.Get(m_rxQpLive);
+    r.Get(m_rxQpCreated);
+    r.Get(m_rxQpFin);
+    r.Get(m_rxQpExpired);
+    m_rxQpExpireEvent = r.GetEvent(MakeEvent(&RdmaHw::ExpireRxQps, this));
 }
 
 Ptr<Packet> RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp){
@@ -675,7 +1035,11 @@ Ptr<Packet> RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp){
     SeqTsHeader seqTs;
 
     // seqTs.SetSeq (qp->snd_nxt);
+    // the seq field carries the qp ids for the receiver: its own in the high
+    // 16 bits, ours in the low ones (both plus one, 0 if unknown or too large)
+    seqTs.SetSeq (((uint32_t)qp->m_rxQpId << 16) | (qp->m_slot < 0xffff ? qp->m_slot + 1 : 0));
     seqTs.SetPG (qp->m_pg);
+    seqTs.ih.SetSendTime(Simulator::Now().GetTimeStep()); // base of the compact INT timestamps
     p->AddHeader(seqTs);
     // add udp header
     TcpHeader tcpHeader;
@@ -719,6 +1083,7 @@ void RdmaHw::UpdateNextAvail(Ptr<RdmaQueuePair> qp, Time interframeGap, uint32_t
     else
         sendingTime = interframeGap + Seconds(qp->m_max_rate.CalculateTxTime(pkt_size));
     qp->m_nextAvail = Simulator::Now() + sendingTime;
+    m_nic[GetNicIdxOfQp(qp)].qpGrp->UpdateAvail(PeekPointer(qp));
 }
 
 void RdmaHw::ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate){
@@ -728,6 +1093,7 @@ void RdmaHw::ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate){
     qp->m_nextAvail = qp->m_nextAvail + new_sendintTime - sendingTime;
     // update nic's next avail event
     uint32_t nic_idx = GetNicIdxOfQp(qp);
+    m_nic[nic_idx].qpGrp->UpdateAvail(PeekPointer(qp));
     m_nic[nic_idx].dev->UpdateNextAvail(qp->m_nextAvail);
     #endif
 
@@ -740,80 +1106,85 @@ void RdmaHw::ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate){
  * Mellanox's version of DCQCN
  *****************************/
 void RdmaHw::UpdateAlphaMlx(Ptr<RdmaQueuePair> qp){
+    RdmaQpMlx &mlx = qp->GetCc<RdmaQpMlx>();
     #if PRINT_LOG
-    //std::cout << Simulator::Now() << " alpha update:" << m_node->GetId() << ' ' << qp->mlx.m_alpha << ' ' << (int)qp->mlx.m_alpha_cnp_arrived << '\n';
-    //printf("%lu alpha update: %08x %08x %u %u %.6lf->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_alpha);
+    //std::cout << Simulator::Now() << " alpha update:" << m_node->GetId() << ' ' << mlx.m_alpha << ' ' << (int)mlx.m_alpha_cnp_arrived << '\n';
+    //printf("%lu alpha update: %08x %08x %u %u %.6lf->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, mlx.m_alpha);
     #endif
-    if (qp->mlx.m_alpha_cnp_arrived){
-        qp->mlx.m_alpha = (1 - m_g)*qp->mlx.m_alpha + m_g;     //binary feedback
+    if (mlx.m_alpha_cnp_arrived){
+        mlx.m_alpha = (1 - m_g)*mlx.m_alpha + m_g;     //binary feedback
     }else {
-        qp->mlx.m_alpha = (1 - m_g)*qp->mlx.m_alpha;     //binary feedback
+        mlx.m_alpha = (1 - m_g)*mlx.m_alpha;     //binary feedback
     }
     #if PRINT_LOG
-    //printf("%.6lf\n", qp->mlx.m_alpha);
+    //printf("%.6lf\n", mlx.m_alpha);
     #endif
-    qp->mlx.m_alpha_cnp_arrived = false; // clear the CNP_arrived bit
+    mlx.m_alpha_cnp_arrived = false; // clear the CNP_arrived bit
     ScheduleUpdateAlphaMlx(qp);
 }
 void RdmaHw::ScheduleUpdateAlphaMlx(Ptr<RdmaQueuePair> qp){
-    qp->mlx.m_eventUpdateAlpha = Simulator::Schedule(MicroSeconds(m_alpha_resume_interval), &RdmaHw::UpdateAlphaMlx, this, qp);
+    qp->GetCc<RdmaQpMlx>().m_eventUpdateAlpha = Simulator::Schedule(MicroSeconds(m_alpha_resume_interval), &RdmaHw::UpdateAlphaMlx, this, qp);
 }
 
 void RdmaHw::cnp_received_mlx(Ptr<RdmaQueuePair> qp){
-    qp->mlx.m_alpha_cnp_arrived = true; // set CNP_arrived bit for alpha update
-    qp->mlx.m_decrease_cnp_arrived = true; // set CNP_arrived bit for rate decrease
-    if (qp->mlx.m_first_cnp){
+    RdmaQpMlx &mlx = qp->GetCc<RdmaQpMlx>();
+    mlx.m_alpha_cnp_arrived = true; // set CNP_arrived bit for alpha update
+    mlx.m_decrease_cnp_arrived = true; // set CNP_arrived bit for rate decrease
+    if (mlx.m_first_cnp){
         // init alpha
-        qp->mlx.m_alpha = 1;
-        qp->mlx.m_alpha_cnp_arrived = false;
+        mlx.m_alpha = 1;
+        mlx.m_alpha_cnp_arrived = false;
         // schedule alpha update
         ScheduleUpdateAlphaMlx(qp);
         // schedule rate decrease
         ScheduleDecreaseRateMlx(qp, 1); // add 1 ns to make sure rate decrease is after alpha update
         // set rate on first CNP
-        qp->mlx.m_targetRate = qp->m_rate = m_rateOnFirstCNP * qp->m_rate;
-        qp->mlx.m_first_cnp = false;
+        mlx.m_targetRate = qp->m_rate = m_rateOnFirstCNP * qp->m_rate;
+        mlx.m_first_cnp = false;
     }
 }
 
 void RdmaHw::CheckRateDecreaseMlx(Ptr<RdmaQueuePair> qp){
+    RdmaQpMlx &mlx = qp->GetCc<RdmaQpMlx>();
     ScheduleDecreaseRateMlx(qp, 0);
-    if (qp->mlx.m_decrease_cnp_arrived){
+    if (mlx.m_decrease_cnp_arrived){
         #if PRINT_LOG
-        printf("%lu rate dec: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+        printf("%lu rate dec: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
         #endif
         bool clamp = true;
         if (!m_EcnClampTgtRate){
-            if (qp->mlx.m_rpTimeStage == 0)
+            if (mlx.m_rpTimeStage == 0)
                 clamp = false;
         }
         if (clamp)
-            qp->mlx.m_targetRate = qp->m_rate;
-        qp->m_rate = std::max(m_minRate, qp->m_rate * (1 - qp->mlx.m_alpha / 2));
+            mlx.m_targetRate = qp->m_rate;
+        qp->m_rate = std::max(m_minRate, qp->m_rate * (1 - mlx.m_alpha / 2));
         // reset rate increase related things
-        qp->mlx.m_rpTimeStage = 0;
-        qp->mlx.m_decrease_cnp_arrived = false;
-        Simulator::Cancel(qp->mlx.m_rpTimer);
-        qp->mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, qp);
+        mlx.m_rpTimeStage = 0;
+        mlx.m_decrease_cnp_arrived = false;
+        Simulator::Cancel(mlx.m_rpTimer);
+        mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, qp);
         #if PRINT_LOG
-        printf("(%.3lf %.3lf)\n", qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+        printf("(%.3lf %.3lf)\n", mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
         #endif
     }
 }
 void RdmaHw::ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> qp, uint32_t delta){
-    qp->mlx.m_eventDecreaseRate = Simulator::Schedule(MicroSeconds(m_rateDecreaseInterval) + NanoSeconds(delta), &RdmaHw::CheckRateDecreaseMlx, this, qp);
+    qp->GetCc<RdmaQpMlx>().m_eventDecreaseRate = Simulator::Schedule(MicroSeconds(m_rateDecreaseInterval) + NanoSeconds(delta), &RdmaHw::CheckRateDecreaseMlx, this, qp);
 }
 
 void RdmaHw::RateIncEventTimerMlx(Ptr<RdmaQueuePair> qp){
-    qp->mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, qp);
+    RdmaQpMlx &mlx = qp->GetCc<RdmaQpMlx>();
+    mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, qp);
     RateIncEventMlx(qp);
-    qp->mlx.m_rpTimeStage++;
+    mlx.m_rpTimeStage++;
 }
 void RdmaHw::RateIncEventMlx(Ptr<RdmaQueuePair> qp){
+    RdmaQpMlx &mlx = qp->GetCc<RdmaQpMlx>();
     // check which increase phase: fast recovery, active increase, hyper increase
-    if (qp->mlx.m_rpTimeStage < m_rpgThreshold){ // fast recovery
+    if (mlx.m_rpTimeStage < m_rpgThreshold){ // fast recovery
         FastRecoveryMlx(qp);
-    }else if (qp->mlx.m_rpTimeStage == m_rpgThreshold){ // active increase
+    }else if (mlx.m_rpTimeStage == m_rpgThreshold){ // active increase
         ActiveIncreaseMlx(qp);
     }else { // hyper increase
         HyperIncreaseMlx(qp);
@@ -821,383 +1192,58 @@ void RdmaHw::RateIncEventMlx(Ptr<RdmaQueuePair> qp){
 }
 
 void RdmaHw::FastRecoveryMlx(Ptr<RdmaQueuePair> qp){
+    RdmaQpMlx &mlx = qp->GetCc<RdmaQpMlx>();
     #if PRINT_LOG
-    printf("%lu fast recovery: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    printf("%lu fast recovery: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
     #endif
-    qp->m_rate = (qp->m_rate / 2) + (qp->mlx.m_targetRate / 2);
+    qp->m_rate = (qp->m_rate / 2) + (mlx.m_targetRate / 2);
     #if PRINT_LOG
-    printf("(%.3lf %.3lf)\n", qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    printf("(%.3lf %.3lf)\n", mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
     #endif
 }
 void RdmaHw::ActiveIncreaseMlx(Ptr<RdmaQueuePair> qp){
+    RdmaQpMlx &mlx = qp->GetCc<RdmaQpMlx>();
     #if PRINT_LOG
-    printf("%lu active inc: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    printf("%lu active inc: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
     #endif
     // get NIC
     uint32_t nic_idx = GetNicIdxOfQp(qp);
     Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
     // increate rate
-    qp->mlx.m_targetRate += m_rai;
-    if (qp->mlx.m_targetRate > dev->GetDataRate())
-        qp->mlx.m_targetRate = dev->GetDataRate();
-    qp->m_rate = (qp->m_rate / 2) + (qp->mlx.m_targetRate / 2);
+    mlx.m_targetRate += m_rai;
+    if (mlx.m_targetRate > dev->GetDataRate())
+        mlx.m_targetRate = dev->GetDataRate();
+    qp->m_rate = (qp->m_rate / 2) + (mlx.m_targetRate / 2);
     #if PRINT_LOG
-    printf("(%.3lf %.3lf)\n", qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    printf("(%.3lf %.3lf)\n", mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
     #endif
 }
 void RdmaHw::HyperIncreaseMlx(Ptr<RdmaQueuePair> qp){
+    RdmaQpMlx &mlx = qp->GetCc<RdmaQpMlx>();
     #if PRINT_LOG
-    printf("%lu hyper inc: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    printf("%lu hyper inc: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
     #endif
     // get NIC
     uint32_t nic_idx = GetNicIdxOfQp(qp);
     Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
     // increate rate
-    qp->mlx.m_targetRate += m_rhai;
-    if (qp->mlx.m_targetRate > dev->GetDataRate())
-        qp->mlx.m_targetRate = dev->GetDataRate();
-    qp->m_rate = (qp->m_rate / 2) + (qp->mlx.m_targetRate / 2);
+    mlx.m_targetRate += m_rhai;
+    if (mlx.m_targetRate > dev->GetDataRate())
+        mlx.m_targetRate = dev->GetDataRate();
+    qp->m_rate = (qp->m_rate / 2) + (mlx.m_targetRate / 2);
     #if PRINT_LOG
-    printf("(%.3lf %.3lf)\n", qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    printf("(%.3lf %.3lf)\n", mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
     #endif
 }
 
 
-/***********************
- * My CC
- ***********************/
-void RdmaHw::HandleAckMycc(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
-    //可能是自身的ack数据包，也可能是同set主机的ack数据包
-    //如果是第一个窗口或者当前窗口和上一个窗口的大小未发生改变的情况，此时不考虑过度反应
-    if (qp->mycc.m_lastUpdateSeq == 0 || qp->mycc.m_currentWinSize == qp->mycc.m_lastWinSize ) {
-        // std::cout<<"current node:"<< m_node->GetId()<<" 1"<<std::endl;
-        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息
-            // std::cout<<"current node:"<< m_node->GetId()<<" 2"<<std::endl;
-            int maxDepthIndex = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.dinfo[i].depth >= ch.ack.ih.dinfo[maxDepthIndex].depth) {
-                    maxDepthIndex = i;
-                }
-            }
-            int64_t dDelta_time = Simulator::Now().GetTimeStep()%((1<<24)*100) - 100*ch.ack.ih.dinfo[maxDepthIndex].ts;
-            if (dDelta_time<0)
-            {
-                dDelta_time += (1<<24)*100;
-            }
-            uint64_t maxDepthTime = Simulator::Now().GetTimeStep() - dDelta_time;
-            if (dDelta_time < qp->mycc.m_congestTimeStamp || qp->mycc.m_congestTimeStamp == 0 ) {
-                // std::cout<<"node:"<<m_node->GetId()<<" depth:"<<ch.ack.ih.dinfo[maxDepthIndex].depth<<" ID"<<ch.ack.ih.dinfo[maxDepthIndex].iinfo.id<<std::endl;
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndex].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_time;
-                qp->mycc.m_dTs = Simulator::Now().GetTimeStep() - dDelta_time;
-                //qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndex].ts*100;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndex].maxRate;
-            }
-            
-        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息
-            int maxRadioIndex = 0;
-            // std::cout<<"current node:"<< m_node->GetId()<<" 5"<<std::endl;
-            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.rinfo[i].ratio >= ch.ack.ih.rinfo[maxRadioIndex].ratio) {
-                    maxRadioIndex = i;
-                }
-            }
-            // uint64_t rDelta_time = Simulator::Now().GetTimeStep() - ch.ack.ih.rinfo[maxRadioIndex].ts;
-            int64_t rDelta_time = Simulator::Now().GetTimeStep()%((1<<24)*100) - 100*ch.ack.ih.rinfo[maxRadioIndex].ts;;
-            if (rDelta_time<0)
-            {
-                rDelta_time += (1<<24)*100;
-            }
-            uint64_t maxRatioTime = Simulator::Now().GetTimeStep() - rDelta_time;
-            if ((rDelta_time < qp->mycc.m_idleTimeStamp || qp->mycc.m_idleTimeStamp == 0 )) {
-                // if (m_node->GetId()==4)
-                // {
-                //     std::cout<<"flags:"<<ch.ack.flags<<" ratio:"<<ch.ack.ih.rinfo[maxRadioIndex].ratio<<"   node:"<<ch.ack.ih.rinfo[maxRadioIndex].iinfo.id<<std::endl;
-                // }
-                
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndex].ratio;
-                qp->mycc.m_rTs = Simulator::Now().GetTimeStep()-rDelta_time;
-                qp->mycc.m_idleTimeStamp = rDelta_time;
-                //qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndex].ts*100;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndex].maxRate;
-
-            }
-        }
-    }else if(qp->mycc.m_currentWinSize < qp->mycc.m_lastWinSize ){//当前窗口的大小小于上一个窗口的大小，防止对同一个拥塞事件作出反应
-        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息,只选择同set主机且在窗口内发生拥塞的数据包做为判断
-            // std::cout<<"current node:"<< m_node->GetId()<<" 8"<<std::endl;
-            int maxDepthIndexOverReaction = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.dinfo[i].depth >= ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth) {
-                    maxDepthIndexOverReaction = i;
-                }
-            }
-            int64_t dDelta_overReactionTime = Simulator::Now().GetTimeStep()%((1<<24)*100) - 100*ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-
-            
-            
-            // int64_t dDelta_time = Simulator::Now().GetTimeStep()%((1<<24)*100) - 100*ch.ack.ih.dinfo[maxDepthIndex].ts;
-            if (dDelta_overReactionTime<0)
-            {
-                dDelta_overReactionTime += (1<<24)*100;
-            }
-            uint64_t maxDepthTime = Simulator::Now().GetTimeStep() - dDelta_overReactionTime;
-
-            if (ch.ack.flags == 1 && 
-            (dDelta_overReactionTime < qp->mycc.m_congestTimeStamp || qp->mycc.m_congestTimeStamp == 0)&& 
-             maxDepthTime > qp->mycc.m_lastUpdateTime + qp->m_baseRtt/3)   
-            {
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_overReactionTime;
-                qp->mycc.m_dTs = maxDepthTime;
-                //qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts*100;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
-
-            }
-        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息，只选择
-            int maxRadioIndexOverReaction = 0;
-            // std::cout<<"current node:"<< m_node->GetId()<<" 11"<<std::endl;
-            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.rinfo[i].ratio >= ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio) {
-                    maxRadioIndexOverReaction = i;
-                }
-            }
-            int64_t rDelta_overReactionTime = Simulator::Now().GetTimeStep()%((1<<24)*100) - 100*ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-            if (rDelta_overReactionTime<0)
-            {
-                rDelta_overReactionTime += (1<<24)*100;
-            }
-            uint64_t maxRatioTime = Simulator::Now().GetTimeStep() - rDelta_overReactionTime;
-
-            if ((rDelta_overReactionTime < qp->mycc.m_idleTimeStamp || qp->mycc.m_idleTimeStamp == 0) && 
-                maxRatioTime > qp->mycc.m_lastUpdateCongestTime
-             
-            // ((ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts*100 > qp->mycc.m_lastUpdateCongestTime) && 
-            // (ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts*100 - qp->mycc.m_lastUpdateCongestTime < qp->m_baseRtt*2))||
-            // ((ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts*100 < qp->mycc.m_lastUpdateCongestTime)&&
-            // (qp->mycc.m_lastUpdateCongestTime - ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts*100 > qp->m_baseRtt))  
-
-            ) 
-            {
-                // std::cout<<"12"<<std::endl;
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
-                qp->mycc.m_idleTimeStamp = rDelta_overReactionTime;
-                qp->mycc.m_rTs = maxRatioTime;
-                //qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts*100;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
-                
-            }
-
-        }
-    }else{//当前窗口的大小大于上一个窗口的大小，防止对同一个空闲事件作出反应
-        // std::cout<<"14"<<std::endl;
-        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息
-            int maxDepthIndexOverReaction = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.dinfo[i].depth >= ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth) {
-                    maxDepthIndexOverReaction = i;
-                }
-            }
-            // uint64_t dDelta_overReactionTime = Simulator::Now().GetTimeStep() - ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-            int64_t dDelta_overReactionTime = Simulator::Now().GetTimeStep()%((1<<24)*100) - 100*ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-            if (dDelta_overReactionTime<0)
-            {
-                dDelta_overReactionTime += (1<<24)*100;
-            }
-            uint64_t maxDepthTime = Simulator::Now().GetTimeStep() - dDelta_overReactionTime;
-            if ((dDelta_overReactionTime < qp->mycc.m_congestTimeStamp || 
-            qp->mycc.m_congestTimeStamp == 0) && 
-            maxDepthTime >  qp->mycc.m_lastUpdateIdleTime
-            // ((ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts*100 > qp->mycc.m_lastUpdateIdleTime) &&
-            // (ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts*100 - qp->mycc.m_lastUpdateIdleTime < qp->m_baseRtt))||
-            // ((ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts*100 < qp->mycc.m_lastUpdateIdleTime) &&
-            // (qp->mycc.m_lastUpdateIdleTime - ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts*100 > qp->m_baseRtt))
-            ) 
-            {//
-                // std::cout<<"15"<<std::endl;
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_overReactionTime;
-                qp->mycc.m_dTs = maxDepthTime;
-                //qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts*100;
-//                qp->mycc.m_dIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
-
-            }
-        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息
-            // std::cout<<"17"<<std::endl;
-            int maxRadioIndexOverReaction = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.rinfo[i].ratio >= ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio) {
-                    maxRadioIndexOverReaction = i;
-                }
-            }
-            // uint64_t rDelta_overReactionTime = Simulator::Now().GetTimeStep() - ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-            int64_t rDelta_overReactionTime = Simulator::Now().GetTimeStep()%((1<<24)*100) - 100*ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-            if (rDelta_overReactionTime<0)
-            {
-                rDelta_overReactionTime += (1<<24)*100;
-            }
-
-            uint64_t maxRatioTime = Simulator::Now().GetTimeStep()-rDelta_overReactionTime;
-
-            if (ch.ack.flags == 1 && 
-            (rDelta_overReactionTime < qp->mycc.m_idleTimeStamp || qp->mycc.m_idleTimeStamp == 0) && 
-            maxRatioTime > qp->mycc.m_lastUpdateTime+qp->m_baseRtt/3 )  
-            {
-                // std::cout<<"18"<<std::endl;
-                
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
-                qp->mycc.m_idleTimeStamp = rDelta_overReactionTime;
-                qp->mycc.m_rTs = maxRatioTime;
-                //qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts*100;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
-
-            }
-
-        }
-    }
-    
-    if (ch.ack.flags == 0) {//自身的数据包并且一个完整的RTT窗口之后，更新发送速率
-        // std::cout<<"current depth:"<<qp->mycc.m_depth<<std::endl;
-        // std::cout<<"current ratio:"<<qp->mycc.m_ratio<<std::endl;
-
-        DataRate new_rate;
-        uint32_t ack_seq = ch.ack.seq;
-        uint32_t next_seq = qp->snd_nxt;//snd_nxt为下一个发送的位置，它指向未发送但可以发送的第一个字节的序列号。
-        if (ack_seq > qp->mycc.m_lastUpdateSeq && qp->mycc.m_lastUpdateSeq != 0) { //一个完整RTT的窗口，此时更新发送速率
-        // std::cout<<"current node:"<< m_node->GetId()<<" one window"<<std::endl;
-        // std::cout<<"current node:"<< m_node->GetId()<<" m_dTs:"<<qp->mycc.m_dTs<<" m_rTs:"<<qp->mycc.m_rTs<<std::endl;
-            //todo:计算速率
-            // if (m_node->GetId() == 5)
-            // {
-            //     std::cout<<"current_node:"<< m_node->GetId()<<" currentTime:"<< Simulator::Now().GetTimeStep()<<std::endl;
-            // }
-            // exit(0);
-            
-            if ((qp->mycc.m_dTs != 0 || qp->mycc.m_rTs != 0) && qp->mycc.m_dTs > qp->mycc.m_rTs ) {//在一个窗口内拥塞事件最后发生
-                // std::cout<<"current node:"<< m_node->GetId()<<" decrease rate"<<std::endl;
-                qp->mycc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
-                qp->mycc.m_lastUpdateSeq = next_seq;
-                //1std::cout<<"next_seq:"<<next_seq<<std::endl;
-                qp->mycc.m_lastWinSize = qp->mycc.m_currentWinSize;
-                qp->mycc.m_lastUpdateCongestTime = qp->mycc.m_dTs;
-
-                //1std::cout<<"next_seq:"<<next_seq<<std::endl;
-                // xiugai
-                double alpha = (qp->mycc.m_depth/(double)(qp->mycc.m_depth + (10 * qp->m_baseRtt)/8));
-                
-                // std::cout<<"qp->mycc.m_depth:"<<qp->mycc.m_depth<<" qp->mycc.m_max_dRate:"<<qp->mycc.m_max_dRate<<" qp->m_baseRtt:"<<qp->m_baseRtt<<std::endl;
-                qp->mycc.m_currentWinSize = qp->mycc.m_currentWinSize * (1-alpha);
-                new_rate = qp->m_rate * (1-alpha);
-                
-                //更新速率
-                if (new_rate < m_minRate/1000)
-                    new_rate = m_minRate/1000;
-                if (new_rate > qp->m_max_rate)
-                    new_rate = qp->m_max_rate;
-                qp->m_rate = new_rate;
-                // ChangeRate(qp, new_rate);
-                //1std::cout<<"***************alpha***********************:"<<alpha<<std::endl;
-                // std::cout<<"current_node:"<< m_node->GetId() << " congestTimeStamp:"<< qp->mycc.m_congestTimeStamp <<std::endl;
-                std::cout<<"current_time:"<<Simulator::Now().GetTimeStep()<<" current_node:"<< m_node->GetId() << " congestion"<<" current_rate:" <<  qp->m_rate <<"   depth:"<<qp->mycc.m_depth<<" baseRtt:"<<qp->m_baseRtt<<" alpha:"<<alpha<<" current_windows:"<<qp->mycc.m_currentWinSize<<std::endl;
-                //重置下面的变量
-                qp->mycc.m_congestTimeStamp = 0;
-                qp->mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-//                    qp->mycc.m_dIsOwn = 3;
-//                    qp->mycc.m_rIsOwn = 3;
-                qp->mycc.m_depth = 0;
-                qp->mycc.m_ratio = 10000;
-                qp->mycc.m_dTs = 0;//发生拥塞时的时间
-                qp->mycc.m_rTs = 0;
-
-
-                
-            }else if((qp->mycc.m_dTs != 0 || qp->mycc.m_rTs != 0) && qp->mycc.m_dTs < qp->mycc.m_rTs && qp->mycc.m_ratio != 10000){//在一个窗口内空闲事件最后发生
-                // std::cout<<"current node:"<< m_node->GetId()<<" increase rate"<<std::endl;
-                qp->mycc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
-                qp->mycc.m_lastUpdateSeq = next_seq;
-                qp->mycc.m_lastWinSize = qp->mycc.m_currentWinSize;
-                qp->mycc.m_lastUpdateIdleTime = qp->mycc.m_rTs;
-                if (qp->mycc.m_ratio!=0)
-                {
-                    // std::cout<<"m_rai:"<<m_rai.GetBitRate()<<"m_rai's BDP:"<<m_rai.GetBitRate()*qp->m_baseRtt/1000000000<<std::endl;
-                    qp->mycc.m_currentWinSize = 0.95*(double)qp->mycc.m_currentWinSize/((double)qp->mycc.m_ratio/10000)+m_rai.GetBitRate()*qp->m_baseRtt/100000000;
-                    new_rate = 0.95*qp->m_rate/((double)qp->mycc.m_ratio/10000)+m_rai.GetBitRate()*1.6;
-                    // new_rate = qp->mycc.m_currentWinSize / qp->m_baseRtt;
-                    if (new_rate < m_minRate/1000)
-                        new_rate = m_minRate/1000;
-                    if (new_rate > qp->m_max_rate)
-                        new_rate = qp->m_max_rate;
-                    // ChangeRate(qp, new_rate);
-                    qp->m_rate = new_rate;
-                    std::cout<<"current_time:"<<Simulator::Now().GetTimeStep()<<" current_node:"<< m_node->GetId() <<" idle"<<" current_rate:" << qp->m_rate<<" ratio:"<<qp->mycc.m_ratio<<" current_windows:"<<qp->mycc.m_currentWinSize<<std::endl;
-                                    // qp->m_rate = new_rate;
-                    
-                }
-                //重置下面的变量
-                    qp->mycc.m_congestTimeStamp = 0;
-                    qp->mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-    //                    qp->mycc.m_dIsOwn = 3;
-    //                    qp->mycc.m_rIsOwn = 3;
-                    qp->mycc.m_depth = 0;
-                    qp->mycc.m_ratio = 10000;
-                    qp->mycc.m_dTs = 0;//发生拥塞时的时间
-                    qp->mycc.m_rTs = 0;
-                
-                
-
-                
-
-            }else{
-                // std::cout<<"current node:"<< m_node->GetId()<<" unchanged rate"<<std::endl;
-                qp->mycc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
-                qp->mycc.m_lastUpdateSeq = next_seq;
-                qp->mycc.m_lastWinSize = qp->mycc.m_currentWinSize;
-                // qp->mycc.m_lastUpdateCongestTime = qp->mycc.m_dTs;
-                std::cout<<"current_time:"<<Simulator::Now().GetTimeStep()<<" current_node:"<< m_node->GetId() <<" normal"<<" current_rate:" << qp->m_rate<<" ratio:"<<qp->mycc.m_ratio<<"  qp->mycc.m_depth:"<<qp->mycc.m_depth <<" current_windows:"<<qp->mycc.m_currentWinSize<<std::endl;
-                qp->mycc.m_congestTimeStamp = 0;
-                qp->mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-//                    qp->mycc.m_dIsOwn = 3;
-//                    qp->mycc.m_rIsOwn = 3;
-                qp->mycc.m_depth = 0;
-                qp->mycc.m_ratio = 10000;
-                qp->mycc.m_dTs = 0;//发生拥塞时的时间
-                qp->mycc.m_rTs = 0;
-            }
-        }else if (qp->mycc.m_lastUpdateSeq == 0){
-            qp->mycc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
-            qp->mycc.m_lastUpdateSeq = next_seq;
-            qp->mycc.m_lastWinSize = qp->mycc.m_currentWinSize;
-            // qp->mycc.m_lastUpdateCongestTime = qp->mycc.m_dTs;
-            std::cout<<"current_time:"<<Simulator::Now().GetTimeStep()<<" current_node:"<< m_node->GetId() <<"    first_rtt_window"<< "  ack_sip:" << ch.sip << "    ack_dip:" << ch.dip<< "  ch-ack-flag:"<< ch.ack.flags<<" current_rate:" << qp->m_rate<<" ratio:"<<qp->mycc.m_ratio<<"  qp->mycc.m_depth:"<<qp->mycc.m_depth <<" current_windows:"<<qp->mycc.m_currentWinSize<<std::endl;
-            qp->mycc.m_congestTimeStamp = 0;
-            qp->mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-//                    qp->mycc.m_dIsOwn = 3;
-//                    qp->mycc.m_rIsOwn = 3;
-            qp->mycc.m_depth = 0;
-            qp->mycc.m_ratio = 10000;
-            qp->mycc.m_dTs = 0;//发生拥塞时的时间
-            qp->mycc.m_rTs = 0;
-    }
-    }
-    //1std::cout<< "node:" << m_node->GetId()<<"change windowsSIZE:"<<qp->mycc.m_currentWinSize<<std::endl;
-}
-
-
-
-
-
-
 /***********************
  * High Precision CC
  ***********************/
 void RdmaHw::HandleAckHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
     uint32_t ack_seq = ch.ack.seq;
     // update rate
-    if (ack_seq > qp->hp.m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
+    if (ack_seq > qp->GetCc<RdmaQpHp>().m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
         UpdateRateHp(qp, p, ch, false);
     }else{ // do fast react
         FastReactHp(qp, p, ch);
@@ -1207,16 +1253,16 @@ void RdmaHw::HandleAckHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch)
 void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool fast_react){
     uint32_t next_seq = qp->snd_nxt;
     bool print = !fast_react || true;
-    if (qp->hp.m_lastUpdateSeq == 0){ // first RTT
-        qp->hp.m_lastUpdateSeq = next_seq;
+    if (qp->GetCc<RdmaQpHp>().m_lastUpdateSeq == 0){ // first RTT
+        qp->GetCc<RdmaQpHp>().m_lastUpdateSeq = next_seq;
         // store INT
         IntHeader &ih = ch.ack.ih;
         NS_ASSERT(ih.nhop <= IntHeader::maxHop);
         for (uint32_t i = 0; i < ih.nhop; i++)
-            qp->hp.hop[i] = ih.hop[i];
+            qp->GetCc<RdmaQpHp>().hop[i] = ih.hop[i];
         #if PRINT_LOG
         if (print){
-            printf("%lu %s %08x %08x %u %u [%u,%u,%u]", Simulator::Now().GetTimeStep(), fast_react? "fast" : "update", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->hp.m_lastUpdateSeq, ch.ack.seq, next_seq);
+            printf("%lu %s %08x %08x %u %u [%u,%u,%u]", Simulator::Now().GetTimeStep(), fast_react? "fast" : "update", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->GetCc<RdmaQpHp>().m_lastUpdateSeq, ch.ack.seq, next_seq);
             for (uint32_t i = 0; i < ih.nhop; i++)
                 printf(" %u %lu %lu", ih.hop[i].GetQlen(), ih.hop[i].GetBytes(), ih.hop[i].GetTime());
             printf("\n");
@@ -1230,7 +1276,7 @@ void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch
             bool inStable = false;
             #if PRINT_LOG
             if (print)
-                printf("%lu %s %08x %08x %u %u [%u,%u,%u]", Simulator::Now().GetTimeStep(), fast_react? "fast" : "update", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->hp.m_lastUpdateSeq, ch.ack.seq, next_seq);
+                printf("%lu %s %08x %08x %u %u [%u,%u,%u]", Simulator::Now().GetTimeStep(), fast_react? "fast" : "update", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->GetCc<RdmaQpHp>().m_lastUpdateSeq, ch.ack.seq, next_seq);
             #endif
             // check each hop
             double U = 0;
@@ -1245,12 +1291,12 @@ void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch
                 updated[i] = updated_any = true;
                 #if PRINT_LOG
                 if (print)
-                    printf(" %u(%u) %lu(%lu) %lu(%lu)", ih.hop[i].GetQlen(), qp->hp.hop[i].GetQlen(), ih.hop[i].GetBytes(), qp->hp.hop[i].GetBytes(), ih.hop[i].GetTime(), qp->hp.hop[i].GetTime());
+                    printf(" %u(%u) %lu(%lu) %lu(%lu)", ih.hop[i].GetQlen(), qp->GetCc<RdmaQpHp>().hop[i].GetQlen(), ih.hop[i].GetBytes(), qp->GetCc<RdmaQpHp>().hop[i].GetBytes(), ih.hop[i].GetTime(), qp->GetCc<RdmaQpHp>().hop[i].GetTime());
                 #endif
-                uint64_t tau = ih.hop[i].GetTimeDelta(qp->hp.hop[i]);;
+                uint64_t tau = ih.hop[i].GetTimeDelta(qp->GetCc<RdmaQpHp>().hop[i]);;
                 double duration = tau * 1e-9;
-                double txRate = (ih.hop[i].GetBytesDelta(qp->hp.hop[i])) * 8 / duration;
-                double u = txRate / ih.hop[i].GetLineRate() + (double)std::min(ih.hop[i].GetQlen(), qp->hp.hop[i].GetQlen()) * qp->m_max_rate.GetBitRate() / ih.hop[i].GetLineRate() /qp->m_win;//获取的是该窗口内收到的队列长度最小
+                double txRate = (ih.hop[i].GetBytesDelta(qp->GetCc<RdmaQpHp>().hop[i])) * 8 / duration;
+                double u = txRate / ih.hop[i].GetLineRate() + (double)std::min(ih.hop[i].GetQlen(), qp->GetCc<RdmaQpHp>().hop[i].GetQlen()) * qp->m_max_rate.GetBitRate() / ih.hop[i].GetLineRate() /qp->m_win;//获取的是该窗口内收到的队列长度最小
                 #if PRINT_LOG
                 if (print)
                     printf(" %.3lf %.3lf", txRate, u);
@@ -1265,9 +1311,9 @@ void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch
                     // for per hop (per hop R)
                     if (tau > qp->m_baseRtt)
                         tau = qp->m_baseRtt;
-                    qp->hp.hopState[i].u = (qp->hp.hopState[i].u * (qp->m_baseRtt - tau) + u * tau) / double(qp->m_baseRtt);
+                    qp->GetCc<RdmaQpHp>().hopState[i].u = (qp->GetCc<RdmaQpHp>().hopState[i].u * (qp->m_baseRtt - tau) + u * tau) / double(qp->m_baseRtt);
                 }
-                qp->hp.hop[i] = ih.hop[i];
+                qp->GetCc<RdmaQpHp>().hop[i] = ih.hop[i];
             }
 
             DataRate new_rate;
@@ -1279,15 +1325,15 @@ void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch
                 if (updated_any){
                     if (dt > qp->m_baseRtt)
                         dt = qp->m_baseRtt;
-                    qp->hp.u = (qp->hp.u * (qp->m_baseRtt - dt) + U * dt) / double(qp->m_baseRtt);
-                    max_c = qp->hp.u / m_targetUtil;
+                    qp->GetCc<RdmaQpHp>().u = (qp->GetCc<RdmaQpHp>().u * (qp->m_baseRtt - dt) + U * dt) / double(qp->m_baseRtt);
+                    max_c = qp->GetCc<RdmaQpHp>().u / m_targetUtil;
 
-                    if (max_c >= 1 || qp->hp.m_incStage >= m_miThresh){
-                        new_rate = qp->hp.m_curRate / max_c + m_rai;
+                    if (max_c >= 1 || qp->GetCc<RdmaQpHp>().m_incStage >= m_miThresh){
+                        new_rate = qp->GetCc<RdmaQpHp>().m_curRate / max_c + m_rai;
                         new_incStage = 0;
                     }else{
-                        new_rate = qp->hp.m_curRate + m_rai;
-                        new_incStage = qp->hp.m_incStage+1;
+                        new_rate = qp->GetCc<RdmaQpHp>().m_curRate + m_rai;
+                        new_incStage = qp->GetCc<RdmaQpHp>().m_incStage+1;
                     }
                     if (new_rate < m_minRate)
                         new_rate = m_minRate;
@@ -1295,11 +1341,11 @@ void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch
                         new_rate = qp->m_max_rate;
                     #if PRINT_LOG
                     if (print)
-                        printf(" u=%.6lf U=%.3lf dt=%u max_c=%.3lf", qp->hp.u, U, dt, max_c);
+                        printf(" u=%.6lf U=%.3lf dt=%u max_c=%.3lf", qp->GetCc<RdmaQpHp>().u, U, dt, max_c);
                     #endif
                     #if PRINT_LOG
                     if (print)
-                        printf(" rate:%.3lf->%.3lf\n", qp->hp.m_curRate.GetBitRate()*1e-9, new_rate.GetBitRate()*1e-9);
+                        printf(" rate:%.3lf->%.3lf\n", qp->GetCc<RdmaQpHp>().m_curRate.GetBitRate()*1e-9, new_rate.GetBitRate()*1e-9);
                     #endif
                 }
             }else{
@@ -1307,13 +1353,13 @@ void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch
                 new_rate = qp->m_max_rate;
                 for (uint32_t i = 0; i < ih.nhop; i++){
                     if (updated[i]){
-                        double c = qp->hp.hopState[i].u / m_targetUtil;
-                        if (c >= 1 || qp->hp.hopState[i].incStage >= m_miThresh){
-                            new_rate_per_hop[i] = qp->hp.hopState[i].Rc / c + m_rai;
+                        double c = qp->GetCc<RdmaQpHp>().hopState[i].u / m_targetUtil;
+                        if (c >= 1 || qp->GetCc<RdmaQpHp>().hopState[i].incStage >= m_miThresh){
+                            new_rate_per_hop[i] = qp->GetCc<RdmaQpHp>().hopState[i].Rc / c + m_rai;
                             new_incStage_per_hop[i] = 0;
                         }else{
-                            new_rate_per_hop[i] = qp->hp.hopState[i].Rc + m_rai;
-                            new_incStage_per_hop[i] = qp->hp.hopState[i].incStage+1;
+                            new_rate_per_hop[i] = qp->GetCc<RdmaQpHp>().hopState[i].Rc + m_rai;
+                            new_incStage_per_hop[i] = qp->GetCc<RdmaQpHp>().hopState[i].incStage+1;
                         }
                         // bound rate
                         if (new_rate_per_hop[i] < m_minRate)
@@ -1325,15 +1371,15 @@ void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch
                             new_rate = new_rate_per_hop[i];
                         #if PRINT_LOG
                         if (print)
-                            printf(" [%u]u=%.6lf c=%.3lf", i, qp->hp.hopState[i].u, c);
+                            printf(" [%u]u=%.6lf c=%.3lf", i, qp->GetCc<RdmaQpHp>().hopState[i].u, c);
                         #endif
                         #if PRINT_LOG
                         if (print)
-                            printf(" %.3lf->%.3lf", qp->hp.hopState[i].Rc.GetBitRate()*1e-9, new_rate.GetBitRate()*1e-9);
+                            printf(" %.3lf->%.3lf", qp->GetCc<RdmaQpHp>().hopState[i].Rc.GetBitRate()*1e-9, new_rate.GetBitRate()*1e-9);
                         #endif
                     }else{
-                        if (qp->hp.hopState[i].Rc < new_rate)
-                            new_rate = qp->hp.hopState[i].Rc;
+                        if (qp->GetCc<RdmaQpHp>().hopState[i].Rc < new_rate)
+                            new_rate = qp->GetCc<RdmaQpHp>().hopState[i].Rc;
                     }
                 }
                 #if PRINT_LOG
@@ -1344,23 +1390,23 @@ void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch
                 ChangeRate(qp, new_rate);
             if (!fast_react){
                 if (updated_any){
-                    qp->hp.m_curRate = new_rate;
-                    qp->hp.m_incStage = new_incStage;
+                    qp->GetCc<RdmaQpHp>().m_curRate = new_rate;
+                    qp->GetCc<RdmaQpHp>().m_incStage = new_incStage;
                 }
                 if (m_multipleRate){
                     // for per hop (per hop R)
                     for (uint32_t i = 0; i < ih.nhop; i++){
                         if (updated[i]){
-                            qp->hp.hopState[i].Rc = new_rate_per_hop[i];
-                            qp->hp.hopState[i].incStage = new_incStage_per_hop[i];
+                            qp->GetCc<RdmaQpHp>().hopState[i].Rc = new_rate_per_hop[i];
+                            qp->GetCc<RdmaQpHp>().hopState[i].incStage = new_incStage_per_hop[i];
                         }
                     }
                 }
             }
         }
         if (!fast_react){
-            if (next_seq > qp->hp.m_lastUpdateSeq)
-                qp->hp.m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
+            if (next_seq > qp->GetCc<RdmaQpHp>().m_lastUpdateSeq)
+                qp->GetCc<RdmaQpHp>().m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
         }
     }
 }
@@ -1376,7 +1422,7 @@ void RdmaHw::FastReactHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch)
 void RdmaHw::HandleAckTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
     uint32_t ack_seq = ch.ack.seq;
     // update rate
-    if (ack_seq > qp->tmly.m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
+    if (ack_seq > qp->GetCc<RdmaQpTimely>().m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
         UpdateRateTimely(qp, p, ch, false);
     }else{ // do fast react
         FastReactTimely(qp, p, ch);
@@ -1386,15 +1432,15 @@ void RdmaHw::UpdateRateTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader
     uint32_t next_seq = qp->snd_nxt;
     uint64_t rtt = Simulator::Now().GetTimeStep() - ch.ack.ih.ts;
     bool print = !us;
-    if (qp->tmly.m_lastUpdateSeq != 0){ // not first RTT
-        int64_t new_rtt_diff = (int64_t)rtt - (int64_t)qp->tmly.lastRtt;
-        double rtt_diff = (1 - m_tmly_alpha) * qp->tmly.rttDiff + m_tmly_alpha * new_rtt_diff;
+    if (qp->GetCc<RdmaQpTimely>().m_lastUpdateSeq != 0){ // not first RTT
+        int64_t new_rtt_diff = (int64_t)rtt - (int64_t)qp->GetCc<RdmaQpTimely>().lastRtt;
+        double rtt_diff = (1 - m_tmly_alpha) * qp->GetCc<RdmaQpTimely>().rttDiff + m_tmly_alpha * new_rtt_diff;
         double gradient = rtt_diff / m_tmly_minRtt;
         bool inc = false;
         double c = 0;
         #if PRINT_LOG
         if (print)
-            printf("%lu node:%u rtt:%lu rttDiff:%.0lf gradient:%.3lf rate:%.3lf", Simulator::Now().GetTimeStep(), m_node->GetId(), rtt, rtt_diff, gradient, qp->tmly.m_curRate.GetBitRate() * 1e-9);
+            printf("%lu node:%u rtt:%lu rttDiff:%.0lf gradient:%.3lf rate:%.3lf", Simulator::Now().GetTimeStep(), m_node->GetId(), rtt, rtt_diff, gradient, qp->GetCc<RdmaQpTimely>().m_curRate.GetBitRate() * 1e-9);
         #endif
         if (rtt < m_tmly_TLow){
             inc = true;
@@ -1410,24 +1456,24 @@ void RdmaHw::UpdateRateTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader
             inc = false;
         }
         if (inc){
-            if (qp->tmly.m_incStage < 5){
-                qp->m_rate = qp->tmly.m_curRate + m_rai;
+            if (qp->GetCc<RdmaQpTimely>().m_incStage < 5){
+                qp->m_rate = qp->GetCc<RdmaQpTimely>().m_curRate + m_rai;
             }else{
-                qp->m_rate = qp->tmly.m_curRate + m_rhai;
+                qp->m_rate = qp->GetCc<RdmaQpTimely>().m_curRate + m_rhai;
             }
             if (qp->m_rate > qp->m_max_rate)
                 qp->m_rate = qp->m_max_rate;
             if (!us){
-                qp->tmly.m_curRate = qp->m_rate;
-                qp->tmly.m_incStage++;
-                qp->tmly.rttDiff = rtt_diff;
+                qp->GetCc<RdmaQpTimely>().m_curRate = qp->m_rate;
+                qp->GetCc<RdmaQpTimely>().m_incStage++;
+                qp->GetCc<RdmaQpTimely>().rttDiff = rtt_diff;
             }
         }else{
-            qp->m_rate = std::max(m_minRate, qp->tmly.m_curRate * c);
+            qp->m_rate = std::max(m_minRate, qp->GetCc<RdmaQpTimely>().m_curRate * c);
             if (!us){
-                qp->tmly.m_curRate = qp->m_rate;
-                qp->tmly.m_incStage = 0;
-                qp->tmly.rttDiff = rtt_diff;
+                qp->GetCc<RdmaQpTimely>().m_curRate = qp->m_rate;
+                qp->GetCc<RdmaQpTimely>().m_incStage = 0;
+                qp->GetCc<RdmaQpTimely>().rttDiff = rtt_diff;
             }
         }
         #if PRINT_LOG
@@ -1436,10 +1482,10 @@ void RdmaHw::UpdateRateTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader
         }
         #endif
     }
-    if (!us && next_seq > qp->tmly.m_lastUpdateSeq){
-        qp->tmly.m_lastUpdateSeq = next_seq;
+    if (!us && next_seq > qp->GetCc<RdmaQpTimely>().m_lastUpdateSeq){
+        qp->GetCc<RdmaQpTimely>().m_lastUpdateSeq = next_seq;
         // update
-        qp->tmly.lastRtt = rtt;
+        qp->GetCc<RdmaQpTimely>().lastRtt = rtt;
     }
 }
 void RdmaHw::FastReactTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
@@ -1454,23 +1500,23 @@ void RdmaHw::HandleAckDctcp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &
     bool new_batch = false;
 
     // update alpha
-    qp->dctcp.m_ecnCnt += (cnp > 0);
-    if (ack_seq > qp->dctcp.m_lastUpdateSeq){ // if full RTT feedback is ready, do alpha update
+    qp->GetCc<RdmaQpDctcp>().m_ecnCnt += (cnp > 0);
+    if (ack_seq > qp->GetCc<RdmaQpDctcp>().m_lastUpdateSeq){ // if full RTT feedback is ready, do alpha update
         #if PRINT_LOG
-        printf("%lu %s %08x %08x %u %u [%u,%u,%u] %.3lf->", Simulator::Now().GetTimeStep(), "alpha", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->dctcp.m_lastUpdateSeq, ch.ack.seq, qp->snd_nxt, qp->dctcp.m_alpha);
+        printf("%lu %s %08x %08x %u %u [%u,%u,%u] %.3lf->", Simulator::Now().GetTimeStep(), "alpha", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->GetCc<RdmaQpDctcp>().m_lastUpdateSeq, ch.ack.seq, qp->snd_nxt, qp->GetCc<RdmaQpDctcp>().m_alpha);
         #endif
         new_batch = true;
-        if (qp->dctcp.m_lastUpdateSeq == 0){ // first RTT
-            qp->dctcp.m_lastUpdateSeq = qp->snd_nxt;
-            qp->dctcp.m_batchSizeOfAlpha = qp->snd_nxt / m_mtu + 1;
+        if (qp->GetCc<RdmaQpDctcp>().m_lastUpdateSeq == 0){ // first RTT
+            qp->GetCc<RdmaQpDctcp>().m_lastUpdateSeq = qp->snd_nxt;
+            qp->GetCc<RdmaQpDctcp>().m_batchSizeOfAlpha = qp->snd_nxt / m_mtu + 1;
         }else {
-            double frac = std::min(1.0, double(qp->dctcp.m_ecnCnt) / qp->dctcp.m_batchSizeOfAlpha);
-            qp->dctcp.m_alpha = (1 - m_g) * qp->dctcp.m_alpha + m_g * frac;
-            qp->dctcp.m_lastUpdateSeq = qp->snd_nxt;
-            qp->dctcp.m_ecnCnt = 0;
-            qp->dctcp.m_batchSizeOfAlpha = (qp->snd_nxt - ack_seq) / m_mtu + 1;
+            double frac = std::min(1.0, double(qp->GetCc<RdmaQpDctcp>().m_ecnCnt) / qp->GetCc<RdmaQpDctcp>().m_batchSizeOfAlpha);
+            qp->GetCc<RdmaQpDctcp>().m_alpha = (1 - m_g) * qp->GetCc<RdmaQpDctcp>().m_alpha + m_g * frac;
+            qp->GetCc<RdmaQpDctcp>().m_lastUpdateSeq = qp->snd_nxt;
+            qp->GetCc<RdmaQpDctcp>().m_ecnCnt = 0;
+            qp->GetCc<RdmaQpDctcp>().m_batchSizeOfAlpha = (qp->snd_nxt - ack_seq) / m_mtu + 1;
             #if PRINT_LOG
-            printf("%.3lf F:%.3lf", qp->dctcp.m_alpha, frac);
+            printf("%.3lf F:%.3lf", qp->GetCc<RdmaQpDctcp>().m_alpha, frac);
             #endif
         }
         #if PRINT_LOG
@@ -1479,26 +1525,26 @@ void RdmaHw::HandleAckDctcp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &
     }
 
     // check cwr exit
-    if (qp->dctcp.m_caState == 1){
-        if (ack_seq > qp->dctcp.m_highSeq)
-            qp->dctcp.m_caState = 0;
+    if (qp->GetCc<RdmaQpDctcp>().m_caState == 1){
+        if (ack_seq > qp->GetCc<RdmaQpDctcp>().m_highSeq)
+            qp->GetCc<RdmaQpDctcp>().m_caState = 0;
     }
 
     // check if need to reduce rate: ECN and not in CWR
-    if (cnp && qp->dctcp.m_caState == 0){
+    if (cnp && qp->GetCc<RdmaQpDctcp>().m_caState == 0){
         #if PRINT_LOG
         printf("%lu %s %08x %08x %u %u %.3lf->", Simulator::Now().GetTimeStep(), "rate", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->m_rate.GetBitRate()*1e-9);
         #endif
-        qp->m_rate = std::max(m_minRate, qp->m_rate * (1 - qp->dctcp.m_alpha / 2));
+        qp->m_rate = std::max(m_minRate, qp->m_rate * (1 - qp->GetCc<RdmaQpDctcp>().m_alpha / 2));
         #if PRINT_LOG
         printf("%.3lf\n", qp->m_rate.GetBitRate() * 1e-9);
         #endif
-        qp->dctcp.m_caState = 1;
-        qp->dctcp.m_highSeq = qp->snd_nxt;
+        qp->GetCc<RdmaQpDctcp>().m_caState = 1;
+        qp->GetCc<RdmaQpDctcp>().m_highSeq = qp->snd_nxt;
     }
 
     // additive inc
-    if (qp->dctcp.m_caState == 0 && new_batch)
+    if (qp->GetCc<RdmaQpDctcp>().m_caState == 0 && new_batch)
         qp->m_rate = std::min(qp->m_max_rate, qp->m_rate + m_dctcp_rai);
 }
 
@@ -1510,10 +1556,10 @@ void RdmaHw::SetPintSmplThresh(double p){
 }
 void RdmaHw::HandleAckHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
        uint32_t ack_seq = ch.ack.seq;
-       if (rand() % 65536 >= pint_smpl_thresh)
+       if (ThreadRand::Next() % 65536 >= pint_smpl_thresh)
                return;
        // update rate
-       if (ack_seq > qp->hpccPint.m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
+       if (ack_seq > qp->GetCc<RdmaQpHpPint>().m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
                UpdateRateHpPint(qp, p, ch, false);
        }else{ // do fast react
                UpdateRateHpPint(qp, p, ch, true);
@@ -1522,8 +1568,8 @@ void RdmaHw::HandleAckHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader
 
 void RdmaHw::UpdateRateHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool fast_react){
        uint32_t next_seq = qp->snd_nxt;
-       if (qp->hpccPint.m_lastUpdateSeq == 0){ // first RTT
-               qp->hpccPint.m_lastUpdateSeq = next_seq;
+       if (qp->GetCc<RdmaQpHpPint>().m_lastUpdateSeq == 0){ // first RTT
+               qp->GetCc<RdmaQpHpPint>().m_lastUpdateSeq = next_seq;
        }else {
                // check packet INT
                IntHeader &ih = ch.ack.ih;
@@ -1533,12 +1579,12 @@ void RdmaHw::UpdateRateHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader
                int32_t new_incStage;
                double max_c = U / m_targetUtil;
 
-               if (max_c >= 1 || qp->hpccPint.m_incStage >= m_miThresh){
-                       new_rate = qp->hpccPint.m_curRate / max_c + m_rai;
+               if (max_c >= 1 || qp->GetCc<RdmaQpHpPint>().m_incStage >= m_miThresh){
+                       new_rate = qp->GetCc<RdmaQpHpPint>().m_curRate / max_c + m_rai;
                        new_incStage = 0;
                }else{
-                       new_rate = qp->hpccPint.m_curRate + m_rai;
-                       new_incStage = qp->hpccPint.m_incStage+1;
+                       new_rate = qp->GetCc<RdmaQpHpPint>().m_curRate + m_rai;
+                       new_incStage = qp->GetCc<RdmaQpHpPint>().m_incStage+1;
                }
                if (new_rate < m_minRate)
                        new_rate = m_minRate;
@@ -1546,12 +1592,12 @@ void RdmaHw::UpdateRateHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader
                        new_rate = qp->m_max_rate;
                ChangeRate(qp, new_rate);
                if (!fast_react){
-                       qp->hpccPint.m_curRate = new_rate;
-                       qp->hpccPint.m_incStage = new_incStage;
+                       qp->GetCc<RdmaQpHpPint>().m_curRate = new_rate;
+                       qp->GetCc<RdmaQpHpPint>().m_incStage = new_incStage;
                }
                if (!fast_react){
-                       if (next_seq > qp->hpccPint.m_lastUpdateSeq)
-                               qp->hpccPint.m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
+                       if (next_seq > qp->GetCc<RdmaQpHpPint>().m_lastUpdateSeq)
+                               qp->GetCc<RdmaQpHpPint>().m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
                }
        }
 }
@@ -11,6 +11,8 @@
 #include "qbb-net-device.h"
 #include <unordered_map>
 #include "pint.h"
+#include "qp-hash-map.h"
+#include "rdma-cc.h"
 
 namespace ns3 {
 
@@ -24,6 +26,32 @@ struct RdmaInterfaceMgr{
     }
 };
 
+/**
+ * A flow to start with RdmaHw::AddFlows (or RdmaDriver::AddFlows): what
+ * AddQueuePair takes, but plain data, so a batch of flows is one array.
+ */
+struct RdmaFlow{
+    uint64_t size;
+    Ipv4Address sip, dip;
+    uint16_t pg, sport, dport;
+    uint16_t notify; // completion callback, an index from AddFlowNotify (0: none)
+    uint32_t win;
+    uint64_t baseRtt;
+};
+
+/**
+ * A completed flow, what its QP held when the last byte was acknowledged.
+ * RdmaHw reports them in batches (see FlushCompletions), so a run with
+ * many short flows makes a call per batch rather than per flow.
+ */
+struct RdmaFlowDone{
+    Ipv4Address sip, dip;
+    uint16_t sport, dport;
+    uint32_t nackRecv, retxCnt;
+    uint64_t size, retxBytes;
+    Time startTime, finishTime;
+};
+
 class RdmaHw : public Object {
 public:
 
@@ -34,6 +62,8 @@ public:
     DataRate m_minRate;        //< Min sending rate
     uint32_t m_mtu;
     uint32_t m_cc_mode;
+    std::string m_ccAlgorithm; // TypeId name of the RdmaCc, empty for the one of m_cc_mode
+    Ptr<RdmaCc> m_cc;
     double m_nack_interval;
     uint32_t m_chunk;
     uint32_t m_ack_interval;
@@ -41,25 +71,53 @@ public:
     bool m_var_win, m_fast_react;
     bool m_rateBound;
     std::vector<RdmaInterfaceMgr> m_nic; // list of running nic controlled by this RdmaHw
-    std::unordered_map<uint64_t, Ptr<RdmaQueuePair> > m_qpMap; // mapping from uint64_t to qp
-    std::unordered_map<uint64_t, Ptr<RdmaRxQueuePair> > m_rxQpMap; // mapping from uint64_t to rx qp
+    QpHashMap<Ptr<RdmaQueuePair> > m_qpMap; // mapping from uint64_t to qp
+    Ptr<RdmaQpTable> m_qpTable; // scheduling and CC state of the tx qps
+    std::vector<RdmaQueuePair*> m_qpById; // m_qpById[qp->m_slot] is the qp while it is in m_qpMap
+    QpHashMap<RdmaRxQueuePair*> m_rxQpMap; // mapping from uint64_t to rx qp
+    RdmaRxQpTable m_rxQpTable; // the rx qps, q->m_id is the slot plus one
+    // an rx qp is freed when its FIN packet arrives in order, or after it has
+    // received nothing for m_rxQpIdleTimeout (0: never), swept by ExpireRxQps
+    Time m_rxQpIdleTimeout;
+    EventId m_rxQpExpireEvent;
 //    std::unordered_map<uint32_t, std::vector<int> > m_rtTable; // map from ip address (u32) to possible ECMP port (index of dev)
     std::unordered_map<int32_t, int> m_routerMap;
+    // loss statistics of all qps of this host (plain counters, see StatsRegistry)
+    uint64_t m_nackRecv, m_retxCnt, m_retxBytes; // sender side
+    uint64_t m_nackSent, m_outOfOrderRecv, m_duplicateRecv; // receiver side
+    uint32_t m_rxQpLive; // rx qps in m_rxQpTable
+    uint64_t m_rxQpCreated, m_rxQpFin, m_rxQpExpired; // rx qps created, freed by their FIN, freed when idle
     // qp complete callback
     typedef Callback<void, Ptr<RdmaQueuePair> > QpCompleteCallback;
     QpCompleteCallback m_qpCompleteCallback;
+    // completion callbacks of the flows of AddFlows, shared by all the flows that name them
+    std::vector<QpCompleteCallback> m_flowNotify;
+    // completed flows not reported yet to m_flowsCompleteCallback, which gets them by m_completionBatch
+    typedef Callback<void, const RdmaFlowDone*, uint32_t> FlowsCompleteCallback;
+    FlowsCompleteCallback m_flowsCompleteCallback;
+    uint32_t m_completionBatch;
+    std::vector<RdmaFlowDone> m_done;
 
     void SetNode(Ptr<Node> node);
     void Setup(QpCompleteCallback cb); // setup shared data and callbacks with the QbbNetDevice
+    void InitCc(void); // create m_cc and m_qpTable, done by Setup
+    static std::string GetCcAlgorithmName(uint32_t ccMode); // the RdmaCc of a CC_MODE, empty for the refused ones
     static uint64_t GetQpKey(uint32_t dip, uint16_t sport, uint16_t pg); // get the lookup key for m_qpMap
     Ptr<RdmaQueuePair> GetQp(uint32_t dip, uint16_t sport, uint16_t pg); // get the qp
+    Ptr<RdmaQueuePair> GetQpById(uint16_t id, uint32_t dip, uint16_t sport); // get the qp by the id echoed in an ACK, GetQp if it is stale
     uint32_t GetNicIdxOfQp(Ptr<RdmaQueuePair> qp); // get the NIC index of the qp
     void AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport, uint32_t win, uint64_t baseRtt, Callback<void> notifyAppFinish); // add a new qp (new send)
+    Ptr<RdmaQueuePair> AddQueuePair(const RdmaFlow &flow); // add a new qp for the flow
+    void AddFlows(const RdmaFlow *flows, uint32_t n); // start a batch of flows, in order
+    uint16_t AddFlowNotify(QpCompleteCallback cb); // register a completion callback for RdmaFlow::notify
     void DeleteQueuePair(Ptr<RdmaQueuePair> qp);
 
-    Ptr<RdmaRxQueuePair> GetRxQp(uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport, uint16_t pg, bool create); // get a rxQp
-    uint32_t GetNicIdxOfRxQp(Ptr<RdmaRxQueuePair> q); // get the NIC index of the rxQp
+    RdmaRxQueuePair* GetRxQp(uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport, uint16_t pg, bool create); // get a rxQp
+    RdmaRxQueuePair* GetRxQpById(uint16_t id, uint32_t dip, uint16_t dport); // get a rxQp by the id carried in a data packet, NULL if it is stale
+    uint32_t GetNicIdxOfRxQp(RdmaRxQueuePair *q); // get the NIC index of the rxQp
     void DeleteRxQp(uint32_t dip, uint16_t pg, uint16_t dport);
+    void DeleteRxQp(RdmaRxQueuePair *q);
+    void ExpireRxQps(void); // free the rx qps idle for m_rxQpIdleTimeout
 
     int ReceiveUdp(Ptr<Packet> p, MyCustomHeader &ch);
     int ReceiveTcp(Ptr<Packet> p, MyCustomHeader &ch);
@@ -67,13 +125,14 @@ public:
     int ReceiveAck(Ptr<Packet> p, MyCustomHeader &ch); // handle both ACK and NACK
     int Receive(Ptr<Packet> p, MyCustomHeader &ch); // callback function that the QbbNetDevice should use when receive packets. Only NIC can call this function. And do not call this upon PFC
 
-    void CheckandSendQCN(Ptr<RdmaRxQueuePair> q);
-    int ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> q, uint32_t size);
+    void CheckandSendQCN(RdmaRxQueuePair *q);
+    int ReceiverCheckSeq(uint32_t seq, RdmaRxQueuePair *q, uint32_t size);
     void AddHeader (Ptr<Packet> p, uint16_t protocolNumber);
     static uint16_t EtherToPpp (uint16_t protocol);
 
     void RecoverQueue(Ptr<RdmaQueuePair> qp);
     void QpComplete(Ptr<RdmaQueuePair> qp);
+    void FlushCompletions(void); // report the completed flows of the current batch now
     void SetLinkDown(Ptr<QbbNetDevice> dev);
 
     // call this function after the NIC is setup
@@ -81,6 +140,17 @@ public:
     void ClearTable();
     void RedistributeQp();
 
+    /*
+     * Save the qps, the rx qps, their maps and the counters into a
+     * checkpoint. The restored RdmaHw is set up (Setup, AddFlowNotify) but
+     * has no qp yet; the qps are restored in their slots, and the maps and
+     * the NIC groups with the same layout, so they are walked in the same
+     * order as in the saved run. The completed flows must have been
+     * reported (FlushCompletions).
+     */
+    void Save(CheckpointWriter &w);
+    void Restore(CheckpointReader &r);
+
     Ptr<Packet> GetNxtPacket(Ptr<RdmaQueuePair> qp); // get next packet to send, inc snd_nxt
     void PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap);
     void UpdateNextAvail(Ptr<RdmaQueuePair> qp, Time interframeGap, uint32_t pkt_size);
@@ -158,7 +228,7 @@ public:
     /*********************
      * MY- CC
      ********************/
-    void HandleAckMycc(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+    // FIDCC is in RdmaCcFidcc
 };
 
 } /* namespace ns3 */
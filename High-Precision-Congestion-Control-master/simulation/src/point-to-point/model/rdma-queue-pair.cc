@@ -4,91 +4,302 @@
 #include <ns3/udp-header.h>
 #include <ns3/ipv4-header.h>
 #include <ns3/simulator.h>
+#include <ns3/mem-profiler.h>
 #include "ns3/ppp-header.h"
+#include "ns3/checkpoint.h"
 #include "rdma-queue-pair.h"
 
 namespace ns3 {
 
-/**************************
- * RdmaQueuePair
- *************************/
-TypeId RdmaQueuePair::GetTypeId (void)
-{
-    static TypeId tid = TypeId ("ns3::RdmaQueuePair")
-        .SetParent<Object> ()
-        ;
-    return tid;
+NS_MEM_CATEGORY(g_memQpTable, "ns3::RdmaQpTable"); // count: slots
+NS_MEM_CATEGORY(g_memRxQpTable, "ns3::RdmaRxQpTable"); // count: slots
+static const uint32_t qpChunk = 1u << RdmaQpSlab<RdmaQpHot>::chunkShift;
+
+// slots of the chunks that hold n slots
+static inline uint64_t ChunkSlots(uint32_t n){
+    return (n + qpChunk - 1) / qpChunk * qpChunk;
 }
 
-RdmaQueuePair::RdmaQueuePair(uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport){
-    startTime = Simulator::Now();
-    sip = _sip;
-    dip = _dip;
-    sport = _sport;
-    dport = _dport;
-    m_size = 0;
+/**************************
+ * RdmaQpTable
+ *************************/
+RdmaQpHot::RdmaQpHot(){
     snd_nxt = snd_una = 0;
-    m_pg = pg;
-    m_ipid = 0;
-    m_win = 0;
-    m_baseRtt = 0;
+    m_size = 0;
+    m_nextAvail = Time(0);
+    m_rate = 0;
     m_max_rate = 0;
+    m_win = 0;
+    m_pg = 0;
     m_var_win = false;
-    m_rate = 0;
-    m_nextAvail = Time(0);
-    mlx.m_alpha = 1;
-    mlx.m_alpha_cnp_arrived = false;
-    mlx.m_first_cnp = true;
-    mlx.m_decrease_cnp_arrived = false;
-    mlx.m_rpTimeStage = 0;
-    
-    
-    mycc.m_congestTimeStamp = 0;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
-    mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-    mycc.m_lastUpdateSeq = 0;
-
-    mycc.m_lastUpdateTime = 0;//上一次更新窗口的时间
-    mycc.m_lastUpdateCongestTime = 0;//上一次根据该数据包更新窗口时的数据包记录的拥塞发生的时间
-    mycc.m_lastUpdateIdleTime = 0;//上一次根据该数据包更新窗口时的数据包记录的空闲发生的时间
-
-    mycc.m_currentWinSize = 0;//当前窗口的大小
-    mycc.m_lastWinSize = 0;//上一个窗口的大小
-
-    mycc.m_congestTimeStamp = 0;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
-    mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-    mycc.m_depth = 0;
-    mycc.m_ratio = 10000;
-    mycc.m_rTs = 0;//队列空闲时的时间
-    mycc.m_dTs = 0;//发生拥塞时的时间
-    mycc.m_max_dRate = 1; // 缺省队列返回最大速率时间
-    mycc.m_max_rRate = 1; // 缺省比值返回最大速率时间
-    
-    
-    hp.m_lastUpdateSeq = 0;
-    for (uint32_t i = 0; i < sizeof(hp.keep) / sizeof(hp.keep[0]); i++)
-        hp.keep[i] = 0;
-    hp.m_incStage = 0;
-    hp.m_lastGap = 0;
-    hp.u = 1;
+}
+
+RdmaQpMlx::RdmaQpMlx(){
+    m_alpha = 1;
+    m_alpha_cnp_arrived = false;
+    m_first_cnp = true;
+    m_decrease_cnp_arrived = false;
+    m_rpTimeStage = 0;
+}
+
+RdmaQpHp::RdmaQpHp(){
+    m_lastUpdateSeq = 0;
+    for (uint32_t i = 0; i < sizeof(keep) / sizeof(keep[0]); i++)
+        keep[i] = 0;
+    m_incStage = 0;
+    m_lastGap = 0;
+    u = 1;
     for (uint32_t i = 0; i < IntHeader::maxHop; i++){
-        hp.hopState[i].u = 1;
-        hp.hopState[i].incStage = 0;
+        hopState[i].u = 1;
+        hopState[i].incStage = 0;
+    }
+}
+
+RdmaQpMycc::RdmaQpMycc(){
+    m_lastUpdateSeq = 0;
+    m_lastUpdateTime = 0;//上一次更新窗口的时间
+    m_lastUpdateCongestTime = 0;//上一次根据该数据包更新窗口时的数据包记录的拥塞发生的时间
+    m_lastUpdateIdleTime = 0;//上一次根据该数据包更新窗口时的数据包记录的空闲发生的时间
+
+    m_currentWinSize = 0;//当前窗口的大小
+    m_lastWinSize = 0;//上一个窗口的大小
+
+    m_congestTimeStamp = 0;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
+    m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+    m_depth = 0;
+    m_ratio = 10000;
+    m_rTs = 0;//队列空闲时的时间
+    m_dTs = 0;//发生拥塞时的时间
+    m_max_dRate = 1; // 缺省队列返回最大速率时间
+    m_max_rRate = 1; // 缺省比值返回最大速率时间
+}
+
+RdmaQpTimely::RdmaQpTimely(){
+    m_lastUpdateSeq = 0;
+    m_incStage = 0;
+    lastRtt = 0;
+    rttDiff = 0;
+}
+
+RdmaQpDctcp::RdmaQpDctcp(){
+    m_lastUpdateSeq = 0;
+    m_caState = 0;
+    m_highSeq = 0;
+    m_alpha = 1;
+    m_ecnCnt = 0;
+    m_batchSizeOfAlpha = 0;
+}
+
+RdmaQpHpPint::RdmaQpHpPint(){
+    m_lastUpdateSeq = 0;
+    m_incStage = 0;
+}
+
+RdmaQpCcSlab::RdmaQpCcSlab(const RdmaQpCcState &type) : m_type(type){
+    m_size = (type.size + 7) / 8 * 8;
+}
+
+RdmaQpCcSlab::~RdmaQpCcSlab(){
+    for (uint32_t i = 0; i < m_chunk.size(); i++)
+        delete[] (uint64_t*)m_chunk[i];
+}
+
+void RdmaQpCcSlab::Construct(uint32_t slot){
+    while ((slot >> RdmaQpSlab<RdmaQpHot>::chunkShift) >= m_chunk.size())
+        m_chunk.push_back((uint8_t*)new uint64_t[(m_size << RdmaQpSlab<RdmaQpHot>::chunkShift) / 8]);
+    m_type.construct((*this)[slot]);
+}
+
+void RdmaQpCcSlab::Destruct(uint32_t slot){
+    m_type.destruct((*this)[slot]);
+}
+
+uint32_t RdmaQpCcSlab::GetStateSize(void) const{
+    return m_type.size;
+}
+
+bool RdmaQpCcSlab::IsTrivial(void) const{
+    return m_type.trivial;
+}
+
+uint32_t RdmaQpCcSlab::GetSlotSize(void) const{
+    return m_size;
+}
+
+RdmaQpTable::RdmaQpTable(const RdmaQpCcState &cc) : m_cc(cc){
+    m_n = 0;
+}
+
+RdmaQpTable::~RdmaQpTable(){
+    // the QPs hold a Ptr to the table, so they are all gone
+    for (uint32_t i = 0; i < m_qpChunk.size(); i++)
+        delete[] m_qpChunk[i];
+    NS_MEM_FREE(g_memQpTable, ChunkSlots(m_n) * (sizeof(RdmaQpHot) + m_cc.GetSlotSize() + sizeof(RdmaQueuePair)), ChunkSlots(m_n));
+}
+
+uint32_t RdmaQpTable::Alloc(void){
+    uint32_t slot;
+    if (!m_free.empty()){
+        slot = m_free.back();
+        m_free.pop_back();
+    }else{
+        slot = m_n++;
+        if (slot % qpChunk == 0) // the slabs grow by a chunk
+            NS_MEM_ALLOC(g_memQpTable, qpChunk * (sizeof(RdmaQpHot) + m_cc.GetSlotSize() + sizeof(RdmaQueuePair)), qpChunk);
     }
+    m_hot.Reset(slot);
+    m_cc.Construct(slot);
+    return slot;
+}
+
+uint32_t RdmaQpTable::AllocAt(uint32_t slot){
+    NS_ASSERT(slot < m_n);
+    m_hot.Reset(slot);
+    m_cc.Construct(slot);
+    return slot;
+}
+
+void RdmaQpTable::Free(uint32_t slot){
+    m_cc.Destruct(slot);
+    m_free.push_back(slot);
+}
+
+uint32_t RdmaQpTable::GetNActive(void) const{
+    return m_n - m_free.size();
+}
+
+uint32_t RdmaQpTable::GetNSlots(void) const{
+    return m_n;
+}
+
+void RdmaQpTable::Save(CheckpointWriter &w) const{
+    w.Put(m_n);
+    w.Put((uint32_t)m_free.size());
+    w.PutBytes(m_free.data(), m_free.size() * sizeof(uint32_t));
+}
+
+void RdmaQpTable::Restore(CheckpointReader &r){
+    NS_ASSERT(m_n == 0);
+    m_n = r.Get<uint32_t>();
+    m_free.resize(r.Get<uint32_t>());
+    r.GetBytes(m_free.data(), m_free.size() * sizeof(uint32_t));
+    NS_MEM_ALLOC(g_memQpTable, ChunkSlots(m_n) * (sizeof(RdmaQpHot) + m_cc.GetSlotSize() + sizeof(RdmaQueuePair)), ChunkSlots(m_n));
+}
+
+void* RdmaQpTable::GetQpMemory(uint32_t slot){
+    static_assert(alignof(RdmaQueuePair) <= alignof(uint64_t), "the QP chunks are arrays of uint64_t");
+    const uint32_t words = (sizeof(RdmaQueuePair) + 7) / 8;
+    while (slot / qpChunk >= m_qpChunk.size())
+        m_qpChunk.push_back(new uint64_t[words * qpChunk]);
+    return m_qpChunk[slot / qpChunk] + (slot % qpChunk) * words;
+}
+
+/**************************
+ * RdmaQueuePair
+ *************************/
+Ptr<RdmaQueuePair> RdmaQueuePair::Create(Ptr<RdmaQpTable> table, uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport){
+    uint32_t slot = table->Alloc();
+    RdmaQueuePair *qp = new (table->GetQpMemory(slot)) RdmaQueuePair(table, slot);
+    qp->startTime = Simulator::Now();
+    qp->sip = _sip;
+    qp->dip = _dip;
+    qp->sport = _sport;
+    qp->dport = _dport;
+    qp->m_pg = pg;
+    return Ptr<RdmaQueuePair>(qp, false);
+}
+
+Ptr<RdmaQueuePair> RdmaQueuePair::Create(Ptr<RdmaQpTable> table, uint32_t slot){
+    table->AllocAt(slot);
+    return Ptr<RdmaQueuePair>(new (table->GetQpMemory(slot)) RdmaQueuePair(table, slot), false);
+}
+
+RdmaQueuePair::RdmaQueuePair(Ptr<RdmaQpTable> table, uint32_t slot)
+    : m_table(table), m_slot(slot), m_hot(table->m_hot[m_slot]),
+      m_size(m_hot.m_size), snd_nxt(m_hot.snd_nxt), snd_una(m_hot.snd_una), m_pg(m_hot.m_pg),
+      m_win(m_hot.m_win), m_max_rate(m_hot.m_max_rate), m_var_win(m_hot.m_var_win), m_nextAvail(m_hot.m_nextAvail),
+      m_rate(m_hot.m_rate), m_ccState(table->m_cc[m_slot])
+{
+    sport = dport = 0;
+    m_ipid = 0;
+    m_rxQpId = 0;
+    wp = 0;
+    lastPktSize = 0;
+    m_notify = 0;
+    m_availPos = RdmaQueuePairGroup::NO_POS;
+    m_baseRtt = 0;
+    m_nackRecv = 0;
+    m_retxCnt = 0;
+    m_retxBytes = 0;
+}
+
+void RdmaQueuePair::Save(CheckpointWriter &w) const{
+    if (!m_notifyAppFinish.IsNull())
+        w.Fail("a qp has an application callback, which is not saved");
+    if (!m_table->m_cc.IsTrivial())
+        w.Fail("the per-qp state of the CC algorithm has events or pointers, which are not saved");
+    w.PutTime(startTime);
+    w.Put(sip.Get());
+    w.Put(dip.Get());
+    w.Put(sport);
+    w.Put(dport);
+    w.Put(m_ipid);
+    w.Put(m_rxQpId);
+    w.Put(m_baseRtt);
+    w.Put(wp);
+    w.Put(lastPktSize);
+    w.Put(m_notify);
+    w.Put(m_availPos);
+    w.Put(m_nackRecv);
+    w.Put(m_retxCnt);
+    w.Put(m_retxBytes);
+    w.Put(m_hot.snd_nxt);
+    w.Put(m_hot.snd_una);
+    w.Put(m_hot.m_size);
+    w.PutTime(m_hot.m_nextAvail);
+    w.Put(m_hot.m_rate.GetBitRate());
+    w.Put(m_hot.m_max_rate.GetBitRate());
+    w.Put(m_hot.m_win);
+    w.Put(m_hot.m_pg);
+    w.Put(m_hot.m_var_win);
+    w.PutBytes(m_ccState, m_table->m_cc.GetStateSize());
+}
 
-    tmly.m_lastUpdateSeq = 0;
-    tmly.m_incStage = 0;
-    tmly.lastRtt = 0;
-    tmly.rttDiff = 0;
+void RdmaQueuePair::Restore(CheckpointReader &r){
+    startTime = r.GetTime();
+    sip.Set(r.Get<uint32_t>());
+    dip.Set(r.Get<uint32_t>());
+    r.Get(sport);
+    r.Get(dport);
+    r.Get(m_ipid);
+    r.Get(m_rxQpId);
+    r.Get(m_baseRtt);
+    r.Get(wp);
+    r.Get(lastPktSize);
+    r.Get(m_notify);
+    r.Get(m_availPos);
+    r.Get(m_nackRecv);
+    r.Get(m_retxCnt);
+    r.Get(m_retxBytes);
+    r.Get(m_hot.snd_nxt);
+    r.Get(m_hot.snd_una);
+    r.Get(m_hot.m_size);
+    m_hot.m_nextAvail = r.GetTime();
+    m_hot.m_rate = DataRate(r.Get<uint64_t>());
+    m_hot.m_max_rate = DataRate(r.Get<uint64_t>());
+    r.Get(m_hot.m_win);
+    r.Get(m_hot.m_pg);
+    r.Get(m_hot.m_var_win);
+    r.GetBytes(m_ccState, m_table->m_cc.GetStateSize());
+}
 
-    dctcp.m_lastUpdateSeq = 0;
-    dctcp.m_caState = 0;
-    dctcp.m_highSeq = 0;
-    dctcp.m_alpha = 1;
-    dctcp.m_ecnCnt = 0;
-    dctcp.m_batchSizeOfAlpha = 0;
+RdmaQueuePair::~RdmaQueuePair(){
+    m_table->Free(m_slot);
+}
 
-    hpccPint.m_lastUpdateSeq = 0;
-    hpccPint.m_incStage = 0;
+void RdmaQpDeleter::Delete(RdmaQueuePair *qp){
+    Ptr<RdmaQpTable> table = qp->m_table; // holds the memory of the qp until it is destroyed
+    qp->~RdmaQueuePair();
 }
 
 void RdmaQueuePair::SetSize(uint64_t size){
@@ -112,7 +323,7 @@ void RdmaQueuePair::SetAppNotifyCallback(Callback<void> notifyAppFinish){
 }
 
 uint64_t RdmaQueuePair::GetBytesLeft(){
-    return m_size >= snd_nxt ? m_size - snd_nxt : 0;
+    return m_hot.GetBytesLeft();
 }
 
 uint32_t RdmaQueuePair::GetHash(void){
@@ -137,26 +348,15 @@ void RdmaQueuePair::Acknowledge(uint64_t ack){
 }
 
 uint64_t RdmaQueuePair::GetOnTheFly(){
-    return snd_nxt - snd_una;
+    return m_hot.GetOnTheFly();
 }
 
 bool RdmaQueuePair::IsWinBound(){
-    uint64_t w = GetWin();
-    return w != 0 && GetOnTheFly() >= w;
+    return m_hot.IsWinBound();
 }
 
 uint64_t RdmaQueuePair::GetWin(){
-    if (m_win == 0)
-        return 0;
-    uint64_t w;
-    if (m_var_win){
-        w = m_win * m_rate.GetBitRate() / m_max_rate.GetBitRate();
-        if (w == 0)
-            w = 1; // must > 0
-    }else{
-        w = m_win;
-    }
-    return w;
+    return m_hot.GetWin();
 }
 // uint64_t RdmaQueuePair::GetWin(){
 //     if (mycc.m_currentWinSize == 0)
@@ -173,42 +373,26 @@ uint64_t RdmaQueuePair::GetWin(){
 // }
 
 
-uint64_t RdmaQueuePair::HpGetCurWin(){
-    if (m_win == 0)
-        return 0;
-    uint64_t w;
-    if (m_var_win){
-        w = m_win * hp.m_curRate.GetBitRate() / m_max_rate.GetBitRate();
-        if (w == 0)
-            w = 1; // must > 0
-    }else{
-        w = m_win;
-    }
-    return w;
-}
-
 bool RdmaQueuePair::IsFinished(){
-    return snd_una >= m_size;
+    return m_hot.IsFinished();
 }
 
 /*********************
  * RdmaRxQueuePair
  ********************/
-TypeId RdmaRxQueuePair::GetTypeId (void)
-{
-    static TypeId tid = TypeId ("ns3::RdmaRxQueuePair")
-        .SetParent<Object> ()
-        ;
-    return tid;
-}
-
 RdmaRxQueuePair::RdmaRxQueuePair(){
     sip = dip = sport = dport = 0;
     m_ipid = 0;
+    m_id = 0;
+    m_slot = 0;
     ReceiverNextExpectedSeq = 0;
     m_nackTimer = Time(0);
+    m_lastActive = Time(0);
     m_milestone_rx = 0;
     m_lastNACK = 0;
+    m_nackSent = 0;
+    m_outOfOrder = 0;
+    m_duplicate = 0;
 }
 
 uint32_t RdmaRxQueuePair::GetHash(void){
@@ -226,9 +410,97 @@ uint32_t RdmaRxQueuePair::GetHash(void){
     return Hash32(buf.c, 12);
 }
 
+RdmaRxQpTable::RdmaRxQpTable(){
+    m_n = 0;
+}
+
+RdmaRxQpTable::~RdmaRxQpTable(){
+    NS_MEM_FREE(g_memRxQpTable, ChunkSlots(m_n) * sizeof(RdmaRxQueuePair), ChunkSlots(m_n));
+}
+
+RdmaRxQueuePair* RdmaRxQpTable::Alloc(void){
+    uint32_t slot;
+    if (!m_free.empty()){
+        slot = m_free.back();
+        m_free.pop_back();
+    }else{
+        slot = m_n++;
+        if (slot % qpChunk == 0)
+            NS_MEM_ALLOC(g_memRxQpTable, qpChunk * sizeof(RdmaRxQueuePair), qpChunk);
+    }
+    m_slab.Reset(slot);
+    m_slab[slot].m_slot = slot;
+    return &m_slab[slot];
+}
+
+void RdmaRxQpTable::Save(CheckpointWriter &w){
+    w.Put(m_n);
+    w.Put((uint32_t)m_free.size());
+    w.PutBytes(m_free.data(), m_free.size() * sizeof(uint32_t));
+    for (uint32_t i = 0; i < m_n; i++){
+        const RdmaRxQueuePair &q = m_slab[i];
+        if (q.QcnTimerEvent.IsRunning())
+            w.Fail("an rx qp has a QCN timer, which is not saved");
+        w.Put(q.m_ecn_source);
+        w.Put(q.sip);
+        w.Put(q.dip);
+        w.Put(q.sport);
+        w.Put(q.dport);
+        w.Put(q.m_ipid);
+        w.Put(q.m_id);
+        w.Put(q.ReceiverNextExpectedSeq);
+        w.PutTime(q.m_nackTimer);
+        w.PutTime(q.m_lastActive);
+        w.Put(q.m_milestone_rx);
+        w.Put(q.m_lastNACK);
+        w.Put(q.m_nackSent);
+        w.Put(q.m_outOfOrder);
+        w.Put(q.m_duplicate);
+    }
+}
+
+void RdmaRxQpTable::Restore(CheckpointReader &r){
+    NS_ASSERT(m_n == 0);
+    m_n = r.Get<uint32_t>();
+    m_free.resize(r.Get<uint32_t>());
+    r.GetBytes(m_free.data(), m_free.size() * sizeof(uint32_t));
+    if (r.Failed())
+        m_n = 0;
+    NS_MEM_ALLOC(g_memRxQpTable, ChunkSlots(m_n) * sizeof(RdmaRxQueuePair), ChunkSlots(m_n));
+    for (uint32_t i = 0; i < m_n; i++){
+        m_slab.Reset(i);
+        RdmaRxQueuePair &q = m_slab[i];
+        q.m_slot = i;
+        r.Get(q.m_ecn_source);
+        r.Get(q.sip);
+        r.Get(q.dip);
+        r.Get(q.sport);
+        r.Get(q.dport);
+        r.Get(q.m_ipid);
+        r.Get(q.m_id);
+        r.Get(q.ReceiverNextExpectedSeq);
+        q.m_nackTimer = r.GetTime();
+        q.m_lastActive = r.GetTime();
+        r.Get(q.m_milestone_rx);
+        r.Get(q.m_lastNACK);
+        r.Get(q.m_nackSent);
+        r.Get(q.m_outOfOrder);
+        r.Get(q.m_duplicate);
+    }
+}
+
+void RdmaRxQpTable::Free(RdmaRxQueuePair *q){
+    uint32_t slot = q->m_slot;
+    Simulator::Cancel(q->QcnTimerEvent);
+    *q = RdmaRxQueuePair(); // stale ids no longer match it
+    m_free.push_back(slot);
+}
+
 /*********************
  * RdmaQueuePairGroup
  ********************/
+NS_OBJECT_ENSURE_REGISTERED(RdmaQueuePairGroup);
+
 TypeId RdmaQueuePairGroup::GetTypeId (void)
 {
     static TypeId tid = TypeId ("ns3::RdmaQueuePairGroup")
@@ -254,6 +526,8 @@ Ptr<RdmaQueuePair> RdmaQueuePairGroup::operator[](uint32_t idx){
 
 void RdmaQueuePairGroup::AddQp(Ptr<RdmaQueuePair> qp){
     m_qps.push_back(qp);
+    m_hot.push_back(&qp->m_hot);
+    UpdateAvail(PeekPointer(qp));
 }
 
 #if 0
@@ -263,7 +537,77 @@ void RdmaQueuePairGroup::AddRxQp(Ptr<RdmaRxQueuePair> rxQp){
 #endif
 
 void RdmaQueuePairGroup::Clear(void){
+    for (uint32_t i = 0; i < m_avail.size(); i++)
+        m_avail[i]->m_availPos = NO_POS;
+    m_avail.clear();
     m_qps.clear();
+    m_hot.clear();
+}
+
+void RdmaQueuePairGroup::SiftUp(uint32_t i){
+    RdmaQueuePair *qp = m_avail[i];
+    while (i > 0){
+        uint32_t parent = (i - 1) / 2;
+        if (!(qp->m_nextAvail < m_avail[parent]->m_nextAvail))
+            break;
+        m_avail[i] = m_avail[parent];
+        m_avail[i]->m_availPos = i;
+        i = parent;
+    }
+    m_avail[i] = qp;
+    qp->m_availPos = i;
+}
+
+void RdmaQueuePairGroup::SiftDown(uint32_t i){
+    RdmaQueuePair *qp = m_avail[i];
+    uint32_t n = m_avail.size();
+    while (2 * i + 1 < n){
+        uint32_t child = 2 * i + 1;
+        if (child + 1 < n && m_avail[child + 1]->m_nextAvail < m_avail[child]->m_nextAvail)
+            child++;
+        if (!(m_avail[child]->m_nextAvail < qp->m_nextAvail))
+            break;
+        m_avail[i] = m_avail[child];
+        m_avail[i]->m_availPos = i;
+        i = child;
+    }
+    m_avail[i] = qp;
+    qp->m_availPos = i;
+}
+
+void RdmaQueuePairGroup::UpdateAvail(RdmaQueuePair *qp){
+    if (qp->m_availPos == NO_POS){
+        // a finished QP may already be out of the group
+        if (qp->GetBytesLeft() == 0 || qp->IsFinished())
+            return;
+        m_avail.push_back(qp);
+        qp->m_availPos = m_avail.size() - 1;
+    }
+    SiftUp(qp->m_availPos);
+    SiftDown(qp->m_availPos);
+}
+
+void RdmaQueuePairGroup::RemoveAvail(RdmaQueuePair *qp){
+    uint32_t i = qp->m_availPos;
+    if (i == NO_POS)
+        return;
+    qp->m_availPos = NO_POS;
+    RdmaQueuePair *last = m_avail.back();
+    m_avail.pop_back();
+    if (last != qp){
+        m_avail[i] = last;
+        last->m_availPos = i;
+        SiftUp(i);
+        SiftDown(last->m_availPos);
+    }
+}
+
+Time RdmaQueuePairGroup::GetNextAvail(void){
+    while (!m_avail.empty() && m_avail[0]->GetBytesLeft() == 0)
+        RemoveAvail(m_avail[0]);
+    if (m_avail.empty())
+        return Simulator::GetMaximumSimulationTime();
+    return m_avail[0]->m_nextAvail;
 }
 
 }
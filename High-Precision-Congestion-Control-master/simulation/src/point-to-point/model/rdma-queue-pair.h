@@ -2,106 +2,339 @@
 #define RDMA_QUEUE_PAIR_H
 
 #include <ns3/object.h>
+#include <ns3/simple-ref-count.h>
 #include <ns3/packet.h>
 #include <ns3/ipv4-address.h>
 #include <ns3/data-rate.h>
 #include <ns3/event-id.h>
 #include <ns3/custom-header.h>
 #include <ns3/int-header.h>
+#include <ns3/fatal-error.h>
+#include <ns3/assert.h>
 #include <vector>
+#include <new>
+#include <cstdlib>
+#include <type_traits>
 
 namespace ns3 {
 
-class RdmaQueuePair : public Object {
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * Scheduling state of a tx QP: the fields RdmaEgressQueue::GetNextQindex
+ * reads for every QP of the NIC each time it picks the next packet. They
+ * share one cache line and live in RdmaQpTable, next to those of the other
+ * QPs, instead of in the RdmaQueuePair object.
+ */
+struct alignas(64) RdmaQpHot{
+    uint64_t snd_nxt, snd_una; // next seq to send, the highest unacked seq
+    uint64_t m_size;
+    Time m_nextAvail;    //< Soonest time of next send
+    DataRate m_rate;    //< Current rate
+    DataRate m_max_rate; // max rate
+    uint32_t m_win; // bound of on-the-fly packets
+    uint16_t m_pg;
+    bool m_var_win; // variable window size
+
+    RdmaQpHot();
+    inline uint64_t GetBytesLeft() const{
+        return m_size >= snd_nxt ? m_size - snd_nxt : 0;
+    }
+    inline uint64_t GetOnTheFly() const{
+        return snd_nxt - snd_una;
+    }
+    inline uint64_t GetWin() const{ // window size calculated from m_rate
+        if (m_win == 0)
+            return 0;
+        uint64_t w;
+        if (m_var_win){
+            w = m_win * m_rate.GetBitRate() / m_max_rate.GetBitRate();
+            if (w == 0)
+                w = 1; // must > 0
+        }else{
+            w = m_win;
+        }
+        return w;
+    }
+    inline bool IsWinBound() const{
+        uint64_t w = GetWin();
+        return w != 0 && GetOnTheFly() >= w;
+    }
+    inline bool IsFinished() const{
+        return snd_una >= m_size;
+    }
+};
+
+/******************************
+ * per-algorithm state of a tx QP; a QP only has the state of the CC
+ * algorithm of its RdmaHw (see RdmaCc)
+ *****************************/
+struct RdmaQpMlx{
+    DataRate m_targetRate;    //< Target rate
+    EventId m_eventUpdateAlpha;
+    double m_alpha;
+    bool m_alpha_cnp_arrived; // indicate if CNP arrived in the last slot
+    bool m_first_cnp; // indicate if the current CNP is the first CNP
+    EventId m_eventDecreaseRate;
+    bool m_decrease_cnp_arrived; // indicate if CNP arrived in the last slot
+    uint32_t m_rpTimeStage;
+    EventId m_rpTimer;
+    RdmaQpMlx();
+};
+struct RdmaQpHp{
+    uint32_t m_lastUpdateSeq;
+    DataRate m_curRate;
+    IntHop hop[IntHeader::maxHop];
+    uint32_t keep[IntHeader::maxHop];
+    uint32_t m_incStage;
+    double m_lastGap;
+    double u;
+    struct {
+        double u;
+        DataRate Rc;
+        uint32_t incStage;
+    }hopState[IntHeader::maxHop];
+    RdmaQpHp();
+};
+struct RdmaQpMycc{
+    uint32_t m_lastUpdateSeq;//上一次更新窗口时的seq
+    uint64_t m_lastUpdateTime;//上一次更新窗口的时间
+    uint64_t m_lastUpdateCongestTime;//上一次根据该数据包更新窗口时的数据包记录的拥塞发生的时间
+    uint64_t m_lastUpdateIdleTime;//上一次根据该数据包更新窗口时的数据包记录的空闲发生的时间
+
+    uint32_t m_currentWinSize;//当前窗口的大小
+    uint32_t m_lastWinSize;//上一个窗口的大小
+
+    uint64_t m_congestTimeStamp;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
+    uint64_t m_idleTimeStamp;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+    uint32_t m_depth;
+    uint16_t m_ratio;
+    uint32_t m_rTs;//队列空闲时的时间
+    uint32_t m_dTs;//发生拥塞时的时间
+    uint32_t m_max_dRate;
+    uint32_t m_max_rRate;
+    RdmaQpMycc();
+};
+struct RdmaQpTimely{
+    uint32_t m_lastUpdateSeq;
+    DataRate m_curRate;
+    uint32_t m_incStage;
+    uint64_t lastRtt;
+    double rttDiff;
+    RdmaQpTimely();
+};
+struct RdmaQpDctcp{
+    uint32_t m_lastUpdateSeq;
+    uint32_t m_caState;
+    uint32_t m_highSeq; // when to exit cwr
+    double m_alpha;
+    uint32_t m_ecnCnt;
+    uint32_t m_batchSizeOfAlpha;
+    RdmaQpDctcp();
+};
+struct RdmaQpHpPint{
+    uint32_t m_lastUpdateSeq;
+    DataRate m_curRate;
+    uint32_t m_incStage;
+    RdmaQpHpPint();
+};
+
+/**
+ * Array indexed by QP slot, allocated in chunks that never move, so
+ * references to the entries stay valid while the table grows. The chunks
+ * are aligned to alignof(T) with posix_memalign, as new T[] only aligns to
+ * 16 bytes before C++17.
+ */
+template <typename T>
+class RdmaQpSlab{
+public:
+    static const uint32_t chunkShift = 6;
+    RdmaQpSlab() {}
+    ~RdmaQpSlab(){
+        for (uint32_t i = 0; i < m_chunk.size(); i++){
+            for (uint32_t j = 0; j < (1u << chunkShift); j++)
+                m_chunk[i][j].~T();
+            free(m_chunk[i]);
+        }
+    }
+    inline T& operator[](uint32_t slot){
+        return m_chunk[slot >> chunkShift][slot & ((1u << chunkShift) - 1)];
+    }
+    void Reset(uint32_t slot){ // (re)initialize the entry of a new QP
+        while ((slot >> chunkShift) >= m_chunk.size()){
+            void *b;
+            if (posix_memalign(&b, alignof(T) < sizeof(void*) ? sizeof(void*) : alignof(T), sizeof(T) << chunkShift) != 0)
+                NS_FATAL_ERROR("RdmaQpSlab: out of memory");
+            T *chunk = static_cast<T*>(b);
+            for (uint32_t j = 0; j < (1u << chunkShift); j++)
+                new (&chunk[j]) T();
+            m_chunk.push_back(chunk);
+        }
+        (*this)[slot] = T();
+    }
+private:
+    RdmaQpSlab(const RdmaQpSlab&);
+    RdmaQpSlab& operator=(const RdmaQpSlab&);
+    std::vector<T*> m_chunk;
+};
+
+/**
+ * How to build the per-QP state of a CC algorithm, which the RdmaQpTable
+ * only knows by its size.
+ */
+struct RdmaQpCcState{
+    uint32_t size;
+    bool trivial; // plain data, saved in a checkpoint as its bytes
+    void (*construct)(void *state);
+    void (*destruct)(void *state);
+
+    template <typename State>
+    static RdmaQpCcState Of(void){
+        RdmaQpCcState s = {sizeof(State), std::is_trivially_copyable<State>::value, &Construct<State>, &Destruct<State>};
+        return s;
+    }
+private:
+    template <typename State>
+    static void Construct(void *state){
+        new (state) State();
+    }
+    template <typename State>
+    static void Destruct(void *state){
+        static_cast<State*>(state)->~State();
+    }
+};
+
+/**
+ * Like RdmaQpSlab, for the per-QP state of the CC algorithm: chunks of raw
+ * memory where the entries are built when a slot is allocated and
+ * destroyed when it is freed.
+ */
+class RdmaQpCcSlab{
+public:
+    RdmaQpCcSlab(const RdmaQpCcState &type);
+    ~RdmaQpCcSlab();
+    inline void* operator[](uint32_t slot){
+        return m_chunk[slot >> RdmaQpSlab<RdmaQpHot>::chunkShift] + (slot & ((1u << RdmaQpSlab<RdmaQpHot>::chunkShift) - 1)) * m_size;
+    }
+    void Construct(uint32_t slot);
+    void Destruct(uint32_t slot);
+    uint32_t GetStateSize(void) const;
+    bool IsTrivial(void) const;
+    uint32_t GetSlotSize(void) const; // bytes per entry
+private:
+    RdmaQpCcSlab(const RdmaQpCcSlab&);
+    RdmaQpCcSlab& operator=(const RdmaQpCcSlab&);
+    RdmaQpCcState m_type;
+    uint32_t m_size; // m_type.size rounded up to 8 bytes
+    std::vector<uint8_t*> m_chunk;
+};
+
+class RdmaQueuePair;
+
+/**
+ * \brief State of the tx QPs of a host, in arrays indexed by QP slot.
+ *
+ * The scheduling state (RdmaQpHot) of all QPs is contiguous, so the NIC
+ * scans it without touching the QP objects, and the state of the CC
+ * algorithm is in its own array, away from the hot path, with entries of
+ * the size of that algorithm's state. The RdmaQueuePair itself is built in
+ * a third array, so starting a flow allocates nothing once the table has
+ * grown. The table is per RdmaHw rather than per NIC, so a QP keeps its
+ * slot when RedistributeQp moves it to another NIC. A slot is freed with
+ * its RdmaQueuePair.
+ */
+class RdmaQpTable : public SimpleRefCount<RdmaQpTable>{
+public:
+    RdmaQpTable(const RdmaQpCcState &cc);
+    ~RdmaQpTable();
+    uint32_t Alloc(void);
+    uint32_t AllocAt(uint32_t slot); // the slot of a QP restored from a checkpoint, in use there
+    void Free(uint32_t slot);
+    uint32_t GetNActive(void) const; // slots in use
+    uint32_t GetNSlots(void) const; // slots ever allocated
+    // the slots ever allocated and the free ones; the QPs restore their own slots
+    void Save(CheckpointWriter &w) const;
+    void Restore(CheckpointReader &r);
+    void* GetQpMemory(uint32_t slot); // where the RdmaQueuePair of the slot is built
+
+    RdmaQpSlab<RdmaQpHot> m_hot;
+    RdmaQpCcSlab m_cc;
+private:
+    uint32_t m_n; // slots ever allocated
+    std::vector<uint32_t> m_free;
+    std::vector<uint64_t*> m_qpChunk; // the memory of the RdmaQueuePairs, by chunks like the slabs
+};
+
+// gives the memory of a RdmaQueuePair back to its slot when the last Ptr to it goes
+struct RdmaQpDeleter{
+    static void Delete(RdmaQueuePair *qp);
+};
+
+/**
+ * \brief Handle of a tx QP.
+ *
+ * The QP object keeps the identity of the flow and the cold fields; the
+ * scheduling and CC state are entries of the RdmaQpTable it was created
+ * in. The members below that are references point to those entries, so
+ * qp->snd_nxt, qp->m_rate... are used as plain members.
+ *
+ * It is not an ns3::Object, whose construction (attributes, aggregation)
+ * cost more than a flow of a few packets: Create builds it in the table,
+ * in its slot, and it goes back there when the last Ptr to it is dropped.
+ */
+class RdmaQueuePair : public SimpleRefCount<RdmaQueuePair, empty, RdmaQpDeleter> {
 public:
+    Ptr<RdmaQpTable> m_table;
+    uint32_t m_slot; // index in m_table
+    RdmaQpHot &m_hot;
+
     Time startTime;
     Ipv4Address sip, dip;
     uint16_t sport, dport;
-    uint64_t m_size;
-    uint64_t snd_nxt, snd_una; // next seq to send, the highest unacked seq
-    uint16_t m_pg;
+    uint64_t &m_size;
+    uint64_t &snd_nxt, &snd_una; // next seq to send, the highest unacked seq
+    uint16_t &m_pg;
     uint16_t m_ipid;
-    uint32_t m_win; // bound of on-the-fly packets
+    uint16_t m_rxQpId; // id of the receiver's qp plus one, learned from the ACKs (0: unknown)
+    uint32_t &m_win; // bound of on-the-fly packets
     uint64_t m_baseRtt; // base RTT of this qp
-    DataRate m_max_rate; // max rate
-    bool m_var_win; // variable window size
-    Time m_nextAvail;    //< Soonest time of next send
+    DataRate &m_max_rate; // max rate
+    bool &m_var_win; // variable window size
+    Time &m_nextAvail;    //< Soonest time of next send
     uint32_t wp; // current window of packets
     uint32_t lastPktSize;
     Callback<void> m_notifyAppFinish;
+    uint16_t m_notify; // index in the RdmaHw's m_flowNotify plus one (0: none)
+    uint32_t m_availPos; // position in its group's m_avail heap (RdmaQueuePairGroup::NO_POS: not in it)
+
+    /******************************
+     * loss statistics
+     *****************************/
+    uint32_t m_nackRecv; // NACKs received
+    uint32_t m_retxCnt; // go-back-N recoveries
+    uint64_t m_retxBytes; // bytes rewound (to be sent again) by the recoveries
 
     /******************************
      * runtime states
      *****************************/
-    DataRate m_rate;    //< Current rate
-    struct {
-        DataRate m_targetRate;    //< Target rate
-        EventId m_eventUpdateAlpha;
-        double m_alpha;
-        bool m_alpha_cnp_arrived; // indicate if CNP arrived in the last slot
-        bool m_first_cnp; // indicate if the current CNP is the first CNP
-        EventId m_eventDecreaseRate;
-        bool m_decrease_cnp_arrived; // indicate if CNP arrived in the last slot
-        uint32_t m_rpTimeStage;
-        EventId m_rpTimer;
-    } mlx;
-    struct {
-        uint32_t m_lastUpdateSeq;
-        DataRate m_curRate;
-        IntHop hop[IntHeader::maxHop];
-        uint32_t keep[IntHeader::maxHop];
-        uint32_t m_incStage;
-        double m_lastGap;
-        double u;
-        struct {
-            double u;
-            DataRate Rc;
-            uint32_t incStage;
-        }hopState[IntHeader::maxHop];
-    } hp;
-    struct{
-        uint32_t m_lastUpdateSeq;//上一次更新窗口时的seq
-        uint64_t m_lastUpdateTime;//上一次更新窗口的时间
-        uint64_t m_lastUpdateCongestTime;//上一次根据该数据包更新窗口时的数据包记录的拥塞发生的时间
-        uint64_t m_lastUpdateIdleTime;//上一次根据该数据包更新窗口时的数据包记录的空闲发生的时间
-
-        uint32_t m_currentWinSize;//当前窗口的大小
-        uint32_t m_lastWinSize;//上一个窗口的大小
-
-        uint64_t m_congestTimeStamp;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
-        uint64_t m_idleTimeStamp;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-        uint32_t m_depth;
-        uint16_t m_ratio;
-        uint32_t m_rTs;//队列空闲时的时间
-        uint32_t m_dTs;//发生拥塞时的时间
-        uint32_t m_max_dRate;
-        uint32_t m_max_rRate;
-    }mycc;
-    struct{
-        uint32_t m_lastUpdateSeq;
-        DataRate m_curRate;
-        uint32_t m_incStage;
-        uint64_t lastRtt;
-        double rttDiff;
-    } tmly;
-    struct{
-        uint32_t m_lastUpdateSeq;
-        uint32_t m_caState;
-        uint32_t m_highSeq; // when to exit cwr
-        double m_alpha;
-        uint32_t m_ecnCnt;
-        uint32_t m_batchSizeOfAlpha;
-    } dctcp;
-    struct{
-        uint32_t m_lastUpdateSeq;
-        DataRate m_curRate;
-        uint32_t m_incStage;
-    }hpccPint;
+    DataRate &m_rate;    //< Current rate
+    void *m_ccState; // state of the CC algorithm of the RdmaHw, in m_table
+
+    // the CC state, State must be the one of the RdmaHw's algorithm
+    template <typename State>
+    inline State& GetCc(void){
+        NS_ASSERT_MSG(m_table->m_cc.GetStateSize() == sizeof(State), "GetCc with the state of another CC algorithm");
+        return *static_cast<State*>(m_ccState);
+    }
     /***********
      * methods
      **********/
-    static TypeId GetTypeId (void);
-    RdmaQueuePair(uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport);
+    static Ptr<RdmaQueuePair> Create(Ptr<RdmaQpTable> table, uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport);
+    static Ptr<RdmaQueuePair> Create(Ptr<RdmaQpTable> table, uint32_t slot); // a QP restored from a checkpoint, see Restore
+    // all the state of the QP, its slot excepted: the restored QP is built in it first
+    void Save(CheckpointWriter &w) const;
+    void Restore(CheckpointReader &r);
     void SetSize(uint64_t size);
     void SetWin(uint32_t win);
     void SetBaseRtt(uint64_t baseRtt);
@@ -115,10 +348,15 @@ public:
     bool IsWinBound();
     uint64_t GetWin(); // window size calculated from m_rate
     bool IsFinished();
-    uint64_t HpGetCurWin(); // window size calculated from hp.m_curRate, used by HPCC
+private:
+    friend struct RdmaQpDeleter;
+    RdmaQueuePair(Ptr<RdmaQpTable> table, uint32_t slot);
+    RdmaQueuePair(const RdmaQueuePair&);
+    RdmaQueuePair& operator=(const RdmaQueuePair&);
+    ~RdmaQueuePair();
 };
 
-class RdmaRxQueuePair : public Object { // Rx side queue pair
+class RdmaRxQueuePair { // Rx side queue pair, an entry of RdmaRxQpTable
 public:
     struct ECNAccount{
         uint16_t qIndex;
@@ -132,20 +370,60 @@ public:
     uint32_t sip, dip;
     uint16_t sport, dport;
     uint16_t m_ipid;
+    uint16_t m_id; // dense id of this rx qp in its RdmaHw plus one, 0 if it has none
+    uint32_t m_slot; // index in the RdmaRxQpTable
     uint32_t ReceiverNextExpectedSeq;
     Time m_nackTimer;
+    Time m_lastActive; // arrival of the last data packet, for the idle timeout
     int32_t m_milestone_rx;
     uint32_t m_lastNACK;
-    EventId QcnTimerEvent; // if destroy this rxQp, remember to cancel this timer
+    uint32_t m_nackSent;
+    uint32_t m_outOfOrder; // packets beyond the expected seq (lost before them)
+    uint32_t m_duplicate;
+    EventId QcnTimerEvent; // cancelled when the rx qp is freed
 
-    static TypeId GetTypeId (void);
     RdmaRxQueuePair();
     uint32_t GetHash(void);
 };
 
+/**
+ * \brief The rx QPs of a host, in a slab indexed by slot.
+ *
+ * Entries never move, so RdmaHw hands out plain pointers to them. A freed
+ * entry is reset (its m_id is 0) and its slot is the next one allocated.
+ */
+class RdmaRxQpTable{
+public:
+    RdmaRxQpTable();
+    ~RdmaRxQpTable();
+    RdmaRxQueuePair* Alloc(void); // a new entry, with m_slot set
+    void Free(RdmaRxQueuePair *q);
+    inline RdmaRxQueuePair* Get(uint32_t slot){ // NULL if the slot was never allocated
+        return slot < m_n ? &m_slab[slot] : NULL;
+    }
+    // all the entries, free ones included, since a freed slot is reused first
+    void Save(CheckpointWriter &w);
+    void Restore(CheckpointReader &r);
+private:
+    RdmaQpSlab<RdmaRxQueuePair> m_slab;
+    uint32_t m_n; // slots ever allocated
+    std::vector<uint32_t> m_free;
+};
+
 class RdmaQueuePairGroup : public Object {
 public:
+    static const uint32_t NO_POS = 0xffffffff;
+
     std::vector<Ptr<RdmaQueuePair> > m_qps;
+    std::vector<RdmaQpHot*> m_hot; // m_hot[i] is &m_qps[i]->m_hot, what the NIC scans
+    /*
+     * Min-heap of the QPs on m_nextAvail, so the NIC reads the soonest
+     * wakeup without scanning the QPs. It holds every QP of the group with
+     * bytes left (and maybe some without, dropped when they reach the top):
+     * UpdateAvail must be called after each change of a QP's m_nextAvail
+     * and after snd_nxt goes back.
+     */
+    std::vector<RdmaQueuePair*> m_avail;
     //std::vector<Ptr<RdmaRxQueuePair> > m_rxQps;
 
     static TypeId GetTypeId (void);
@@ -153,9 +431,20 @@ public:
     uint32_t GetN(void);
     Ptr<RdmaQueuePair> Get(uint32_t idx);
     Ptr<RdmaQueuePair> operator[](uint32_t idx);
+    inline RdmaQpHot& GetHot(uint32_t idx){
+        return *m_hot[idx];
+    }
     void AddQp(Ptr<RdmaQueuePair> qp);
     //void AddRxQp(Ptr<RdmaRxQueuePair> rxQp);
     void Clear(void);
+
+    void UpdateAvail(RdmaQueuePair *qp);
+    void RemoveAvail(RdmaQueuePair *qp);
+    // the soonest m_nextAvail of the QPs with bytes left, or the maximum simulation time if none
+    Time GetNextAvail(void);
+private:
+    void SiftUp(uint32_t i);
+    void SiftDown(uint32_t i);
 };
 
 }
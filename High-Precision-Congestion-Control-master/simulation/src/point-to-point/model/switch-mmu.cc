@@ -9,10 +9,16 @@
 #include "ns3/global-value.h"
 #include "ns3/boolean.h"
 #include "ns3/simulator.h"
+#include "ns3/mem-profiler.h"
+#include "ns3/checkpoint.h"
 #include "switch-mmu.h"
 
 NS_LOG_COMPONENT_DEFINE("SwitchMmu");
 namespace ns3 {
+    NS_MEM_CATEGORY(g_memMmu, "ns3::SwitchMmu");
+
+    NS_OBJECT_ENSURE_REGISTERED(SwitchMmu);
+
     TypeId SwitchMmu::GetTypeId(void){
         static TypeId tid = TypeId("ns3::SwitchMmu")
             .SetParent<Object>()
@@ -25,12 +31,34 @@ namespace ns3 {
         reserve = 4 * 1024;
         resume_offset = 3 * 1024;
 
+        // no ECN marking until ConfigEcn
+        for (uint32_t i = 0; i < pCnt; i++){
+            kmin[i] = kmax[i] = 0xffffffff;
+            pmax[i] = 0;
+            ecn_slope[i] = 0;
+        }
+        // dynamic threshold is off by default, alpha = 1
+        dynamic_egress = false;
+        for (uint32_t i = 0; i < qCnt; i++)
+            egress_alpha[i] = 256;
+
         // headroom
         shared_used_bytes = 0;
         memset(hdrm_bytes, 0, sizeof(hdrm_bytes));
         memset(ingress_bytes, 0, sizeof(ingress_bytes));
         memset(paused, 0, sizeof(paused));
         memset(egress_bytes, 0, sizeof(egress_bytes));
+        egress_total_bytes = 0;
+
+        memset(ingress_drop_pkts, 0, sizeof(ingress_drop_pkts));
+        memset(egress_drop_pkts, 0, sizeof(egress_drop_pkts));
+        memset(egress_drop_bytes, 0, sizeof(egress_drop_bytes));
+
+        m_uv = CreateObject<UniformRandomVariable>();
+        NS_MEM_ALLOC(g_memMmu, sizeof(SwitchMmu));
+    }
+    SwitchMmu::~SwitchMmu(){
+        NS_MEM_FREE(g_memMmu, sizeof(SwitchMmu));
     }
     bool SwitchMmu::CheckIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
         if (psize + hdrm_bytes[port][qIndex] > headroom[port] && psize + GetSharedUsed(port, qIndex) > GetPfcThreshold(port)){
@@ -38,11 +66,22 @@ namespace ns3 {
             for (uint32_t i = 1; i < 64; i++)
                 printf("(%u,%u)", hdrm_bytes[i][3], ingress_bytes[i][3]);
             printf("\n");
+            ingress_drop_pkts[port][qIndex]++;
             return false;
         }
         return true;
     }
     bool SwitchMmu::CheckEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
+        if (!dynamic_egress)
+            return true;
+        // Broadcom-style dynamic threshold: the queue may grow up to alpha times the free shared buffer
+        uint32_t free_bytes = buffer_size > egress_total_bytes ? buffer_size - egress_total_bytes : 0;
+        uint64_t thresh = ((uint64_t)free_bytes * egress_alpha[qIndex]) >> 8;
+        if (egress_bytes[port][qIndex] + psize > thresh || psize > free_bytes){
+            egress_drop_pkts[port][qIndex]++;
+            egress_drop_bytes[port][qIndex] += psize;
+            return false;
+        }
         return true;
     }
     void SwitchMmu::UpdateIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
@@ -61,6 +100,7 @@ namespace ns3 {
     }
     void SwitchMmu::UpdateEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
         egress_bytes[port][qIndex] += psize;
+        egress_total_bytes += psize;
     }
     void SwitchMmu::RemoveFromIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
         uint32_t from_hdrm = std::min(hdrm_bytes[port][qIndex], psize);
@@ -71,6 +111,7 @@ namespace ns3 {
     }
     void SwitchMmu::RemoveFromEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
         egress_bytes[port][qIndex] -= psize;
+        egress_total_bytes -= psize;
     }
     bool SwitchMmu::CheckShouldPause(uint32_t port, uint32_t qIndex){
         return !paused[port][qIndex] && (hdrm_bytes[port][qIndex] > 0 || GetSharedUsed(port, qIndex) >= GetPfcThreshold(port));
@@ -98,19 +139,24 @@ namespace ns3 {
     bool SwitchMmu::ShouldSendCN(uint32_t ifindex, uint32_t qIndex){
         if (qIndex == 0)
             return false;
-        if (egress_bytes[ifindex][qIndex] > kmax[ifindex])
+        uint32_t qlen = egress_bytes[ifindex][qIndex];
+        if (qlen <= kmin[ifindex])
+            return false;
+        if (qlen > kmax[ifindex])
             return true;
-        /*if (egress_bytes[ifindex][qIndex] > kmin[ifindex]){
-            double p = pmax[ifindex] * double(egress_bytes[ifindex][qIndex] - kmin[ifindex]) / (kmax[ifindex] - kmin[ifindex]);
-            //if (UniformVariable(0, 1).GetValue() < p)
-                return true;
-        }*/
-        return false;
+        // RED ramp: p = pmax * (qlen - kmin) / (kmax - kmin), in 1/2^32 units
+        uint64_t p = (uint64_t)(qlen - kmin[ifindex]) * ecn_slope[ifindex];
+        return (uint64_t)(m_uv->GetValue() * 4294967296.0) < p;
     }
     void SwitchMmu::ConfigEcn(uint32_t port, uint32_t _kmin, uint32_t _kmax, double _pmax){
         kmin[port] = _kmin * 1000;
         kmax[port] = _kmax * 1000;
         pmax[port] = _pmax;
+        ecn_slope[port] = kmax[port] > kmin[port] ? (uint64_t)(_pmax * 4294967296.0 / (kmax[port] - kmin[port])) : 0;
+    }
+    void SwitchMmu::ConfigEgressAlpha(uint32_t qIndex, double alpha){
+        NS_ASSERT_MSG(qIndex < qCnt, "egress alpha for a queue out of range");
+        egress_alpha[qIndex] = alpha * 256;
     }
     void SwitchMmu::ConfigHdrm(uint32_t port, uint32_t size){
         headroom[port] = size;
@@ -126,4 +172,49 @@ namespace ns3 {
     void SwitchMmu::ConfigBufferSize(uint32_t size){
         buffer_size = size;
     }
+    void SwitchMmu::Save(CheckpointWriter &w) const{
+        // the counters of the (port, queue) that have seen traffic, most have not
+        std::vector<uint32_t> used;
+        for (uint32_t i = 0; i < pCnt; i++)
+            for (uint32_t j = 0; j < qCnt; j++)
+                if (hdrm_bytes[i][j] || ingress_bytes[i][j] || paused[i][j] || egress_bytes[i][j]
+                        || ingress_drop_pkts[i][j] || egress_drop_pkts[i][j] || egress_drop_bytes[i][j])
+                    used.push_back(i * qCnt + j);
+        w.Put((uint32_t)used.size());
+        for (uint32_t k = 0; k < used.size(); k++){
+            uint32_t i = used[k] / qCnt, j = used[k] % qCnt;
+            w.Put(used[k]);
+            w.Put(hdrm_bytes[i][j]);
+            w.Put(ingress_bytes[i][j]);
+            w.Put(paused[i][j]);
+            w.Put(egress_bytes[i][j]);
+            w.Put(ingress_drop_pkts[i][j]);
+            w.Put(egress_drop_pkts[i][j]);
+            w.Put(egress_drop_bytes[i][j]);
+        }
+        w.Put(shared_used_bytes);
+        w.Put(egress_total_bytes);
+        w.PutStream(m_uv);
+    }
+    void SwitchMmu::Restore(CheckpointReader &r){
+        uint32_t n = r.Get<uint32_t>();
+        for (uint32_t k = 0; k < n && !r.Failed(); k++){
+            uint32_t idx = r.Get<uint32_t>();
+            if (idx >= pCnt * qCnt){
+                r.Fail("a switch queue of the checkpoint is out of range");
+                break;
+            }
+            uint32_t i = idx / qCnt, j = idx % qCnt;
+            r.Get(hdrm_bytes[i][j]);
+            r.Get(ingress_bytes[i][j]);
+            r.Get(paused[i][j]);
+            r.Get(egress_bytes[i][j]);
+            r.Get(ingress_drop_pkts[i][j]);
+            r.Get(egress_drop_pkts[i][j]);
+            r.Get(egress_drop_bytes[i][j]);
+        }
+        r.Get(shared_used_bytes);
+        r.Get(egress_total_bytes);
+        r.GetStream(m_uv);
+    }
 }
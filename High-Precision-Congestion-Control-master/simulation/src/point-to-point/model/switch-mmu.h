@@ -3,10 +3,13 @@
 
 #include <unordered_map>
 #include <ns3/node.h>
+#include <ns3/random-variable-stream.h>
 
 namespace ns3 {
 
 class Packet;
+class CheckpointWriter;
+class CheckpointReader;
 
 class SwitchMmu: public Object{
 public:
@@ -16,6 +19,7 @@ public:
     static TypeId GetTypeId (void);
 
     SwitchMmu(void);
+    ~SwitchMmu();
 
     bool CheckIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize);
     bool CheckEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize);
@@ -37,10 +41,15 @@ public:
     bool ShouldSendCN(uint32_t ifindex, uint32_t qIndex);
 
     void ConfigEcn(uint32_t port, uint32_t _kmin, uint32_t _kmax, double _pmax);
+    void ConfigEgressAlpha(uint32_t qIndex, double alpha);
     void ConfigHdrm(uint32_t port, uint32_t size);
     void ConfigNPort(uint32_t n_port);
     void ConfigBufferSize(uint32_t size);
 
+    // save the runtime counters and the RED stream into a checkpoint
+    void Save(CheckpointWriter &w) const;
+    void Restore(CheckpointReader &r);
+
     // config
     uint32_t node_id;
     uint32_t buffer_size;
@@ -50,8 +59,12 @@ public:
     uint32_t resume_offset;
     uint32_t kmin[pCnt], kmax[pCnt];
     double pmax[pCnt];
+    uint64_t ecn_slope[pCnt]; // marking probability per byte above kmin, in 1/2^32 units
     uint32_t total_hdrm;
     uint32_t total_rsrv;
+    // dynamic threshold egress admission: queue (port, q) may hold up to egress_alpha[q] * (free buffer)
+    bool dynamic_egress;
+    uint32_t egress_alpha[qCnt]; // alpha in 1/256 units
 
     // runtime
     uint32_t shared_used_bytes;
@@ -59,6 +72,15 @@ public:
     uint32_t ingress_bytes[pCnt][qCnt];
     uint32_t paused[pCnt][qCnt];
     uint32_t egress_bytes[pCnt][qCnt];
+    uint32_t egress_total_bytes;
+
+    // drop accounting
+    uint32_t ingress_drop_pkts[pCnt][qCnt]; // by ingress port
+    uint32_t egress_drop_pkts[pCnt][qCnt]; // by egress port
+    uint64_t egress_drop_bytes[pCnt][qCnt];
+
+private:
+    Ptr<UniformRandomVariable> m_uv; // for RED marking
 };
 
 } /* namespace ns3 */
@@ -2,10 +2,11 @@
 #include "ns3/ipv4.h"
 #include "ns3/packet.h"
 #include "ns3/ipv4-header.h"
-#include "ns3/flow-id-tag.h"
 #include "ns3/boolean.h"
 #include "ns3/uinteger.h"
 #include "ns3/double.h"
+#include "ns3/mem-profiler.h"
+#include "ns3/checkpoint.h"
 #include "switch-node.h"
 //#include "enc-net-device.h"
 #include "qbb-net-device.h"
@@ -16,6 +17,10 @@
 
 namespace ns3 {
 
+NS_MEM_CATEGORY(g_memSwitch, "ns3::SwitchNode"); // most of it is m_bytes
+
+NS_OBJECT_ENSURE_REGISTERED(SwitchNode);
+
 TypeId SwitchNode::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::SwitchNode")
@@ -46,6 +51,18 @@ TypeId SwitchNode::GetTypeId (void)
 }
 
 SwitchNode::SwitchNode() {
+	Construct();
+}
+
+SwitchNode::SwitchNode(uint32_t systemId) : Node(systemId) {
+	Construct();
+}
+
+SwitchNode::~SwitchNode() {
+	NS_MEM_FREE(g_memSwitch, sizeof(SwitchNode));
+}
+
+void SwitchNode::Construct(void) {
 
     //id = 0;
 	m_node_type = 1;
@@ -56,21 +73,18 @@ SwitchNode::SwitchNode() {
 			for (uint32_t k = 0; k < qCnt; k++)
 				m_bytes[i][j][k] = 0;
 	for (uint32_t i = 0; i < pCnt; i++)
-		m_txBytes[i] = 0;
-	for (uint32_t i = 0; i < pCnt; i++)
-		m_lastPktSize[i] = m_lastPktTs[i] = 0;
+		m_lastPktSize[i] = 0;
 	for (uint32_t i = 0; i < pCnt; i++)
 		m_u[i] = 0;
 	for (uint32_t i = 0; i < pCnt; i++)
 		max_rate[i] = 0;
-	for (uint32_t i = 0; i < pCnt; i++)
-		m_rate[i] = 0;
-	for (uint32_t i = 0; i < pCnt; i++)
-		m_cnt[i] = 0;
+	m_noRouteDrops = 0;
+	NS_MEM_ALLOC(g_memSwitch, sizeof(SwitchNode));
 }
 
-void SwitchNode::SetMaxRate(uint8_t _port, uint64_t _max_rate) {
+void SwitchNode::SetMaxRate(uint32_t _port, uint64_t _max_rate) {
 	max_rate[_port] = _max_rate;
+	m_txRate[_port].SetMaxRate(_max_rate);
 	Ptr<QbbNetDevice> device = DynamicCast<QbbNetDevice>(m_devices[_port]);
 	device->SetDataRate(_max_rate);
 }
@@ -131,9 +145,7 @@ void SwitchNode::SendToDev(Ptr<Packet>p, MyCustomHeader &ch){
 		qIndex = 1;
 
 		// admission control
-		FlowIdTag t;
-		p->PeekPacketTag(t);
-		uint32_t inDev = t.GetFlowId();
+		uint32_t inDev = p->GetSwitchMeta().inDev;
 		if (qIndex != 0){ //not highest priority
 			if (m_mmu->CheckIngressAdmission(inDev, qIndex, p->GetSize()) && m_mmu->CheckEgressAdmission(idx, qIndex, p->GetSize())){			// Admission control
 				m_mmu->UpdateIngressAdmission(inDev, qIndex, p->GetSize());
@@ -146,8 +158,10 @@ void SwitchNode::SendToDev(Ptr<Packet>p, MyCustomHeader &ch){
 		}
 		m_bytes[inDev][idx][qIndex] += p->GetSize();
 		m_devices[idx]->SwitchSend(qIndex, p, ch);
-	}else
+	}else{
+		m_noRouteDrops++;
 		return; // Drop
+	}
 }
 
 void SwitchNode::AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx){
@@ -167,14 +181,12 @@ bool SwitchNode::SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> pack
 }
 
 void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p){
-	FlowIdTag t;
-	p->PeekPacketTag(t);
 	if (qIndex != 0){
-		uint32_t inDev = t.GetFlowId();
+		uint32_t inDev = p->GetSwitchMeta().inDev;
 		m_mmu->RemoveFromIngressAdmission(inDev, qIndex, p->GetSize());
 		m_mmu->RemoveFromEgressAdmission(ifIndex, qIndex, p->GetSize());
 		m_bytes[inDev][ifIndex][qIndex] -= p->GetSize();
-		/*if (m_ecnEnabled){
+		if (m_ecnEnabled){
 			bool egressCongested = m_mmu->ShouldSendCN(ifIndex, qIndex);
 			if (egressCongested){
 				PppHeader ppp;
@@ -185,30 +197,19 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 				p->AddHeader(h);
 				p->AddHeader(ppp);
 			}
-		}*/
+		}
 		// 不需要暂停，丢包即可
 		// CheckAndSendPfc(inDev, qIndex);
 		// CheckAndSendResume(inDev, qIndex);
 	}
 
-	m_txBytes[ifIndex] += p->GetSize();
 	m_lastPktSize[ifIndex] = p->GetSize();
-	++m_cnt[ifIndex];
 
 	// 用于计算实时速率
-	uint64_t now_ts = Simulator::Now().GetTimeStep() +  (uint64_t)(p->GetSize())*8*1000000000/max_rate[ifIndex];
-	uint64_t dt = now_ts - m_lastPktTs[ifIndex];
-	uint64_t now_rate = 0;
-
 	// 或者也可以在.h里加一个各端口计数变量，每10个包或过去10us测一次
-	if (m_cnt[ifIndex] == 10 || dt >= 1000*(100000000000/max_rate[ifIndex])) {
-		m_rate[ifIndex] = m_txBytes[ifIndex]*8*1000000000/dt;
-		m_lastPktTs[ifIndex] = now_ts;
-		m_txBytes[ifIndex] = 0;
-		m_cnt[ifIndex] = 0;
-	}
-
-	now_rate = m_rate[ifIndex];
+	RateRatioEstimator &est = m_txRate[ifIndex];
+	est.Dequeue(Simulator::Now().GetTimeStep(), p->GetSize());
+	uint64_t now_rate = est.GetRate();
 
 	
 	uint8_t* buf = p->GetBuffer();
@@ -216,8 +217,8 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 		MyIntHeader *ih = (MyIntHeader*)&buf[PppHeader::GetStaticSize() + 20 + 20 + 6];
 		Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(m_devices[ifIndex]);
 
-		uint8_t id = m_id;
-		uint32_t ts = m_lastPktTs[ifIndex];
+		uint16_t id = m_id;
+		uint64_t ts = est.GetLastTs();
 		int push_rst;
 		// 放置在数据包中的最大速率信息单位为100MB/s
 		uint64_t _max_rate = max_rate[ifIndex]/8/100000000;
@@ -228,7 +229,7 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 		std::cout << "depth: " << depth << std::endl;
 		std::cout << "rate: " << now_rate << std::endl;
 		std::cout << "max rate: " << dev->GetDataRate().GetBitRate() << std::endl;
-		std::cout << "ratio: " << (now_rate*10000)/max_rate[ifIndex] << std::endl;
+		std::cout << "ratio: " << est.GetRatio() << std::endl;
 		std::cout << std::endl;
 
 		if (push_rst < 0) {
@@ -236,7 +237,7 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 			// dev->GetDataRate().GetBitRate() 实际上和 max_rate[ifIndex]是一样的值
 			// 乘10000将比值转化为整数值，比方90.12%会变为9012
 			// uint64_t _ratio = (dev->GetDataRate().GetBitRate()*10000)/max_rate[ifIndex];
-			uint64_t _ratio = (now_rate*10000)/max_rate[ifIndex];
+			uint64_t _ratio = est.GetRatio();
 			_ratio = _ratio<10000 ? _ratio:10000;
 			push_rst = ih->PushRatio(id, ifIndex, _ratio, ts, _max_rate);
 			//if (_ratio >= 10000) {
@@ -256,4 +257,51 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 	
 }
 
+void SwitchNode::Save(CheckpointWriter &w) const{
+	uint32_t nDev = GetNDevices();
+	std::vector<uint32_t> used; // the (inDev, outDev, qidx) with bytes
+	for (uint32_t i = 0; i < nDev; i++)
+		for (uint32_t j = 0; j < nDev; j++)
+			for (uint32_t k = 0; k < qCnt; k++)
+				if (m_bytes[i][j][k])
+					used.push_back((i * pCnt + j) * qCnt + k);
+	const uint32_t *bytes = &m_bytes[0][0][0];
+	w.Put((uint32_t)used.size());
+	for (uint32_t n = 0; n < used.size(); n++){
+		w.Put(used[n]);
+		w.Put(bytes[used[n]]);
+	}
+	for (uint32_t i = 0; i < nDev; i++){
+		w.Put(m_txRate[i]);
+		w.Put(m_lastPktSize[i]);
+		w.Put(m_u[i]);
+	}
+	w.Put(m_noRouteDrops);
+	m_mmu->Save(w);
+}
+
+void SwitchNode::Restore(CheckpointReader &r){
+	uint32_t nDev = GetNDevices();
+	uint32_t *bytes = &m_bytes[0][0][0];
+	uint32_t n = r.Get<uint32_t>();
+	for (uint32_t k = 0; k < n && !r.Failed(); k++){
+		uint32_t idx = r.Get<uint32_t>();
+		if (idx >= pCnt * pCnt * qCnt){
+			r.Fail("a switch port of the checkpoint is out of range");
+			break;
+		}
+		r.Get(bytes[idx]);
+	}
+	for (uint32_t i = 0; i < nDev; i++){
+		RateRatioEstimator est = r.Get<RateRatioEstimator>();
+		if (!r.Failed() && est.GetMaxRate() != m_txRate[i].GetMaxRate())
+			r.Fail("the switch ports of the checkpoint have other rates");
+		m_txRate[i] = est;
+		r.Get(m_lastPktSize[i]);
+		r.Get(m_u[i]);
+	}
+	r.Get(m_noRouteDrops);
+	m_mmu->Restore(r);
+}
+
 } /* namespace ns3 */
@@ -5,10 +5,13 @@
 #include <ns3/node.h>
 #include "qbb-net-device.h"
 #include "switch-mmu.h"
+#include "rate-ratio-estimator.h"
 
 namespace ns3 {
 
 class Packet;
+class CheckpointWriter;
+class CheckpointReader;
 
 class SwitchNode : public Node{
 	static const uint32_t pCnt = 257;	// Number of ports used
@@ -19,12 +22,9 @@ class SwitchNode : public Node{
 	// monitor of PFC
 	uint32_t m_bytes[pCnt][pCnt][qCnt]; // m_bytes[inDev][outDev][qidx] is the bytes from inDev enqueued for outDev at qidx
 	
-	uint64_t m_txBytes[pCnt]; // counter of tx bytes
+	RateRatioEstimator m_txRate[pCnt]; // tx rate of each port, for the INT records
 
 	uint32_t m_lastPktSize[pCnt];
-	uint64_t m_lastPktTs[pCnt]; // ns
-	uint64_t m_rate[pCnt];
-	uint32_t m_cnt[pCnt];
 	double m_u[pCnt];
 
 protected:
@@ -34,12 +34,16 @@ protected:
 
 	uint32_t m_ackHighPrio; // set high priority for ACK/NACK
 
+public:
+	uint64_t m_noRouteDrops; // packets dropped because there is no routing entry (admission drops are counted in m_mmu)
+
 private:
 	int GetOutDev(Ptr<const Packet>, MyCustomHeader &ch);
 	void SendToDev(Ptr<Packet>p, MyCustomHeader &ch);
 	static uint32_t EcmpHash(const uint8_t* key, size_t len, uint32_t seed);
 	void CheckAndSendPfc(uint32_t inDev, uint32_t qIndex);
 	void CheckAndSendResume(uint32_t inDev, uint32_t qIndex);
+	void Construct(void);
 public:
 	Ptr<SwitchMmu> m_mmu;
 	//uint8_t id;
@@ -47,13 +51,19 @@ public:
 
 	static TypeId GetTypeId (void);
 	SwitchNode();
-	void SetMaxRate(uint8_t _port, uint64_t _max_rate);
+	SwitchNode(uint32_t systemId); // systemId: the MPI rank that owns this switch
+	~SwitchNode();
+	void SetMaxRate(uint32_t _port, uint64_t _max_rate); // also sets the rate of the port's device
 	void SetEcmpSeed(uint32_t seed);
 	void AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx);
 	void ClearTable();
 	bool SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, MyCustomHeader &ch);
 	void SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p);
 
+	// save the PFC and INT monitors and the MMU into a checkpoint; the devices save themselves
+	void Save(CheckpointWriter &w) const;
+	void Restore(CheckpointReader &r);
+
 	// for approximate calc in PINT
 	int logres_shift(int b, int l);
 	int log2apprx(int x, int b, int m, int l); // given x of at most b bits, use most significant m bits of x, calc the result in l bits
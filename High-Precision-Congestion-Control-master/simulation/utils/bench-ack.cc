@@ -0,0 +1,168 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Cost of the host side processing of a FIDCC ACK, split in its stages:
+ * parsing the headers, decoding the INT records into the feedback record
+ * (RdmaCcFidcc::DecodeFeedback) and the CC update (RdmaCcFidcc::HandleFeedback).
+ *
+ * The ACKs are built like RdmaHw::ReceiveTcp does, with random depth and
+ * ratio records. The CC update runs inside a window, so it never changes
+ * the rate (nor prints).
+ *
+ *   bench-ack [--n=<acks>] [--version=<INT version, 1 or 2>]
+ */
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/packet.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ppp-header.h"
+#include "ns3/custom-header-niux.h"
+#include "ns3/enc-header.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-cc-fidcc.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdlib.h>
+
+using namespace ns3;
+
+static const uint32_t nPackets = 1024; // distinct ACKs, reused round robin
+
+static Ptr<Packet>
+MakeAck (uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport)
+{
+  uint64_t now = Simulator::Now ().GetTimeStep ();
+  MyIntHeader ih;
+  ih.SetSendTime (now - 20000);
+  ih.PushRoute (rand () % 64, rand () % 16);
+  // most ACKs carry depth records, the others ratio records
+  if (rand () % 4 != 0)
+    {
+      for (uint32_t i = 0; i < MyIntHeader::maxNum; i++)
+        {
+          ih.PushDepth (rand () % 64, rand () % 16, 1000 + rand () % 100000, now - rand () % 10000, 100);
+        }
+    }
+  else
+    {
+      for (uint32_t i = 0; i < MyIntHeader::maxNum; i++)
+        {
+          ih.PushRatio (rand () % 64, rand () % 16, 5000 + rand () % 5000, now - rand () % 10000, 100);
+        }
+    }
+  encHeader encH;
+  encH.SetSeq (1000);
+  encH.SetSport (dport);
+  encH.SetDport (sport);
+  encH.SetMyIntHeader (ih);
+  Ptr<Packet> p = Create<Packet> (std::max (60 - 14 - 20 - (int)encH.GetSerializedSize (), 0));
+  p->AddHeader (encH);
+  Ipv4Header head;
+  head.SetDestination (Ipv4Address (sip));
+  head.SetSource (Ipv4Address (dip));
+  head.SetProtocol (0xFC);
+  head.SetTtl (64);
+  head.SetPayloadSize (p->GetSize ());
+  p->AddHeader (head);
+  PppHeader ppp;
+  ppp.SetProtocol (0x0021);
+  p->AddHeader (ppp);
+  return p;
+}
+
+static void
+Report (const char *name, uint32_t n, uint64_t ms)
+{
+  std::cout << name << ": " << (ms * 1e6 / n) << " ns/ack (" << ms << " ms)" << std::endl;
+}
+
+static void
+Run (uint32_t n)
+{
+  uint32_t sip = 0x0b000101, dip = 0x0b000201;
+  uint16_t sport = 10000, dport = 100;
+  Ptr<RdmaHw> rdma = CreateObject<RdmaHw> ();
+  rdma->SetAttribute ("CcAlgorithm", StringValue ("ns3::RdmaCcFidcc"));
+  rdma->InitCc ();
+  Ptr<RdmaCcFidcc> cc = DynamicCast<RdmaCcFidcc> (rdma->m_cc);
+  Ptr<RdmaQueuePair> qp = RdmaQueuePair::Create (rdma->m_qpTable, 0, Ipv4Address (sip), Ipv4Address (dip), sport, dport);
+  qp->SetBaseRtt (8000);
+  RdmaQpMycc &state = qp->GetCc<RdmaQpMycc> ();
+  state.m_currentWinSize = state.m_lastWinSize = 100000;
+  state.m_lastUpdateSeq = 1u << 30; // the ACKs stay inside the window
+
+  std::vector<Ptr<Packet> > acks;
+  for (uint32_t i = 0; i < nPackets; i++)
+    {
+      acks.push_back (MakeAck (sip, dip, sport, dport));
+    }
+  std::vector<MyCustomHeader> chs (nPackets, MyCustomHeader (MyCustomHeader::L2_Header | MyCustomHeader::L3_Header | MyCustomHeader::L4_Header));
+  std::vector<RdmaCcFidcc::Feedback> fbs (nPackets);
+
+  SystemWallClockMs time;
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      MyCustomHeader &ch = chs[i % nPackets];
+      ch.getInt = 1;
+      acks[i % nPackets]->PeekHeader (ch);
+    }
+  Report ("parse", n, time.End ());
+
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      RdmaCcFidcc::DecodeFeedback (chs[i % nPackets], fbs[i % nPackets]);
+    }
+  Report ("decode", n, time.End ());
+
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      cc->HandleFeedback (qp, acks[i % nPackets], chs[i % nPackets], fbs[i % nPackets]);
+    }
+  Report ("cc update", n, time.End ());
+
+  // what ReceiveAck does per ACK before the go-back-N bookkeeping
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      MyCustomHeader &ch = chs[i % nPackets];
+      ch.getInt = 1;
+      acks[i % nPackets]->PeekHeader (ch);
+      cc->HandleAck (qp, acks[i % nPackets], ch);
+    }
+  Report ("total", n, time.End ());
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 1000000;
+  argc--;
+  argv++;
+  while (argc > 0)
+    {
+      if (strncmp ("--n=", argv[0], strlen ("--n=")) == 0)
+        {
+          std::istringstream iss (argv[0] + strlen ("--n="));
+          iss >> n;
+        }
+      else if (strncmp ("--version=", argv[0], strlen ("--version=")) == 0)
+        {
+          std::istringstream iss (argv[0] + strlen ("--version="));
+          iss >> MyIntHeader::version;
+        }
+      argc--;
+      argv++;
+    }
+  std::cout << "Running bench-ack with n=" << n << " INT version " << MyIntHeader::version << std::endl;
+
+  // timestamps are relative to the simulation time: run at 2 s
+  Simulator::Schedule (Seconds (2), &Run, n);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return 0;
+}
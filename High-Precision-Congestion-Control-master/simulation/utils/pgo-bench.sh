@@ -0,0 +1,50 @@
+#!/bin/bash
+# Speedup of the LTO + PGO build over the optimized build on a reference run.
+#
+# usage: utils/pgo-bench.sh [config] [runs] [extra waf configure options...]
+# env:   BENCH_STOP_TIME  SIMULATOR_STOP_TIME of the reference run (default 2.1)
+#        NO_BUILD=1       reuse build-bench-base and build-bench-pgo from a previous run
+# Afterwards reconfigure the usual build directory (waf remembers the last --out).
+set -e
+cd "$(dirname "$0")/.."
+
+CONFIG=${1:-mix/config.txt}
+RUNS=${2:-3}
+shift 2 || shift $# || true
+WAF=${WAF:-./waf}
+BENCH_DIR=$PWD/build-bench-run
+BASE=build-bench-base
+PGO=build-bench-pgo
+
+if [ -z "$NO_BUILD" ]; then
+	$WAF configure -d optimized --out=$BASE "$@"
+	$WAF build
+	OUT=$PGO utils/pgo-build.sh $CONFIG "$@"
+fi
+
+mkdir -p $BENCH_DIR
+awk -v dir=$BENCH_DIR -v stop=${BENCH_STOP_TIME:-2.1} '
+	$1 ~ /^(TRACE_OUTPUT_FILE|FCT_OUTPUT_FILE|PFC_OUTPUT_FILE|QLEN_MON_FILE|STATS_MON_FILE|PARTITION_FILE)$/ {
+		n = split($2, p, "/"); print $1, dir "/" p[n]; next }
+	$1 == "SIMULATOR_STOP_TIME" { print $1, stop; next }
+	{ print }' $CONFIG > $BENCH_DIR/config.txt
+
+# best wall-clock seconds of RUNS runs each, interleaved so that load changes on the machine hit both alike
+run(){
+	local s=$(date +%s.%N)
+	LD_LIBRARY_PATH=$1 $1/scratch/third $BENCH_DIR/config.txt > $BENCH_DIR/log.txt
+	awk -v s=$s -v e=$(date +%s.%N) -v b=$2 'BEGIN{t = e - s; print (b == "" || t < b) ? t : b}'
+}
+t_base=
+t_pgo=
+for i in $(seq $RUNS); do
+	t_base=$(run $BASE $t_base)
+	t_pgo=$(run $PGO $t_pgo)
+done
+
+awk -v c=$CONFIG -v stop=${BENCH_STOP_TIME:-2.1} -v n=$RUNS -v a=$t_base -v b=$t_pgo 'BEGIN{
+	printf "reference: %s, stop time %s, best of %d runs\n", c, stop, n
+	printf "optimized: %.3f s\n", a
+	printf "lto+pgo:   %.3f s\n", b
+	printf "speedup:   %.2fx\n", a / b
+}'
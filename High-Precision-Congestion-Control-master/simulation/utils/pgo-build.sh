@@ -0,0 +1,41 @@
+#!/bin/bash
+# LTO + profile guided build of the simulator:
+#   1. build with the lto profile, instrumented (--pgo=generate)
+#   2. run a training config derived from a normal config (mix/config.txt by default)
+#   3. rebuild with the collected profile (--pgo=use)
+#
+# usage: utils/pgo-build.sh [config] [extra waf configure options...]
+# env:   OUT            waf build directory (default build)
+#        PGO_STOP_TIME  SIMULATOR_STOP_TIME of the training run (default 2.05, flows of mix/flow.txt start at 2)
+#        WAF            waf command (default ./waf)
+set -e
+cd "$(dirname "$0")/.."
+
+CONFIG=${1:-mix/config.txt}
+shift || true
+OUT=${OUT:-build}
+WAF=${WAF:-./waf}
+PGO_DIR=$PWD/$OUT/pgo
+TRAIN_DIR=$PWD/$OUT/pgo-train
+
+# training config: same topology, flows and CC settings, outputs in TRAIN_DIR, shorter run
+mkdir -p $TRAIN_DIR
+awk -v dir=$TRAIN_DIR -v stop=${PGO_STOP_TIME:-2.05} '
+	$1 ~ /^(TRACE_OUTPUT_FILE|FCT_OUTPUT_FILE|PFC_OUTPUT_FILE|QLEN_MON_FILE|STATS_MON_FILE|PARTITION_FILE)$/ {
+		n = split($2, p, "/"); print $1, dir "/" p[n]; next }
+	$1 == "SIMULATOR_STOP_TIME" { print $1, stop; next }
+	{ print }' $CONFIG > $TRAIN_DIR/config.txt
+
+# 1. instrumented build; stale profiles would not match the new objects
+rm -rf $PGO_DIR
+$WAF configure -d lto --pgo=generate --pgo-dir=$PGO_DIR --out=$OUT "$@"
+$WAF build
+
+# 2. training run
+echo "training run: $TRAIN_DIR/config.txt"
+$OUT/scratch/third $TRAIN_DIR/config.txt > $TRAIN_DIR/log.txt
+echo "profile: $(find $PGO_DIR -name '*.gcda' | wc -l) files in $PGO_DIR"
+
+# 3. optimized build
+$WAF configure -d lto --pgo=use --pgo-dir=$PGO_DIR --out=$OUT "$@"
+$WAF build